@@ -30,6 +30,7 @@ class GenericIndexedCloud;
 class GenericIndexedCloudPersist;
 class GenericIndexedMesh;
 class GenericProgressCallback;
+class NearestNeighboursTable;
 class PointCloud;
 class ReferenceCloud;
 class ReferenceCloudPersist;
@@ -146,7 +147,10 @@ public:
 
 	//! Resamples a point cloud (process based on inter point distance)
 	/** The cloud is resampled so that there is no point nearer than a given distance to other points
-		It works by picking a reference point, removing all points which are to close to this point, and repeating these two steps until the result is reached
+		It works by picking a reference point, removing all points which are to close to this point, and repeating these two steps until the result is reached.
+		The points are processed by octree cells (bigger than the largest neighbourhood radius). Cells that are not
+		adjacent don't share any neighbour, so the cells are processed in parallel, by groups of non-adjacent cells
+		(8 groups, depending on the parity of the cells position). The result doesn't depend on the number of threads.
 		\param cloud the point cloud to resample
 		\param minDistance the distance under which a point in the resulting cloud cannot have any neighbour
 		\param modParams parameters of the subsampling behavior modulation with a scalar field (optional)
@@ -176,8 +180,26 @@ public:
 										DgmOctree* octree = nullptr,
 										GenericProgressCallback* progressCb = nullptr);
 
+	//! Statistical Outliers Removal (SOR) filter based on a precomputed nearest neighbours table
+	/** Same as the other version of CloudSamplingTools::sorFilter, but the neighbours are read from
+		a table that can be shared by several filters (or several runs with different parameters).
+		\param cloud the point cloud to resample
+		\param table nearest neighbours table of the cloud (with at least knn-1 neighbours per point)
+		\param knn number of neighbors (the point itself included, as in PCL)
+		\param nSigma number of sigmas under which the points should be kept
+		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\return a reference cloud corresponding to the filtered cloud
+	**/
+	static ReferenceCloud* sorFilter(	GenericIndexedCloudPersist* cloud,
+										const NearestNeighboursTable& table,
+										int knn,
+										double nSigma,
+										GenericProgressCallback* progressCb = nullptr);
+
 	//! Noise filter based on the distance to the approximate local surface
 	/** This filter removes points based on their distance relatively to the best fit plane computed on their neighbors.
+		In 'knn' mode, the neighbours are extracted in a nearest neighbours table first (see the other version
+		of CloudSamplingTools::noiseFilter).
 		\param cloud the point cloud to resample
 		\param kernelRadius neighborhood radius
 		\param nSigma number of sigmas under which the points should be kept
@@ -201,6 +223,28 @@ public:
 										DgmOctree* octree = nullptr,
 										GenericProgressCallback* progressCb = nullptr);
 
+	//! Noise filter based on a precomputed nearest neighbours table
+	/** Same as the other version of CloudSamplingTools::noiseFilter (in 'knn' mode) but the neighbours
+		are read from a table that can be shared by several filters (or several runs with different parameters).
+		\param cloud the point cloud to resample
+		\param table nearest neighbours table of the cloud (with the neighbours indexes and at least knn-1 neighbours per point)
+		\param knn number of neighbors (the point itself included)
+		\param nSigma number of sigmas under which the points should be kept
+		\param removeIsolatedPoints whether to remove isolated points (i.e. with 3 points or less in the neighborhood)
+		\param useAbsoluteError whether to use an absolute error instead of 'n' sigmas
+		\param absoluteError absolute error (if useAbsoluteError is true)
+		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\return a reference cloud corresponding to the filtered cloud
+	**/
+	static ReferenceCloud* noiseFilter(	GenericIndexedCloudPersist* cloud,
+										const NearestNeighboursTable& table,
+										int knn,
+										double nSigma,
+										bool removeIsolatedPoints = false,
+										bool useAbsoluteError = true,
+										double absoluteError = 0.0,
+										GenericProgressCallback* progressCb = nullptr);
+
 protected:
 
 	//! "Cellular" function to replace one set of points (contained in an octree cell) by a unique point
@@ -1015,6 +1015,9 @@ public:	/***** CELLS POSITION HANDLING *****/
 		(if no points lies in it) or to 1 (if some points lie in it, e.g. if it is indeed a
 		cell of this octree). This version of the algorithm can be applied by considering only
 		a specified list of octree cells (ignoring the others).
+		The cells are merged with a lock-free union-find structure (in parallel if CCLib
+		is compiled with TBB). Components are numbered in the order of their first cell
+		(so the result doesn't depend on the number of threads).
 		\param cellCodes the cell codes to consider for the CC computation
 		\param level the level of subdivision at which to perform the algorithm
 		\param sixConnexity indicates if the CC's 3D connexity should be 6 (26 otherwise)
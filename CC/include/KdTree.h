@@ -29,6 +29,9 @@ class GenericIndexedCloud;
 class GenericProgressCallback;
 
 //! A Kd Tree Class which implements functions related to point to point distance
+/** All the cells are stored in a single contiguous array (allocated once at build time).
+	Once built, the tree is read-only: its query methods can be called concurrently.
+**/
 class CC_CORE_LIB_API KDTree
 {
 public:
@@ -59,14 +62,14 @@ public:
 	**/
 	bool findNearestNeighbour(	const PointCoordinateType *queryPoint,
 								unsigned &nearestPointIndex,
-								ScalarType maxDist);
+								ScalarType maxDist) const;
 
 
 	//! Optimized version of nearest point search method
 	/** Only checks if there is a point p into the tree such that ||p-queryPoint||<=maxDist (see FindNearestNeighbour())
 	**/
 	bool findPointBelowDistance(const PointCoordinateType *queryPoint,
-								ScalarType maxDist);
+								ScalarType maxDist) const;
 
 
 	//! Searches for the points that lie to a given distance (up to a tolerance) from a query point
@@ -79,7 +82,7 @@ public:
 	unsigned findPointsLyingToDistance(const PointCoordinateType *queryPoint,
 										ScalarType distance,
 										ScalarType tolerance,
-										std::vector<unsigned> &points);
+										std::vector<unsigned> &points) const;
 
 protected:
 
@@ -144,6 +147,8 @@ protected:
 
 	//! Tree root
 	KdCell* m_root;
+	//! Cells (contiguous storage)
+	std::vector<KdCell> m_cells;
 	//! Point indexes
 	std::vector<unsigned> m_indexes;
 	//! Associated cloud
@@ -158,14 +163,13 @@ protected:
 	/** \param first first index
 		\param last last index
 		\param father father cell
-		\param nbBuildCell nbBuildCell
 		\param progressCb the client method can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
 		\return sub tree (cell)
 	**/
-	KdCell* buildSubTree(unsigned first, unsigned last, KdCell *father, unsigned &nbBuildCell, GenericProgressCallback *progressCb = nullptr);
+	KdCell* buildSubTree(unsigned first, unsigned last, KdCell *father, GenericProgressCallback *progressCb = nullptr);
 
-	//! Deletes a sub tree
-	void deleteSubTree(KdCell *cell);
+	//! Releases the tree structure
+	void clear();
 
 	//! Computes a cell inside bounding box using the sons ones. The sons bounding boxes have to be up to date considering the points they contain.
 	void updateInsideBoundingBox(KdCell* cell);
@@ -178,14 +182,14 @@ protected:
 		\param cell the cell from which we want to compute the distance
 		\return 0 if the point is inside the cell, the suare of the distance between the two elements if the point is outside
 	**/
-	ScalarType pointToCellSquareDistance(const PointCoordinateType *queryPoint, KdCell *cell);
+	ScalarType pointToCellSquareDistance(const PointCoordinateType *queryPoint, KdCell *cell) const;
 
 	//! Computes the distance between a point and the outside bounding box of the cell in which it lies.
 	/** \param queryPoint the query point coordinates
 		\param cell the cell containting the query point
 		\return the distance between the point and the cell border. If this value is negative, it means that the cell has no border.
 	**/
-	ScalarType InsidePointToCellDistance(const PointCoordinateType *queryPoint, KdCell *cell);
+	ScalarType InsidePointToCellDistance(const PointCoordinateType *queryPoint, KdCell *cell) const;
 
 	//! Computes the distances (min & max) between a point and a cell inside bounding box
 	/** \param queryPoint the query point coordinates
@@ -193,7 +197,7 @@ protected:
 		\param min [out] the minimal distance between the query point and the inside bounding box of cell
 		\param max [out] the maximal distance between the query point and the inside bounding box of cell
 	**/
-	void pointToCellDistances(const PointCoordinateType *queryPoint, KdCell *cell, ScalarType &min, ScalarType &max);
+	void pointToCellDistances(const PointCoordinateType *queryPoint, KdCell *cell, ScalarType &min, ScalarType &max) const;
 
 	//! Checks if there is a point in KdCell that is less than minDist-apart from the query point, starting from cell cell
 	/** \param queryPoint the query Point coordinates
@@ -201,7 +205,7 @@ protected:
 		\param cell kdtree-cell from which to start the research
 		\return -1 if there is no nearer point from querypoint. The nearest point index found in cell if there is one that is at most maxdist apart from querypoint
 	**/
-	int checkNearerPointInSubTree(const PointCoordinateType *queryPoint, ScalarType& maxSqrDist, KdCell *cell);
+	int checkNearerPointInSubTree(const PointCoordinateType *queryPoint, ScalarType& maxSqrDist, KdCell *cell) const;
 
 	//! Checks if there is a point in KdCell that is less than minDist-apart from the query point, starting from cell cell
 	/** Optimiszed version of CheckNearerPointInSubTree since we don't want to find the nearest point, but only check if there is a point that is close enough
@@ -210,7 +214,7 @@ protected:
 		\param cell kdtree-cell from which to start the research
 		\return true if there is a point in the subtree starting at cell that is close enough from the query point
 	**/
-	bool checkDistantPointInSubTree(const PointCoordinateType *queryPoint, ScalarType &maxSqrDist, KdCell *cell);
+	bool checkDistantPointInSubTree(const PointCoordinateType *queryPoint, ScalarType &maxSqrDist, KdCell *cell) const;
 
 	//! Recursive function which store every point lying to a given distance from the query point
 	/** \param queryPoint the query point coordinates
@@ -223,7 +227,7 @@ protected:
 							ScalarType distance, 
 							ScalarType tolerance, 
 							KdCell* cell, 
-							std::vector<unsigned>& localArray);
+							std::vector<unsigned>& localArray) const;
 };
 
 }
@@ -22,9 +22,13 @@
 //Local
 #include "Neighbourhood.h"
 
+//system
+#include <vector>
+
 namespace CCLib
 {
 
+class DgmOctree;
 class GenericIndexedCloud;
 class GenericIndexedCloudPersist;
 class GenericIndexedMesh;
@@ -50,6 +54,103 @@ public:
 	**/
 	static ReferenceCloud* segment(GenericIndexedCloudPersist* aCloud, const Polyline* poly, bool keepInside, const float* viewMat = nullptr);
 
+	//! 2D polygon with its edges sorted by horizontal bands (for fast point-in-polygon tests)
+	/** Only the edges overlapping the band of a given point have to be tested,
+		instead of all the polygon edges. The result is exactly the same as
+		ManualSegmentationTools::isPointInsidePoly.
+	**/
+	class CC_CORE_LIB_API PolygonIndex
+	{
+	public:
+
+		//! Relative position of a 2D rectangle
+		enum RectPosition { RECT_OUTSIDE = 0, RECT_INSIDE = 1, RECT_STRADDLING = 2 };
+
+		//! Default constructor
+		PolygonIndex();
+
+		//! Initializes the structure from polygon vertices (considered as ordered 2D polyline vertices)
+		/** \param polyVertices polygon vertices
+			\param bandCount number of bands (0 = automatic)
+			\return false if there's not enough memory
+		**/
+		bool init(const std::vector<CCVector2>& polyVertices, unsigned bandCount = 0);
+
+		//! Initializes the structure from a polyline (only the X and Y coordinates of its vertices are considered)
+		bool init(const GenericIndexedCloud* polyVertices, unsigned bandCount = 0);
+
+		//! Tests if a point is inside the polygon
+		bool isPointInside(const CCVector2& P) const;
+
+		//! Determines whether a 2D rectangle is inside, outside or straddles the polygon border
+		RectPosition classifyRect(const CCVector2& rectMin, const CCVector2& rectMax) const;
+
+	protected:
+
+		//! Returns the band corresponding to a given Y coordinate
+		inline unsigned bandIndex(PointCoordinateType y) const
+		{
+			PointCoordinateType relPos = (y - m_min.y) / m_bandHeight;
+			if (relPos < 0)
+				return 0;
+			unsigned index = static_cast<unsigned>(relPos);
+			return (index < m_bandCount ? index : m_bandCount - 1);
+		}
+
+		//! Polygon vertices
+		std::vector<CCVector2> m_vertices;
+		//! Per-band offsets in the m_bandEdges array (size = band count + 1)
+		std::vector<unsigned> m_bandOffsets;
+		//! Edges overlapping each band (edge i goes from vertex i-1 to vertex i % vertex count)
+		std::vector<unsigned> m_bandEdges;
+		//! Polygon bounding box
+		CCVector2 m_min, m_max;
+		//! Number of bands
+		unsigned m_bandCount;
+		//! Height of each band
+		PointCoordinateType m_bandHeight;
+	};
+
+	//! Generic 3D to 2D projection (see ManualSegmentationTools::segment)
+	class CC_CORE_LIB_API Projector
+	{
+	public:
+		//! Default destructor
+		virtual ~Projector() = default;
+
+		//! Projects a 3D point in 2D
+		virtual CCVector2 project(const CCVector3& P) const = 0;
+
+		//! Returns whether the projection of a 3D box is contained in the 2D bounding box of its projected corners
+		/** This is always the case for affine projections, but not for perspective
+			projections if a part of the box lies behind the camera.
+		**/
+		virtual bool isBoxProjectable(const CCVector3& /*bbMin*/, const CCVector3& /*bbMax*/) const { return true; }
+	};
+
+	//! Segments the points of a cloud with a 2D polygon once projected (in place)
+	/** If an octree is provided, the projected bounding boxes of its cells are tested
+		first (from the biggest to the smallest ones). The points of the cells that are
+		completely inside or outside of the polygon are processed at once, and only the
+		points of the cells straddling the polygon border are tested individually.
+		Otherwise all the points are tested. In both cases the process is parallel (if possible).
+		\param cloud the cloud to segment
+		\param polygon the polygon
+		\param projector 3D to 2D projection
+		\param keepInside if true (resp. false), the points falling inside (resp. outside) the polygon will be kept
+		\param visibility points visibility (same size as the cloud): only the POINT_VISIBLE points are tested, and the ones that are not kept are set to POINT_HIDDEN
+		\param octree optional octree (must have been computed on the cloud)
+		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
+		\return false if the process has been canceled or if the input is invalid
+	**/
+	static bool segment(GenericIndexedCloudPersist* cloud,
+						const PolygonIndex& polygon,
+						const Projector& projector,
+						bool keepInside,
+						std::vector<unsigned char>& visibility,
+						DgmOctree* octree = nullptr,
+						GenericProgressCallback* progressCb = nullptr);
+
 	//! Selects the points which associated scalar value fall inside or outside a specified interval
 	/** \warning: be sure to activate an OUTPUT scalar field on the input cloud
 		\param cloud the cloud to segment
@@ -0,0 +1,140 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 or later of the  #
+//#  License.                                                              #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef MESH_ADJACENCY_HEADER
+#define MESH_ADJACENCY_HEADER
+
+//Local
+#include "CCCoreLib.h"
+
+//system
+#include <cassert>
+#include <vector>
+
+namespace CCLib
+{
+
+class GenericIndexedMesh;
+
+//! Compact adjacency structure of a triangular mesh
+/** All the information is stored in flat arrays:
+	- the unique edges of the mesh, sorted by key (see MeshAdjacency::ComputeEdgeKey),
+	along with the number of triangles using each of them
+	- the triangles using each vertex (CSR layout)
+	- the (edge) neighbours of each vertex (CSR layout)
+
+	The structure is built once by sorting the edge keys (in parallel if
+	possible) and can then be shared by the various mesh algorithms
+	(connectivity statistics, smoothing, subdivision, etc.). It must be
+	built again if the mesh triangles are modified.
+**/
+class CC_CORE_LIB_API MeshAdjacency
+{
+public:
+
+	//! Default constructor
+	MeshAdjacency();
+
+	//! Builds the structure from a mesh
+	/** \param mesh triangular mesh
+		\param vertexCount number of vertices (if 0, it will be deduced from the triangle indexes)
+		\return false if the input is invalid (i.e. a vertex index is out of range) or if there's not enough memory
+	**/
+	bool build(GenericIndexedMesh* mesh, unsigned vertexCount = 0);
+
+	//! Clears the structure
+	void clear();
+
+	//! Returns whether the structure has been built
+	inline bool isValid() const { return m_valid; }
+
+	//! Returns the number of vertices
+	inline unsigned vertexCount() const { return m_vertexCount; }
+	//! Returns the number of triangles
+	inline unsigned triangleCount() const { return m_triangleCount; }
+	//! Returns the number of (unique) edges
+	inline unsigned edgeCount() const { return static_cast<unsigned>(m_edgeKeys.size()); }
+
+	//! Computes the unique key corresponding to an edge
+	/** Edges are represented by two 32 bits indexes merged as a 64 bits integer
+		(the biggest index being stored in the upper bits).
+	**/
+	static inline unsigned long long ComputeEdgeKey(unsigned i1, unsigned i2)
+	{
+		return	i1 < i2
+				? ((static_cast<unsigned long long>(i2) << 32) | static_cast<unsigned long long>(i1))
+				: ((static_cast<unsigned long long>(i1) << 32) | static_cast<unsigned long long>(i2));
+	}
+	//! Computes the edge vertex indexes from its unique key
+	static inline void DecodeEdgeKey(unsigned long long key, unsigned& i1, unsigned& i2)
+	{
+		i1 = static_cast<unsigned>(  key        & 0x00000000FFFFFFFF );
+		i2 = static_cast<unsigned>( (key >> 32) & 0x00000000FFFFFFFF );
+	}
+
+	//! Returns the key of a given edge (edges are sorted by increasing key)
+	inline unsigned long long edgeKey(unsigned edgeIndex) const { assert(edgeIndex < m_edgeKeys.size()); return m_edgeKeys[edgeIndex]; }
+	//! Returns the number of triangles using a given edge
+	inline unsigned edgeTriangleCount(unsigned edgeIndex) const { assert(edgeIndex < m_edgeTriCounts.size()); return m_edgeTriCounts[edgeIndex]; }
+	//! Returns the index of the edge between two vertices
+	/** \return the edge index or -1 if the two vertices are not connected
+	**/
+	int findEdge(unsigned i1, unsigned i2) const;
+
+	//! Returns the number of triangles using a given vertex
+	inline unsigned vertexTriangleCount(unsigned vertexIndex) const { assert(vertexIndex < m_vertexCount); return m_vertTriOffsets[vertexIndex + 1] - m_vertTriOffsets[vertexIndex]; }
+	//! Returns the (sorted) indexes of the triangles using a given vertex
+	/** See MeshAdjacency::vertexTriangleCount
+	**/
+	inline const unsigned* vertexTriangles(unsigned vertexIndex) const { assert(vertexIndex < m_vertexCount); return m_vertTriangles.data() + m_vertTriOffsets[vertexIndex]; }
+
+	//! Returns the number of neighbours of a given vertex (i.e. the number of edges using it)
+	inline unsigned vertexNeighbourCount(unsigned vertexIndex) const { assert(vertexIndex < m_vertexCount); return m_vertNeighOffsets[vertexIndex + 1] - m_vertNeighOffsets[vertexIndex]; }
+	//! Returns the (sorted) indexes of the neighbours of a given vertex
+	/** See MeshAdjacency::vertexNeighbourCount
+	**/
+	inline const unsigned* vertexNeighbours(unsigned vertexIndex) const { assert(vertexIndex < m_vertexCount); return m_vertNeighbours.data() + m_vertNeighOffsets[vertexIndex]; }
+
+protected:
+
+	//! Unique edges keys (sorted)
+	std::vector<unsigned long long> m_edgeKeys;
+	//! Number of triangles using each edge
+	std::vector<unsigned> m_edgeTriCounts;
+
+	//! Per-vertex offsets in the m_vertTriangles array (size = vertex count + 1)
+	std::vector<unsigned> m_vertTriOffsets;
+	//! Triangles using each vertex
+	std::vector<unsigned> m_vertTriangles;
+
+	//! Per-vertex offsets in the m_vertNeighbours array (size = vertex count + 1)
+	std::vector<unsigned> m_vertNeighOffsets;
+	//! Neighbours of each vertex
+	std::vector<unsigned> m_vertNeighbours;
+
+	//! Number of vertices
+	unsigned m_vertexCount;
+	//! Number of triangles
+	unsigned m_triangleCount;
+	//! Whether the structure has been built
+	bool m_valid;
+};
+
+}
+
+#endif //MESH_ADJACENCY_HEADER
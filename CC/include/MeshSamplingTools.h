@@ -23,7 +23,6 @@
 #include "CCToolbox.h"
 
 //system
-#include <map>
 #include <vector>
 
 namespace CCLib
@@ -32,6 +31,7 @@ namespace CCLib
 class GenericProgressCallback;
 class GenericMesh;
 class GenericIndexedMesh;
+class MeshAdjacency;
 class PointCloud;
 class ScalarField;
 
@@ -84,6 +84,14 @@ public:
 	**/
 	static bool computeMeshEdgesConnectivity(GenericIndexedMesh* mesh, EdgeConnectivityStats& stats);
 
+	//! Computes some statistics on the edges connectivty of a mesh (from its adjacency structure)
+	/** See MeshSamplingTools::computeMeshEdgesConnectivity.
+		\param[in] adjacency mesh adjacency structure (already built)
+		\param[out] stats output statistics
+		\return false if the adjacency structure is invalid
+	**/
+	static bool computeMeshEdgesConnectivity(const MeshAdjacency& adjacency, EdgeConnectivityStats& stats);
+
 	//! Flags used by the MeshSamplingTools::flagMeshVerticesByType method.
 	enum VertexFlags
 	{
@@ -101,6 +109,15 @@ public:
 	**/
 	static bool flagMeshVerticesByType(GenericIndexedMesh* mesh, ScalarField* flags, EdgeConnectivityStats* stats = nullptr);
 
+	//! Flags the vertices of a mesh depending on their type (from its adjacency structure)
+	/** See MeshSamplingTools::flagMeshVerticesByType.
+		\param[in] adjacency mesh adjacency structure (already built)
+		\param[in] flags already allocated scalar field to store the per-vertex flags
+		\param[out] stats output statistics (optional)
+		\return false if an error occurred (invalid input)
+	**/
+	static bool flagMeshVerticesByType(const MeshAdjacency& adjacency, ScalarField* flags, EdgeConnectivityStats* stats = nullptr);
+
 	//! Samples points on a mesh
 	/** The points are sampled on each triangle randomly, by generating
 		two numbers between 0 and 1 (a and b). If a+b > 1, then a = 1-a and
@@ -113,61 +130,60 @@ public:
 		handled by generating another random number between 0 and 1.
 		If this number is less than Nf, then Ni = Ni+1. The number of points
 		sampled on the triangle will simply be Ni.
+
+		The triangles are processed in two (parallel) passes: the number of points
+		of each triangle is computed first, then the points are generated directly
+		at their final position in the output cloud. The random numbers of each
+		triangle are drawn from a deterministic stream (derived from the seed and
+		the triangle index), so that the result only depends on the seed.
 		\param mesh the mesh to be sampled
 		\param samplingDensity the sampling surface density
 		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
 		\param[out] triIndices triangle index for each samples point (output only - optional)
+		\param randomSeed random seed (0 = random)
 		\return the sampled points
 	**/
 	static PointCloud* samplePointsOnMesh(	GenericMesh* mesh,
 											double samplingDensity,
 											GenericProgressCallback* progressCb = nullptr,
-											std::vector<unsigned>* triIndices = nullptr);
-
+											std::vector<unsigned>* triIndices = nullptr,
+											unsigned randomSeed = 0);
 	//! Samples points on a mesh
 	/** See the other version of this method. Instead of specifying a
 		density, it is possible here to specify the total number of
-		points to sample (approximative).
+		points to sample (exact). The fractional parts of the per-triangle
+		numbers of points are distributed by systematic sampling so that
+		the total matches the requested number of points.
 		\param mesh the mesh to be sampled
 		\param numberOfPoints the desired number of points on the whole mesh
 		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
 		\param[out] triIndices triangle index for each samples point (output only - optional)
+		\param randomSeed random seed (0 = random)
 		\return the sampled points
 	**/
 	static PointCloud* samplePointsOnMesh(	GenericMesh* mesh,
 											unsigned numberOfPoints,
 											GenericProgressCallback* progressCb = nullptr,
-											std::vector<unsigned>* triIndices = nullptr);
-
+											std::vector<unsigned>* triIndices = nullptr,
+											unsigned randomSeed = 0);
 protected:
 
 	//! Samples points on a mesh - internal method
 	/** See public methods descriptions
 		\param mesh the mesh to be sampled
 		\param samplingDensity the sampling surfacical density
-		\param theoreticNumberOfPoints the approximated number of points that will be sampled
+		\param exactNumberOfPoints the exact number of points to sample (or 0 to only rely on the density)
+		\param randomSeed random seed (0 = random)
 		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
 		\param[out] triIndices triangle index for each samples point (output only - optional)
 		\return the sampled points
 	**/
 	static PointCloud* samplePointsOnMesh(	GenericMesh* mesh,
 											double samplingDensity,
-											unsigned theoreticNumberOfPoints,
+											unsigned exactNumberOfPoints,
+											unsigned randomSeed,
 											GenericProgressCallback* progressCb = nullptr,
 											std::vector<unsigned>* triIndices = nullptr);
-
-	//! Map used to count the number of triangles using each edge
-	/** Edges are represented by two 32 bits indexes merged as a 64 integer
-	**/
-	using EdgeUsageMap = std::map<unsigned long long, unsigned>;
-
-	//! Computes the unique key corresponding to an edge
-	static unsigned long long ComputeEdgeKey(unsigned i1, unsigned i2);
-	//! Computes the edge vertex indexes from its unique key
-	static void DecodeEdgeKey(unsigned long long key, unsigned& i1, unsigned& i2);
-
-	//! Creates a map to count the number of triangles using each edge
-	static bool buildMeshEdgeUsageMap(GenericIndexedMesh* mesh, EdgeUsageMap& edgeMap);
 };
 
 }
@@ -0,0 +1,110 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 or later of the  #
+//#  License.                                                              #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef NEAREST_NEIGHBOURS_TABLE_HEADER
+#define NEAREST_NEIGHBOURS_TABLE_HEADER
+
+//Local
+#include "DgmOctree.h"
+
+//system
+#include <cassert>
+#include <vector>
+
+namespace CCLib
+{
+
+class GenericIndexedCloudPersist;
+class GenericProgressCallback;
+
+//! Compact table of the k nearest neighbours of each point of a cloud
+/** For each point, the k nearest neighbours (the point itself excluded) are
+	stored by increasing distance in flat arrays: their distances (as floats)
+	and optionally their indexes.
+
+	The table is computed once (in parallel) and can then be shared by several
+	filters or by several runs of the same filter with different parameters
+	(see CloudSamplingTools::sorFilter and CloudSamplingTools::noiseFilter).
+	Any filter working with n neighbours (the point itself included, as in PCL)
+	only needs the first n-1 entries of each row.
+	The table must be computed again if the cloud is modified.
+**/
+class CC_CORE_LIB_API NearestNeighboursTable
+{
+public:
+
+	//! Default constructor
+	NearestNeighboursTable();
+
+	//! Computes the table
+	/** \param cloud point cloud (must have more than k points)
+		\param k number of neighbours per point (the point itself excluded)
+		\param storeIndexes whether to store the neighbours indexes (otherwise only the distances are stored)
+		\param octree the cloud octree (if already computed)
+		\param progressCb optional progress callback
+		\return false if the input is invalid, if the process was cancelled or if there's not enough memory
+	**/
+	bool compute(	GenericIndexedCloudPersist* cloud,
+					unsigned k,
+					bool storeIndexes = true,
+					DgmOctree* octree = nullptr,
+					GenericProgressCallback* progressCb = nullptr);
+
+	//! Clears the table
+	void clear();
+
+	//! Returns whether the table has been computed
+	inline bool isValid() const { return m_k != 0; }
+
+	//! Returns the number of points
+	inline unsigned pointCount() const { return m_pointCount; }
+	//! Returns the number of neighbours per point
+	inline unsigned k() const { return m_k; }
+	//! Returns whether the neighbours indexes are stored
+	inline bool hasIndexes() const { return !m_indexes.empty(); }
+
+	//! Returns the distances to the k nearest neighbours of a given point (by increasing distance)
+	inline const float* neighbourDistances(unsigned pointIndex) const { assert(pointIndex < m_pointCount); return m_distances.data() + static_cast<size_t>(pointIndex) * m_k; }
+	//! Returns the indexes of the k nearest neighbours of a given point (by increasing distance)
+	/** \warning Only available if the table was computed with 'storeIndexes = true'
+	**/
+	inline const unsigned* neighbourIndexes(unsigned pointIndex) const { assert(pointIndex < m_pointCount && hasIndexes()); return m_indexes.data() + static_cast<size_t>(pointIndex) * m_k; }
+
+	//! Returns the memory used by the table (in bytes)
+	inline size_t memoryUsage() const { return m_distances.capacity() * sizeof(float) + m_indexes.capacity() * sizeof(unsigned); }
+
+protected:
+
+	//! "Cellular" function to extract the nearest neighbours of the points of an octree cell
+	static bool ComputeCellNeighbours(	const DgmOctree::octreeCell& cell,
+										void** additionalParameters,
+										NormalizedProgress* nProgress = nullptr);
+
+	//! Neighbours distances (k per point)
+	std::vector<float> m_distances;
+	//! Neighbours indexes (k per point, optional)
+	std::vector<unsigned> m_indexes;
+	//! Number of points
+	unsigned m_pointCount;
+	//! Number of neighbours per point
+	unsigned m_k;
+};
+
+}
+
+#endif //NEAREST_NEIGHBOURS_TABLE_HEADER
@@ -0,0 +1,103 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 or later of the  #
+//#  License.                                                              #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_PROFILER_HEADER
+#define CC_PROFILER_HEADER
+
+//Local
+#include "CCCoreLib.h"
+
+//system
+#include <chrono>
+
+namespace CCLib
+{
+
+//! Lightweight profiling hook
+/** The main phases of the library algorithms (octree computation, cell
+	functions, etc.) are reported to the current sink (if any). When no sink
+	is set (default), a phase only costs an atomic read.
+**/
+class CC_CORE_LIB_API Profiler
+{
+public:
+
+	//! Clock used to time the phases
+	using Clock = std::chrono::steady_clock;
+
+	//! Profiling sink interface
+	/** Warning: phases may be reported concurrently by several threads.
+	**/
+	class Sink
+	{
+	public:
+		//! Destructor
+		virtual ~Sink() = default;
+
+		//! Reports a (complete) phase
+		/** \param name phase name (only valid during the call)
+			\param start phase start time
+			\param stop phase stop time
+		**/
+		virtual void addPhase(const char* name, Clock::time_point start, Clock::time_point stop) = 0;
+	};
+
+	//! Sets the current sink (or none if null)
+	/** The sink must outlive any running algorithm.
+	**/
+	static void SetSink(Sink* sink);
+
+	//! Returns the current sink (if any)
+	static Sink* GetSink();
+
+	//! Scoped phase
+	class Scope
+	{
+	public:
+		//! Starts the phase
+		/** \param name phase name (must remain valid until the end of the phase)
+		**/
+		explicit Scope(const char* name)
+			: m_sink(GetSink())
+			, m_name(name)
+		{
+			if (m_sink)
+				m_start = Clock::now();
+		}
+
+		//! Stops the phase
+		~Scope()
+		{
+			if (m_sink)
+				m_sink->addPhase(m_name, m_start, Clock::now());
+		}
+
+	protected:
+
+		//! Sink (captured at construction time)
+		Sink* m_sink;
+		//! Phase name
+		const char* m_name;
+		//! Phase start time
+		Clock::time_point m_start;
+	};
+};
+
+}
+
+#endif //CC_PROFILER_HEADER
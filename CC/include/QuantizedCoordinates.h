@@ -0,0 +1,151 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 or later of the  #
+//#  License.                                                              #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef QUANTIZED_COORDINATES_HEADER
+#define QUANTIZED_COORDINATES_HEADER
+
+//Local
+#include "CCGeom.h"
+
+//system
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace CCLib
+{
+
+class GenericIndexedCloud;
+
+//! Compact (quantized) storage of point coordinates
+/** As in LAS files, each coordinate is stored as an integer: P = offset + scale * Q.
+	The points are then grouped by blocks (of BLOCK_SIZE points): each block only
+	stores the differences to its minimum integer coordinates, bit-packed with as
+	many bits as required by the block extent along each dimension.
+
+	The footprint depends on the scale and on the spatial coherence of the points
+	(e.g. scan order). Any point can be decoded in constant time, and whole blocks
+	can be decoded (concurrently) in a buffer of floating point coordinates, which
+	is how algorithms and rendering should access the points.
+**/
+class CC_CORE_LIB_API QuantizedCoordinates
+{
+public:
+
+	//! Number of points per block
+	static const unsigned BLOCK_SIZE = 4096;
+
+	//! Default constructor
+	QuantizedCoordinates();
+
+	//! Encodes the points of a cloud
+	/** \param cloud input cloud
+		\param scale quantization step along each dimension (e.g. 0.001 for millimetres)
+		\param offset coordinates origin (if null, the minimum corner of the cloud bounding-box is used)
+		\return false if the input is invalid, if the quantized coordinates overflow 32 bits integers or if there's not enough memory
+	**/
+	bool encode(const GenericIndexedCloud* cloud, const CCVector3d& scale, const CCVector3d* offset = nullptr);
+
+	//! Encodes an array of points
+	/** See the other version of this method.
+	**/
+	bool encode(const CCVector3* points, unsigned count, const CCVector3d& scale, const CCVector3d* offset = nullptr);
+
+	//! Clears the structure
+	void clear();
+
+	//! Returns the number of points
+	inline unsigned size() const { return m_count; }
+	//! Returns the number of blocks
+	inline unsigned blockCount() const { return static_cast<unsigned>(m_blocks.size()); }
+	//! Returns the number of points of a given block
+	inline unsigned blockPointCount(unsigned blockIndex) const { return (blockIndex + 1 < blockCount() ? BLOCK_SIZE : m_count - blockIndex * BLOCK_SIZE); }
+
+	//! Returns the quantization step along each dimension
+	inline const CCVector3d& scale() const { return m_scale; }
+	//! Returns the coordinates origin
+	inline const CCVector3d& offset() const { return m_offset; }
+
+	//! Decodes one point
+	void getPoint(unsigned index, CCVector3& P) const;
+
+	//! Decodes one block of points
+	/** Thread-safe (blocks can be decoded concurrently).
+		\param blockIndex block index
+		\param[out] points output buffer (at least blockPointCount(blockIndex) points)
+	**/
+	void decodeBlock(unsigned blockIndex, CCVector3* points) const;
+
+	//! Decodes all the points (in parallel)
+	/** \param[out] points output buffer (at least size() points)
+	**/
+	void decode(CCVector3* points) const;
+
+	//! Returns the memory used by the structure (in bytes)
+	std::size_t memoryUsage() const;
+
+	//! Block descriptor
+	struct Block
+	{
+		//! Minimum quantized coordinates of the block points
+		std::int32_t base[3];
+		//! Number of bits per dimension
+		unsigned char bits[3];
+		//! Index of the first word of the block in the bit stream
+		std::size_t firstWord;
+	};
+
+	//! Returns the blocks descriptors (e.g. to save them)
+	inline const std::vector<Block>& blocks() const { return m_blocks; }
+	//! Returns the bit-packed coordinates (e.g. to save them)
+	inline const std::vector<std::uint64_t>& stream() const { return m_stream; }
+
+	//! Restores the structure from its raw content (e.g. loaded from a file)
+	/** The blocks layout (Block::firstWord) is recomputed from their numbers of bits.
+		\param count number of points
+		\param scale quantization step along each dimension
+		\param offset coordinates origin
+		\param blocks blocks descriptors (swapped with the structure content)
+		\param stream bit-packed coordinates (swapped with the structure content)
+		\return false if the content is inconsistent
+	**/
+	bool assign(unsigned count, const CCVector3d& scale, const CCVector3d& offset, std::vector<Block>& blocks, std::vector<std::uint64_t>& stream);
+
+protected:
+
+	//! Encodes points given by an accessor (void operator()(unsigned, CCVector3&))
+	template <class PointAccessor> bool encodeFrom(const PointAccessor& pointAt, unsigned count, const CCVector3d& scale, const CCVector3d* offset);
+
+	//! Decodes the quantized coordinates of one point of a block
+	inline void decodeQuantized(const Block& block, unsigned indexInBlock, std::int64_t Q[3]) const;
+
+	//! Blocks
+	std::vector<Block> m_blocks;
+	//! Bit-packed coordinates (the blocks start on word boundaries)
+	std::vector<std::uint64_t> m_stream;
+	//! Quantization step
+	CCVector3d m_scale;
+	//! Coordinates origin
+	CCVector3d m_offset;
+	//! Number of points
+	unsigned m_count;
+};
+
+}
+
+#endif //QUANTIZED_COORDINATES_HEADER
@@ -251,6 +251,7 @@ public:
         \param nbTries number of tries to find a base in the reference cloud
 		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
         \param nbMaxCandidates if>0, maximal number of candidate bases allowed for each step. Otherwise the number of candidates is not bounded
+        \param randomSeed seed of the random bases selection (if 0, the current time is used). For a given seed, the result is always the same (whatever the number of threads)
 		\return false: failure ; true: success.
     **/
     static bool RegisterClouds(	GenericIndexedCloud* modelCloud,
@@ -262,7 +263,8 @@ public:
                                 unsigned nbBases,
                                 unsigned nbTries,
                                 GenericProgressCallback* progressCb = nullptr,
-                                unsigned nbMaxCandidates = 0);
+                                unsigned nbMaxCandidates = 0,
+                                unsigned randomSeed = 0);
 
 protected:
 
@@ -294,7 +296,7 @@ protected:
         \param results the resulting bases
         \return the number of bases found (number of element in the results array) or -1 is a problem occurred
     **/
-    static int FindCongruentBases(	KDTree* tree,
+    static int FindCongruentBases(	const KDTree* tree,
 									ScalarType delta,
 									const CCVector3* base[4],
 									std::vector<Base>& results);
@@ -307,7 +309,7 @@ protected:
         \param delta tolerance above which data points are not counted (if a point is less than delta-apart from the model cloud, then it is counted)
         \return the number of data points which are distance-apart from the model cloud
     **/
-    static unsigned ComputeRegistrationScore(	KDTree *modelTree,
+    static unsigned ComputeRegistrationScore(	const KDTree *modelTree,
 												GenericIndexedCloud *dataCloud,
 												ScalarType delta,
 												const ScaledTransformation& dataToModel);
@@ -22,6 +22,7 @@
 //Local
 #include "CCConst.h"
 #include "CCShareable.h"
+#include "ScalarFieldStatistics.h"
 
 //System
 #include <vector>
@@ -61,14 +62,36 @@ public:
 	static inline ScalarType NaN() { return NAN_VALUE; }
 
 	//! Computes the mean value (and optionally the variance value) of the scalar field
-	/** \param mean a field to store the mean value
+	/** Always computed from the current values (in parallel if possible): the cached
+		statistics can't tell whether the values have been changed since they were computed.
+		\param mean a field to store the mean value
 		\param variance if not void, the variance will be computed and stored here
 	**/
 	CC_CORE_LIB_API void computeMeanAndVariance(ScalarType &mean, ScalarType* variance = nullptr) const;
 
 	//! Determines the min and max values
+	/** The other statistics (mean, variance, etc.) are computed and cached at the same time.
+	**/
 	CC_CORE_LIB_API virtual void computeMinAndMax();
 
+	//! Computes (and caches) the statistics of the scalar field
+	/** The min and max values are updated as well.
+		\param histogramClasses number of histogram classes (0 = no histogram)
+		\return false if there's not enough memory
+	**/
+	CC_CORE_LIB_API bool computeStatistics(unsigned histogramClasses = 0);
+
+	//! Returns the cached statistics
+	/** They are computed by computeMinAndMax or computeStatistics, and only updated
+		afterwards by updateValue.
+	**/
+	inline const ScalarFieldStatistics& getStatistics() const { return m_statistics; }
+
+	//! Changes a value and updates the cached statistics incrementally
+	/** \warning Not thread-safe. To change many values, prefer setValue then computeMinAndMax.
+	**/
+	CC_CORE_LIB_API virtual void updateValue(std::size_t index, ScalarType value);
+
 	//! Returns whether a scalar value is valid or not
 	static inline bool ValidValue(ScalarType value) { return value == value; } //'value == value' fails for NaN values
 
@@ -112,6 +135,9 @@ protected: //members
 	ScalarType m_minVal;
 	//! Maximum value
 	ScalarType m_maxVal;
+
+	//! Cached statistics
+	ScalarFieldStatistics m_statistics;
 };
 
 }
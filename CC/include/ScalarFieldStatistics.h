@@ -0,0 +1,163 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 or later of the  #
+//#  License.                                                              #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef SCALAR_FIELD_STATISTICS_HEADER
+#define SCALAR_FIELD_STATISTICS_HEADER
+
+//Local
+#include "CCConst.h"
+#include "CCCoreLib.h"
+
+//system
+#include <cstddef>
+#include <vector>
+
+namespace CCLib
+{
+
+class GenericCloud;
+
+//! Statistics of a set of scalar values (invalid values are ignored)
+/** The number of valid values, the extremas, the mean and the variance are
+	computed in a single (parallel) pass. An histogram can be computed at the
+	same time: it requires a second (parallel) pass as its classes depend on the
+	extremas. The histogram is also used to estimate quantiles.
+
+	The statistics can then be updated incrementally when a few values change
+	(see updateValue).
+**/
+class CC_CORE_LIB_API ScalarFieldStatistics
+{
+public:
+
+	//! Default constructor
+	ScalarFieldStatistics();
+
+	//! Computes the statistics of an array of values
+	/** \param values scalar values
+		\param count number of values
+		\param histogramClasses number of histogram classes (0 = no histogram)
+		\return false if there's not enough memory
+	**/
+	bool compute(const ScalarType* values, std::size_t count, unsigned histogramClasses = 0);
+
+	//! Computes the statistics of the scalar values of a cloud
+	/** See the other version of this method.
+	**/
+	bool compute(const GenericCloud* cloud, unsigned histogramClasses = 0);
+
+	//! Clears the statistics
+	void clear();
+
+	//! Updates the statistics after one value has changed
+	/** The number of valid values, the mean and the variance are updated exactly.
+		The histogram is updated if the new value lies inside its range (otherwise
+		it is cleared). The extremas are extended if necessary, but if the previous
+		value was one of them they may now be overestimated (see extremasAreExact).
+		\param previousValue previous value (may be invalid)
+		\param newValue new value (may be invalid)
+	**/
+	void updateValue(ScalarType previousValue, ScalarType newValue);
+
+	//! Returns whether the statistics have been computed
+	inline bool isValid() const { return m_valid; }
+	//! Returns the number of values (including the invalid ones)
+	inline std::size_t valueCount() const { return m_valueCount; }
+	//! Returns the number of valid values
+	inline std::size_t validCount() const { return m_validCount; }
+
+	//! Returns the minimum value (0 if there's no valid value)
+	inline ScalarType minValue() const { return m_minVal; }
+	//! Returns the maximum value (0 if there's no valid value)
+	inline ScalarType maxValue() const { return m_maxVal; }
+	//! Returns whether the extremas are exact (see updateValue)
+	inline bool extremasAreExact() const { return m_exactExtremas; }
+
+	//! Returns the mean value
+	double mean() const;
+	//! Returns the variance
+	double variance() const;
+
+	//! Returns the histogram (may be empty)
+	/** Its classes regularly span [histogramMin ; histogramMax].
+	**/
+	inline const std::vector<unsigned>& histogram() const { return m_histogram; }
+	//! Returns the lower bound of the histogram
+	inline ScalarType histogramMin() const { return m_histoMin; }
+	//! Returns the upper bound of the histogram
+	inline ScalarType histogramMax() const { return m_histoMax; }
+
+	//! Estimates a quantile from the histogram
+	/** The value is linearly interpolated inside the histogram class that contains
+		the quantile, so the error is less than the size of one class.
+		\param q quantile (between 0 and 1, e.g. 0.5 for the median)
+		\param[out] value estimated value
+		\return false if there's no histogram (or no valid value)
+	**/
+	bool estimateQuantile(double q, double& value) const;
+
+	//! Computes the histogram of an array of values (in parallel)
+	/** The classes regularly span [minV ; maxV]. Values outside of this range are ignored.
+		\param values scalar values
+		\param count number of values
+		\param minV histogram lower bound
+		\param maxV histogram upper bound
+		\param[out] histo histogram (its size must be the number of classes)
+		\return false if there's not enough memory
+	**/
+	static bool ComputeHistogram(	const ScalarType* values,
+									std::size_t count,
+									ScalarType minV,
+									ScalarType maxV,
+									std::vector<unsigned>& histo);
+
+protected:
+
+	//! Computes the statistics of values given by an accessor (ScalarType operator()(std::size_t))
+	template <class ValueAccessor> bool computeFrom(const ValueAccessor& valueAt, std::size_t count, unsigned histogramClasses);
+
+	//! Returns the histogram class of a value (inside the histogram range)
+	std::size_t histogramClass(ScalarType value) const;
+
+	//! Number of values
+	std::size_t m_valueCount;
+	//! Number of valid values
+	std::size_t m_validCount;
+	//! Sum of the valid values
+	double m_sum;
+	//! Sum of the squared valid values
+	double m_sumSquare;
+	//! Minimum value
+	ScalarType m_minVal;
+	//! Maximum value
+	ScalarType m_maxVal;
+	//! Histogram
+	std::vector<unsigned> m_histogram;
+	//! Histogram lower bound
+	ScalarType m_histoMin;
+	//! Histogram upper bound
+	ScalarType m_histoMax;
+	//! Whether the extremas are exact
+	bool m_exactExtremas;
+	//! Whether the statistics are valid
+	bool m_valid;
+};
+
+}
+
+#endif //SCALAR_FIELD_STATISTICS_HEADER
@@ -120,8 +120,9 @@ protected:
 		- (GenericDistribution*) the theoretical noise distribution
 		- (int) the size of a neighbourhood for local analysis
 		- (int) the number of classes for the Chi2 distance computation
-		- (unsigned*) a pre-allocated array (of a size equal to the number of classes)for computation acceleration
-		- (bool) specifies whether negative values should be included in computation
+		- (double*) the pre-computed probability of each class (if the histogram bounds are fixed) or null
+		- (ScalarType*) the minimum histogram value (or null)
+		- (ScalarType*) the maximum histogram value (or null)
 		\param cell structure describing the cell on which processing is applied
 		\param additionalParameters see method description
 		\param nProgress optional (normalized) progress notification (per-point)
@@ -22,6 +22,7 @@
 #include <DistanceComputationTools.h>
 #include <DgmOctreeReferenceCloud.h>
 #include <GenericProgressCallback.h>
+#include <NearestNeighboursTable.h>
 #include <Neighbourhood.h>
 #include <PointCloud.h>
 #include <ReferenceCloud.h>
@@ -31,10 +32,180 @@
 
 //system
 #include <algorithm>
+#include <atomic>
+#include <memory>
 #include <random>
 
+#ifdef USE_TBB
+#include <tbb/parallel_for.h>
+#endif
+
 using namespace CCLib;
 
+//number of points processed by each task (filters and statistics)
+static const unsigned s_filterChunkSize = (1 << 16);
+
+//! Computes the mean and the standard deviation of a set of values
+/** The partial sums are computed in parallel (by chunks) and then added
+	in a fixed order, so that the result doesn't depend on the number of threads.
+**/
+static bool ComputeMeanAndStdDev(const std::vector<PointCoordinateType>& values, double& mean, double& stdDev)
+{
+	unsigned count = static_cast<unsigned>(values.size());
+	if (count == 0)
+	{
+		return false;
+	}
+
+	int chunkCount = static_cast<int>((count + s_filterChunkSize - 1) / s_filterChunkSize);
+	std::vector<double> partialSums, partialSquareSums;
+	try
+	{
+		partialSums.resize(chunkCount, 0);
+		partialSquareSums.resize(chunkCount, 0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+
+#ifdef USE_TBB
+	tbb::parallel_for(0, chunkCount, [&](int c)
+#else
+	for (int c = 0; c < chunkCount; ++c)
+#endif
+	{
+		unsigned first = static_cast<unsigned>(c) * s_filterChunkSize;
+		unsigned last = std::min(first + s_filterChunkSize, count);
+		double sum = 0;
+		double sumSquare = 0;
+		for (unsigned i = first; i < last; ++i)
+		{
+			double v = values[i];
+			sum += v;
+			sumSquare += v * v;
+		}
+		partialSums[c] = sum;
+		partialSquareSums[c] = sumSquare;
+	}
+#ifdef USE_TBB
+	);
+#endif
+
+	double sum = 0;
+	double sumSquare = 0;
+	for (int c = 0; c < chunkCount; ++c)
+	{
+		sum += partialSums[c];
+		sumSquare += partialSquareSums[c];
+	}
+
+	mean = sum / count;
+	stdDev = sqrt(fabs(sumSquare / count - mean*mean));
+
+	return true;
+}
+
+//! Creates the reference cloud of the points flagged as 'kept' (in the points order)
+static ReferenceCloud* CreateFilteredCloud(GenericIndexedCloudPersist* cloud, const std::vector<char>& keep)
+{
+	unsigned keptCount = static_cast<unsigned>(std::count(keep.begin(), keep.end(), 1));
+
+	ReferenceCloud* filteredCloud = new ReferenceCloud(cloud);
+	if (keptCount != 0 && !filteredCloud->reserve(keptCount))
+	{
+		//not enough memory
+		delete filteredCloud;
+		return nullptr;
+	}
+
+	for (unsigned i = 0; i < static_cast<unsigned>(keep.size()); ++i)
+	{
+		if (keep[i])
+		{
+			filteredCloud->addPointIndex(i); //can't fail, see above
+		}
+	}
+
+	return filteredCloud;
+}
+
+//! SOR filter: keeps the points with a mean distance to their neighbours below 'mean + nSigma * std. dev.'
+static ReferenceCloud* SelectSORPoints(GenericIndexedCloudPersist* cloud, const std::vector<PointCoordinateType>& meanDistances, double nSigma)
+{
+	double avgDist = 0, stdDev = 0;
+	if (!ComputeMeanAndStdDev(meanDistances, avgDist, stdDev))
+	{
+		return nullptr;
+	}
+
+	//deduce the max distance
+	double maxDist = avgDist + nSigma * stdDev;
+
+	unsigned pointCount = static_cast<unsigned>(meanDistances.size());
+	ReferenceCloud* filteredCloud = new ReferenceCloud(cloud);
+	if (!filteredCloud->reserve(pointCount))
+	{
+		//not enough memory
+		delete filteredCloud;
+		return nullptr;
+	}
+
+	for (unsigned i = 0; i < pointCount; ++i)
+	{
+		if (meanDistances[i] <= maxDist)
+		{
+			filteredCloud->addPointIndex(i);
+		}
+	}
+
+	filteredCloud->resize(filteredCloud->size());
+
+	return filteredCloud;
+}
+
+//! Noise filter: returns whether a point is close enough to the best fit plane of its neighbours
+static bool IsCloseToNeighboursPlane(	const CCVector3& P,
+										GenericIndexedCloudPersist* neighbours,
+										double nSigma,
+										bool useAbsoluteError,
+										double absoluteError)
+{
+	Neighbourhood Z(neighbours);
+
+	const PointCoordinateType* lsPlane = Z.getLSPlane();
+	if (!lsPlane)
+	{
+		//TODO: ???
+		return false;
+	}
+
+	double maxD = absoluteError;
+	if (!useAbsoluteError)
+	{
+		//compute the std. dev. to this plane
+		unsigned neighbourCount = neighbours->size();
+		double sum_d = 0;
+		double sum_d2 = 0;
+		for (unsigned j = 0; j < neighbourCount; ++j)
+		{
+			const CCVector3* Q = neighbours->getPoint(j);
+			double d = CCLib::DistanceComputationTools::computePoint2PlaneDistance(Q, lsPlane);
+			sum_d += d;
+			sum_d2 += d*d;
+		}
+
+		double stddev = sqrt(fabs(sum_d2*neighbourCount - sum_d*sum_d)) / neighbourCount;
+		maxD = stddev * nSigma;
+	}
+
+	//distance from the query point to the plane
+	double d = fabs(CCLib::DistanceComputationTools::computePoint2PlaneDistance(&P, lsPlane));
+
+	return (d <= maxD);
+}
+
 GenericIndexedCloud* CloudSamplingTools::resampleCloudWithOctree(	GenericIndexedCloudPersist* inputCloud,
 																	int newNumberOfPoints,
 																	RESAMPLING_CELL_METHOD resamplingMethod,
@@ -274,18 +445,12 @@ ReferenceCloud* CloudSamplingTools::resampleCloudSpatially(GenericIndexedCloudPe
 
 	//output cloud
 	ReferenceCloud* sampledCloud = new ReferenceCloud(inputCloud);
-	const unsigned c_reserveStep = 65536;
-	if (!sampledCloud->reserve(std::min(cloudSize, c_reserveStep)))
-	{
-		if (!inputOctree)
-			delete octree;
-		return nullptr;
-	}
 
-	std::vector<char> markers; //DGM: upgraded from vector, as this can be quite huge!
+	//point markers: 1 = candidate (default), 0 = removed, 2 = kept
+	std::unique_ptr< std::atomic<unsigned char>[] > markers;
 	try
 	{
-		markers.resize(cloudSize, 1); //true by default
+		markers.reset(new std::atomic<unsigned char>[cloudSize]);
 	}
 	catch (const std::bad_alloc&)
 	{
@@ -294,6 +459,10 @@ ReferenceCloud* CloudSamplingTools::resampleCloudSpatially(GenericIndexedCloudPe
 		delete sampledCloud;
 		return nullptr;
 	}
+	for (unsigned i = 0; i < cloudSize; ++i)
+	{
+		markers[i].store(1, std::memory_order_relaxed);
+	}
 
 	//best octree level (there may be several of them if we use parameter modulation)
 	std::vector<unsigned char> bestOctreeLevel;
@@ -354,8 +523,57 @@ ReferenceCloud* CloudSamplingTools::resampleCloudSpatially(GenericIndexedCloudPe
 		return nullptr;
 	}
 
+	//the points are processed by octree cells, with a cell size larger than the biggest
+	//neighbourhood radius. The cells are split in 8 groups ('colors') depending on the
+	//parity of their position: the neighbourhoods of two cells of the same color can't
+	//contain the same points, so that they can be processed in parallel. The result is
+	//the same whatever the number of threads.
+	PointCoordinateType maxRadius = minDistance;
+	if (modParamsEnabled)
+	{
+		maxRadius = std::max(maxRadius, static_cast<PointCoordinateType>(sfMin * modParams.a + modParams.b));
+		maxRadius = std::max(maxRadius, static_cast<PointCoordinateType>(sfMax * modParams.a + modParams.b));
+	}
+	unsigned char coloringLevel = 0;
+	while (coloringLevel < DgmOctree::MAX_OCTREE_LEVEL && octree->getCellSize(coloringLevel + 1) > maxRadius)
+	{
+		++coloringLevel;
+	}
+
+	const DgmOctree::cellsContainer& octreeStructure = octree->pointsAndTheirCellCodes();
+	unsigned projectedPointCount = octree->getNumberOfProjectedPoints();
+
+	//cells of each color (range of indexes in the octree structure)
+	std::vector< std::pair<unsigned, unsigned> > colorCells[8];
+	try
+	{
+		DgmOctree::cellsContainer cells;
+		if (!octree->getCellCodesAndIndexes(coloringLevel, cells, true))
+		{
+			throw std::bad_alloc();
+		}
+
+		for (size_t j = 0; j < cells.size(); ++j)
+		{
+			Tuple3i cellPos;
+			octree->getCellPos(cells[j].theCode, coloringLevel, cellPos, true);
+			unsigned lastIndex = (j + 1 < cells.size() ? cells[j + 1].theIndex : projectedPointCount);
+			colorCells[(cellPos.x & 1) | ((cellPos.y & 1) << 1) | ((cellPos.z & 1) << 2)].emplace_back(cells[j].theIndex, lastIndex);
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		if (!inputOctree)
+		{
+			delete octree;
+		}
+		delete sampledCloud;
+		return nullptr;
+	}
+
 	//progress notification
-	NormalizedProgress normProgress(progressCb, cloudSize);
+	NormalizedProgress normProgress(progressCb, octree->getCellNumber(coloringLevel));
 	if (progressCb)
 	{
 		if (progressCb->textCanBeEdited())
@@ -369,84 +587,130 @@ ReferenceCloud* CloudSamplingTools::resampleCloudSpatially(GenericIndexedCloudPe
 		progressCb->start();
 	}
 
-	//for each point in the cloud that is still 'marked', we look
-	//for its neighbors and remove their own marks
-	bool error = false;
-	//default octree level
-	assert(!bestOctreeLevel.empty());
-	unsigned char octreeLevel = bestOctreeLevel.front();
-	//default distance between points
-	PointCoordinateType minDistBetweenPoints = minDistance;
-	for (unsigned i = 0; i < cloudSize; i++)
+	std::atomic<bool> error(false);
+	for (unsigned char color = 0; color < 8 && !error; ++color)
 	{
-		//no mark? we skip this point
-		if (markers[i] != 0)
+		const std::vector< std::pair<unsigned, unsigned> >& cells = colorCells[color];
+		int cellCount = static_cast<int>(cells.size());
+
+#ifdef USE_TBB
+		tbb::parallel_for(0, cellCount, [&](int c)
+#else
+		for (int c = 0; c < cellCount; ++c)
+#endif
 		{
-			//init neighbor search structure
-			const CCVector3* P = inputCloud->getPoint(i);
-
-			//parameters modulation
-			if (modParamsEnabled)
+			//points of the current cell (sorted by index, so that the result doesn't depend on the octree sort)
+			std::vector<unsigned> cellPoints;
+			if (!error)
 			{
-				ScalarType sfVal = inputCloud->getPointScalarValue(i);
-				if (ScalarField::ValidValue(sfVal))
+				try
 				{
-					//modulate minDistance
-					minDistBetweenPoints = static_cast<PointCoordinateType>(sfVal * modParams.a + modParams.b);
-					//get (approximate) best level
-					std::size_t levelIndex = static_cast<std::size_t>(bestOctreeLevel.size() * ((sfVal - sfMin) / (sfMax - sfMin)));
-					if (levelIndex == bestOctreeLevel.size())
-						--levelIndex;
-					octreeLevel = bestOctreeLevel[levelIndex];
+					cellPoints.reserve(cells[c].second - cells[c].first);
+					for (unsigned j = cells[c].first; j < cells[c].second; ++j)
+					{
+						cellPoints.push_back(octreeStructure[j].theIndex);
+					}
+					std::sort(cellPoints.begin(), cellPoints.end());
 				}
-				else
+				catch (const std::bad_alloc&)
 				{
-					minDistBetweenPoints = minDistance;
-					octreeLevel = bestOctreeLevel.front();
+					//not enough memory
+					error = true;
+					cellPoints.clear();
 				}
 			}
 
-			//look for neighbors and 'de-mark' them
+			//default octree level
+			unsigned char octreeLevel = bestOctreeLevel.front();
+			//default distance between points
+			PointCoordinateType minDistBetweenPoints = minDistance;
+
+			//for each point of the cell that is still 'marked', we look
+			//for its neighbors and remove their own marks
+			DgmOctree::NeighboursSet neighbours;
+			for (unsigned i : cellPoints)
 			{
-				DgmOctree::NeighboursSet neighbours;
-				octree->getPointsInSphericalNeighbourhood(*P, minDistBetweenPoints, neighbours, octreeLevel);
-				for (DgmOctree::NeighboursSet::iterator it = neighbours.begin(); it != neighbours.end(); ++it)
-					if (it->pointIndex != i)
-						markers[it->pointIndex] = 0;
+				//no mark? we skip this point
+				if (markers[i].load(std::memory_order_relaxed) == 0)
+					continue;
+
+				CCVector3 P;
+				inputCloud->getPoint(i, P);
+
+				//parameters modulation
+				if (modParamsEnabled)
+				{
+					ScalarType sfVal = inputCloud->getPointScalarValue(i);
+					if (ScalarField::ValidValue(sfVal))
+					{
+						//modulate minDistance
+						minDistBetweenPoints = static_cast<PointCoordinateType>(sfVal * modParams.a + modParams.b);
+						//get (approximate) best level
+						std::size_t levelIndex = static_cast<std::size_t>(bestOctreeLevel.size() * ((sfVal - sfMin) / (sfMax - sfMin)));
+						if (levelIndex == bestOctreeLevel.size())
+							--levelIndex;
+						octreeLevel = bestOctreeLevel[levelIndex];
+					}
+					else
+					{
+						minDistBetweenPoints = minDistance;
+						octreeLevel = bestOctreeLevel.front();
+					}
+				}
+
+				//look for neighbors and 'de-mark' them
+				//(points already kept - in the neighbour cells - must remain so)
+				neighbours.clear();
+				octree->getPointsInSphericalNeighbourhood(P, minDistBetweenPoints, neighbours, octreeLevel);
+				for (const DgmOctree::PointDescriptor& n : neighbours)
+				{
+					if (n.pointIndex != i && markers[n.pointIndex].load(std::memory_order_relaxed) == 1)
+						markers[n.pointIndex].store(0, std::memory_order_relaxed);
+				}
+
+				//At this stage, the ith point is the only one marked in a radius of <minDistance>.
+				//Therefore it will necessarily be in the final cloud!
+				markers[i].store(2, std::memory_order_relaxed);
 			}
 
-			//At this stage, the ith point is the only one marked in a radius of <minDistance>.
-			//Therefore it will necessarily be in the final cloud!
-			if (sampledCloud->size() == sampledCloud->capacity() && !sampledCloud->reserve(sampledCloud->capacity() + c_reserveStep))
+			//progress indicator
+			if (!error && !normProgress.oneStep())
 			{
-				//not enough memory
+				//cancel process
 				error = true;
-				break;
 			}
-			if (!sampledCloud->addPointIndex(i))
+		}
+#ifdef USE_TBB
+		);
+#endif
+	}
+
+	//output cloud (sorted by point index)
+	if (!error)
+	{
+		unsigned count = 0;
+		for (unsigned i = 0; i < cloudSize; ++i)
+		{
+			if (markers[i].load(std::memory_order_relaxed) != 0)
+				++count;
+		}
+
+		if (sampledCloud->reserve(count))
+		{
+			for (unsigned i = 0; i < cloudSize; ++i)
 			{
-				//not enough memory
-				error = true;
-				break;
+				if (markers[i].load(std::memory_order_relaxed) != 0)
+					sampledCloud->addPointIndex(i);
 			}
 		}
-
-		//progress indicator
-		if (progressCb && !normProgress.oneStep())
+		else
 		{
-			//cancel process
+			//not enough memory
 			error = true;
-			break;
 		}
 	}
 
-	//remove unnecessarily allocated memory
-	if (!error)
-	{
-		if (sampledCloud->capacity() > sampledCloud->size())
-			sampledCloud->resize(sampledCloud->size());
-	}
-	else
+	if (error)
 	{
 		delete sampledCloud;
 		sampledCloud = nullptr;
@@ -509,8 +773,6 @@ ReferenceCloud* CloudSamplingTools::sorFilter(	GenericIndexedCloudPersist* input
 			//not enough memory
 			break;
 		}
-		double avgDist = 0, stdDev = 0;
-
 		//1st step: compute the average distance to the neighbors
 		{
 			//additional parameters
@@ -530,52 +792,108 @@ ReferenceCloud* CloudSamplingTools::sorFilter(	GenericIndexedCloudPersist* input
 				//something went wrong
 				break;
 			}
-
-			//deduce the average distance and std. dev.
-			double sumDist = 0;
-			double sumSquareDist = 0;
-			for (unsigned i = 0; i < pointCount; ++i)
-			{
-				sumDist += meanDistances[i];
-				sumSquareDist += meanDistances[i] * meanDistances[i];
-			}
-			avgDist = sumDist / pointCount;
-			stdDev = sqrt(fabs(sumSquareDist / pointCount - avgDist*avgDist));
 		}
 
-		//2nd step: remove the farthest points 
-		{
-			//deduce the max distance
-			double maxDist = avgDist + nSigma * stdDev;
+		//2nd step: remove the farthest points
+		filteredCloud = SelectSORPoints(inputCloud, meanDistances, nSigma);
+	}
 
-			filteredCloud = new ReferenceCloud(inputCloud);
-			if (!filteredCloud->reserve(pointCount))
-			{
-				//not enough memory
-				delete filteredCloud;
-				filteredCloud = nullptr;
-				break;
-			}
+	if (!inputOctree)
+	{
+		delete octree;
+		octree = 0;
+	}
 
-			for (unsigned i = 0; i < pointCount; ++i)
+	return filteredCloud;
+}
+
+ReferenceCloud* CloudSamplingTools::sorFilter(	GenericIndexedCloudPersist* inputCloud,
+												const NearestNeighboursTable& table,
+												int knn,
+												double nSigma,
+												GenericProgressCallback* progressCb/*=nullptr*/)
+{
+	if (	!inputCloud
+		||	knn < 2
+		||	table.pointCount() != inputCloud->size()
+		||	table.k() < static_cast<unsigned>(knn - 1))
+	{
+		//invalid input
+		assert(false);
+		return nullptr;
+	}
+
+	unsigned pointCount = inputCloud->size();
+
+	std::vector<PointCoordinateType> meanDistances;
+	try
+	{
+		meanDistances.resize(pointCount, 0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return nullptr;
+	}
+
+	if (progressCb)
+	{
+		if (progressCb->textCanBeEdited())
+		{
+			progressCb->setMethodTitle("SOR filter");
+			char buffer[64];
+			sprintf(buffer, "Points: %u\nNeighbors: %i", pointCount, knn);
+			progressCb->setInfo(buffer);
+		}
+		progressCb->update(0);
+		progressCb->start();
+	}
+	NormalizedProgress nProgress(progressCb, pointCount);
+
+	//the point itself is not in the table
+	const unsigned neighbourCount = static_cast<unsigned>(knn - 1);
+	std::atomic<bool> cancelled(false);
+
+	int chunkCount = static_cast<int>((pointCount + s_filterChunkSize - 1) / s_filterChunkSize);
+#ifdef USE_TBB
+	tbb::parallel_for(0, chunkCount, [&](int c)
+#else
+	for (int c = 0; c < chunkCount; ++c)
+#endif
+	{
+		unsigned first = static_cast<unsigned>(c) * s_filterChunkSize;
+		unsigned last = std::min(first + s_filterChunkSize, pointCount);
+		for (unsigned i = first; i < last && !cancelled; ++i)
+		{
+			const float* distances = table.neighbourDistances(i);
+			double sumDist = 0;
+			for (unsigned j = 0; j < neighbourCount; ++j)
 			{
-				if (meanDistances[i] <= maxDist)
-				{
-					filteredCloud->addPointIndex(i);
-				}
+				sumDist += distances[j];
 			}
+			meanDistances[i] = static_cast<PointCoordinateType>(sumDist / neighbourCount);
+		}
 
-			filteredCloud->resize(filteredCloud->size());
+		if (progressCb && !nProgress.steps(last - first))
+		{
+			cancelled = true;
 		}
 	}
+#ifdef USE_TBB
+	);
+#endif
 
-	if (!inputOctree)
+	if (progressCb)
 	{
-		delete octree;
-		octree = 0;
+		progressCb->stop();
 	}
 
-	return filteredCloud;
+	if (cancelled)
+	{
+		return nullptr;
+	}
+
+	return SelectSORPoints(inputCloud, meanDistances, nSigma);
 }
 
 ReferenceCloud* CloudSamplingTools::noiseFilter(GenericIndexedCloudPersist* inputCloud,
@@ -596,6 +914,17 @@ ReferenceCloud* CloudSamplingTools::noiseFilter(GenericIndexedCloudPersist* inpu
 		return nullptr;
 	}
 
+	if (useKnn)
+	{
+		//the neighbours are extracted once (in parallel), then the points are filtered
+		NearestNeighboursTable table;
+		if (knn > 3 && !table.compute(inputCloud, static_cast<unsigned>(knn - 1), true, inputOctree, progressCb))
+		{
+			return nullptr;
+		}
+		return noiseFilter(inputCloud, table, knn, nSigma, removeIsolatedPoints, useAbsoluteError, absoluteError, progressCb);
+	}
+
 	DgmOctree* octree = inputOctree;
 	if (!octree)
 	{
@@ -607,20 +936,22 @@ ReferenceCloud* CloudSamplingTools::noiseFilter(GenericIndexedCloudPersist* inpu
 		}
 	}
 
-	ReferenceCloud* filteredCloud = new ReferenceCloud(inputCloud);
-
-	unsigned pointCount = inputCloud->size();
-	if (!filteredCloud->reserve(pointCount))
+	//the cells are processed in parallel: each point is only flagged (the filtered cloud is created afterwards, in the points order)
+	std::vector<char> keep;
+	try
+	{
+		keep.resize(inputCloud->size(), 0);
+	}
+	catch (const std::bad_alloc&)
 	{
 		//not enough memory
 		if (!inputOctree)
 			delete octree;
-		delete filteredCloud;
 		return nullptr;
 	}
 
 	//additional parameters
-	void* additionalParameters[] = {reinterpret_cast<void*>(filteredCloud),
+	void* additionalParameters[] = {reinterpret_cast<void*>(&keep),
 									reinterpret_cast<void*>(&kernelRadius),
 									reinterpret_cast<void*>(&nSigma),
 									reinterpret_cast<void*>(&removeIsolatedPoints),
@@ -630,22 +961,17 @@ ReferenceCloud* CloudSamplingTools::noiseFilter(GenericIndexedCloudPersist* inpu
 									reinterpret_cast<void*>(&absoluteError)
 	};
 
-	unsigned char octreeLevel = 0;
-	if (useKnn)
-		octreeLevel = octree->findBestLevelForAGivenNeighbourhoodSizeExtraction(kernelRadius);
-	else
-		octreeLevel = octree->findBestLevelForAGivenPopulationPerCell(knn);
+	unsigned char octreeLevel = octree->findBestLevelForAGivenNeighbourhoodSizeExtraction(kernelRadius);
 
+	ReferenceCloud* filteredCloud = nullptr;
 	if (octree->executeFunctionForAllCellsAtLevel(	octreeLevel,
 													&applyNoiseFilterAtLevel,
 													additionalParameters,
 													true,
 													progressCb,
-													"Noise filter" ) == 0)
+													"Noise filter" ) != 0)
 	{
-		//something went wrong
-		delete filteredCloud;
-		filteredCloud = nullptr;
+		filteredCloud = CreateFilteredCloud(inputCloud, keep);
 	}
 
 	if (!inputOctree)
@@ -654,12 +980,119 @@ ReferenceCloud* CloudSamplingTools::noiseFilter(GenericIndexedCloudPersist* inpu
 		octree = nullptr;
 	}
 
-	if (filteredCloud)
+	return filteredCloud;
+}
+
+ReferenceCloud* CloudSamplingTools::noiseFilter(GenericIndexedCloudPersist* inputCloud,
+												const NearestNeighboursTable& table,
+												int knn,
+												double nSigma,
+												bool removeIsolatedPoints/*=false*/,
+												bool useAbsoluteError/*=true*/,
+												double absoluteError/*=0.0*/,
+												GenericProgressCallback* progressCb/*=nullptr*/)
+{
+	//the point itself is not in the table
+	const unsigned neighbourCount = (knn > 1 ? static_cast<unsigned>(knn - 1) : 0);
+	//we want 3 points or more (other than the point itself!)
+	const bool enoughNeighbours = (neighbourCount >= 3);
+
+	if (	!inputCloud
+		||	knn <= 0
+		||	(enoughNeighbours && (!table.hasIndexes() || table.pointCount() != inputCloud->size() || table.k() < neighbourCount)))
 	{
-		filteredCloud->resize(filteredCloud->size());
+		//invalid input
+		assert(false);
+		return nullptr;
 	}
 
-	return filteredCloud;
+	unsigned pointCount = inputCloud->size();
+
+	std::vector<char> keep;
+	try
+	{
+		keep.resize(pointCount, 0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return nullptr;
+	}
+
+	if (!enoughNeighbours)
+	{
+		//not enough points to fit a plane AND compute distances to it
+		std::fill(keep.begin(), keep.end(), removeIsolatedPoints ? 0 : 1);
+		return CreateFilteredCloud(inputCloud, keep);
+	}
+
+	if (progressCb)
+	{
+		if (progressCb->textCanBeEdited())
+		{
+			progressCb->setMethodTitle("Noise filter");
+			char buffer[64];
+			sprintf(buffer, "Points: %u\nNeighbors: %i", pointCount, knn);
+			progressCb->setInfo(buffer);
+		}
+		progressCb->update(0);
+		progressCb->start();
+	}
+	NormalizedProgress nProgress(progressCb, pointCount);
+
+	std::atomic<bool> cancelled(false);
+	std::atomic<bool> notEnoughMemory(false);
+
+	int chunkCount = static_cast<int>((pointCount + s_filterChunkSize - 1) / s_filterChunkSize);
+#ifdef USE_TBB
+	tbb::parallel_for(0, chunkCount, [&](int c)
+#else
+	for (int c = 0; c < chunkCount; ++c)
+#endif
+	{
+		//neighbours (buffer reused for all the points of the chunk)
+		ReferenceCloud neighbours(inputCloud);
+		if (!neighbours.reserve(neighbourCount))
+		{
+			notEnoughMemory = true;
+		}
+
+		unsigned first = static_cast<unsigned>(c) * s_filterChunkSize;
+		unsigned last = std::min(first + s_filterChunkSize, pointCount);
+		for (unsigned i = first; i < last && !cancelled && !notEnoughMemory; ++i)
+		{
+			neighbours.clear(false);
+			const unsigned* indexes = table.neighbourIndexes(i);
+			for (unsigned j = 0; j < neighbourCount; ++j)
+			{
+				neighbours.addPointIndex(indexes[j]); //can't fail, see above
+			}
+
+			CCVector3 P;
+			inputCloud->getPoint(i, P);
+			keep[i] = (IsCloseToNeighboursPlane(P, &neighbours, nSigma, useAbsoluteError, absoluteError) ? 1 : 0);
+		}
+
+		if (progressCb && !nProgress.steps(last - first))
+		{
+			cancelled = true;
+		}
+	}
+#ifdef USE_TBB
+	);
+#endif
+
+	if (progressCb)
+	{
+		progressCb->stop();
+	}
+
+	if (cancelled || notEnoughMemory)
+	{
+		return nullptr;
+	}
+
+	return CreateFilteredCloud(inputCloud, keep);
 }
 
 bool CloudSamplingTools::resampleCellAtLevel(	const DgmOctree::octreeCell& cell,
@@ -740,7 +1173,7 @@ bool CloudSamplingTools::applyNoiseFilterAtLevel(	const DgmOctree::octreeCell& c
 													void** additionalParameters,
 													NormalizedProgress* nProgress/*=0*/)
 {
-	ReferenceCloud* cloud				=  static_cast<ReferenceCloud*>(additionalParameters[0]);
+	std::vector<char>& keep				= *static_cast<std::vector<char>*>(additionalParameters[0]);
 	PointCoordinateType kernelRadius	= *static_cast<PointCoordinateType*>(additionalParameters[1]);
 	double nSigma						= *static_cast<double*>(additionalParameters[2]);
 	bool removeIsolatedPoints			= *static_cast<bool*>(additionalParameters[3]);
@@ -766,6 +1199,7 @@ bool CloudSamplingTools::applyNoiseFilterAtLevel(	const DgmOctree::octreeCell& c
 	for (unsigned i = 0; i < n; ++i)
 	{
 		cell.points->getPoint(i, nNSS.queryPoint);
+		const unsigned globalIndex = cell.points->getPointGlobalIndex(i);
 
 		//look for neighbors (either inside a sphere or the k nearest ones)
 		//warning: there may be more points at the end of nNSS.pointsInNeighbourhood than the actual nearest neighbors (neighborCount)!
@@ -779,7 +1213,6 @@ bool CloudSamplingTools::applyNoiseFilterAtLevel(	const DgmOctree::octreeCell& c
 		if (neighborCount > 3) //we want 3 points or more (other than the point itself!)
 		{
 			//find the query point in the nearest neighbors set and place it at the end
-			const unsigned globalIndex = cell.points->getPointGlobalIndex(i);
 			unsigned localIndex = 0;
 			while (localIndex < neighborCount && nNSS.pointsInNeighbourhood[localIndex].pointIndex != globalIndex)
 				++localIndex;
@@ -792,49 +1225,14 @@ bool CloudSamplingTools::applyNoiseFilterAtLevel(	const DgmOctree::octreeCell& c
 
 			unsigned realNeighborCount = neighborCount - 1;
 			DgmOctreeReferenceCloud neighboursCloud(&nNSS.pointsInNeighbourhood, realNeighborCount); //we don't take the query point into account!
-			Neighbourhood Z(&neighboursCloud);
-
-			const PointCoordinateType* lsPlane = Z.getLSPlane();
-			if (lsPlane)
-			{
-				double maxD = absoluteError;
-				if (!useAbsoluteError)
-				{
-					//compute the std. dev. to this plane
-					double sum_d = 0;
-					double sum_d2 = 0;
-					for (unsigned j = 0; j < realNeighborCount; ++j)
-					{
-						const CCVector3* P = neighboursCloud.getPoint(j);
-						double d = CCLib::DistanceComputationTools::computePoint2PlaneDistance(P, lsPlane);
-						sum_d += d;
-						sum_d2 += d*d;
-					}
 
-					double stddev = sqrt(fabs(sum_d2*realNeighborCount - sum_d*sum_d)) / realNeighborCount;
-					maxD = stddev * nSigma;
-				}
-
-				//distance from the query point to the plane
-				double d = fabs(CCLib::DistanceComputationTools::computePoint2PlaneDistance(&nNSS.queryPoint, lsPlane));
-
-				if (d <= maxD)
-					cloud->addPointIndex(globalIndex);
-			}
-			else
-			{
-				//TODO: ???
-			}
+			//each point is only flagged by the thread processing its cell
+			keep[globalIndex] = (IsCloseToNeighboursPlane(nNSS.queryPoint, &neighboursCloud, nSigma, useAbsoluteError, absoluteError) ? 1 : 0);
 		}
 		else
 		{
 			//not enough points to fit a plane AND compute distances to it
-			if (!removeIsolatedPoints)
-			{
-				//we keep the point
-				unsigned globalIndex = cell.points->getPointGlobalIndex(i);
-				cloud->addPointIndex(globalIndex);
-			}
+			keep[globalIndex] = (removeIsolatedPoints ? 0 : 1);
 		}
 
 		if (nProgress && !nProgress->oneStep())
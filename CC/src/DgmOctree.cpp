@@ -22,14 +22,22 @@
 #include <CCMiscTools.h>
 #include <GenericProgressCallback.h>
 #include <ParallelSort.h>
+#include <Profiler.h>
 #include <RayAndBox.h>
 #include <ReferenceCloud.h>
 #include <ScalarField.h>
 
 //system
+#include <atomic>
 #include <cstdio>
+#include <memory>
 #include <set>
 
+#ifdef USE_TBB
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#endif
+
 //DGM: tests in progress
 //#define COMPUTE_NN_SEARCH_STATISTICS
 //#define ADAPTATIVE_BINARY_SEARCH
@@ -236,6 +244,8 @@ int DgmOctree::build(	const CCVector3& octreeMin,
 
 int DgmOctree::genericBuild(GenericProgressCallback* progressCb)
 {
+	Profiler::Scope profilerScope("Octree computation");
+
 	unsigned pointCount = (m_theAssociatedCloud ? m_theAssociatedCloud->size() : 0);
 	if (pointCount == 0)
 	{
@@ -2795,6 +2805,77 @@ struct IndexAndCodeExt
 
 };
 
+//! Lock-free union-find structure (used for connected components labelling)
+/** The root of each set is always its smallest element (so that the result
+	doesn't depend on the order in which the unions are performed).
+**/
+class ConcurrentUnionFind
+{
+public:
+
+	//! Initializes the structure with 'count' singletons
+	/** \warning May throw std::bad_alloc
+	**/
+	explicit ConcurrentUnionFind(std::size_t count)
+		: m_parents(count)
+	{
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			m_parents[i].store(static_cast<unsigned>(i), std::memory_order_relaxed);
+		}
+	}
+
+	//! Returns the root of a given element (with path halving)
+	unsigned find(unsigned x)
+	{
+		while (true)
+		{
+			unsigned p = m_parents[x].load(std::memory_order_relaxed);
+			if (p == x)
+			{
+				return x;
+			}
+			unsigned gp = m_parents[p].load(std::memory_order_relaxed);
+			if (gp != p)
+			{
+				//path compression (we don't care if it fails: another thread did the job)
+				m_parents[x].compare_exchange_weak(p, gp, std::memory_order_relaxed);
+			}
+			x = gp;
+		}
+	}
+
+	//! Merges the sets of two elements
+	void merge(unsigned a, unsigned b)
+	{
+		while (true)
+		{
+			a = find(a);
+			b = find(b);
+			if (a == b)
+			{
+				return;
+			}
+			//we always attach the biggest root to the smallest one
+			if (a > b)
+			{
+				std::swap(a, b);
+			}
+			unsigned expected = b;
+			if (m_parents[b].compare_exchange_strong(expected, a, std::memory_order_relaxed))
+			{
+				return;
+			}
+			//another thread has modified 'b' in the meantime: we try again
+		}
+	}
+
+protected:
+
+	//! Parent of each element
+	std::vector< std::atomic<unsigned> > m_parents;
+};
+
 int DgmOctree::extractCCs(const cellCodesContainer& cellCodes, unsigned char level, bool sixConnexity, GenericProgressCallback* progressCb) const
 {
 	std::size_t numberOfCells = cellCodes.size();
@@ -2814,114 +2895,52 @@ int DgmOctree::extractCCs(const cellCodesContainer& cellCodes, unsigned char lev
 	}
 
 	//we compute the position of each cell (grid coordinates)
-	Tuple3i indexMin, indexMax;
 	{
 		//binary shift for cell code truncation
 		unsigned char bitDec = GET_BIT_SHIFT(level);
 
+#ifdef USE_TBB
+		tbb::parallel_for(static_cast<std::size_t>(0), numberOfCells, [&](std::size_t i)
+#else
 		for (std::size_t i = 0; i < numberOfCells; i++)
+#endif
 		{
 			ccCells[i].theCode = (cellCodes[i] >> bitDec);
 
 			Tuple3i cellPos;
 			getCellPos(ccCells[i].theCode, level, cellPos, true);
 
-			//we look for the actual min and max dimensions of the input cells set
-			//(which may not be the whole set of octree cells!)
-			if (i != 0)
-			{
-				for (unsigned char k = 0; k < 3; k++)
-				{
-					if (cellPos.u[k] < indexMin.u[k])
-						indexMin.u[k] = cellPos.u[k];
-					else if (cellPos.u[k] > indexMax.u[k])
-						indexMax.u[k] = cellPos.u[k];
-				}
-			}
-			else
-			{
-				indexMin.x = indexMax.x = cellPos.x;
-				indexMin.y = indexMax.y = cellPos.y;
-				indexMin.z = indexMax.z = cellPos.z;
-			}
-
-			//Warning: the cells will have to be sorted inside a slice afterwards!
 			ccCells[i].theIndex = (static_cast<IndexAndCodeExt::IndexType>(cellPos.x))
 								+ (static_cast<IndexAndCodeExt::IndexType>(cellPos.y) << level)
 								+ (static_cast<IndexAndCodeExt::IndexType>(cellPos.z) << (2 * level));
 		}
+#ifdef USE_TBB
+		);
+#endif
 	}
 
-	//we deduce the size of the grid that totally includes input cells
-	Tuple3i gridSize = indexMax - indexMin + Tuple3i(1, 1, 1);
-
 	//we sort the cells
 	ParallelSort(ccCells.begin(), ccCells.end(), IndexAndCodeExt::indexComp); //ascending index code order
 
-	const int& di = gridSize.x;
-	const int& dj = gridSize.y;
-	const int& step = gridSize.z;
-
-	//relative neighbos positions (either 6 or 26 total - but we only use half of it)
-	unsigned char neighborsInCurrentSlice = 0, neighborsInPrecedingSlice = 0;
-	int currentSliceNeighborsShifts[4], precedingSliceNeighborsShifts[9]; //maximum size to simplify code...
-
-	if (sixConnexity) //6-connexity
-	{
-		neighborsInCurrentSlice = 2;
-		currentSliceNeighborsShifts[0] = -(di + 2);
-		currentSliceNeighborsShifts[1] = -1;
-
-		neighborsInPrecedingSlice = 1;
-		precedingSliceNeighborsShifts[0] = 0;
-	}
-	else //26-connexity
-	{
-		neighborsInCurrentSlice = 4;
-		currentSliceNeighborsShifts[0] = -1 - (di + 2);
-		currentSliceNeighborsShifts[1] = -(di + 2);
-		currentSliceNeighborsShifts[2] = 1 - (di + 2);
-		currentSliceNeighborsShifts[3] = -1;
-
-		neighborsInPrecedingSlice = 9;
-		precedingSliceNeighborsShifts[0] = -1 - (di + 2);
-		precedingSliceNeighborsShifts[1] = -(di + 2);
-		precedingSliceNeighborsShifts[2] = 1 - (di + 2);
-		precedingSliceNeighborsShifts[3] = -1;
-		precedingSliceNeighborsShifts[4] = 0;
-		precedingSliceNeighborsShifts[5] = 1;
-		precedingSliceNeighborsShifts[6] = -1 + (di + 2);
-		precedingSliceNeighborsShifts[7] = (di + 2);
-		precedingSliceNeighborsShifts[8] = 1 + (di + 2);
-	}
-
-	//shared structures (to avoid repeated allocations)
-	std::vector<int> neighboursVal, neighboursMin;
-	try
-	{
-		neighboursVal.reserve(neighborsInCurrentSlice + neighborsInPrecedingSlice);
-		neighboursMin.reserve(neighborsInCurrentSlice + neighborsInPrecedingSlice);
-	}
-	catch (const std::bad_alloc&)
-	{
-		//not enough memory
-		return -2;
-	}
-
-	//temporary virtual 'slices'
-	int sliceSize = (di + 2) * (dj + 2); //add a margin to avoid "boundary effects"
-	std::vector<int> slice;
-	std::vector<int> oldSlice;
-	//equivalence table between 'on the fly' labels
-	std::vector<int> equivalentLabels;
-	std::vector<int> cellIndexToLabel;
-
+	//relative positions of the neighbors that precede a cell in the grid (either 3 or 13 - i.e. half of 6 or 26)
+	std::vector<Tuple3i> precedingNeighbors;
 	try
 	{
-		slice.resize(sliceSize);
-		oldSlice.resize(sliceSize, 0); //previous slice is empty by default
-		equivalentLabels.resize(numberOfCells + 2, 0);
-		cellIndexToLabel.resize(numberOfCells, 0);
+		if (sixConnexity) //6-connexity
+		{
+			precedingNeighbors.push_back(Tuple3i(-1, 0, 0));
+			precedingNeighbors.push_back(Tuple3i(0, -1, 0));
+			precedingNeighbors.push_back(Tuple3i(0, 0, -1));
+		}
+		else //26-connexity
+		{
+			for (int k = -1; k <= 0; ++k)
+				for (int j = -1; j <= 1; ++j)
+					for (int i = -1; i <= 1; ++i)
+						if (k < 0 || j < 0 || (j == 0 && i < 0))
+							precedingNeighbors.push_back(Tuple3i(i, j, k));
+			assert(precedingNeighbors.size() == 13);
+		}
 	}
 	catch (const std::bad_alloc&)
 	{
@@ -2930,215 +2949,120 @@ int DgmOctree::extractCCs(const cellCodesContainer& cellCodes, unsigned char lev
 	}
 
 	//progress notification
+	static const std::size_t s_cellsPerStep = (1 << 16);
+	std::size_t stepCount = (numberOfCells + s_cellsPerStep - 1) / s_cellsPerStep;
 	if (progressCb)
 	{
 		if (progressCb->textCanBeEdited())
 		{
 			progressCb->setMethodTitle("Components Labeling");
 			char buffer[256];
-			sprintf(buffer, "Box: [%i*%i*%i]", gridSize.x, gridSize.y, gridSize.z);
+			sprintf(buffer, "Cells: %u", static_cast<unsigned>(numberOfCells));
 			progressCb->setInfo(buffer);
 		}
 		progressCb->update(0);
 		progressCb->start();
 	}
 
-	//current label
-	std::size_t currentLabel = 1;
-
-	//process each slice
+	//we merge each cell with its (preceding) neighbors
+	std::vector<unsigned> cellIndexToLabel;
 	{
-		unsigned counter = 0;
+		std::unique_ptr<ConcurrentUnionFind> unionFind;
+		try
+		{
+			unionFind.reset(new ConcurrentUnionFind(numberOfCells));
+			cellIndexToLabel.resize(numberOfCells, 0);
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			return -2;
+		}
+
 		const IndexAndCodeExt::IndexType gridCoordMask = (static_cast<IndexAndCodeExt::IndexType>(1) << level) - 1;
-		std::vector<IndexAndCodeExt>::const_iterator _ccCells = ccCells.begin();
-		NormalizedProgress nprogress(progressCb, step);
+		const int maxCoord = static_cast<int>(gridCoordMask);
+		NormalizedProgress nprogress(progressCb, static_cast<unsigned>(stepCount));
 
-		for (int k = indexMin.z; k < indexMin.z + step; k++)
+		//we process the cells by chunks so as to update the progress bar (from the main thread)
+		for (std::size_t step = 0; step < stepCount; ++step)
 		{
-			//initialize the 'current' slice
-			std::fill(slice.begin(), slice.end(), 0);
+			std::size_t firstCell = step * s_cellsPerStep;
+			std::size_t lastCell = std::min(firstCell + s_cellsPerStep, numberOfCells);
 
-			//for each cell of the slice
-			while (counter < numberOfCells && static_cast<int>(_ccCells->theIndex >> (level << 1)) == k)
+#ifdef USE_TBB
+			tbb::parallel_for(firstCell, lastCell, [&](std::size_t i)
+#else
+			for (std::size_t i = firstCell; i < lastCell; i++)
+#endif
 			{
-				int iind = static_cast<int>(_ccCells->theIndex & gridCoordMask);
-				int jind = static_cast<int>((_ccCells->theIndex >> level) & gridCoordMask);
-				int cellIndex = (iind - indexMin.x + 1) + (jind - indexMin.y + 1)*(di + 2);
-				++_ccCells;
+				const IndexAndCodeExt::IndexType index = ccCells[i].theIndex;
+				Tuple3i cellPos(static_cast<int>(index & gridCoordMask),
+								static_cast<int>((index >> level) & gridCoordMask),
+								static_cast<int>(index >> (2 * level)));
 
-				//we look if the cell has neighbors inside the slice
-				int* _slice = &(slice[cellIndex]);
+				for (const Tuple3i& shift : precedingNeighbors)
 				{
-					for (unsigned char n = 0; n < neighborsInCurrentSlice; n++)
+					Tuple3i neighborPos = cellPos + shift;
+					if (	neighborPos.x < 0 || neighborPos.x > maxCoord
+						||	neighborPos.y < 0 || neighborPos.y > maxCoord
+						||	neighborPos.z < 0)
 					{
-						assert(cellIndex + currentSliceNeighborsShifts[n] < sliceSize);
-						const int& neighborLabel = _slice[currentSliceNeighborsShifts[n]];
-						if (neighborLabel > 1)
-							neighboursVal.push_back(neighborLabel);
-					}
-				}
-
-				//and in the previous slice
-				const int* _oldSlice = &(oldSlice[cellIndex]);
-				{
-					for (unsigned char n = 0; n < neighborsInPrecedingSlice; n++)
-					{
-						assert(cellIndex + precedingSliceNeighborsShifts[n] < sliceSize);
-						const int& neighborLabel = _oldSlice[precedingSliceNeighborsShifts[n]];
-						if (neighborLabel > 1)
-							neighboursVal.push_back(neighborLabel);
+						continue;
 					}
-				}
 
-				//number of neighbors for current cell
-				std::size_t p = neighboursVal.size();
+					IndexAndCodeExt neighbor;
+					neighbor.theIndex = (static_cast<IndexAndCodeExt::IndexType>(neighborPos.x))
+										+ (static_cast<IndexAndCodeExt::IndexType>(neighborPos.y) << level)
+										+ (static_cast<IndexAndCodeExt::IndexType>(neighborPos.z) << (2 * level));
 
-				if (p == 0) //no neighbor
-				{
-					*_slice = static_cast<int>(++currentLabel); //we create a new label
-				}
-				else if (p == 1) //1 neighbor
-				{
-					*_slice = neighboursVal.back(); //we'll use its label
-					neighboursVal.pop_back();
-				}
-				else //more than 1 neighbor?
-				{
-					//we get the smallest label
-					ParallelSort(neighboursVal.begin(), neighboursVal.end());
-					
-					int smallestLabel = neighboursVal[0];
-
-					//if they are not the same
-					if (smallestLabel != neighboursVal.back())
+					//the preceding neighbors can only be before the current cell
+					std::vector<IndexAndCodeExt>::const_iterator it = std::lower_bound(ccCells.begin(), ccCells.begin() + i, neighbor, IndexAndCodeExt::indexComp);
+					if (it != ccCells.begin() + i && it->theIndex == neighbor.theIndex)
 					{
-						int lastLabel = 0;
-						neighboursMin.clear();
-						//we get the smallest equivalent label for each neighbor's branch
-						{
-							for (std::size_t n = 0; n < p; n++)
-							{
-								// ... we start from its C.C. index
-								int label = neighboursVal[n];
-								//if it's not the same as the previous neighbor's
-								if (label != lastLabel)
-								{
-									//we update the 'before' value
-									assert(label < static_cast<int>(numberOfCells)+2);
-									lastLabel = label;
-
-									//we look for its real equivalent value
-									while (equivalentLabels[label] > 1)
-									{
-										label = equivalentLabels[label];
-										assert(label < static_cast<int>(numberOfCells)+2);
-									}
-
-									neighboursMin.push_back(label);
-								}
-							}
-						}
-
-						//get the smallest one
-						ParallelSort(neighboursMin.begin(), neighboursMin.end());
-						
-						smallestLabel = neighboursMin.front();
-
-						//update the equivalence table by the way
-						//for all other branches
-						lastLabel = smallestLabel;
-						{
-							for (std::size_t n = 1; n < neighboursMin.size(); n++)
-							{
-								int label = neighboursMin[n];
-								assert(label < static_cast<int>(numberOfCells)+2);
-								//we don't process it if it's the same label as the previous neighbor
-								if (label != lastLabel)
-								{
-									equivalentLabels[label] = smallestLabel;
-									lastLabel = label;
-								}
-							}
-						}
+						unionFind->merge(static_cast<unsigned>(i), static_cast<unsigned>(it - ccCells.begin()));
 					}
-
-					//update current cell label
-					*_slice = smallestLabel;
-					neighboursVal.clear();
 				}
-
-				cellIndexToLabel[counter++] = *_slice;
 			}
-
-			if (counter == numberOfCells)
-				break;
-
-			std::swap(slice, oldSlice);
+#ifdef USE_TBB
+			);
+#endif
 
 			nprogress.oneStep();
 		}
-	}
 
-	//release some memory
-	slice.clear();
-	oldSlice.clear();
-
-	if (progressCb)
-	{
-		progressCb->stop();
-	}
-
-	if (currentLabel < 2)
-	{
-		//No component found
-		return -3;
-	}
-
-	//path compression (http://en.wikipedia.org/wiki/Union_find)
-	assert(currentLabel < numberOfCells + 2);
-	{
-		for (std::size_t i = 2; i <= currentLabel; i++)
+		//we create (following) indexes for each component
+		//(in the order of their first cell, i.e. their root - labels start at '1')
+		unsigned numberOfComponents = 0;
+		for (std::size_t i = 0; i < numberOfCells; i++)
 		{
-			int label = equivalentLabels[i];
-			assert(label < static_cast<int>(numberOfCells)+2);
-			while (equivalentLabels[label] > 1) //equivalentLabels[0] == 0 !!!
+			unsigned root = unionFind->find(static_cast<unsigned>(i));
+			if (root == i)
+			{
+				cellIndexToLabel[i] = ++numberOfComponents;
+			}
+			else
 			{
-				label = equivalentLabels[label];
-				assert(label < static_cast<int>(numberOfCells)+2);
+				assert(root < i);
+				cellIndexToLabel[i] = cellIndexToLabel[root];
 			}
-			equivalentLabels[i] = label;
 		}
 	}
 
-	//update leaves
+	if (progressCb)
 	{
-		for (std::size_t i = 0; i < numberOfCells; i++)
-		{
-			int label = cellIndexToLabel[i];
-			assert(label < static_cast<int>(numberOfCells)+2);
-			if (equivalentLabels[label] > 1)
-				cellIndexToLabel[i] = equivalentLabels[label];
-		}
+		progressCb->stop();
 	}
 
-	//hack: we use "equivalentLabels" to count how many components will have to be created
 	int numberOfComponents = 0;
+	for (std::size_t i = 0; i < numberOfCells; i++)
 	{
-		std::fill(equivalentLabels.begin(), equivalentLabels.end(), 0);
-
-		for (std::size_t i = 0; i < numberOfCells; i++)
-		{
-			assert(cellIndexToLabel[i] > 1 && cellIndexToLabel[i] < static_cast<int>(numberOfCells)+2);
-			equivalentLabels[cellIndexToLabel[i]] = 1;
-		}
-
-		//we create (following) indexes for each components
-		for (std::size_t i = 2; i < numberOfCells + 2; i++)
-			if (equivalentLabels[i] == 1)
-				equivalentLabels[i] = ++numberOfComponents; //labels start at '1'
+		numberOfComponents = std::max(numberOfComponents, static_cast<int>(cellIndexToLabel[i]));
+	}
+	if (numberOfComponents == 0)
+	{
+		//No component found
+		return -3;
 	}
-	assert(equivalentLabels[0] == 0);
-	assert(equivalentLabels[1] == 0);
 
 	//we flag each component's points with its label
 	{
@@ -3154,23 +3078,38 @@ int DgmOctree::extractCCs(const cellCodesContainer& cellCodes, unsigned char lev
 			progressCb->update(0);
 			progressCb->start();
 		}
-		NormalizedProgress nprogress(progressCb, static_cast<unsigned>(numberOfCells));
+		NormalizedProgress nprogress(progressCb, static_cast<unsigned>(stepCount));
 
-		ReferenceCloud Y(m_theAssociatedCloud);
-		for (std::size_t i = 0; i < numberOfCells; i++)
+		for (std::size_t step = 0; step < stepCount; ++step)
 		{
-			assert(cellIndexToLabel[i] < static_cast<int>(numberOfCells)+2);
-
-			const int& label = equivalentLabels[cellIndexToLabel[i]];
-			assert(label > 0);
-			getPointsInCell(ccCells[i].theCode, level, &Y, true);
-			Y.placeIteratorAtBeginning();
-			ScalarType d = static_cast<ScalarType>(label);
-			for (unsigned j = 0; j < Y.size(); ++j)
+			std::size_t firstCell = step * s_cellsPerStep;
+			std::size_t lastCell = std::min(firstCell + s_cellsPerStep, numberOfCells);
+
+			//each cell has its own points (so we can write the labels concurrently)
+#ifdef USE_TBB
+			tbb::parallel_for(tbb::blocked_range<std::size_t>(firstCell, lastCell), [&](const tbb::blocked_range<std::size_t>& range)
+#else
+			std::pair<std::size_t, std::size_t> range(firstCell, lastCell);
+#endif
 			{
-				Y.setCurrentPointScalarValue(d);
-				Y.forwardIterator();
+				ReferenceCloud Y(m_theAssociatedCloud);
+#ifdef USE_TBB
+				for (std::size_t i = range.begin(); i < range.end(); i++)
+#else
+				for (std::size_t i = range.first; i < range.second; i++)
+#endif
+				{
+					ScalarType d = static_cast<ScalarType>(cellIndexToLabel[i]);
+					getPointsInCell(ccCells[i].theCode, level, &Y, true);
+					for (unsigned j = 0; j < Y.size(); ++j)
+					{
+						m_theAssociatedCloud->setPointScalarValue(Y.getPointGlobalIndex(j), d);
+					}
+				}
 			}
+#ifdef USE_TBB
+			);
+#endif
 
 			nprogress.oneStep();
 		}
@@ -3224,7 +3163,7 @@ DgmOctree::octreeCell::~octreeCell()
 
 #include <QtCore>
 #include <QApplication>
-#include <QtConcurrentMap>
+#include <QRunnable>
 #include <QThreadPool>
 
 /*** FOR THE MULTI THREADING WRAPPER ***/
@@ -3235,28 +3174,49 @@ struct octreeCellDesc
 	unsigned char level;
 };
 
-static DgmOctree* s_octree_MT = nullptr;
-static DgmOctree::octreeCellFunc s_func_MT = nullptr;
-static void** s_userParams_MT = nullptr;
-static GenericProgressCallback* s_progressCb_MT = nullptr;
-static NormalizedProgress* s_normProgressCb_MT = nullptr;
-static bool s_cellFunc_MT_success = true;
+//! Multi-threaded process context
+/** One instance per call (instead of a static one), so that several octrees can be processed concurrently
+**/
+struct OctreeCellFuncContext_MT
+{
+	OctreeCellFuncContext_MT(DgmOctree* _octree, DgmOctree::octreeCellFunc _func, void** _userParams, GenericProgressCallback* _progressCb)
+		: octree(_octree)
+		, func(_func)
+		, userParams(_userParams)
+		, progressCb(_progressCb)
+		, normProgressCb(nullptr)
+		, success(true)
+	{}
+
+	~OctreeCellFuncContext_MT()
+	{
+		delete normProgressCb;
+	}
 
-void LaunchOctreeCellFunc_MT(const octreeCellDesc& desc)
+	DgmOctree* octree;
+	DgmOctree::octreeCellFunc func;
+	void** userParams;
+	GenericProgressCallback* progressCb;
+	NormalizedProgress* normProgressCb;
+	std::atomic<bool> success;
+};
+
+static void LaunchOctreeCellFunc_MT(OctreeCellFuncContext_MT& context, const octreeCellDesc& desc)
 {
 	//skip cell if process is aborted/has failed
-	if (!s_cellFunc_MT_success)
+	if (!context.success)
 	{
 		return;
 	}
 
-	const DgmOctree::cellsContainer& pointsAndCodes = s_octree_MT->pointsAndTheirCellCodes();
+	const DgmOctree::cellsContainer& pointsAndCodes = context.octree->pointsAndTheirCellCodes();
 
 	//cell descriptor
-	DgmOctree::octreeCell cell(s_octree_MT);
+	DgmOctree::octreeCell cell(context.octree);
 	cell.level = desc.level;
 	cell.index = desc.i1;
 	cell.truncatedCode = desc.truncatedCode;
+	bool success = false;
 	if (cell.points->reserve(desc.i2 - desc.i1 + 1))
 	{
 		for (unsigned i = desc.i1; i <= desc.i2; ++i)
@@ -3264,35 +3224,82 @@ void LaunchOctreeCellFunc_MT(const octreeCellDesc& desc)
 			cell.points->addPointIndex(pointsAndCodes[i].theIndex);
 		}
 
-		s_cellFunc_MT_success &= (*s_func_MT)(cell, s_userParams_MT, s_normProgressCb_MT);
-	}
-	else
-	{
-		s_cellFunc_MT_success = false;
+		success = (*context.func)(cell, context.userParams, context.normProgressCb);
 	}
 
-	if (!s_cellFunc_MT_success)
+	if (!success)
 	{
+		context.success = false;
+
 		//TODO: display a message to make clear that the cancel order has been acknowledged!
-		if (s_progressCb_MT)
+		if (context.progressCb)
 		{
-			if (s_progressCb_MT->textCanBeEdited())
+			if (context.progressCb->textCanBeEdited())
 			{
-				s_progressCb_MT->setInfo("Cancelling...");
+				context.progressCb->setInfo("Cancelling...");
 			}
 		}
 
-		//if (s_normProgressCb_MT)
+		//if (context.normProgressCb)
 		//{
-		//	if (!s_normProgressCb_MT->oneStep())
+		//	if (!context.normProgressCb->oneStep())
 		//	{
-		//		s_cellFunc_MT_success = false;
+		//		context.success = false;
 		//		return;
 		//	}
 		//}
 	}
 }
 
+//! Task processing the cells of a multi-threaded process (until there's none left)
+class OctreeCellsTask_MT : public QRunnable
+{
+public:
+
+	OctreeCellsTask_MT(OctreeCellFuncContext_MT& context, const std::vector<octreeCellDesc>& cells, std::atomic<size_t>& nextCell)
+		: m_context(context)
+		, m_cells(cells)
+		, m_nextCell(nextCell)
+	{}
+
+	void run() override
+	{
+		for (size_t i = m_nextCell++; i < m_cells.size(); i = m_nextCell++)
+		{
+			LaunchOctreeCellFunc_MT(m_context, m_cells[i]);
+		}
+	}
+
+protected:
+
+	OctreeCellFuncContext_MT& m_context;
+	const std::vector<octreeCellDesc>& m_cells;
+	std::atomic<size_t>& m_nextCell;
+};
+
+//! Processes the cells of a multi-threaded process with a given number of threads
+/** A local thread pool is used: the global one is shared by all the (possibly
+	concurrent) processes, and changing its maximum number of threads would
+	change it for all of them.
+**/
+static void LaunchOctreeCellsFunc_MT(OctreeCellFuncContext_MT& context, const std::vector<octreeCellDesc>& cells, int maxThreadCount)
+{
+	if (maxThreadCount <= 0)
+	{
+		maxThreadCount = QThread::idealThreadCount();
+	}
+	int taskCount = static_cast<int>(std::min(static_cast<size_t>(maxThreadCount), cells.size()));
+
+	QThreadPool pool;
+	pool.setMaxThreadCount(maxThreadCount);
+	std::atomic<size_t> nextCell(0);
+	for (int i = 0; i < taskCount; ++i)
+	{
+		pool.start(new OctreeCellsTask_MT(context, cells, nextCell)); //auto-deleted by the pool
+	}
+	pool.waitForDone();
+}
+
 #endif
 
 unsigned DgmOctree::executeFunctionForAllCellsAtLevel(	unsigned char level,
@@ -3306,9 +3313,11 @@ unsigned DgmOctree::executeFunctionForAllCellsAtLevel(	unsigned char level,
 	if (m_thePointsAndTheirCellCodes.empty())
 		return 0;
 
+	Profiler::Scope profilerScope(functionTitle ? functionTitle : "Octree cell function");
+
 #ifdef ENABLE_MT_OCTREE
 
-	//cells that will be processed by QtConcurrent::map
+	//cells that will be processed by the thread pool
 	const unsigned cellsNumber = getCellNumber(level);
 	std::vector<octreeCellDesc> cells;
 
@@ -3467,17 +3476,8 @@ unsigned DgmOctree::executeFunctionForAllCellsAtLevel(	unsigned char level,
 		//don't forget the last cell!
 		cells.push_back(cellDesc);
 
-		//static wrap
-		s_octree_MT = this;
-		s_func_MT = func;
-		s_userParams_MT = additionalParameters;
-		s_cellFunc_MT_success = true;
-		s_progressCb_MT = progressCb;
-		if (s_normProgressCb_MT)
-		{
-			delete s_normProgressCb_MT;
-			s_normProgressCb_MT = 0;
-		}
+		//process context
+		OctreeCellFuncContext_MT context(this, func, additionalParameters, progressCb);
 
 		//progress notification
 		if (progressCb)
@@ -3493,7 +3493,7 @@ unsigned DgmOctree::executeFunctionForAllCellsAtLevel(	unsigned char level,
 				progressCb->setInfo(buffer);
 			}
 			progressCb->update(0);
-			s_normProgressCb_MT = new NormalizedProgress(progressCb,m_theAssociatedCloud->size());
+			context.normProgressCb = new NormalizedProgress(progressCb, m_theAssociatedCloud->size());
 			progressCb->start();
 		}
 
@@ -3504,12 +3504,7 @@ unsigned DgmOctree::executeFunctionForAllCellsAtLevel(	unsigned char level,
 		s_binarySearchCount = 0.0;
 #endif
 
-		if (maxThreadCount == 0)
-		{
-			maxThreadCount = QThread::idealThreadCount();
-		}
-		QThreadPool::globalInstance()->setMaxThreadCount(maxThreadCount);
-		QtConcurrent::blockingMap(cells, LaunchOctreeCellFunc_MT);
+		LaunchOctreeCellsFunc_MT(context, cells, maxThreadCount);
 
 #ifdef COMPUTE_NN_SEARCH_STATISTICS
 		FILE* fp = fopen("octree_log.txt", "at");
@@ -3526,21 +3521,13 @@ unsigned DgmOctree::executeFunctionForAllCellsAtLevel(	unsigned char level,
 		}
 #endif
 
-		s_octree_MT = nullptr;
-		s_func_MT = nullptr;
-		s_userParams_MT = nullptr;
-
 		if (progressCb)
 		{
 			progressCb->stop();
-			if (s_normProgressCb_MT)
-				delete s_normProgressCb_MT;
-			s_normProgressCb_MT = nullptr;
-			s_progressCb_MT = nullptr;
 		}
 
 		//if something went wrong, we clear everything and return 0!
-		if (!s_cellFunc_MT_success)
+		if (!context.success)
 			cells.clear();
 
 		return static_cast<unsigned>(cells.size());
@@ -3565,11 +3552,13 @@ unsigned DgmOctree::executeFunctionForAllCellsStartingAtLevel(unsigned char star
 	if (m_thePointsAndTheirCellCodes.empty())
 		return 0;
 
+	Profiler::Scope profilerScope(functionTitle ? functionTitle : "Octree cell function");
+
 	const unsigned cellsNumber = getCellNumber(startingLevel);
 
 #ifdef ENABLE_MT_OCTREE
 
-	//cells that will be processed by QtConcurrent::map
+	//cells that will be processed by the thread pool
 	std::vector<octreeCellDesc> cells;
 	if (multiThread)
 	{
@@ -4016,14 +4005,8 @@ unsigned DgmOctree::executeFunctionForAllCellsStartingAtLevel(unsigned char star
 		double mean = static_cast<double>(popSum) / cells.size();
 		double stddev = sqrt(static_cast<double>(popSum2 - popSum*popSum)) / cells.size();
 
-		//static wrap
-		s_octree_MT = this;
-		s_func_MT = func;
-		s_userParams_MT = additionalParameters;
-		s_cellFunc_MT_success = true;
-		if (s_normProgressCb_MT)
-			delete s_normProgressCb_MT;
-		s_normProgressCb_MT = nullptr;
+		//process context
+		OctreeCellFuncContext_MT context(this, func, additionalParameters, progressCb);
 
 		//progress notification
 		if (progressCb)
@@ -4038,11 +4021,7 @@ unsigned DgmOctree::executeFunctionForAllCellsStartingAtLevel(unsigned char star
 				sprintf(buffer, "Octree levels %i - %i\nCells: %i\nAverage population: %3.2f (+/-%3.2f)\nMax population: %llu", startingLevel, MAX_OCTREE_LEVEL, static_cast<int>(cells.size()), mean, stddev, maxPop);
 				progressCb->setInfo(buffer);
 			}
-			if (s_normProgressCb_MT)
-			{
-				delete s_normProgressCb_MT;
-			}
-			s_normProgressCb_MT = new NormalizedProgress(progressCb,static_cast<unsigned>(cells.size()));
+			context.normProgressCb = new NormalizedProgress(progressCb, static_cast<unsigned>(cells.size()));
 			progressCb->update(0);
 			progressCb->start();
 		}
@@ -4054,12 +4033,7 @@ unsigned DgmOctree::executeFunctionForAllCellsStartingAtLevel(unsigned char star
 		s_binarySearchCount = 0.0;
 #endif
 
-		if (maxThreadCount == 0)
-		{
-			maxThreadCount = QThread::idealThreadCount();
-		}
-		QThreadPool::globalInstance()->setMaxThreadCount(maxThreadCount);
-		QtConcurrent::blockingMap(cells, LaunchOctreeCellFunc_MT);
+		LaunchOctreeCellsFunc_MT(context, cells, maxThreadCount);
 
 #ifdef COMPUTE_NN_SEARCH_STATISTICS
 		FILE* fp=fopen("octree_log.txt","at");
@@ -4076,20 +4050,13 @@ unsigned DgmOctree::executeFunctionForAllCellsStartingAtLevel(unsigned char star
 		}
 #endif
 
-		s_octree_MT = nullptr;
-		s_func_MT = nullptr;
-		s_userParams_MT = nullptr;
-
 		if (progressCb)
 		{
 			progressCb->stop();
-			if (s_normProgressCb_MT)
-				delete s_normProgressCb_MT;
-			s_normProgressCb_MT = nullptr;
 		}
 
 		//if something went wrong, we clear everything and return 0!
-		if (!s_cellFunc_MT_success)
+		if (!context.success)
 			cells.clear();
 
 		return static_cast<unsigned>(cells.size());
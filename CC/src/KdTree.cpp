@@ -35,174 +35,113 @@ KDTree::KDTree()
 
 KDTree::~KDTree()
 {
-    deleteSubTree(m_root);
+	clear();
+}
+
+void KDTree::clear()
+{
+	m_root = nullptr;
+	m_cells.clear();
+	m_cells.shrink_to_fit();
+	m_cellCount = 0;
 }
 
 bool KDTree::buildFromCloud(GenericIndexedCloud *cloud, GenericProgressCallback *progressCb)
 {
-    unsigned cloudsize = cloud->size();
+	unsigned cloudsize = cloud->size();
 
-    m_indexes.clear();
-    m_cellCount = 0;
+	m_indexes.clear();
+	clear();
 	m_associatedCloud = nullptr;
-	m_root = nullptr;
 
-    if (cloudsize == 0)
-        return false;
+	if (cloudsize == 0)
+		return false;
 
 	try
 	{
 		m_indexes.resize(cloudsize);
+		//a binary tree with one point per leaf has exactly 2N-1 cells
+		m_cells.resize(2 * static_cast<size_t>(cloudsize) - 1);
 	}
 	catch (.../*const std::bad_alloc&*/) //out of memory
 	{
+		m_indexes.clear();
 		return false;
 	}
 
 	m_associatedCloud = cloud;
 
 	for (unsigned i=0; i<cloudsize; i++)
-        m_indexes[i] = i;
+		m_indexes[i] = i;
 
-    if (progressCb)
-    {
+	if (progressCb)
+	{
 		if (progressCb->textCanBeEdited())
 		{
 			progressCb->setInfo("Building KD-tree");
 		}
 		progressCb->update(0);
 		progressCb->start();
-    }
-
-    m_root = buildSubTree(0, cloudsize-1, nullptr, m_cellCount, progressCb);
-
-    if (progressCb)
-        progressCb->stop();
-
-    //if the tree building has failed (memory issues)
-    if (!m_root)
-    {
-        m_associatedCloud = nullptr;
-        m_cellCount = 0;
-        return false;
-    }
-
-	try
-	{
-		m_indexes.resize(cloudsize);
 	}
-	catch (.../*const std::bad_alloc&*/) //out of memory
-	{
-        m_associatedCloud = nullptr;
-        m_cellCount = 0;
-        return false;
-    }
-
-    return true;
-}
-
-
-void KDTree::deleteSubTree(KdCell *cell)
-{
-    if (!cell)
-        return;
-
-    deleteSubTree(cell->leSon);
-    deleteSubTree(cell->gSon);
-    delete cell;
-	assert(m_cellCount>0);
-    m_cellCount--;
-}
 
-/*** Comparison functions used by the sort function (Strict ordering must be used) ***/
-static CCLib::GenericIndexedCloud* s_comparisonCloud = nullptr;
+	m_root = buildSubTree(0, cloudsize-1, nullptr, progressCb);
+	assert(m_cellCount == m_cells.size());
 
-//! Compares X coordinates of two points designated by their index
-static bool ComparisonX(const unsigned &a, const unsigned &b)
-{
-	return (s_comparisonCloud->getPoint(a)->x < s_comparisonCloud->getPoint(b)->x);
-}
+	if (progressCb)
+		progressCb->stop();
 
-//! Compares Y coordinates of two points designated by their index
-static bool ComparisonY(const unsigned &a, const unsigned &b)
-{
-	return (s_comparisonCloud->getPoint(a)->y < s_comparisonCloud->getPoint(b)->y);
+	return true;
 }
 
-//! Compares Z coordinates of two points designated by their index
-static bool ComparisonZ(const unsigned &a, const unsigned &b)
+KDTree::KdCell* KDTree::buildSubTree(unsigned first, unsigned last, KdCell* father, GenericProgressCallback *progressCb)
 {
-	return (s_comparisonCloud->getPoint(a)->z < s_comparisonCloud->getPoint(b)->z);
-}
-
-KDTree::KdCell* KDTree::buildSubTree(unsigned first, unsigned last, KdCell* father, unsigned &nbBuildCell, GenericProgressCallback *progressCb)
-{
-    KdCell* cell = new KdCell;
-    if (!cell)
-        return nullptr;
-    m_cellCount++;
-
-    unsigned dim = (father == nullptr ? 0 : ((father->cuttingDim+1) % 3));
-
-    //Compute outside bounding box (have to be done before building the current cell sons)
-    cell->father = father;
-    cell->startingPointIndex = first;
-    cell->nbPoints = last-first+1;
-    cell->cuttingDim = dim;
-    updateOutsideBoundingBox(cell);
-    if (progressCb)
-        progressCb->update(m_cellCount*100.0f/(m_indexes.size()*2.0f-1.0f));
-
-    //If there is only one point to insert, build a leaf
-    if (first == last)
-    {
-        cell->cuttingDim = 0;
-        cell->leSon = nullptr;
-        cell->gSon = nullptr;
-    }
-    else
-    {
-        //sort the remaining points considering dimension dim
-		s_comparisonCloud = m_associatedCloud; //TODO: not compatible with parallelism!!!
-        if (dim == 0)
-            sort(m_indexes.begin()+first, m_indexes.begin()+(last+1), ComparisonX);
-        else if (dim == 1)
-            sort(m_indexes.begin()+first, m_indexes.begin()+(last+1), ComparisonY);
-        else if (dim == 2)
-            sort(m_indexes.begin()+first, m_indexes.begin()+(last+1), ComparisonZ);
-        //find the median point in the sorted tab
-        unsigned split = (first+last)/2;
-        const CCVector3* P = m_associatedCloud->getPoint(m_indexes[split]);
-        cell->cuttingCoordinate = P->u[dim];
-        //recursively build the other two sub trees
-        //trap the memory issues. At this point, none of the cell sons can be set to 0. Otherwise there has been memory allocation failure.
-        cell->leSon = cell->gSon = nullptr;
-        cell->leSon = buildSubTree(first, split, cell, nbBuildCell, progressCb);
-        if (cell->leSon == nullptr)
-        {
-            deleteSubTree(cell);
-            //the tree beyond the current cell will be deleted when noticing that this cell is set to 0
-            return nullptr;
-        }
-        cell->gSon = buildSubTree(split+1, last, cell, nbBuildCell, progressCb);
-        if (cell->gSon == nullptr)
-        {
-            deleteSubTree(cell);
-            //the tree beyond the current cell will be deleted when noticing that this cell is set to 0
-            return nullptr;
-        }
-
-    }
-    //Compute inside bounding box (have to be done once sons have been built)
-    updateInsideBoundingBox(cell);
+	assert(m_cellCount < m_cells.size());
+	KdCell* cell = &m_cells[m_cellCount++];
+
+	unsigned dim = (father == nullptr ? 0 : ((father->cuttingDim+1) % 3));
+
+	//Compute outside bounding box (have to be done before building the current cell sons)
+	cell->father = father;
+	cell->startingPointIndex = first;
+	cell->nbPoints = last-first+1;
+	cell->cuttingDim = dim;
+	updateOutsideBoundingBox(cell);
+	if (progressCb)
+		progressCb->update(m_cellCount*100.0f/m_cells.size());
+
+	//If there is only one point to insert, build a leaf
+	if (first == last)
+	{
+		cell->cuttingDim = 0;
+		cell->leSon = nullptr;
+		cell->gSon = nullptr;
+	}
+	else
+	{
+		//find the median point considering dimension dim
+		//(we only need the points to be partitioned around it, not to be fully sorted)
+		unsigned split = (first+last)/2;
+		GenericIndexedCloud* cloud = m_associatedCloud;
+		std::nth_element(	m_indexes.begin() + first,
+							m_indexes.begin() + split,
+							m_indexes.begin() + (last + 1),
+							[cloud, dim](unsigned a, unsigned b) { return cloud->getPoint(a)->u[dim] < cloud->getPoint(b)->u[dim]; });
+		const CCVector3* P = m_associatedCloud->getPoint(m_indexes[split]);
+		cell->cuttingCoordinate = P->u[dim];
+		//recursively build the other two sub trees
+		cell->leSon = buildSubTree(first, split, cell, progressCb);
+		cell->gSon = buildSubTree(split+1, last, cell, progressCb);
+	}
+	//Compute inside bounding box (have to be done once sons have been built)
+	updateInsideBoundingBox(cell);
 
-    return cell;
+	return cell;
 }
 
 
 bool KDTree::findNearestNeighbour(	const PointCoordinateType *queryPoint,
 									unsigned &nearestPointIndex,
-									ScalarType maxDist)
+									ScalarType maxDist) const
 {
     if (m_root == nullptr)
         return false;
@@ -234,35 +173,31 @@ bool KDTree::findNearestNeighbour(	const PointCoordinateType *queryPoint,
     }
 
     //Go up in the tree to check that neighbours cells do not contain a nearer point than the one we found
-    while (cellPtr != nullptr)
+    while (cellPtr->father != nullptr)
     {
         KdCell* prevPtr = cellPtr;
         cellPtr = cellPtr->father;
-        if (cellPtr != nullptr)
+
+        //the brother cell may contain a nearer point
+        KdCell* brotherPtr = (cellPtr->leSon == prevPtr ? cellPtr->gSon : cellPtr->leSon);
+        int a = checkNearerPointInSubTree(queryPoint, maxDist, brotherPtr);
+        if (a >= 0)
         {
-            ScalarType sqrdist = InsidePointToCellDistance(queryPoint, cellPtr);
-            if (sqrdist >= 0 && sqrdist*sqrdist < maxDist)
-            {
-				KdCell* brotherPtr = (cellPtr->leSon == prevPtr ? cellPtr->gSon : cellPtr->leSon);
-                int a = checkNearerPointInSubTree(queryPoint, maxDist, brotherPtr);
-                if (a >= 0)
-                {
-                    nearestPointIndex = a;
-                    found = true;
-                }
-            }
-            else
-			{
-                cellPtr = nullptr;
-			}
+            nearestPointIndex = a;
+            found = true;
         }
+
+        //if the search sphere lies inside the current cell, no need to go further up
+        ScalarType sqrdist = InsidePointToCellDistance(queryPoint, cellPtr);
+        if (sqrdist < 0 || sqrdist*sqrdist >= maxDist)
+            break;
     }
 
     return found;
 }
 
 bool KDTree::findPointBelowDistance(const PointCoordinateType *queryPoint,
-									ScalarType maxDist)
+									ScalarType maxDist) const
 {
     if (m_root == nullptr)
         return false;
@@ -289,24 +224,19 @@ bool KDTree::findPointBelowDistance(const PointCoordinateType *queryPoint,
     }
 
     //Go up in the tree to check that neighbours cells do not contain a point
-    while (cellPtr != nullptr)
+    while (cellPtr->father != nullptr)
     {
         KdCell* prevPtr = cellPtr;
         cellPtr = cellPtr->father;
-        if (cellPtr != nullptr)
-        {
-            ScalarType sqrdist = InsidePointToCellDistance(queryPoint, cellPtr);
-            if (sqrdist >= 0 && sqrdist*sqrdist < maxDist)
-            {
-				KdCell* brotherPtr = (cellPtr->leSon == prevPtr ? cellPtr->gSon : cellPtr->leSon);
-                if (checkDistantPointInSubTree(queryPoint, maxDist, brotherPtr))
-                    return true;
-            }
-            else
-			{
-                cellPtr = nullptr;
-			}
-        }
+
+        KdCell* brotherPtr = (cellPtr->leSon == prevPtr ? cellPtr->gSon : cellPtr->leSon);
+        if (checkDistantPointInSubTree(queryPoint, maxDist, brotherPtr))
+            return true;
+
+        //if the search sphere lies inside the current cell, no need to go further up
+        ScalarType sqrdist = InsidePointToCellDistance(queryPoint, cellPtr);
+        if (sqrdist < 0 || sqrdist*sqrdist >= maxDist)
+            break;
     }
 
     return false;
@@ -315,7 +245,7 @@ bool KDTree::findPointBelowDistance(const PointCoordinateType *queryPoint,
 unsigned KDTree::findPointsLyingToDistance(const PointCoordinateType *queryPoint,
 											ScalarType distance,
 											ScalarType tolerance,
-											std::vector<unsigned> &points)
+											std::vector<unsigned> &points) const
 {
     if (m_root == nullptr)
         return 0;
@@ -367,9 +297,9 @@ void KDTree::updateOutsideBoundingBox(KdCell *cell)
         cell->boundsMask = cell->father->boundsMask;
         cell->outbbmax = cell->father->outbbmax;
         cell->outbbmin = cell->father->outbbmin;
-        const CCVector3* P = m_associatedCloud->getPoint(m_indexes[cell->startingPointIndex]);
         //Check if this cell is its father leSon (if...) or gSon (else...)
-        if (P->u[cell->father->cuttingDim] <= cell->father->cuttingCoordinate)
+        //(we can't rely on the coordinates of the points as some may be equal to the cutting coordinate in both sons)
+        if (cell->startingPointIndex == cell->father->startingPointIndex)
         {
             //Bounding box max point is linked to the bits [3..5] in the bounds mask
             bound = bound<<(3+cell->father->cuttingDim);
@@ -386,7 +316,7 @@ void KDTree::updateOutsideBoundingBox(KdCell *cell)
     }
 }
 
-ScalarType KDTree::pointToCellSquareDistance(const PointCoordinateType *queryPoint, KdCell *cell)
+ScalarType KDTree::pointToCellSquareDistance(const PointCoordinateType *queryPoint, KdCell *cell) const
 {
     PointCoordinateType dx, dy, dz;
 
@@ -412,7 +342,7 @@ ScalarType KDTree::pointToCellSquareDistance(const PointCoordinateType *queryPoi
 void KDTree::pointToCellDistances(	const PointCoordinateType *queryPoint,
 									KdCell *cell,
 									ScalarType& min,
-									ScalarType& max)
+									ScalarType& max) const
 {
     PointCoordinateType dx, dy, dz;
 
@@ -423,7 +353,7 @@ void KDTree::pointToCellDistances(	const PointCoordinateType *queryPoint,
     max = static_cast<ScalarType>( sqrt(dx*dx + dy*dy + dz*dz) );
 }
 
-ScalarType KDTree::InsidePointToCellDistance(const PointCoordinateType *queryPoint, KdCell *cell)
+ScalarType KDTree::InsidePointToCellDistance(const PointCoordinateType *queryPoint, KdCell *cell) const
 {
     PointCoordinateType dx, dy, dz, max;
 
@@ -466,7 +396,7 @@ ScalarType KDTree::InsidePointToCellDistance(const PointCoordinateType *queryPoi
 
 int KDTree::checkNearerPointInSubTree(	const PointCoordinateType *queryPoint,
 										ScalarType& maxSqrDist,
-										KdCell *cell)
+										KdCell *cell) const
 {
     if (pointToCellSquareDistance(queryPoint, cell) >= maxSqrDist)
         return -1;
@@ -488,14 +418,14 @@ int KDTree::checkNearerPointInSubTree(	const PointCoordinateType *queryPoint,
         return a;
     }
 
+	//both sons must be checked (the second one may contain an even nearer point)
 	int b = checkNearerPointInSubTree(queryPoint, maxSqrDist, cell->gSon);
-	if (b >= 0)
-		return b;
+	int c = checkNearerPointInSubTree(queryPoint, maxSqrDist, cell->leSon);
 
-	return checkNearerPointInSubTree(queryPoint, maxSqrDist, cell->leSon);
+	return (c >= 0 ? c : b);
 }
 
-bool KDTree::checkDistantPointInSubTree(const PointCoordinateType *queryPoint, ScalarType &maxSqrDist, KdCell *cell)
+bool KDTree::checkDistantPointInSubTree(const PointCoordinateType *queryPoint, ScalarType &maxSqrDist, KdCell *cell) const
 {
     if (pointToCellSquareDistance(queryPoint, cell)>=maxSqrDist)
         return false;
@@ -525,7 +455,7 @@ void KDTree::distanceScanTree(
     ScalarType distance,
     ScalarType tolerance,
     KdCell *cell,
-    std::vector<unsigned> &localArray)
+    std::vector<unsigned> &localArray) const
 {
     ScalarType min, max;
 
@@ -533,22 +463,15 @@ void KDTree::distanceScanTree(
 
     if ((min<=distance+tolerance) && (max>=distance-tolerance))
     {
-        if ((cell->leSon!=nullptr) && (cell->gSon!=nullptr))
+        if ((cell->leSon==nullptr) && (cell->gSon==nullptr))
         {
-            //This case shall always happen (the other case is for leaves that contain more than one point - bucket KDtree)
-            if (cell->nbPoints == 1)
-            {
-                localArray.push_back(m_indexes[cell->startingPointIndex]);
-            }
-            else
+            //leaf cell
+            for (unsigned i=0; i<cell->nbPoints; i++)
             {
-                for (unsigned i=0; i<cell->nbPoints; i++)
-                {
-                    const CCVector3 *p = m_associatedCloud->getPoint(m_indexes[i+cell->startingPointIndex]);
-                    PointCoordinateType dist = CCVector3::vdistance(queryPoint, p->u);
-                    if (distance-tolerance <= dist && dist <= distance+tolerance)
-                        localArray.push_back(m_indexes[cell->startingPointIndex+i]);
-                }
+                const CCVector3 *p = m_associatedCloud->getPoint(m_indexes[i+cell->startingPointIndex]);
+                PointCoordinateType dist = CCVector3::vdistance(queryPoint, p->u);
+                if (distance-tolerance <= dist && dist <= distance+tolerance)
+                    localArray.push_back(m_indexes[cell->startingPointIndex+i]);
             }
         }
         else
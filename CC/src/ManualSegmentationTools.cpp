@@ -19,55 +19,569 @@
 #include <ManualSegmentationTools.h>
 
 //local
+#include <DgmOctree.h>
 #include <GenericProgressCallback.h>
 #include <PointCloud.h>
 #include <Polyline.h>
 #include <SimpleMesh.h>
 
 //system
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <map>
 
+#ifdef USE_TBB
+#include <tbb/parallel_for.h>
+#endif
+
 
 using namespace CCLib;
 
+//! Projection with an (optional) 4x4 matrix
+class MatrixProjector : public ManualSegmentationTools::Projector
+{
+public:
+	explicit MatrixProjector(const float* viewMat)
+		: m_trans(viewMat ? new SquareMatrix(viewMat) : nullptr)
+	{}
+
+	~MatrixProjector() override
+	{
+		delete m_trans;
+	}
+
+	CCVector2 project(const CCVector3& P) const override
+	{
+		if (m_trans)
+		{
+			CCVector3 Q = (*m_trans) * P;
+			return CCVector2(Q.x, Q.y);
+		}
+		return CCVector2(P.x, P.y);
+	}
+
+protected:
+	SquareMatrix* m_trans;
+};
+
 ReferenceCloud* ManualSegmentationTools::segment(GenericIndexedCloudPersist* aCloud, const Polyline* poly, bool keepInside, const float* viewMat)
 {
 	assert(poly && aCloud);
 
-	CCLib::SquareMatrix* trans = (viewMat ? new CCLib::SquareMatrix(viewMat) : nullptr);
-
 	ReferenceCloud* Y = new ReferenceCloud(aCloud);
 
-	//we check for each point if it falls inside the polyline
-	unsigned count = aCloud->size();
-	for (unsigned i = 0; i < count; ++i)
+	try
+	{
+		PolygonIndex polygon;
+		if (!polygon.init(poly))
+		{
+			//not enough memory
+			delete Y;
+			return nullptr;
+		}
+
+		//we check for each point if it falls inside the polyline
+		unsigned count = aCloud->size();
+		std::vector<unsigned char> visibility(count, POINT_VISIBLE);
+		segment(aCloud, polygon, MatrixProjector(viewMat), keepInside, visibility);
+
+		unsigned keptCount = static_cast<unsigned>(std::count(visibility.begin(), visibility.end(), POINT_VISIBLE));
+		if (!Y->reserve(keptCount))
+		{
+			//not enough memory
+			delete Y;
+			return nullptr;
+		}
+		for (unsigned i = 0; i < count; ++i)
+		{
+			if (visibility[i] == POINT_VISIBLE)
+			{
+				Y->addPointIndex(i);
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		delete Y;
+		Y = nullptr;
+	}
+
+	return Y;
+}
+
+ManualSegmentationTools::PolygonIndex::PolygonIndex()
+	: m_min(0, 0)
+	, m_max(0, 0)
+	, m_bandCount(0)
+	, m_bandHeight(0)
+{
+}
+
+bool ManualSegmentationTools::PolygonIndex::init(const GenericIndexedCloud* polyVertices, unsigned bandCount/*=0*/)
+{
+	unsigned vertCount = (polyVertices ? polyVertices->size() : 0);
+
+	std::vector<CCVector2> vertices;
+	try
+	{
+		vertices.resize(vertCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+
+	for (unsigned i = 0; i < vertCount; ++i)
 	{
 		CCVector3 P;
-		aCloud->getPoint(i, P);
+		polyVertices->getPoint(i, P);
+		vertices[i] = CCVector2(P.x, P.y);
+	}
+
+	return init(vertices, bandCount);
+}
 
-		//we project the point in screen space first if necessary
-		if (trans)
+bool ManualSegmentationTools::PolygonIndex::init(const std::vector<CCVector2>& polyVertices, unsigned bandCount/*=0*/)
+{
+	m_bandCount = 0;
+	m_bandOffsets.clear();
+	m_bandEdges.clear();
+
+	try
+	{
+		m_vertices = polyVertices;
+
+		size_t vertCount = m_vertices.size();
+		if (vertCount < 2)
 		{
-			P = (*trans) * P;
+			//the test will always fail
+			return true;
 		}
 
-		bool pointInside = isPointInsidePoly(CCVector2(P.x, P.y), poly);
-		if ((keepInside && pointInside) || (!keepInside && !pointInside))
+		m_min = m_max = m_vertices.front();
+		for (const CCVector2& P : m_vertices)
 		{
-			if (!Y->addPointIndex(i))
+			m_min.x = std::min(m_min.x, P.x);
+			m_min.y = std::min(m_min.y, P.y);
+			m_max.x = std::max(m_max.x, P.x);
+			m_max.y = std::max(m_max.y, P.y);
+		}
+
+		if (bandCount == 0)
+		{
+			//roughly one band per edge
+			bandCount = static_cast<unsigned>(std::min<size_t>(std::max<size_t>(vertCount, 1), 4096));
+		}
+		m_bandCount = bandCount;
+		m_bandHeight = (m_max.y - m_min.y) / bandCount;
+		if (m_bandHeight <= 0)
+		{
+			//flat polygon
+			m_bandCount = 1;
+			m_bandHeight = 1;
+		}
+
+		//edges overlapping each band (CSR)
+		m_bandOffsets.resize(static_cast<size_t>(m_bandCount) + 1, 0);
+		for (size_t i = 1; i <= vertCount; ++i)
+		{
+			const CCVector2& A = m_vertices[i - 1];
+			const CCVector2& B = m_vertices[i % vertCount];
+			unsigned b0 = bandIndex(std::min(A.y, B.y));
+			unsigned b1 = bandIndex(std::max(A.y, B.y));
+			for (unsigned b = b0; b <= b1; ++b)
 			{
-				//not engouh memory
-				delete Y;
-				Y = nullptr;
-				break;
+				++m_bandOffsets[b + 1];
+			}
+		}
+		for (unsigned b = 0; b < m_bandCount; ++b)
+		{
+			m_bandOffsets[b + 1] += m_bandOffsets[b];
+		}
+
+		m_bandEdges.resize(m_bandOffsets.back());
+		std::vector<unsigned> fillPos(m_bandOffsets.begin(), m_bandOffsets.end() - 1);
+		for (size_t i = 1; i <= vertCount; ++i)
+		{
+			const CCVector2& A = m_vertices[i - 1];
+			const CCVector2& B = m_vertices[i % vertCount];
+			unsigned b0 = bandIndex(std::min(A.y, B.y));
+			unsigned b1 = bandIndex(std::max(A.y, B.y));
+			for (unsigned b = b0; b <= b1; ++b)
+			{
+				m_bandEdges[fillPos[b]++] = static_cast<unsigned>(i);
 			}
 		}
 	}
+	catch (const std::bad_alloc&)
+	{
+		m_vertices.clear();
+		m_bandOffsets.clear();
+		m_bandEdges.clear();
+		m_bandCount = 0;
+		return false;
+	}
+
+	return true;
+}
+
+bool ManualSegmentationTools::PolygonIndex::isPointInside(const CCVector2& P) const
+{
+	//an edge is only crossed if A.y <= P.y < B.y (or the opposite)
+	if (m_bandCount == 0 || P.y < m_min.y || P.y >= m_max.y)
+		return false;
+
+	bool inside = false;
+
+	size_t vertCount = m_vertices.size();
+	unsigned b = bandIndex(P.y);
+	for (unsigned e = m_bandOffsets[b]; e < m_bandOffsets[b + 1]; ++e)
+	{
+		unsigned i = m_bandEdges[e];
+		const CCVector2& A = m_vertices[i - 1];
+		const CCVector2& B = m_vertices[i % vertCount];
+
+		//same test as ManualSegmentationTools::isPointInsidePoly
+		if ((B.y <= P.y && P.y < A.y) || (A.y <= P.y && P.y < B.y))
+		{
+			PointCoordinateType t = (P.x - B.x)*(A.y - B.y) - (A.x - B.x)*(P.y - B.y);
+			if (A.y < B.y)
+				t = -t;
+			if (t < 0)
+				inside = !inside;
+		}
+	}
+
+	return inside;
+}
+
+ManualSegmentationTools::PolygonIndex::RectPosition ManualSegmentationTools::PolygonIndex::classifyRect(const CCVector2& rectMin, const CCVector2& rectMax) const
+{
+	if (	m_bandCount == 0
+		||	rectMax.x < m_min.x || rectMin.x > m_max.x
+		||	rectMax.y < m_min.y || rectMin.y > m_max.y)
+	{
+		return RECT_OUTSIDE;
+	}
 
-	delete trans;
+	//if no edge intersects the rectangle, it is either completely inside or completely outside
+	size_t vertCount = m_vertices.size();
+	unsigned b0 = bandIndex(rectMin.y);
+	unsigned b1 = bandIndex(rectMax.y);
+	for (unsigned e = m_bandOffsets[b0]; e < m_bandOffsets[b1 + 1]; ++e)
+	{
+		unsigned i = m_bandEdges[e];
+		const CCVector2& A = m_vertices[i - 1];
+		const CCVector2& B = m_vertices[i % vertCount];
 
-	return Y;
+		//bounding boxes overlap
+		if (	std::max(A.x, B.x) < rectMin.x || std::min(A.x, B.x) > rectMax.x
+			||	std::max(A.y, B.y) < rectMin.y || std::min(A.y, B.y) > rectMax.y)
+		{
+			continue;
+		}
+
+		//the rectangle corners are all on the same side of the edge line?
+		CCVector2 AB = B - A;
+		PointCoordinateType c1 = AB.x * (rectMin.y - A.y) - AB.y * (rectMin.x - A.x);
+		PointCoordinateType c2 = AB.x * (rectMin.y - A.y) - AB.y * (rectMax.x - A.x);
+		PointCoordinateType c3 = AB.x * (rectMax.y - A.y) - AB.y * (rectMin.x - A.x);
+		PointCoordinateType c4 = AB.x * (rectMax.y - A.y) - AB.y * (rectMax.x - A.x);
+		if (	(c1 > 0 && c2 > 0 && c3 > 0 && c4 > 0)
+			||	(c1 < 0 && c2 < 0 && c3 < 0 && c4 < 0))
+		{
+			continue;
+		}
+
+		return RECT_STRADDLING;
+	}
+
+	return isPointInside((rectMin + rectMax) / 2) ? RECT_INSIDE : RECT_OUTSIDE;
+}
+
+//! Octree-based segmentation (see ManualSegmentationTools::segment)
+class OctreeSegmenter
+{
+public:
+
+	OctreeSegmenter(const GenericIndexedCloudPersist* cloud,
+					const DgmOctree* octree,
+					const ManualSegmentationTools::PolygonIndex& polygon,
+					const ManualSegmentationTools::Projector& projector,
+					bool keepInside,
+					std::vector<unsigned char>& visibility)
+		: m_cloud(cloud)
+		, m_octree(octree)
+		, m_codes(octree->pointsAndTheirCellCodes())
+		, m_polygon(polygon)
+		, m_projector(projector)
+		, m_keepInside(keepInside)
+		, m_visibility(visibility)
+	{}
+
+	//! A range of points (in the octree structure) belonging to the same cell
+	struct CellRange
+	{
+		unsigned begin;
+		unsigned end;
+		unsigned char level;
+	};
+
+	//! Lists the cells of a given level
+	void getCells(unsigned char level, std::vector<CellRange>& cells) const
+	{
+		unsigned count = static_cast<unsigned>(m_codes.size());
+		for (unsigned pos = 0; pos < count; )
+		{
+			unsigned next = cellEnd(pos, count, level);
+			CellRange cell;
+			cell.begin = pos;
+			cell.end = next;
+			cell.level = level;
+			cells.push_back(cell);
+			pos = next;
+		}
+	}
+
+	//! Processes the points of a cell (and of its sub-cells)
+	void processCell(const CellRange& cell) const
+	{
+		unsigned count = cell.end - cell.begin;
+		if (count > s_minPointsPerCell)
+		{
+			CCVector2 rectMin, rectMax;
+			if (projectCell(cell, rectMin, rectMax))
+			{
+				switch (m_polygon.classifyRect(rectMin, rectMax))
+				{
+				case ManualSegmentationTools::PolygonIndex::RECT_INSIDE:
+					if (!m_keepInside)
+						hidePoints(cell);
+					return;
+
+				case ManualSegmentationTools::PolygonIndex::RECT_OUTSIDE:
+					if (m_keepInside)
+						hidePoints(cell);
+					return;
+
+				default:
+					break;
+				}
+			}
+
+			//straddling cell: we test its sub-cells
+			if (cell.level < DgmOctree::MAX_OCTREE_LEVEL)
+			{
+				unsigned char childLevel = cell.level + 1;
+				for (unsigned pos = cell.begin; pos < cell.end; )
+				{
+					CellRange child;
+					child.begin = pos;
+					child.end = cellEnd(pos, cell.end, childLevel);
+					child.level = childLevel;
+					processCell(child);
+					pos = child.end;
+				}
+				return;
+			}
+		}
+
+		//small cell: we test its points directly
+		for (unsigned pos = cell.begin; pos < cell.end; ++pos)
+		{
+			unsigned index = m_codes[pos].theIndex;
+			if (m_visibility[index] == POINT_VISIBLE)
+			{
+				CCVector3 P;
+				m_cloud->getPoint(index, P);
+				bool pointInside = m_polygon.isPointInside(m_projector.project(P));
+				if (pointInside != m_keepInside)
+					m_visibility[index] = POINT_HIDDEN;
+			}
+		}
+	}
+
+protected:
+
+	//! Below this number of points, the points of a cell are tested directly
+	static const unsigned s_minPointsPerCell = 64;
+
+	//! Returns the end of the cell (at a given level) starting at 'begin'
+	unsigned cellEnd(unsigned begin, unsigned end, unsigned char level) const
+	{
+		unsigned char bitShift = DgmOctree::GET_BIT_SHIFT(level);
+		DgmOctree::CellCode truncatedCode = (m_codes[begin].theCode >> bitShift);
+		return static_cast<unsigned>(std::upper_bound(	m_codes.begin() + begin,
+														m_codes.begin() + end,
+														truncatedCode,
+														[bitShift](DgmOctree::CellCode code, const DgmOctree::IndexAndCode& pc) { return code < (pc.theCode >> bitShift); }
+													) - m_codes.begin());
+	}
+
+	//! Computes the 2D bounding box of the projected cell (slightly enlarged)
+	bool projectCell(const CellRange& cell, CCVector2& rectMin, CCVector2& rectMax) const
+	{
+		unsigned char bitShift = DgmOctree::GET_BIT_SHIFT(cell.level);
+		CCVector3 cellMin, cellMax;
+		m_octree->computeCellLimits(m_codes[cell.begin].theCode >> bitShift, cell.level, cellMin, cellMax, true);
+		if (!m_projector.isBoxProjectable(cellMin, cellMax))
+		{
+			return false;
+		}
+
+		for (unsigned char j = 0; j < 8; ++j)
+		{
+			CCVector3 corner(	j & 1 ? cellMax.x : cellMin.x,
+								j & 2 ? cellMax.y : cellMin.y,
+								j & 4 ? cellMax.z : cellMin.z);
+			CCVector2 Q = m_projector.project(corner);
+			if (j == 0)
+			{
+				rectMin = rectMax = Q;
+			}
+			else
+			{
+				rectMin.x = std::min(rectMin.x, Q.x);
+				rectMin.y = std::min(rectMin.y, Q.y);
+				rectMax.x = std::max(rectMax.x, Q.x);
+				rectMax.y = std::max(rectMax.y, Q.y);
+			}
+		}
+
+		//to be robust to rounding errors
+		CCVector2 margin = (rectMax - rectMin) * static_cast<PointCoordinateType>(1.0e-3);
+		margin.x += static_cast<PointCoordinateType>(1.0e-3);
+		margin.y += static_cast<PointCoordinateType>(1.0e-3);
+		rectMin -= margin;
+		rectMax += margin;
+
+		return true;
+	}
+
+	//! Hides all the (visible) points of a cell
+	void hidePoints(const CellRange& cell) const
+	{
+		for (unsigned pos = cell.begin; pos < cell.end; ++pos)
+		{
+			unsigned char& vis = m_visibility[m_codes[pos].theIndex];
+			if (vis == POINT_VISIBLE)
+				vis = POINT_HIDDEN;
+		}
+	}
+
+	const GenericIndexedCloudPersist* m_cloud;
+	const DgmOctree* m_octree;
+	const DgmOctree::cellsContainer& m_codes;
+	const ManualSegmentationTools::PolygonIndex& m_polygon;
+	const ManualSegmentationTools::Projector& m_projector;
+	bool m_keepInside;
+	std::vector<unsigned char>& m_visibility;
+};
+
+bool ManualSegmentationTools::segment(	GenericIndexedCloudPersist* cloud,
+										const PolygonIndex& polygon,
+										const Projector& projector,
+										bool keepInside,
+										std::vector<unsigned char>& visibility,
+										DgmOctree* octree/*=nullptr*/,
+										GenericProgressCallback* progressCb/*=nullptr*/)
+{
+	if (!cloud || visibility.size() != cloud->size())
+	{
+		assert(false);
+		return false;
+	}
+
+	//the octree can only be used if all the points have been projected
+	if (octree && (octree->associatedCloud() != cloud || octree->getNumberOfProjectedPoints() != cloud->size()))
+	{
+		octree = nullptr;
+	}
+
+	std::atomic<bool> canceled(false);
+
+	if (octree)
+	{
+		OctreeSegmenter segmenter(cloud, octree, polygon, projector, keepInside, visibility);
+
+		//the cells of the first levels are processed in parallel
+		static const unsigned char s_startLevel = 4;
+		std::vector<OctreeSegmenter::CellRange> cells;
+		try
+		{
+			segmenter.getCells(s_startLevel, cells);
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			return false;
+		}
+
+		NormalizedProgress nProgress(progressCb, static_cast<unsigned>(cells.size()));
+		int cellCount = static_cast<int>(cells.size());
+#ifdef USE_TBB
+		tbb::parallel_for(0, cellCount, [&](int c)
+#else
+		for (int c = 0; c < cellCount; ++c)
+#endif
+		{
+			if (!canceled)
+			{
+				segmenter.processCell(cells[c]);
+
+				if (!nProgress.oneStep())
+				{
+					canceled = true;
+				}
+			}
+		}
+#ifdef USE_TBB
+		);
+#endif
+	}
+	else
+	{
+		static const unsigned s_chunkSize = 65536;
+		unsigned count = cloud->size();
+		int chunkCount = static_cast<int>((count + s_chunkSize - 1) / s_chunkSize);
+
+		NormalizedProgress nProgress(progressCb, static_cast<unsigned>(chunkCount));
+#ifdef USE_TBB
+		tbb::parallel_for(0, chunkCount, [&](int c)
+#else
+		for (int c = 0; c < chunkCount; ++c)
+#endif
+		{
+			if (!canceled)
+			{
+				unsigned firstIndex = static_cast<unsigned>(c) * s_chunkSize;
+				unsigned lastIndex = std::min(firstIndex + s_chunkSize, count);
+				for (unsigned i = firstIndex; i < lastIndex; ++i)
+				{
+					if (visibility[i] == POINT_VISIBLE)
+					{
+						CCVector3 P;
+						cloud->getPoint(i, P);
+						bool pointInside = polygon.isPointInside(projector.project(P));
+						if (pointInside != keepInside)
+							visibility[i] = POINT_HIDDEN;
+					}
+				}
+
+				if (!nProgress.oneStep())
+				{
+					canceled = true;
+				}
+			}
+		}
+#ifdef USE_TBB
+		);
+#endif
+	}
+
+	return !canceled;
 }
 
 bool ManualSegmentationTools::isPointInsidePoly(const CCVector2& P, const GenericIndexedCloud* polyVertices)
@@ -0,0 +1,217 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 or later of the  #
+//#  License.                                                              #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include <MeshAdjacency.h>
+
+//local
+#include <GenericIndexedMesh.h>
+#include <ParallelSort.h>
+
+//system
+#include <algorithm>
+
+using namespace CCLib;
+
+MeshAdjacency::MeshAdjacency()
+	: m_vertexCount(0)
+	, m_triangleCount(0)
+	, m_valid(false)
+{
+}
+
+void MeshAdjacency::clear()
+{
+	m_edgeKeys.resize(0);
+	m_edgeKeys.shrink_to_fit();
+	m_edgeTriCounts.resize(0);
+	m_edgeTriCounts.shrink_to_fit();
+	m_vertTriOffsets.resize(0);
+	m_vertTriOffsets.shrink_to_fit();
+	m_vertTriangles.resize(0);
+	m_vertTriangles.shrink_to_fit();
+	m_vertNeighOffsets.resize(0);
+	m_vertNeighOffsets.shrink_to_fit();
+	m_vertNeighbours.resize(0);
+	m_vertNeighbours.shrink_to_fit();
+
+	m_vertexCount = 0;
+	m_triangleCount = 0;
+	m_valid = false;
+}
+
+bool MeshAdjacency::build(GenericIndexedMesh* mesh, unsigned vertexCount/*=0*/)
+{
+	clear();
+
+	if (!mesh)
+	{
+		assert(false);
+		return false;
+	}
+
+	unsigned triCount = mesh->size();
+
+	try
+	{
+		//we read the triangles only once (getNextTriangleVertIndexes is faster for mesh groups!)
+		std::vector<VerticesIndexes> triangles;
+		triangles.resize(triCount);
+		{
+			unsigned maxIndex = 0;
+			mesh->placeIteratorAtBeginning();
+			for (unsigned n = 0; n < triCount; ++n)
+			{
+				const VerticesIndexes* tsi = mesh->getNextTriangleVertIndexes();
+				triangles[n] = *tsi;
+				maxIndex = std::max(maxIndex, std::max(tsi->i1, std::max(tsi->i2, tsi->i3)));
+			}
+
+			if (vertexCount == 0)
+			{
+				vertexCount = (triCount != 0 ? maxIndex + 1 : 0);
+			}
+			else if (triCount != 0 && maxIndex >= vertexCount)
+			{
+				//invalid vertex index
+				return false;
+			}
+		}
+
+		//unique edges (sorted by key) and the number of triangles using them
+		{
+			std::vector<unsigned long long> keys;
+			keys.resize(static_cast<size_t>(triCount) * 3);
+			for (unsigned n = 0; n < triCount; ++n)
+			{
+				const VerticesIndexes& tsi = triangles[n];
+				keys[3 * static_cast<size_t>(n)    ] = ComputeEdgeKey(tsi.i1, tsi.i2);
+				keys[3 * static_cast<size_t>(n) + 1] = ComputeEdgeKey(tsi.i2, tsi.i3);
+				keys[3 * static_cast<size_t>(n) + 2] = ComputeEdgeKey(tsi.i3, tsi.i1);
+			}
+
+			ParallelSort(keys.begin(), keys.end());
+
+			//count the unique keys first
+			size_t uniqueCount = 0;
+			for (size_t i = 0; i < keys.size(); ++i)
+			{
+				if (i == 0 || keys[i] != keys[i - 1])
+					++uniqueCount;
+			}
+
+			m_edgeKeys.reserve(uniqueCount);
+			m_edgeTriCounts.reserve(uniqueCount);
+			for (size_t i = 0; i < keys.size(); ++i)
+			{
+				if (i == 0 || keys[i] != keys[i - 1])
+				{
+					m_edgeKeys.push_back(keys[i]);
+					m_edgeTriCounts.push_back(1);
+				}
+				else
+				{
+					++m_edgeTriCounts.back();
+				}
+			}
+		}
+
+		//triangles using each vertex (CSR)
+		{
+			m_vertTriOffsets.resize(static_cast<size_t>(vertexCount) + 1, 0);
+			for (const VerticesIndexes& tsi : triangles)
+			{
+				++m_vertTriOffsets[tsi.i1 + 1];
+				if (tsi.i2 != tsi.i1)
+					++m_vertTriOffsets[tsi.i2 + 1];
+				if (tsi.i3 != tsi.i1 && tsi.i3 != tsi.i2)
+					++m_vertTriOffsets[tsi.i3 + 1];
+			}
+			for (unsigned i = 0; i < vertexCount; ++i)
+			{
+				m_vertTriOffsets[i + 1] += m_vertTriOffsets[i];
+			}
+
+			m_vertTriangles.resize(m_vertTriOffsets.back());
+			std::vector<unsigned> fillPos(m_vertTriOffsets.begin(), m_vertTriOffsets.end() - 1);
+			for (unsigned n = 0; n < triCount; ++n)
+			{
+				const VerticesIndexes& tsi = triangles[n];
+				m_vertTriangles[fillPos[tsi.i1]++] = n;
+				if (tsi.i2 != tsi.i1)
+					m_vertTriangles[fillPos[tsi.i2]++] = n;
+				if (tsi.i3 != tsi.i1 && tsi.i3 != tsi.i2)
+					m_vertTriangles[fillPos[tsi.i3]++] = n;
+			}
+		}
+
+		//neighbours of each vertex (CSR)
+		{
+			m_vertNeighOffsets.resize(static_cast<size_t>(vertexCount) + 1, 0);
+			for (unsigned long long key : m_edgeKeys)
+			{
+				unsigned i1, i2;
+				DecodeEdgeKey(key, i1, i2);
+				if (i1 != i2) //degenerate edge
+				{
+					++m_vertNeighOffsets[i1 + 1];
+					++m_vertNeighOffsets[i2 + 1];
+				}
+			}
+			for (unsigned i = 0; i < vertexCount; ++i)
+			{
+				m_vertNeighOffsets[i + 1] += m_vertNeighOffsets[i];
+			}
+
+			//as the edges are sorted by key, the neighbours of each vertex end up sorted as well
+			m_vertNeighbours.resize(m_vertNeighOffsets.back());
+			std::vector<unsigned> fillPos(m_vertNeighOffsets.begin(), m_vertNeighOffsets.end() - 1);
+			for (unsigned long long key : m_edgeKeys)
+			{
+				unsigned i1, i2;
+				DecodeEdgeKey(key, i1, i2);
+				if (i1 != i2)
+				{
+					m_vertNeighbours[fillPos[i1]++] = i2;
+					m_vertNeighbours[fillPos[i2]++] = i1;
+				}
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		clear();
+		return false;
+	}
+
+	m_vertexCount = vertexCount;
+	m_triangleCount = triCount;
+	m_valid = true;
+
+	return true;
+}
+
+int MeshAdjacency::findEdge(unsigned i1, unsigned i2) const
+{
+	unsigned long long key = ComputeEdgeKey(i1, i2);
+	std::vector<unsigned long long>::const_iterator it = std::lower_bound(m_edgeKeys.begin(), m_edgeKeys.end(), key);
+	if (it == m_edgeKeys.end() || *it != key)
+		return -1;
+
+	return static_cast<int>(it - m_edgeKeys.begin());
+}
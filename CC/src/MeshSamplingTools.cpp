@@ -22,14 +22,120 @@
 #include <GenericIndexedMesh.h>
 #include <GenericProgressCallback.h>
 #include <GenericTriangle.h>
+#include <MeshAdjacency.h>
 #include <PointCloud.h>
 #include <ScalarField.h>
 
 //system
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <random>
 
+#ifdef USE_TBB
+#include <tbb/parallel_for.h>
+#endif
+
 using namespace CCLib;
 
+//! Number of triangles processed by each sampling task
+static const unsigned s_samplingChunkSize = 4096;
+
+//! Processes chunks of triangles (in parallel if possible)
+template <class ChunkFunc> static void ForEachChunk(int chunkCount, bool parallel, ChunkFunc func)
+{
+#ifdef USE_TBB
+	if (parallel)
+	{
+		tbb::parallel_for(0, chunkCount, func);
+		return;
+	}
+#else
+	(void)parallel; //the chunks are always processed sequentially without TBB
+#endif
+	for (int c = 0; c < chunkCount; ++c)
+	{
+		func(c);
+	}
+}
+
+//! Triangles reader
+/** Indexed meshes can be read concurrently (see GenericIndexedMesh::getTriangleVertices).
+	Other meshes must be read sequentially (i.e. chunks processed in order) with the
+	global iterator, after a call to TriangleReader::reset.
+**/
+class TriangleReader
+{
+public:
+	explicit TriangleReader(GenericMesh* mesh)
+		: m_mesh(mesh)
+		, m_indexedMesh(dynamic_cast<GenericIndexedMesh*>(mesh))
+	{
+		reset();
+	}
+
+	//! Returns whether the triangles can be read concurrently
+	inline bool isThreadSafe() const { return m_indexedMesh != nullptr; }
+
+	//! Resets the (sequential) reading
+	inline void reset() { if (!m_indexedMesh) m_mesh->placeIteratorAtBeginning(); }
+
+	//! Returns the vertices of a given triangle
+	inline void getTriangle(unsigned triIndex, CCVector3& A, CCVector3& B, CCVector3& C)
+	{
+		if (m_indexedMesh)
+		{
+			m_indexedMesh->getTriangleVertices(triIndex, A, B, C);
+		}
+		else
+		{
+			GenericTriangle* tri = m_mesh->_getNextTriangle();
+			A = *tri->_getA();
+			B = *tri->_getB();
+			C = *tri->_getC();
+		}
+	}
+
+protected:
+	GenericMesh* m_mesh;
+	GenericIndexedMesh* m_indexedMesh;
+};
+
+//! Deterministic random stream (SplitMix64)
+/** Each triangle has its own streams, derived from the sampling seed and the
+	triangle index. The sampled points are therefore the same whatever the
+	number of threads and the order in which the triangles are processed.
+**/
+class RandomStream
+{
+public:
+	//! Stream purpose
+	enum Purpose { TRIANGLE_COUNT = 0, TRIANGLE_SAMPLES = 1, GLOBAL = 2 };
+
+	RandomStream(uint64_t seed, Purpose purpose, unsigned index)
+		: m_state(seed + Mix((static_cast<uint64_t>(purpose) << 32) | index))
+	{}
+
+	//! Returns a uniform random number in [0, 1)
+	inline double uniform()
+	{
+		m_state += 0x9E3779B97F4A7C15ULL;
+		return (Mix(m_state) >> 11) * (1.0 / 9007199254740992.0); //53 bits mantissa
+	}
+
+protected:
+	static inline uint64_t Mix(uint64_t z)
+	{
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	uint64_t m_state;
+};
+
 double MeshSamplingTools::computeMeshArea(GenericMesh* mesh)
 {
 	if (!mesh)
@@ -38,23 +144,47 @@ double MeshSamplingTools::computeMeshArea(GenericMesh* mesh)
 		return -1.0;
 	}
 
-	//total area
-	double Stotal = 0.0;
+	unsigned triCount = mesh->size();
+	int chunkCount = static_cast<int>((triCount + s_samplingChunkSize - 1) / s_samplingChunkSize);
 
-	mesh->placeIteratorAtBeginning();
-	for (unsigned n=0; n<mesh->size(); ++n)
+	//per-chunk (twice the) areas, summed afterwards in a fixed order
+	std::vector<double> chunkAreas;
+	try
 	{
-		GenericTriangle* tri = mesh->_getNextTriangle();
+		chunkAreas.resize(chunkCount, 0.0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return -1.0;
+	}
+
+	TriangleReader reader(mesh);
+	ForEachChunk(chunkCount, reader.isThreadSafe(), [&](int c)
+	{
+		unsigned firstIndex = static_cast<unsigned>(c) * s_samplingChunkSize;
+		unsigned lastIndex = std::min(firstIndex + s_samplingChunkSize, triCount);
 
-		//vertices
-		const CCVector3* O = tri->_getA();
-		const CCVector3* A = tri->_getB();
-		const CCVector3* B = tri->_getC();
+		double S = 0.0;
+		for (unsigned n = firstIndex; n < lastIndex; ++n)
+		{
+			//vertices
+			CCVector3 O, A, B;
+			reader.getTriangle(n, O, A, B);
+
+			//compute the area of the triangle (= half of the vector product norm)
+			CCVector3 OA = A - O;
+			CCVector3 OB = B - O;
+			S += OA.cross(OB).norm();
+		}
+		chunkAreas[c] = S;
+	});
 
-		//compute the area of the triangle (= half of the vector product norm)
-		CCVector3 OA = *A - *O;
-		CCVector3 OB = *B - *O;
-		Stotal += OA.cross(OB).norm();
+	//total area
+	double Stotal = 0.0;
+	for (double S : chunkAreas)
+	{
+		Stotal += S;
 	}
 
 	return Stotal / 2;
@@ -99,75 +229,37 @@ double MeshSamplingTools::computeMeshVolume(GenericMesh* mesh)
 	return fabs(Vtotal); //in case the triangles are in the wrong order!
 }
 
-unsigned long long MeshSamplingTools::ComputeEdgeKey(unsigned i1, unsigned i2)
-{
-	//build unique index
-	if (i1 > i2)
-		std::swap(i1,i2);
-	return ((static_cast<unsigned long long>(i2) << 32) | static_cast<unsigned long long>(i1));
-}
-
-void MeshSamplingTools::DecodeEdgeKey(unsigned long long key, unsigned& i1, unsigned& i2)
-{
-	i1 = static_cast<unsigned>(  key        & 0x00000000FFFFFFFF );
-	i2 = static_cast<unsigned>( (key >> 32) & 0x00000000FFFFFFFF );
-}
-
-bool MeshSamplingTools::buildMeshEdgeUsageMap(GenericIndexedMesh* mesh, EdgeUsageMap& edgeMap)
+bool MeshSamplingTools::computeMeshEdgesConnectivity(GenericIndexedMesh* mesh, EdgeConnectivityStats& stats)
 {
-	edgeMap.clear();
+	stats = EdgeConnectivityStats();
 
 	if (!mesh)
 		return false;
 
-	try
-	{
-		mesh->placeIteratorAtBeginning();
-		//for all triangles
-		for (unsigned n=0; n<mesh->size(); ++n)
-		{
-			VerticesIndexes* tri = mesh->getNextTriangleVertIndexes();
-
-			//for all edges
-			for (unsigned j=0; j<3; ++j)
-			{
-				unsigned i1 = tri->i[j];
-				unsigned i2 = tri->i[(j+1) % 3];
-				//build unique index
-				unsigned long long edgeKey = ComputeEdgeKey(i1,i2);
-				++edgeMap[edgeKey];
-			}
-		}
-	}
-	catch (const std::bad_alloc&)
-	{
-		//not enough memory
+	//count the number of triangles using each edge
+	MeshAdjacency adjacency;
+	if (!adjacency.build(mesh))
 		return false;
-	}
 
-	return true;
+	return computeMeshEdgesConnectivity(adjacency, stats);
 }
 
-bool MeshSamplingTools::computeMeshEdgesConnectivity(GenericIndexedMesh* mesh, EdgeConnectivityStats& stats)
+bool MeshSamplingTools::computeMeshEdgesConnectivity(const MeshAdjacency& adjacency, EdgeConnectivityStats& stats)
 {
 	stats = EdgeConnectivityStats();
 
-	if (!mesh)
-		return false;
-
-	//count the number of triangles using each edge
-	EdgeUsageMap edgeCounters;
-	if (!buildMeshEdgeUsageMap(mesh,edgeCounters))
+	if (!adjacency.isValid())
 		return false;
 
 	//for all edges
-	stats.edgesCount = static_cast<unsigned>(edgeCounters.size());
-	for (std::map<unsigned long long, unsigned>::const_iterator edgeIt = edgeCounters.begin(); edgeIt != edgeCounters.end(); ++edgeIt)
+	stats.edgesCount = adjacency.edgeCount();
+	for (unsigned i = 0; i < stats.edgesCount; ++i)
 	{
-		assert(edgeIt->second != 0);
-		if (edgeIt->second == 1)
+		unsigned triCount = adjacency.edgeTriangleCount(i);
+		assert(triCount != 0);
+		if (triCount == 1)
 			++stats.edgesNotShared;
-		else if (edgeIt->second == 2)
+		else if (triCount == 2)
 			++stats.edgesSharedByTwo;
 		else
 			++stats.edgesSharedByMore;
@@ -181,41 +273,53 @@ bool MeshSamplingTools::flagMeshVerticesByType(GenericIndexedMesh* mesh, ScalarF
 	if (!mesh || !flags || flags->currentSize() == 0)
 		return false;
 
-	//'non-processed' flag
-	flags->fill(NAN_VALUE);
-
 	//count the number of triangles using each edge
-	EdgeUsageMap edgeCounters;
-	if (!buildMeshEdgeUsageMap(mesh, edgeCounters))
+	MeshAdjacency adjacency;
+	if (!adjacency.build(mesh, flags->currentSize()))
+		return false;
+
+	return flagMeshVerticesByType(adjacency, flags, stats);
+}
+
+bool MeshSamplingTools::flagMeshVerticesByType(const MeshAdjacency& adjacency, ScalarField* flags, EdgeConnectivityStats* stats/*=0*/)
+{
+	if (!adjacency.isValid() || !flags || flags->currentSize() < adjacency.vertexCount())
 		return false;
 
+	//'non-processed' flag
+	flags->fill(NAN_VALUE);
+
 	//now scan all the edges and flag their vertices
 	{
 		if (stats)
-			stats->edgesCount = static_cast<unsigned>(edgeCounters.size());
+		{
+			*stats = EdgeConnectivityStats();
+			stats->edgesCount = adjacency.edgeCount();
+		}
 
-		//for all edges
-		for (std::map<unsigned long long, unsigned>::const_iterator edgeIt = edgeCounters.begin(); edgeIt != edgeCounters.end(); ++edgeIt)
+		//for all edges (sorted by key)
+		for (unsigned i = 0; i < adjacency.edgeCount(); ++i)
 		{
 			unsigned i1, i2;
-			DecodeEdgeKey(edgeIt->first, i1, i2);
+			MeshAdjacency::DecodeEdgeKey(adjacency.edgeKey(i), i1, i2);
 
+			unsigned triCount = adjacency.edgeTriangleCount(i);
 			ScalarType flag = NAN_VALUE;
-			if (edgeIt->second == 1)
+			if (triCount == 1)
 			{
 				//only one triangle uses this edge
 				flag = static_cast<ScalarType>(VERTEX_BORDER);
 				if (stats)
 					++stats->edgesNotShared;
 			}
-			else if (edgeIt->second == 2)
+			else if (triCount == 2)
 			{
 				//two triangles use this edge
 				flag = static_cast<ScalarType>(VERTEX_NORMAL);
 				if (stats)
 					++stats->edgesSharedByTwo;
 			}
-			else if (edgeIt->second > 2)
+			else if (triCount > 2)
 			{
 				//more than two triangles use this edge!
 				flag = static_cast<ScalarType>(VERTEX_NON_MANIFOLD);
@@ -237,9 +341,10 @@ bool MeshSamplingTools::flagMeshVerticesByType(GenericIndexedMesh* mesh, ScalarF
 PointCloud* MeshSamplingTools::samplePointsOnMesh(	GenericMesh* mesh,
 													unsigned numberOfPoints,
 													GenericProgressCallback* progressCb/*=0*/,
-													std::vector<unsigned>* triIndices/*=0*/)
+													std::vector<unsigned>* triIndices/*=0*/,
+													unsigned randomSeed/*=0*/)
 {
-	if (!mesh)
+	if (!mesh || numberOfPoints == 0)
         return nullptr;
 
 	//total mesh surface
@@ -251,154 +356,277 @@ PointCloud* MeshSamplingTools::samplePointsOnMesh(	GenericMesh* mesh,
 	double samplingDensity = numberOfPoints / Stotal;
 
     //no normal needs to be computed here
-	return samplePointsOnMesh(mesh, samplingDensity, numberOfPoints, progressCb, triIndices);
+	return samplePointsOnMesh(mesh, samplingDensity, numberOfPoints, randomSeed, progressCb, triIndices);
 }
 
 PointCloud* MeshSamplingTools::samplePointsOnMesh(	GenericMesh* mesh,
 													double samplingDensity,
 													GenericProgressCallback* progressCb/*=0*/,
-													std::vector<unsigned>* triIndices/*=0*/)
+													std::vector<unsigned>* triIndices/*=0*/,
+													unsigned randomSeed/*=0*/)
 {
-	if (!mesh)
+	if (!mesh || samplingDensity <= 0)
         return nullptr;
 
-	//we must compute the total area to deduce the number of points
-	double Stotal = computeMeshArea(mesh);
-
-	unsigned theoreticNumberOfPoints = static_cast<unsigned>(ceil(Stotal * samplingDensity));
-
-	return samplePointsOnMesh(mesh, samplingDensity, theoreticNumberOfPoints, progressCb, triIndices);
+	return samplePointsOnMesh(mesh, samplingDensity, 0, randomSeed, progressCb, triIndices);
 }
 
 PointCloud* MeshSamplingTools::samplePointsOnMesh(	GenericMesh* mesh,
 													double samplingDensity,
-													unsigned theoreticNumberOfPoints,
+													unsigned exactNumberOfPoints,
+													unsigned randomSeed,
 													GenericProgressCallback* progressCb,
 													std::vector<unsigned>* triIndices/*=0*/)
 {
-	if (theoreticNumberOfPoints < 1)
-        return nullptr;
-
 	assert(mesh);
 	unsigned triCount = (mesh ? mesh->size() : 0);
 	if (triCount == 0)
 		return nullptr;
 
-	PointCloud* sampledCloud = new PointCloud();
-	if (!sampledCloud->reserve(theoreticNumberOfPoints)) //not enough memory
+	if (randomSeed == 0)
 	{
-		delete sampledCloud;
-		return nullptr;
+		std::random_device rd; //non-deterministic generator
+		randomSeed = rd();
 	}
-
-	if (triIndices)
+	bool exactCount = (exactNumberOfPoints != 0);
+
+	int chunkCount = static_cast<int>((triCount + s_samplingChunkSize - 1) / s_samplingChunkSize);
+
+	//number of points to sample on each triangle
+	std::vector<unsigned> triPointCounts;
+	//fractional part of the (theoretical) number of points of each triangle (exact count mode only)
+	std::vector<float> triFractions;
+	//sum of the fractional parts of each chunk (exact count mode only)
+	std::vector<double> chunkFractions;
+	//number of points (then index of the first point) of each chunk
+	std::vector<uint64_t> chunkPointCounts;
+	try
 	{
-	    triIndices->clear(); //just in case
-		try
+		triPointCounts.resize(triCount);
+		chunkPointCounts.resize(static_cast<size_t>(chunkCount) + 1, 0);
+		if (exactCount)
 		{
-			triIndices->reserve(theoreticNumberOfPoints);
-		}
-		catch (const std::bad_alloc&)
-		{
-			//not enough memory? DGM TODO: we should warn the caller
-			delete sampledCloud;
-			return nullptr;
+			triFractions.resize(triCount);
+			chunkFractions.resize(static_cast<size_t>(chunkCount) + 1, 0.0);
 		}
 	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return nullptr;
+	}
 
-	NormalizedProgress normProgress(progressCb, triCount);
+	NormalizedProgress normProgress(progressCb, static_cast<unsigned>(chunkCount) * 2);
     if (progressCb)
     {
 		if (progressCb->textCanBeEdited())
 		{
 			progressCb->setMethodTitle("Mesh sampling");
 			char buffer[256];
-			sprintf(buffer, "Triangles: %u\nPoints: %u", triCount, theoreticNumberOfPoints);
+			if (exactCount)
+				sprintf(buffer, "Triangles: %u\nPoints: %u", triCount, exactNumberOfPoints);
+			else
+				sprintf(buffer, "Triangles: %u\nDensity: %g", triCount, samplingDensity);
 			progressCb->setInfo(buffer);
 		}
         progressCb->update(0);
 		progressCb->start();
 	}
 
-	unsigned addedPoints = 0;
-	std::random_device rd;   // non-deterministic generator
-	std::mt19937 gen(rd());  // to seed mersenne twister.
-	std::uniform_real_distribution<double> dist(0, 1);
+	std::atomic<bool> canceled(false);
+	TriangleReader reader(mesh);
 
-	//for each triangle
-	mesh->placeIteratorAtBeginning();
-	for (unsigned n = 0; n < triCount; ++n)
+	//first pass: number of points to sample on each triangle
+	ForEachChunk(chunkCount, reader.isThreadSafe(), [&](int c)
 	{
-		const GenericTriangle* tri = mesh->_getNextTriangle();
+		if (canceled)
+			return;
+
+		unsigned firstIndex = static_cast<unsigned>(c) * s_samplingChunkSize;
+		unsigned lastIndex = std::min(firstIndex + s_samplingChunkSize, triCount);
+
+		uint64_t chunkPoints = 0;
+		double chunkFraction = 0.0;
+		for (unsigned n = firstIndex; n < lastIndex; ++n)
+		{
+			//vertices (OAB)
+			CCVector3 O, A, B;
+			reader.getTriangle(n, O, A, B);
+
+			//we compute the triangle area
+			CCVector3 N = (A - O).cross(B - O);
+			double S = N.normd() / 2;
 
-		//vertices (OAB)
-		const CCVector3 *O = tri->_getA();
-		const CCVector3 *A = tri->_getB();
-		const CCVector3 *B = tri->_getC();
+			//we deduce the number of points to generate on this face
+			double fPointsToAdd = S * samplingDensity;
+			unsigned pointsToAdd = static_cast<unsigned>(fPointsToAdd);
 
-		//edges (OA and OB)
-		CCVector3 u = *A - *O;
-		CCVector3 v = *B - *O;
+			//take care of the remaining fractional part
+			double fracPart = fPointsToAdd - static_cast<double>(pointsToAdd);
+			if (exactCount)
+			{
+				//will be handled globally (see below)
+				triFractions[n] = static_cast<float>(fracPart);
+				chunkFraction += triFractions[n];
+			}
+			else if (fracPart > 0)
+			{
+				//we add a point with the same probability as its (relative) area
+				if (RandomStream(randomSeed, RandomStream::TRIANGLE_COUNT, n).uniform() < fracPart)
+					pointsToAdd += 1;
+			}
 
-		//we compute the (twice) the triangle area
-		CCVector3 N = u.cross(v);
-		double S = N.normd() / 2;
+			triPointCounts[n] = pointsToAdd;
+			chunkPoints += pointsToAdd;
+		}
 
-		//we deduce the number of points to generate on this face
-		double fPointsToAdd = S*samplingDensity;
-		unsigned pointsToAdd = static_cast<unsigned>(fPointsToAdd);
+		chunkPointCounts[c] = chunkPoints;
+		if (exactCount)
+		{
+			chunkFractions[c] = chunkFraction;
+		}
 
-		//take care of the remaining fractional part
-		double fracPart = fPointsToAdd - static_cast<double>(pointsToAdd);
-		if (fracPart > 0)
+		if (!normProgress.oneStep())
 		{
-			//we add a point with the same probability as its (relative) area
-			if (dist(gen) <= fracPart)
-				pointsToAdd += 1;
+			canceled = true;
 		}
+	});
 
-		if (pointsToAdd)
+	if (exactCount && !canceled)
+	{
+		//the remaining points are distributed on the triangles by systematic sampling of
+		//their fractional parts: each triangle receives an additional point with a
+		//probability equal to its fractional part, and the total is exactly the requested one
+		uint64_t pointCount = 0;
+		for (int c = 0; c < chunkCount; ++c)
+		{
+			pointCount += chunkPointCounts[c];
+		}
+		uint64_t remainingPoints = (pointCount < exactNumberOfPoints ? exactNumberOfPoints - pointCount : 0);
+
+		//prefix sum of the fractional parts
+		double fractionSum = 0.0;
+		for (int c = 0; c <= chunkCount; ++c)
 		{
-			if (addedPoints + pointsToAdd >= theoreticNumberOfPoints)
+			double chunkFraction = chunkFractions[c];
+			chunkFractions[c] = fractionSum;
+			fractionSum += chunkFraction;
+		}
+		double totalFraction = chunkFractions[chunkCount];
+
+		if (remainingPoints != 0 && totalFraction > 0)
+		{
+			double scale = remainingPoints / totalFraction;
+			double offset = RandomStream(randomSeed, RandomStream::GLOBAL, 0).uniform();
+
+			//number of remaining points sampled before a given (cumulated) fraction
+			auto pointsBefore = [&](double cumulatedFraction) -> uint64_t
 			{
-				theoreticNumberOfPoints += pointsToAdd;
-				//reserve memory for the cloud
-				if (!sampledCloud->reserve(theoreticNumberOfPoints))
-				{
-					delete sampledCloud;
-					sampledCloud = nullptr;
-					if (triIndices)
-					{
-						triIndices->clear();
-					}
-					break;
-				}
-				//reserve memory for the triangle indexes
-				if (triIndices && triIndices->capacity() < theoreticNumberOfPoints) //not enough memory
+				if (cumulatedFraction >= totalFraction)
+					return remainingPoints;
+				return std::min(static_cast<uint64_t>(cumulatedFraction * scale + offset), remainingPoints);
+			};
+
+			ForEachChunk(chunkCount, true, [&](int c)
+			{
+				unsigned firstIndex = static_cast<unsigned>(c) * s_samplingChunkSize;
+				unsigned lastIndex = std::min(firstIndex + s_samplingChunkSize, triCount);
+
+				//the fractions are cumulated in the same order as the chunk sums
+				//so that the chunk boundaries match exactly
+				double localFraction = 0.0;
+				uint64_t before = pointsBefore(chunkFractions[c]);
+				for (unsigned n = firstIndex; n < lastIndex; ++n)
 				{
-					try
-					{
-						triIndices->reserve(theoreticNumberOfPoints);
-					}
-					catch (const std::bad_alloc&)
+					localFraction += triFractions[n];
+					uint64_t after = pointsBefore(n + 1 == lastIndex ? chunkFractions[c + 1] : chunkFractions[c] + localFraction);
+					if (after != before)
 					{
-						delete sampledCloud;
-						sampledCloud = nullptr;
-						if (triIndices)
-						{
-							triIndices->clear();
-						}
-						break;
+						triPointCounts[n] += static_cast<unsigned>(after - before);
+						chunkPointCounts[c] += after - before;
+						before = after;
 					}
 				}
-			}
+			});
+		}
 
-			for (unsigned i = 0; i < pointsToAdd; ++i)
+		triFractions.resize(0);
+		triFractions.shrink_to_fit();
+	}
+
+	if (canceled)
+	{
+		return nullptr;
+	}
+
+	//prefix sum: index of the first point of each chunk
+	uint64_t pointCount = 0;
+	for (int c = 0; c <= chunkCount; ++c)
+	{
+		uint64_t chunkPoints = chunkPointCounts[c];
+		chunkPointCounts[c] = pointCount;
+		pointCount += chunkPoints;
+	}
+	if (pointCount > std::numeric_limits<unsigned>::max())
+	{
+		//too many points
+		return nullptr;
+	}
+
+	PointCloud* sampledCloud = new PointCloud();
+	if (!sampledCloud->resize(static_cast<unsigned>(pointCount))) //not enough memory
+	{
+		delete sampledCloud;
+		return nullptr;
+	}
+
+	if (triIndices)
+	{
+		try
+		{
+			triIndices->resize(static_cast<size_t>(pointCount));
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory? DGM TODO: we should warn the caller
+			delete sampledCloud;
+			triIndices->clear();
+			return nullptr;
+		}
+	}
+
+	//second pass: points generation
+	reader.reset();
+	ForEachChunk(chunkCount, reader.isThreadSafe(), [&](int c)
+	{
+		if (canceled)
+			return;
+
+		unsigned firstIndex = static_cast<unsigned>(c) * s_samplingChunkSize;
+		unsigned lastIndex = std::min(firstIndex + s_samplingChunkSize, triCount);
+
+		unsigned pointIndex = static_cast<unsigned>(chunkPointCounts[c]);
+		for (unsigned n = firstIndex; n < lastIndex; ++n)
+		{
+			//vertices (OAB)
+			CCVector3 O, A, B;
+			reader.getTriangle(n, O, A, B);
+
+			unsigned pointsToAdd = triPointCounts[n];
+			if (pointsToAdd == 0)
+				continue;
+
+			//edges (OA and OB)
+			CCVector3 u = A - O;
+			CCVector3 v = B - O;
+
+			RandomStream random(randomSeed, RandomStream::TRIANGLE_SAMPLES, n);
+			for (unsigned i = 0; i < pointsToAdd; ++i, ++pointIndex)
 			{
 				//we generate random points as in:
 				//'Greg Turk. Generating random points in triangles. In A. S. Glassner, editor, Graphics Gems, pages 24-28. Academic Press, 1990.'
-				double x = dist(gen);
-				double y = dist(gen);
+				double x = random.uniform();
+				double y = random.uniform();
 
 				//we test if the generated point lies on the right side of (AB)
 				if (x + y > 1.0)
@@ -407,32 +635,25 @@ PointCloud* MeshSamplingTools::samplePointsOnMesh(	GenericMesh* mesh,
 					y = 1.0 - y;
                 }
 
-				CCVector3 P = (*O) + static_cast<PointCoordinateType>(x) * u + static_cast<PointCoordinateType>(y) * v;
-
-				sampledCloud->addPoint(P);
+				*const_cast<CCVector3*>(sampledCloud->getPoint(pointIndex)) = O + static_cast<PointCoordinateType>(x) * u + static_cast<PointCoordinateType>(y) * v;
 				if (triIndices)
-					triIndices->push_back(n);
-				++addedPoints;
+					(*triIndices)[pointIndex] = n;
 			}
 		}
+		assert(pointIndex == chunkPointCounts[c + 1]);
 
-		if (progressCb && !normProgress.oneStep())
-			break;
-	}
-
-	if (sampledCloud) //can be in case of memory overflow!
-	{
-		if (addedPoints)
-		{
-			sampledCloud->resize(addedPoints); //should always be ok as addedPoints < theoreticNumberOfPoints
-			if (triIndices)
-				triIndices->resize(addedPoints);
-		}
-		else
+		if (!normProgress.oneStep())
 		{
-			if (triIndices)
-				triIndices->clear();
+			canceled = true;
 		}
+	});
+
+	if (canceled)
+	{
+		delete sampledCloud;
+		if (triIndices)
+			triIndices->clear();
+		return nullptr;
 	}
 
 	return sampledCloud;
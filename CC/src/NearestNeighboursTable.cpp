@@ -0,0 +1,186 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 or later of the  #
+//#  License.                                                              #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include <NearestNeighboursTable.h>
+
+//local
+#include <GenericIndexedCloudPersist.h>
+#include <GenericProgressCallback.h>
+#include <ReferenceCloud.h>
+
+//system
+#include <algorithm>
+#include <cmath>
+
+using namespace CCLib;
+
+NearestNeighboursTable::NearestNeighboursTable()
+	: m_pointCount(0)
+	, m_k(0)
+{
+}
+
+void NearestNeighboursTable::clear()
+{
+	m_distances.resize(0);
+	m_distances.shrink_to_fit();
+	m_indexes.resize(0);
+	m_indexes.shrink_to_fit();
+
+	m_pointCount = 0;
+	m_k = 0;
+}
+
+bool NearestNeighboursTable::compute(	GenericIndexedCloudPersist* cloud,
+										unsigned k,
+										bool storeIndexes/*=true*/,
+										DgmOctree* inputOctree/*=nullptr*/,
+										GenericProgressCallback* progressCb/*=nullptr*/)
+{
+	clear();
+
+	if (!cloud || k == 0 || cloud->size() <= k)
+	{
+		//invalid input
+		assert(false);
+		return false;
+	}
+
+	unsigned pointCount = cloud->size();
+	try
+	{
+		m_distances.resize(static_cast<size_t>(pointCount) * k);
+		if (storeIndexes)
+		{
+			m_indexes.resize(static_cast<size_t>(pointCount) * k);
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		clear();
+		return false;
+	}
+
+	DgmOctree* octree = inputOctree;
+	if (!octree)
+	{
+		//compute the octree if necessary
+		octree = new DgmOctree(cloud);
+		if (octree->build(progressCb) < 1)
+		{
+			delete octree;
+			clear();
+			return false;
+		}
+	}
+
+	m_pointCount = pointCount;
+	m_k = k;
+
+	//additional parameters
+	void* additionalParameters[] = { reinterpret_cast<void*>(this) };
+
+	//the point itself will be part of the extracted neighbours
+	unsigned char octreeLevel = octree->findBestLevelForAGivenPopulationPerCell(k + 1);
+
+	bool success = (octree->executeFunctionForAllCellsAtLevel(	octreeLevel,
+																&ComputeCellNeighbours,
+																additionalParameters,
+																true,
+																progressCb,
+																"Nearest neighbours") != 0);
+
+	if (!inputOctree)
+	{
+		delete octree;
+		octree = nullptr;
+	}
+
+	if (!success)
+	{
+		//something went wrong
+		clear();
+	}
+
+	return success;
+}
+
+bool NearestNeighboursTable::ComputeCellNeighbours(	const DgmOctree::octreeCell& cell,
+													void** additionalParameters,
+													NormalizedProgress* nProgress/*=nullptr*/)
+{
+	NearestNeighboursTable* table = static_cast<NearestNeighboursTable*>(additionalParameters[0]);
+	const unsigned k = table->m_k;
+	const bool storeIndexes = table->hasIndexes();
+
+	//structure for nearest neighbors search
+	DgmOctree::NearestNeighboursSphericalSearchStruct nNSS;
+	nNSS.level = cell.level;
+	nNSS.minNumberOfNeighbors = k + 1;
+	cell.parentOctree->getCellPos(cell.truncatedCode, cell.level, nNSS.cellPos, true);
+	cell.parentOctree->computeCellCenter(nNSS.cellPos, cell.level, nNSS.cellCenter);
+
+	unsigned n = cell.points->size(); //number of points in the current cell
+
+	//for each point in the cell
+	for (unsigned i = 0; i < n; ++i)
+	{
+		cell.points->getPoint(i, nNSS.queryPoint);
+		const unsigned globalIndex = cell.points->getPointGlobalIndex(i);
+
+		//look for the k+1 nearest neighbors (the point itself should be one of them)
+		unsigned neighborCount = std::min(cell.parentOctree->findNearestNeighborsStartingFromCell(nNSS), k + 1);
+
+		float* distances = table->m_distances.data() + static_cast<size_t>(globalIndex) * k;
+		unsigned* indexes = (storeIndexes ? table->m_indexes.data() + static_cast<size_t>(globalIndex) * k : nullptr);
+
+		unsigned count = 0;
+		for (unsigned j = 0; j < neighborCount && count < k; ++j)
+		{
+			const DgmOctree::PointDescriptor& desc = nNSS.pointsInNeighbourhood[j];
+			if (desc.pointIndex != globalIndex)
+			{
+				distances[count] = static_cast<float>(sqrt(desc.squareDistd));
+				if (indexes)
+				{
+					indexes[count] = desc.pointIndex;
+				}
+				++count;
+			}
+		}
+
+		//shouldn't happen (the cloud has more than k points)
+		assert(count == k);
+		for (; count < k; ++count)
+		{
+			distances[count] = (count != 0 ? distances[count - 1] : 0);
+			if (indexes)
+			{
+				indexes[count] = (count != 0 ? indexes[count - 1] : globalIndex);
+			}
+		}
+
+		if (nProgress && !nProgress->oneStep())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -28,6 +28,7 @@
 #include <ErrorFunction.h>
 #include <GenericCloud.h>
 #include <ScalarField.h>
+#include <ScalarFieldStatistics.h>
 #include <ScalarFieldTools.h>
 
 
@@ -101,30 +102,13 @@ bool NormalDistribution::computeParameters(const GenericCloud* cloud)
 {
 	setValid(false);
 
-	double mean = 0.0, stddev2 = 0.0;
-	unsigned counter = 0;
-
-	unsigned n = cloud->size();
-	for (unsigned i = 0; i < n; ++i)
-	{
-		ScalarType v = cloud->getPointScalarValue(i);
-		if (ScalarField::ValidValue(v))
-		{
-			mean += v;
-			stddev2 += static_cast<double>(v) * v;
-			++counter;
-		}
-	}
-
-	if (counter == 0)
+	ScalarFieldStatistics stats;
+	if (!stats.compute(cloud) || stats.validCount() == 0)
 	{
 		return false;
 	}
 
-	mean /= counter;
-	stddev2 = fabs(stddev2 / counter - mean*mean);
-
-	return setParameters(static_cast<ScalarType>(mean), static_cast<ScalarType>(stddev2));
+	return setParameters(static_cast<ScalarType>(stats.mean()), static_cast<ScalarType>(stats.variance()));
 }
 
 bool NormalDistribution::computeParameters(const ScalarContainer& values)
@@ -132,28 +116,13 @@ bool NormalDistribution::computeParameters(const ScalarContainer& values)
 	setValid(false);
 
 	//compute mean and std. dev.
-	double mean = 0.0, stddev2 = 0.0;
-	unsigned counter = 0;
-
-	for (ScalarType v : values)
-	{
-		if (ScalarField::ValidValue(v))
-		{
-			mean += v;
-			stddev2 += static_cast<double>(v) * v;
-			++counter;
-		}
-	}
-
-	if (counter == 0)
+	ScalarFieldStatistics stats;
+	if (!stats.compute(values.data(), values.size()) || stats.validCount() == 0)
 	{
 		return false;
 	}
 
-	mean /= counter;
-	stddev2 = fabs(stddev2 / counter - mean*mean);
-
-	return setParameters(static_cast<ScalarType>(mean), static_cast<ScalarType>(stddev2));
+	return setParameters(static_cast<ScalarType>(stats.mean()), static_cast<ScalarType>(stats.variance()));
 }
 
 bool NormalDistribution::computeRobustParameters(const ScalarContainer& values, double nSigma)
@@ -0,0 +1,37 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 or later of the  #
+//#  License.                                                              #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include <Profiler.h>
+
+//system
+#include <atomic>
+
+using namespace CCLib;
+
+//! Current sink
+static std::atomic<Profiler::Sink*> s_sink(nullptr);
+
+void Profiler::SetSink(Sink* sink)
+{
+	s_sink.store(sink);
+}
+
+Profiler::Sink* Profiler::GetSink()
+{
+	return s_sink.load(std::memory_order_acquire);
+}
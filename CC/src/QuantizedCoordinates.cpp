@@ -0,0 +1,381 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 or later of the  #
+//#  License.                                                              #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include <QuantizedCoordinates.h>
+
+//local
+#include <GenericIndexedCloud.h>
+
+//system
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#ifdef USE_TBB
+#include <tbb/parallel_for.h>
+#endif
+
+using namespace CCLib;
+
+//! Writes a value on a given number of bits (at most 32) in a zero-initialized bit stream
+static inline void WriteBits(std::uint64_t* stream, std::size_t bitOffset, unsigned bitCount, std::uint64_t value)
+{
+	if (bitCount == 0)
+	{
+		return;
+	}
+
+	std::size_t word = (bitOffset >> 6);
+	unsigned shift = static_cast<unsigned>(bitOffset & 63);
+	stream[word] |= (value << shift);
+	if (shift + bitCount > 64)
+	{
+		//the value straddles two words
+		stream[word + 1] |= (value >> (64 - shift));
+	}
+}
+
+//! Reads a value stored on a given number of bits (at most 32)
+static inline std::uint64_t ReadBits(const std::uint64_t* stream, std::size_t bitOffset, unsigned bitCount)
+{
+	if (bitCount == 0)
+	{
+		return 0;
+	}
+
+	std::size_t word = (bitOffset >> 6);
+	unsigned shift = static_cast<unsigned>(bitOffset & 63);
+	std::uint64_t value = (stream[word] >> shift);
+	if (shift + bitCount > 64)
+	{
+		//the value straddles two words
+		value |= (stream[word + 1] << (64 - shift));
+	}
+
+	return value & ((static_cast<std::uint64_t>(1) << bitCount) - 1);
+}
+
+//! Returns the number of bits required to store a (positive) value
+static inline unsigned char BitCount(std::uint64_t value)
+{
+	unsigned char bits = 0;
+	while (value != 0)
+	{
+		++bits;
+		value >>= 1;
+	}
+	return bits;
+}
+
+QuantizedCoordinates::QuantizedCoordinates()
+	: m_scale(1.0, 1.0, 1.0)
+	, m_offset(0, 0, 0)
+	, m_count(0)
+{
+}
+
+void QuantizedCoordinates::clear()
+{
+	m_blocks.resize(0);
+	m_blocks.shrink_to_fit();
+	m_stream.resize(0);
+	m_stream.shrink_to_fit();
+	m_count = 0;
+}
+
+template <class PointAccessor> bool QuantizedCoordinates::encodeFrom(const PointAccessor& pointAt, unsigned count, const CCVector3d& scale, const CCVector3d* offset)
+{
+	clear();
+
+	if (count == 0 || scale.x <= 0 || scale.y <= 0 || scale.z <= 0)
+	{
+		//invalid input
+		assert(false);
+		return false;
+	}
+
+	const int blockCount = static_cast<int>((count + BLOCK_SIZE - 1) / BLOCK_SIZE);
+	std::vector<CCVector3d> blockMin, blockMax;
+	try
+	{
+		m_blocks.resize(blockCount);
+		blockMin.resize(blockCount);
+		blockMax.resize(blockCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		clear();
+		return false;
+	}
+	m_count = count;
+	m_scale = scale;
+
+	//first pass: extents of each block
+#ifdef USE_TBB
+	tbb::parallel_for(0, blockCount, [&](int b)
+#else
+	for (int b = 0; b < blockCount; ++b)
+#endif
+	{
+		unsigned first = static_cast<unsigned>(b) * BLOCK_SIZE;
+		unsigned last = std::min(first + BLOCK_SIZE, count);
+		CCVector3 P;
+		pointAt(first, P);
+		CCVector3d minP = CCVector3d::fromArray(P.u);
+		CCVector3d maxP = minP;
+		for (unsigned i = first + 1; i < last; ++i)
+		{
+			pointAt(i, P);
+			for (unsigned d = 0; d < 3; ++d)
+			{
+				if (P.u[d] != P.u[d])
+				{
+					//NaN coordinates can't be quantized (the block will be rejected)
+					minP.u[d] = std::numeric_limits<double>::quiet_NaN();
+				}
+				minP.u[d] = std::min(minP.u[d], static_cast<double>(P.u[d]));
+				maxP.u[d] = std::max(maxP.u[d], static_cast<double>(P.u[d]));
+			}
+		}
+		blockMin[b] = minP;
+		blockMax[b] = maxP;
+	}
+#ifdef USE_TBB
+	);
+#endif
+
+	//coordinates origin
+	if (offset)
+	{
+		m_offset = *offset;
+	}
+	else
+	{
+		m_offset = blockMin.front();
+		for (const CCVector3d& minP : blockMin)
+		{
+			for (unsigned d = 0; d < 3; ++d)
+			{
+				m_offset.u[d] = std::min(m_offset.u[d], minP.u[d]);
+			}
+		}
+	}
+
+	//blocks layout (the quantization is monotonic: the block extents give the quantized extents)
+	std::size_t wordCount = 0;
+	for (int b = 0; b < blockCount; ++b)
+	{
+		Block& block = m_blocks[b];
+		unsigned pointBits = 0;
+		for (unsigned d = 0; d < 3; ++d)
+		{
+			double qMin = std::floor((blockMin[b].u[d] - m_offset.u[d]) / m_scale.u[d] + 0.5);
+			double qMax = std::floor((blockMax[b].u[d] - m_offset.u[d]) / m_scale.u[d] + 0.5);
+			if (	!(qMin >= std::numeric_limits<std::int32_t>::min())
+				||	!(qMax <= std::numeric_limits<std::int32_t>::max()))
+			{
+				//the quantized coordinates don't fit in 32 bits (or are invalid)
+				clear();
+				return false;
+			}
+			block.base[d] = static_cast<std::int32_t>(qMin);
+			block.bits[d] = BitCount(static_cast<std::uint64_t>(static_cast<std::int64_t>(qMax) - block.base[d]));
+			pointBits += block.bits[d];
+		}
+		block.firstWord = wordCount;
+		wordCount += (static_cast<std::size_t>(blockPointCount(b)) * pointBits + 63) / 64;
+	}
+
+	try
+	{
+		m_stream.resize(wordCount, 0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		clear();
+		return false;
+	}
+
+	//second pass: bit packing
+#ifdef USE_TBB
+	tbb::parallel_for(0, blockCount, [&](int b)
+#else
+	for (int b = 0; b < blockCount; ++b)
+#endif
+	{
+		const Block& block = m_blocks[b];
+		const unsigned pointBits = block.bits[0] + block.bits[1] + block.bits[2];
+		unsigned first = static_cast<unsigned>(b) * BLOCK_SIZE;
+		unsigned last = std::min(first + BLOCK_SIZE, count);
+		std::size_t bitOffset = block.firstWord * 64;
+		CCVector3 P;
+		for (unsigned i = first; i < last; ++i, bitOffset += pointBits)
+		{
+			pointAt(i, P);
+			std::size_t dimOffset = bitOffset;
+			for (unsigned d = 0; d < 3; ++d)
+			{
+				std::int64_t q = static_cast<std::int64_t>(std::floor((P.u[d] - m_offset.u[d]) / m_scale.u[d] + 0.5));
+				WriteBits(m_stream.data(), dimOffset, block.bits[d], static_cast<std::uint64_t>(q - block.base[d]));
+				dimOffset += block.bits[d];
+			}
+		}
+	}
+#ifdef USE_TBB
+	);
+#endif
+
+	return true;
+}
+
+bool QuantizedCoordinates::encode(const GenericIndexedCloud* cloud, const CCVector3d& scale, const CCVector3d* offset/*=nullptr*/)
+{
+	if (!cloud)
+	{
+		assert(false);
+		clear();
+		return false;
+	}
+
+	return encodeFrom([cloud](unsigned i, CCVector3& P) { cloud->getPoint(i, P); }, cloud->size(), scale, offset);
+}
+
+bool QuantizedCoordinates::encode(const CCVector3* points, unsigned count, const CCVector3d& scale, const CCVector3d* offset/*=nullptr*/)
+{
+	if (!points && count != 0)
+	{
+		assert(false);
+		clear();
+		return false;
+	}
+
+	return encodeFrom([points](unsigned i, CCVector3& P) { P = points[i]; }, count, scale, offset);
+}
+
+bool QuantizedCoordinates::assign(unsigned count, const CCVector3d& scale, const CCVector3d& offset, std::vector<Block>& blocks, std::vector<std::uint64_t>& stream)
+{
+	clear();
+
+	if (	count == 0
+		||	!(scale.x > 0) || !(scale.y > 0) || !(scale.z > 0)
+		||	blocks.size() != (count + BLOCK_SIZE - 1) / BLOCK_SIZE)
+	{
+		return false;
+	}
+
+	//blocks layout
+	std::size_t wordCount = 0;
+	for (std::size_t b = 0; b < blocks.size(); ++b)
+	{
+		Block& block = blocks[b];
+		if (block.bits[0] > 32 || block.bits[1] > 32 || block.bits[2] > 32)
+		{
+			return false;
+		}
+		unsigned pointBits = block.bits[0] + block.bits[1] + block.bits[2];
+		unsigned pointCount = (b + 1 < blocks.size() ? BLOCK_SIZE : count - static_cast<unsigned>(b) * BLOCK_SIZE);
+		block.firstWord = wordCount;
+		wordCount += (static_cast<std::size_t>(pointCount) * pointBits + 63) / 64;
+	}
+	if (wordCount != stream.size())
+	{
+		return false;
+	}
+
+	m_blocks.swap(blocks);
+	m_stream.swap(stream);
+	m_scale = scale;
+	m_offset = offset;
+	m_count = count;
+
+	return true;
+}
+
+inline void QuantizedCoordinates::decodeQuantized(const Block& block, unsigned indexInBlock, std::int64_t Q[3]) const
+{
+	std::size_t bitOffset = block.firstWord * 64 + static_cast<std::size_t>(indexInBlock) * (block.bits[0] + block.bits[1] + block.bits[2]);
+	for (unsigned d = 0; d < 3; ++d)
+	{
+		Q[d] = block.base[d] + static_cast<std::int64_t>(ReadBits(m_stream.data(), bitOffset, block.bits[d]));
+		bitOffset += block.bits[d];
+	}
+}
+
+void QuantizedCoordinates::getPoint(unsigned index, CCVector3& P) const
+{
+	assert(index < m_count);
+
+	std::int64_t Q[3];
+	decodeQuantized(m_blocks[index / BLOCK_SIZE], index % BLOCK_SIZE, Q);
+
+	P = CCVector3(	static_cast<PointCoordinateType>(m_offset.x + m_scale.x * Q[0]),
+					static_cast<PointCoordinateType>(m_offset.y + m_scale.y * Q[1]),
+					static_cast<PointCoordinateType>(m_offset.z + m_scale.z * Q[2]) );
+}
+
+void QuantizedCoordinates::decodeBlock(unsigned blockIndex, CCVector3* points) const
+{
+	assert(blockIndex < m_blocks.size() && points);
+
+	const Block& block = m_blocks[blockIndex];
+	const unsigned pointCount = blockPointCount(blockIndex);
+	const unsigned pointBits = block.bits[0] + block.bits[1] + block.bits[2];
+
+	//the block origin (in double precision)
+	const CCVector3d origin(m_offset.x + m_scale.x * block.base[0],
+							m_offset.y + m_scale.y * block.base[1],
+							m_offset.z + m_scale.z * block.base[2]);
+
+	std::size_t bitOffset = block.firstWord * 64;
+	for (unsigned i = 0; i < pointCount; ++i, bitOffset += pointBits)
+	{
+		std::size_t dimOffset = bitOffset;
+		for (unsigned d = 0; d < 3; ++d)
+		{
+			points[i].u[d] = static_cast<PointCoordinateType>(origin.u[d] + m_scale.u[d] * static_cast<double>(ReadBits(m_stream.data(), dimOffset, block.bits[d])));
+			dimOffset += block.bits[d];
+		}
+	}
+}
+
+void QuantizedCoordinates::decode(CCVector3* points) const
+{
+	assert(points || m_count == 0);
+
+	const int blockCount = static_cast<int>(m_blocks.size());
+
+#ifdef USE_TBB
+	tbb::parallel_for(0, blockCount, [&](int b)
+#else
+	for (int b = 0; b < blockCount; ++b)
+#endif
+	{
+		decodeBlock(static_cast<unsigned>(b), points + static_cast<std::size_t>(b) * BLOCK_SIZE);
+	}
+#ifdef USE_TBB
+	);
+#endif
+}
+
+std::size_t QuantizedCoordinates::memoryUsage() const
+{
+	return m_blocks.capacity() * sizeof(Block) + m_stream.capacity() * sizeof(std::uint64_t);
+}
@@ -36,6 +36,10 @@
 //system
 #include <ctime>
 
+#ifdef USE_TBB
+#include <tbb/parallel_for.h>
+#endif
+
 using namespace CCLib;
 
 void RegistrationTools::FilterTransformation(	const ScaledTransformation& inTrans,
@@ -1124,7 +1128,8 @@ bool FPCSRegistrationTools::RegisterClouds(	GenericIndexedCloud* modelCloud,
 											unsigned nbBases,
 											unsigned nbTries,
 											GenericProgressCallback* progressCb,
-											unsigned nbMaxCandidates)
+											unsigned nbMaxCandidates,
+											unsigned randomSeed)
 {
 	//DGM: KDTree::buildFromCloud will call reset right away!
 	//if (progressCb)
@@ -1138,10 +1143,10 @@ bool FPCSRegistrationTools::RegisterClouds(	GenericIndexedCloud* modelCloud,
 	//	progressCb->start();
 	//}
 
-	//Initialize random seed with current time
-	srand(static_cast<unsigned>(time(nullptr)));
+	//Initialize random seed (with current time by default)
+	srand(randomSeed != 0 ? randomSeed : static_cast<unsigned>(time(nullptr)));
 
-	unsigned bestScore = 0, score = 0;
+	unsigned bestScore = 0;
 	transform.R.invalidate();
 	transform.T = CCVector3(0,0,0);
 
@@ -1216,22 +1221,45 @@ bool FPCSRegistrationTools::RegisterClouds(	GenericIndexedCloud* modelCloud,
 				return false;
 			}
 
-			for(unsigned j=0; j<candidates.size(); j++)
+			//Apply the rigid transforms to the data cloud and compute the registration scores
+			//(the candidates are independent: they can be evaluated concurrently)
+			std::vector<unsigned> scores;
+			try
+			{
+				scores.resize(transforms.size(), 0);
+			}
+			catch (const std::bad_alloc&)
 			{
-				//Register the current candidate base with the reference base
-				const ScaledTransformation& RT = transforms[j];
-				//Apply the rigid transform to the data cloud and compute the registration score
-				if (RT.R.isValid())
+				delete dataTree;
+				delete modelTree;
+				transform.R = SquareMatrix();
+				return false;
+			}
+
+#ifdef USE_TBB
+			tbb::parallel_for(static_cast<size_t>(0), transforms.size(), [&](size_t j)
+#else
+			for (size_t j = 0; j < transforms.size(); ++j)
+#endif
+			{
+				if (transforms[j].R.isValid())
 				{
-					score = ComputeRegistrationScore(modelTree, dataCloud, delta, RT);
+					scores[j] = ComputeRegistrationScore(modelTree, dataCloud, delta, transforms[j]);
+				}
+			}
+#ifdef USE_TBB
+			);
+#endif
 
-					//Keep parameters that lead to the best result
-					if (score > bestScore)
-					{
-						transform.R = RT.R;
-						transform.T = RT.T;
-						bestScore = score;
-					}
+			//Keep parameters that lead to the best result
+			//(the first one in case of equality, so that the result doesn't depend on the number of threads)
+			for (size_t j = 0; j < scores.size(); ++j)
+			{
+				if (scores[j] > bestScore)
+				{
+					transform.R = transforms[j].R;
+					transform.T = transforms[j].T;
+					bestScore = scores[j];
 				}
 			}
 		}
@@ -1268,7 +1296,7 @@ bool FPCSRegistrationTools::RegisterClouds(	GenericIndexedCloud* modelCloud,
 }
 
 
- unsigned FPCSRegistrationTools::ComputeRegistrationScore(	KDTree *modelTree,
+ unsigned FPCSRegistrationTools::ComputeRegistrationScore(	const KDTree *modelTree,
 															GenericIndexedCloud *dataCloud,
 															ScalarType delta,
 															const ScaledTransformation& dataToModel)
@@ -1419,7 +1447,7 @@ bool FPCSRegistrationTools::FindBase(	GenericIndexedCloud* cloud,
 //pair of indexes
 using IndexPair = std::pair<unsigned,unsigned>;
 
-int FPCSRegistrationTools::FindCongruentBases(KDTree* tree,
+int FPCSRegistrationTools::FindCongruentBases(const KDTree* tree,
 												ScalarType delta,
 												const CCVector3* base[4],
 												std::vector<Base>& results)
@@ -1446,49 +1474,77 @@ int FPCSRegistrationTools::FindCongruentBases(KDTree* tree,
 	std::vector<IndexPair> pairs1, pairs2;
 	{
 		unsigned count = static_cast<unsigned>(cloud->size());
-		std::vector<unsigned> pointsIndexes;
+
+		//the points are processed by blocks (concurrently if possible)
+		//and the pairs are then merged in the blocks order (so that the result is always the same)
+		static const unsigned s_blockSize = 1024;
+		unsigned blockCount = (count + s_blockSize - 1) / s_blockSize;
+		std::vector< std::vector<IndexPair> > blockPairs1, blockPairs2;
 		try
 		{
-			pointsIndexes.reserve(count);
-		}
-		catch(...)
-		{
-			//not enough memory
-			return -1;
-		}
+			blockPairs1.resize(blockCount);
+			blockPairs2.resize(blockCount);
 
-		for (unsigned i=0; i<count; i++)
-		{
-			const CCVector3 *q0 = cloud->getPoint(i);
-			IndexPair idxPair;
-			idxPair.first = i;
-			//Extract all points from the cloud which are d1-appart (up to delta) from q0
-			pointsIndexes.clear();
-			tree->findPointsLyingToDistance(q0->u, static_cast<ScalarType>(d1), delta, pointsIndexes);
+#ifdef USE_TBB
+			tbb::parallel_for(static_cast<unsigned>(0), blockCount, [&](unsigned b)
+#else
+			for (unsigned b = 0; b < blockCount; ++b)
+#endif
 			{
-				for(std::size_t j=0; j<pointsIndexes.size(); j++)
+				std::vector<unsigned> pointsIndexes;
+				unsigned stop = std::min((b + 1) * s_blockSize, count);
+				for (unsigned i = b * s_blockSize; i < stop; i++)
 				{
-					//As ||pi-pj|| = ||pj-pi||, we only take care of pairs that verify i<j
-					if (pointsIndexes[j]>i)
+					const CCVector3 *q0 = cloud->getPoint(i);
+					IndexPair idxPair;
+					idxPair.first = i;
+					//Extract all points from the cloud which are d1-appart (up to delta) from q0
+					pointsIndexes.clear();
+					tree->findPointsLyingToDistance(q0->u, static_cast<ScalarType>(d1), delta, pointsIndexes);
 					{
-						idxPair.second = pointsIndexes[j];
-						pairs1.push_back(idxPair);
+						for(std::size_t j=0; j<pointsIndexes.size(); j++)
+						{
+							//As ||pi-pj|| = ||pj-pi||, we only take care of pairs that verify i<j
+							if (pointsIndexes[j]>i)
+							{
+								idxPair.second = pointsIndexes[j];
+								blockPairs1[b].push_back(idxPair);
+							}
+						}
 					}
-				}
-			}
-			//Extract all points from the cloud which are d2-appart (up to delta) from q0
-			pointsIndexes.clear();
-			tree->findPointsLyingToDistance(q0->u, static_cast<ScalarType>(d2), delta, pointsIndexes);
-			{
-				for(std::size_t j=0; j<pointsIndexes.size(); j++)
-				{
-					if (pointsIndexes[j]>i)
+					//Extract all points from the cloud which are d2-appart (up to delta) from q0
+					pointsIndexes.clear();
+					tree->findPointsLyingToDistance(q0->u, static_cast<ScalarType>(d2), delta, pointsIndexes);
 					{
-						idxPair.second = pointsIndexes[j];
-						pairs2.push_back(idxPair);
+						for(std::size_t j=0; j<pointsIndexes.size(); j++)
+						{
+							if (pointsIndexes[j]>i)
+							{
+								idxPair.second = pointsIndexes[j];
+								blockPairs2[b].push_back(idxPair);
+							}
+						}
 					}
 				}
 			}
+#ifdef USE_TBB
+			);
+#endif
+
+			for (unsigned b = 0; b < blockCount; ++b)
+			{
+				pairs1.insert(pairs1.end(), blockPairs1[b].begin(), blockPairs1[b].end());
+				blockPairs1[b].clear();
+				blockPairs1[b].shrink_to_fit();
+				pairs2.insert(pairs2.end(), blockPairs2[b].begin(), blockPairs2[b].end());
+				blockPairs2[b].clear();
+				blockPairs2[b].shrink_to_fit();
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			return -1;
 		}
 	}
 
@@ -1540,15 +1596,41 @@ int FPCSRegistrationTools::FindCongruentBases(KDTree* tree,
 			if (match.capacity() < count)	//not enough memory
 				return -5;
 		
-			for(unsigned i=0; i<count; i++)
+			//look for the nearest neighbours concurrently (if possible)
+			std::vector<int> nearestIndexes;
+			try
+			{
+				nearestIndexes.resize(count, -1);
+			}
+			catch (const std::bad_alloc&)
+			{
+				return -5;
+			}
+
+#ifdef USE_TBB
+			tbb::parallel_for(static_cast<unsigned>(0), count, [&](unsigned i)
+#else
+			for (unsigned i = 0; i < count; i++)
+#endif
 			{
 				const CCVector3 *q0 = tmpCloud2.getPoint(i);
 				unsigned a;
 				if (intermediateTree.findNearestNeighbour(q0->u, a, delta))
+				{
+					nearestIndexes[i] = static_cast<int>(a);
+				}
+			}
+#ifdef USE_TBB
+			);
+#endif
+
+			for (unsigned i = 0; i < count; i++)
+			{
+				if (nearestIndexes[i] >= 0)
 				{
 					IndexPair idxPair;
 					idxPair.first = i;
-					idxPair.second = a;
+					idxPair.second = static_cast<unsigned>(nearestIndexes[i]);
 					match.push_back(idxPair);
 				}
 			}
@@ -1756,7 +1838,7 @@ bool FPCSRegistrationTools::FilterCandidates(	GenericIndexedCloud *modelCloud,
 		{
 			if (scores[i] <= score && j < nbMaxCandidates)
 			{
-				candidates[i].copy(table[i]);
+				candidates[j].copy(table[i]);
 				transforms.push_back(tarray[i]);
 				j++;
 			}
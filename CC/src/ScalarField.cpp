@@ -45,71 +45,42 @@ void ScalarField::setName(const char* name)
 
 void ScalarField::computeMeanAndVariance(ScalarType &mean, ScalarType* variance) const
 {
-	double _mean = 0.0, _std2 = 0.0;
-	std::size_t count = 0;
+	ScalarFieldStatistics stats;
+	stats.compute(data(), size());
 
-	for (std::size_t i = 0; i < size(); ++i)
+	mean = static_cast<ScalarType>(stats.mean());
+	if (variance)
 	{
-		const ScalarType& val = at(i);
-		if (ValidValue(val))
-		{
-			_mean += val;
-			_std2 += static_cast<double>(val) * val;
-			++count;
-		}
+		*variance = static_cast<ScalarType>(stats.variance());
 	}
+}
 
-	if (count)
-	{
-		_mean /= count;
-		mean = static_cast<ScalarType>(_mean);
+void ScalarField::computeMinAndMax()
+{
+	computeStatistics(0);
+}
 
-		if (variance)
-		{
-			_std2 = fabs(_std2 / count - _mean*_mean);
-			*variance = static_cast<ScalarType>(_std2);
-		}
-	}
-	else
-	{
-		mean = 0;
-		if (variance)
-		{
-			*variance = 0;
-		}
-	}
+bool ScalarField::computeStatistics(unsigned histogramClasses/*=0*/)
+{
+	bool success = m_statistics.compute(data(), size(), histogramClasses);
+
+	//(both 0 if there is no valid value)
+	m_minVal = m_statistics.minValue();
+	m_maxVal = m_statistics.maxValue();
+
+	return success;
 }
 
-void ScalarField::computeMinAndMax()
+void ScalarField::updateValue(std::size_t index, ScalarType value)
 {
-	if (!empty())
-	{
-		bool minMaxInitialized = false;
-		for (std::size_t i = 0; i < size(); ++i)
-		{
-			const ScalarType& val = at(i);
-			if (ValidValue(val))
-			{
-				if (minMaxInitialized)
-				{
-					if (val < m_minVal)
-						m_minVal = val;
-					else if (val > m_maxVal)
-						m_maxVal = val;
-				}
-				else
-				{
-					//first valid value is used to init min and max
-					m_minVal = m_maxVal = val;
-					minMaxInitialized = true;
-				}
-			}
-		}
-	}
-	else //particular case: no value
+	ScalarType& currentValue = at(index);
+	if (m_statistics.isValid() && m_statistics.valueCount() == size())
 	{
-		m_minVal = m_maxVal = 0;
+		m_statistics.updateValue(currentValue, value);
+		m_minVal = m_statistics.minValue();
+		m_maxVal = m_statistics.maxValue();
 	}
+	currentValue = value;
 }
 
 bool ScalarField::reserveSafe(std::size_t count)
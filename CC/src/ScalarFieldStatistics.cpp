@@ -0,0 +1,424 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 or later of the  #
+//#  License.                                                              #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include <ScalarFieldStatistics.h>
+
+//local
+#include <GenericCloud.h>
+#include <ScalarField.h>
+
+//system
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#ifdef USE_TBB
+#include <tbb/parallel_for.h>
+#endif
+
+using namespace CCLib;
+
+//! Number of values processed by each task
+static const std::size_t s_chunkSize = (1 << 16);
+
+#ifdef USE_TBB
+//! Maximum number of partial histograms (one per block of values)
+static const std::size_t s_maxHistogramBlocks = 64;
+#else
+static const std::size_t s_maxHistogramBlocks = 1;
+#endif
+
+//! Partial statistics (of one chunk of values)
+struct PartialStatistics
+{
+	PartialStatistics() : count(0), sum(0), sumSquare(0), minVal(0), maxVal(0) {}
+
+	std::size_t count;
+	double sum;
+	double sumSquare;
+	ScalarType minVal;
+	ScalarType maxVal;
+};
+
+//! Computes the number of valid values, their extremas, sum and sum of squares
+template <class ValueAccessor> static bool ComputeMoments(const ValueAccessor& valueAt, std::size_t count, PartialStatistics& total)
+{
+	total = PartialStatistics();
+
+	std::size_t chunkCount = (count + s_chunkSize - 1) / s_chunkSize;
+	std::vector<PartialStatistics> partials;
+	try
+	{
+		partials.resize(chunkCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+
+#ifdef USE_TBB
+	tbb::parallel_for(static_cast<std::size_t>(0), chunkCount, [&](std::size_t c)
+#else
+	for (std::size_t c = 0; c < chunkCount; ++c)
+#endif
+	{
+		std::size_t first = c * s_chunkSize;
+		std::size_t last = std::min(first + s_chunkSize, count);
+		PartialStatistics& stats = partials[c];
+		for (std::size_t i = first; i < last; ++i)
+		{
+			ScalarType val = valueAt(i);
+			if (ScalarField::ValidValue(val))
+			{
+				if (stats.count != 0)
+				{
+					if (val < stats.minVal)
+						stats.minVal = val;
+					else if (val > stats.maxVal)
+						stats.maxVal = val;
+				}
+				else
+				{
+					stats.minVal = stats.maxVal = val;
+				}
+				++stats.count;
+				stats.sum += val;
+				stats.sumSquare += static_cast<double>(val) * val;
+			}
+		}
+	}
+#ifdef USE_TBB
+	);
+#endif
+
+	//merge the partial statistics (always in the same order so that the result doesn't depend on the threads scheduling)
+	for (const PartialStatistics& stats : partials)
+	{
+		if (stats.count == 0)
+		{
+			continue;
+		}
+		if (total.count != 0)
+		{
+			total.minVal = std::min(total.minVal, stats.minVal);
+			total.maxVal = std::max(total.maxVal, stats.maxVal);
+		}
+		else
+		{
+			total.minVal = stats.minVal;
+			total.maxVal = stats.maxVal;
+		}
+		total.count += stats.count;
+		total.sum += stats.sum;
+		total.sumSquare += stats.sumSquare;
+	}
+
+	return true;
+}
+
+//! Computes the histogram of the values inside [minV ; maxV] (one partial histogram per block of values)
+template <class ValueAccessor> static bool ComputeHistogramFrom(const ValueAccessor& valueAt, std::size_t count, ScalarType minV, ScalarType maxV, std::vector<unsigned>& histo)
+{
+	std::size_t classCount = histo.size();
+	std::fill(histo.begin(), histo.end(), 0);
+	if (classCount == 0 || count == 0)
+	{
+		return true;
+	}
+
+	std::size_t blockCount = std::min(s_maxHistogramBlocks, (count + s_chunkSize - 1) / s_chunkSize);
+	std::size_t blockSize = (count + blockCount - 1) / blockCount;
+	std::vector<unsigned> partialHistos;
+	try
+	{
+		partialHistos.resize(blockCount * classCount, 0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+
+	double step = (maxV > minV ? classCount / (static_cast<double>(maxV) - minV) : 0.0);
+
+#ifdef USE_TBB
+	tbb::parallel_for(static_cast<std::size_t>(0), blockCount, [&](std::size_t b)
+#else
+	for (std::size_t b = 0; b < blockCount; ++b)
+#endif
+	{
+		unsigned* partialHisto = partialHistos.data() + b * classCount;
+		std::size_t first = b * blockSize;
+		std::size_t last = std::min(first + blockSize, count);
+		for (std::size_t i = first; i < last; ++i)
+		{
+			ScalarType val = valueAt(i);
+			//we ignore values outside of [minV ; maxV] (works for NaN values as well)
+			if (val >= minV && val <= maxV)
+			{
+				std::size_t bin = static_cast<std::size_t>((val - minV) * step);
+				++partialHisto[std::min(bin, classCount - 1)];
+			}
+		}
+	}
+#ifdef USE_TBB
+	);
+#endif
+
+	for (std::size_t b = 0; b < blockCount; ++b)
+	{
+		const unsigned* partialHisto = partialHistos.data() + b * classCount;
+		for (std::size_t i = 0; i < classCount; ++i)
+		{
+			histo[i] += partialHisto[i];
+		}
+	}
+
+	return true;
+}
+
+ScalarFieldStatistics::ScalarFieldStatistics()
+{
+	clear();
+}
+
+void ScalarFieldStatistics::clear()
+{
+	m_valueCount = 0;
+	m_validCount = 0;
+	m_sum = 0;
+	m_sumSquare = 0;
+	m_minVal = m_maxVal = 0;
+	m_histogram.resize(0);
+	m_histoMin = m_histoMax = 0;
+	m_exactExtremas = true;
+	m_valid = false;
+}
+
+template <class ValueAccessor> bool ScalarFieldStatistics::computeFrom(const ValueAccessor& valueAt, std::size_t count, unsigned histogramClasses)
+{
+	clear();
+
+	PartialStatistics total;
+	if (!ComputeMoments(valueAt, count, total))
+	{
+		return false;
+	}
+
+	m_valueCount = count;
+	m_validCount = total.count;
+	m_sum = total.sum;
+	m_sumSquare = total.sumSquare;
+	m_minVal = total.minVal;
+	m_maxVal = total.maxVal;
+
+	if (histogramClasses != 0 && m_validCount != 0)
+	{
+		try
+		{
+			m_histogram.resize(histogramClasses);
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			m_histogram.resize(0);
+			return false;
+		}
+
+		m_histoMin = m_minVal;
+		m_histoMax = m_maxVal;
+		if (!ComputeHistogramFrom(valueAt, count, m_histoMin, m_histoMax, m_histogram))
+		{
+			m_histogram.resize(0);
+			return false;
+		}
+	}
+
+	m_valid = true;
+
+	return true;
+}
+
+bool ScalarFieldStatistics::compute(const ScalarType* values, std::size_t count, unsigned histogramClasses/*=0*/)
+{
+	if (!values && count != 0)
+	{
+		assert(false);
+		clear();
+		return false;
+	}
+
+	return computeFrom([values](std::size_t i) { return values[i]; }, count, histogramClasses);
+}
+
+bool ScalarFieldStatistics::compute(const GenericCloud* cloud, unsigned histogramClasses/*=0*/)
+{
+	if (!cloud)
+	{
+		assert(false);
+		clear();
+		return false;
+	}
+
+	return computeFrom([cloud](std::size_t i) { return cloud->getPointScalarValue(static_cast<unsigned>(i)); }, cloud->size(), histogramClasses);
+}
+
+bool ScalarFieldStatistics::ComputeHistogram(	const ScalarType* values,
+												std::size_t count,
+												ScalarType minV,
+												ScalarType maxV,
+												std::vector<unsigned>& histo)
+{
+	if (!values && count != 0)
+	{
+		assert(false);
+		return false;
+	}
+
+	return ComputeHistogramFrom([values](std::size_t i) { return values[i]; }, count, minV, maxV, histo);
+}
+
+double ScalarFieldStatistics::mean() const
+{
+	return (m_validCount != 0 ? m_sum / m_validCount : 0.0);
+}
+
+double ScalarFieldStatistics::variance() const
+{
+	if (m_validCount == 0)
+	{
+		return 0.0;
+	}
+
+	double meanVal = m_sum / m_validCount;
+	return fabs(m_sumSquare / m_validCount - meanVal*meanVal);
+}
+
+std::size_t ScalarFieldStatistics::histogramClass(ScalarType value) const
+{
+	assert(!m_histogram.empty());
+
+	std::size_t classCount = m_histogram.size();
+	if (m_histoMax <= m_histoMin)
+	{
+		return 0;
+	}
+
+	std::size_t bin = static_cast<std::size_t>((value - m_histoMin) * (classCount / (static_cast<double>(m_histoMax) - m_histoMin)));
+	return std::min(bin, classCount - 1);
+}
+
+void ScalarFieldStatistics::updateValue(ScalarType previousValue, ScalarType newValue)
+{
+	if (!m_valid)
+	{
+		return;
+	}
+
+	if (ScalarField::ValidValue(previousValue))
+	{
+		assert(m_validCount != 0);
+		--m_validCount;
+		m_sum -= previousValue;
+		m_sumSquare -= static_cast<double>(previousValue) * previousValue;
+
+		if (!m_histogram.empty() && previousValue >= m_histoMin && previousValue <= m_histoMax)
+		{
+			unsigned& classCount = m_histogram[histogramClass(previousValue)];
+			assert(classCount != 0);
+			if (classCount != 0)
+				--classCount;
+		}
+
+		if (previousValue == m_minVal || previousValue == m_maxVal)
+		{
+			//the extremas may now be overestimated
+			m_exactExtremas = false;
+		}
+	}
+
+	if (ScalarField::ValidValue(newValue))
+	{
+		if (m_validCount != 0)
+		{
+			if (newValue < m_minVal)
+				m_minVal = newValue;
+			else if (newValue > m_maxVal)
+				m_maxVal = newValue;
+		}
+		else
+		{
+			m_minVal = m_maxVal = newValue;
+			m_exactExtremas = true;
+		}
+		++m_validCount;
+		m_sum += newValue;
+		m_sumSquare += static_cast<double>(newValue) * newValue;
+
+		if (!m_histogram.empty())
+		{
+			if (newValue >= m_histoMin && newValue <= m_histoMax)
+			{
+				++m_histogram[histogramClass(newValue)];
+			}
+			else
+			{
+				//the histogram range is not valid anymore
+				m_histogram.resize(0);
+			}
+		}
+	}
+	else if (m_validCount == 0)
+	{
+		m_minVal = m_maxVal = 0;
+		m_exactExtremas = true;
+	}
+}
+
+bool ScalarFieldStatistics::estimateQuantile(double q, double& value) const
+{
+	std::size_t total = 0;
+	for (unsigned classCount : m_histogram)
+	{
+		total += classCount;
+	}
+	if (total == 0)
+	{
+		return false;
+	}
+
+	double target = std::max(0.0, std::min(q, 1.0)) * total;
+	double classWidth = (static_cast<double>(m_histoMax) - m_histoMin) / m_histogram.size();
+
+	std::size_t cumulated = 0;
+	for (std::size_t i = 0; i < m_histogram.size(); ++i)
+	{
+		unsigned classCount = m_histogram[i];
+		if (classCount != 0 && cumulated + classCount >= target)
+		{
+			//linear interpolation inside the class
+			value = m_histoMin + (i + (target - cumulated) / classCount) * classWidth;
+			return true;
+		}
+		cumulated += classCount;
+	}
+
+	value = m_histoMax;
+	return true;
+}
@@ -22,6 +22,7 @@
 #include <GenericProgressCallback.h>
 #include <ReferenceCloud.h>
 #include <ScalarField.h>
+#include <ScalarFieldStatistics.h>
 
 //system
 #include <cstdio>
@@ -455,26 +456,11 @@ void ScalarFieldTools::computeScalarFieldExtremas(const GenericCloud* theCloud,
 	if (numberOfPoints == 0)
 		return;
 
-	bool firstValidValue = true;
-
-	for (unsigned i = 0; i < numberOfPoints; ++i)
+	ScalarFieldStatistics stats;
+	if (stats.compute(theCloud) && stats.validCount() != 0)
 	{
-		ScalarType V = theCloud->getPointScalarValue(i);
-		if (ScalarField::ValidValue(V))
-		{
-			if (!firstValidValue)
-			{
-				if (V < minV)
-					minV = V;
-				else if (V > maxV)
-					maxV = V;
-			}
-			else
-			{
-				minV = maxV = V;
-				firstValidValue = false;
-			}
-		}
+		minV = stats.minValue();
+		maxV = stats.maxValue();
 	}
 }
 
@@ -482,20 +468,13 @@ unsigned ScalarFieldTools::countScalarFieldValidValues(const GenericCloud* theCl
 {
 	assert(theCloud);
 
-	unsigned count = 0;
-
-	if (theCloud)
+	ScalarFieldStatistics stats;
+	if (!theCloud || !stats.compute(theCloud))
 	{
-		unsigned n = theCloud->size();
-		for (unsigned i = 0; i < n; ++i)
-		{
-			ScalarType V = theCloud->getPointScalarValue(i);
-			if (ScalarField::ValidValue(V))
-				++count;
-		}
+		return 0;
 	}
 
-	return count;
+	return static_cast<unsigned>(stats.validCount());
 }
 
 void ScalarFieldTools::computeScalarFieldHistogram(const GenericCloud* theCloud, unsigned numberOfClasses, std::vector<int>& histo)
@@ -518,45 +497,31 @@ void ScalarFieldTools::computeScalarFieldHistogram(const GenericCloud* theCloud,
 		return;
 	}
 
-	try
-	{
-		histo.resize(numberOfClasses,0);
-	}
-	catch (const std::bad_alloc)
+	//compute the min and max sf values and the histogram at once
+	ScalarFieldStatistics stats;
+	if (!stats.compute(theCloud, numberOfClasses))
 	{
 		//out of memory
 		return;
 	}
 
-	//compute the min and max sf values
-	ScalarType minV,maxV;
+	try
 	{
-		computeScalarFieldExtremas(theCloud, minV, maxV);
-
-		if (!ScalarField::ValidValue(minV))
-		{
-			//sf is only composed of NAN values?!
-			return;
-		}
+		histo.resize(numberOfClasses, 0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//out of memory
+		return;
 	}
 
-	//historgram step
-	ScalarType invStep = (maxV > minV ? numberOfClasses / (maxV - minV) : 0);
-
-	//histogram computation
+	//(no histogram if the sf is only composed of NAN values)
+	const std::vector<unsigned>& statsHisto = stats.histogram();
+	if (statsHisto.size() == numberOfClasses)
 	{
-		int iNumberOfClasses = static_cast<int>(numberOfClasses);
-		for (unsigned i = 0; i < pointCount; ++i)
+		for (unsigned i = 0; i < numberOfClasses; ++i)
 		{
-			ScalarType V = theCloud->getPointScalarValue(i);
-			if (ScalarField::ValidValue(V))
-			{
-				int aimClass = static_cast<int>((V - minV) * invStep);
-				if (aimClass == iNumberOfClasses)
-					--aimClass; //sepcific case: V == maxV
-
-				++histo[aimClass];
-			}
+			histo[i] = static_cast<int>(statsHisto[i]);
 		}
 	}
 }
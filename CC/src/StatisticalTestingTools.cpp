@@ -283,6 +283,156 @@ double StatisticalTestingTools::computeAdaptativeChi2Dist(	const GenericDistribu
 	return D2;
 }
 
+//! Computes the Chi2 distance between a (small) set of scalar values and a theoretical distribution
+/** Same result as StatisticalTestingTools::computeAdaptativeChi2Dist without classes compression,
+	but without any dynamic allocation (so that it can be called for each point).
+	\param distrib theoretical distribution
+	\param values scalar values (may contain invalid values)
+	\param count number of values
+	\param numberOfClasses number of classes (>1)
+	\param histoMin [optional] minimum histogram value
+	\param histoMax [optional] maximum histogram value
+	\param classProbabilities [optional] pre-computed probability of each class (only if histoMin and histoMax are defined)
+	\param histo histogram buffer (numberOfClasses elements)
+	\return the Chi2 distance (or a negative value if an error occurred)
+**/
+static double ComputeLocalChi2Dist(	const GenericDistribution* distrib,
+									const ScalarType* values,
+									unsigned count,
+									unsigned numberOfClasses,
+									const ScalarType* histoMin,
+									const ScalarType* histoMax,
+									const double* classProbabilities,
+									unsigned* histo)
+{
+	assert(!classProbabilities || (histoMin && histoMax));
+
+	//compute min and max (valid) values
+	ScalarType minV = 0, maxV = 0;
+	unsigned numberOfValidValues = 0;
+	for (unsigned i = 0; i < count; ++i)
+	{
+		ScalarType V = values[i];
+		if (ScalarField::ValidValue(V))
+		{
+			if (numberOfValidValues != 0)
+			{
+				if (V > maxV)
+					maxV = V;
+				else if (V < minV)
+					minV = V;
+			}
+			else
+			{
+				minV = maxV = V;
+			}
+			++numberOfValidValues;
+		}
+	}
+
+	if (numberOfValidValues == 0)
+		return -1.0;
+
+	if (histoMin)
+		minV = *histoMin;
+	if (histoMax)
+		maxV = *histoMax;
+
+	if (numberOfClasses < 2)
+		return -2.0; //not enough classes
+
+	memset(histo, 0, sizeof(unsigned)*numberOfClasses);
+
+	//accumulate histogram
+	ScalarType dV = maxV - minV;
+	unsigned histoBefore = 0;
+	unsigned histoAfter = 0;
+	if (dV > ZERO_TOLERANCE)
+	{
+		for (unsigned i = 0; i < count; ++i)
+		{
+			ScalarType V = values[i];
+			if (ScalarField::ValidValue(V))
+			{
+				int bin = static_cast<int>(floor((V - minV) * static_cast<ScalarType>(numberOfClasses) / dV));
+				if (bin < 0)
+				{
+					histoBefore++;
+				}
+				else if (bin >= static_cast<int>(numberOfClasses))
+				{
+					if (V > maxV)
+						histoAfter++;
+					else
+						histo[numberOfClasses - 1]++;
+				}
+				else
+				{
+					histo[bin]++;
+				}
+			}
+		}
+	}
+	else
+	{
+		histo[0] = count;
+	}
+
+	//we compute the Chi2 distance (same classes order as computeAdaptativeChi2Dist)
+	double D2 = 0.0;
+	bool saturated = false;
+	auto addClass = [&](double pi, unsigned n)
+	{
+		if (saturated)
+			return;
+
+		double npi = pi * numberOfValidValues;
+		if (npi != 0.0)
+		{
+			double temp = static_cast<double>(static_cast<int>(n)) - npi;
+			D2 += temp*(temp/npi);
+			if (D2 >= CHI2_MAX)
+			{
+				D2 = CHI2_MAX;
+				saturated = true;
+			}
+		}
+		else
+		{
+			D2 = CHI2_MAX;
+			saturated = true;
+		}
+	};
+
+	if (histoBefore)
+	{
+		addClass(1.0e-6, histoBefore);
+	}
+	if (classProbabilities)
+	{
+		for (unsigned k = 0; k < numberOfClasses; ++k)
+		{
+			addClass(classProbabilities[k], histo[k]);
+		}
+	}
+	else
+	{
+		double p1 = distrib->computePfromZero(minV);
+		for (unsigned k = 1; k <= numberOfClasses && !saturated; ++k)
+		{
+			double p2 = distrib->computePfromZero(minV + (k * dV) / numberOfClasses);
+			addClass(p2 - p1, histo[k - 1]);
+			p1 = p2; //next intervale
+		}
+	}
+	if (histoAfter)
+	{
+		addClass(1.0e-6, histoAfter);
+	}
+
+	return D2;
+}
+
 double StatisticalTestingTools::computeChi2Fractile(double p, int d)
 {
 	return Chi2Helper::critchi(p,d);
@@ -323,15 +473,6 @@ double StatisticalTestingTools::testCloudWithStatisticalModel(const GenericDistr
 
 	unsigned numberOfChi2Classes = static_cast<unsigned>(ceil(sqrt(static_cast<double>(numberOfNeighbours))));
 
-	//Chi2 hisogram values
-	unsigned* histoValues = new unsigned[numberOfChi2Classes];
-	if (!histoValues)
-	{
-		if (!inputOctree)
-			delete theOctree;
-		return -3.0;
-	}
-
 	ScalarType* histoMin = nullptr, customHistoMin = 0;
 	ScalarType* histoMax = nullptr, customHistoMax = 0;
 	if (strcmp(distrib->getName(),"Gauss")==0)
@@ -350,11 +491,37 @@ double StatisticalTestingTools::testCloudWithStatisticalModel(const GenericDistr
 		histoMin = &customHistoMin;
 	}
 
+	//if the histogram bounds are fixed (Gauss), the probability of each Chi2 class is the same for all the points
+	std::vector<double> classProbabilities;
+	if (histoMin && histoMax)
+	{
+		try
+		{
+			classProbabilities.resize(numberOfChi2Classes);
+		}
+		catch (const std::bad_alloc&)
+		{
+			if (!inputOctree)
+				delete theOctree;
+			return -3.0;
+		}
+
+		ScalarType minV = *histoMin;
+		ScalarType dV = *histoMax - *histoMin;
+		double p1 = distrib->computePfromZero(minV);
+		for (unsigned k = 1; k <= numberOfChi2Classes; ++k)
+		{
+			double p2 = distrib->computePfromZero(minV + (k * dV) / numberOfChi2Classes);
+			classProbabilities[k - 1] = p2 - p1;
+			p1 = p2; //next intervale
+		}
+	}
+
 	//additionnal parameters for local process
 	void* additionalParameters[] = {	reinterpret_cast<void*>(const_cast<GenericDistribution*>(distrib)),
 										reinterpret_cast<void*>(&numberOfNeighbours),
 										reinterpret_cast<void*>(&numberOfChi2Classes),
-										reinterpret_cast<void*>(histoValues),
+										reinterpret_cast<void*>(classProbabilities.empty() ? nullptr : classProbabilities.data()),
 										reinterpret_cast<void*>(histoMin),
 										reinterpret_cast<void*>(histoMax) };
 
@@ -378,9 +545,6 @@ double StatisticalTestingTools::testCloudWithStatisticalModel(const GenericDistr
 		}
 	}
 
-	delete[] histoValues;
-	histoValues = nullptr;
-
 	if (!inputOctree)
         delete theOctree;
 
@@ -392,12 +556,12 @@ bool StatisticalTestingTools::computeLocalChi2DistAtLevel(	const DgmOctree::octr
 															NormalizedProgress* nProgress/*=0*/)
 {
 	//variables additionnelles
-	GenericDistribution* statModel		= reinterpret_cast<GenericDistribution*>(additionalParameters[0]);
-	unsigned numberOfNeighbours         = *reinterpret_cast<unsigned*>(additionalParameters[1]);
-	unsigned numberOfChi2Classes		= *reinterpret_cast<unsigned*>(additionalParameters[2]);
-	unsigned* histoValues				= reinterpret_cast<unsigned*>(additionalParameters[3]);
-	ScalarType* histoMin				= reinterpret_cast<ScalarType*>(additionalParameters[4]);
-	ScalarType* histoMax				= reinterpret_cast<ScalarType*>(additionalParameters[5]);
+	const GenericDistribution* statModel	= reinterpret_cast<GenericDistribution*>(additionalParameters[0]);
+	unsigned numberOfNeighbours				= *reinterpret_cast<unsigned*>(additionalParameters[1]);
+	unsigned numberOfChi2Classes			= *reinterpret_cast<unsigned*>(additionalParameters[2]);
+	const double* classProbabilities		= reinterpret_cast<double*>(additionalParameters[3]);
+	const ScalarType* histoMin				= reinterpret_cast<ScalarType*>(additionalParameters[4]);
+	const ScalarType* histoMax				= reinterpret_cast<ScalarType*>(additionalParameters[5]);
 
 	//number of points in the current cell
 	unsigned n = cell.points->size();
@@ -428,13 +592,22 @@ bool StatisticalTestingTools::computeLocalChi2DistAtLevel(	const DgmOctree::octr
 		nNSS.alreadyVisitedNeighbourhoodSize = 1;
 	}
 
-	ReferenceCloud neighboursCloud(cell.points->getAssociatedCloud());
-	if (!neighboursCloud.reserve(numberOfNeighbours))
+	//local buffers (one set per cell, as cells may be processed concurrently)
+	std::vector<ScalarType> neighboursValues;
+	std::vector<unsigned> histoValues;
+	try
+	{
+		neighboursValues.resize(numberOfNeighbours);
+		histoValues.resize(numberOfChi2Classes);
+	}
+	catch (const std::bad_alloc&)
 	{
 		//not enough memory!
 		return false;
 	}
 
+	const GenericIndexedCloudPersist* cloud = cell.points->getAssociatedCloud();
+
 	for (unsigned i = 0; i < n; ++i)
 	{
 		cell.points->getPoint(i, nNSS.queryPoint);
@@ -442,21 +615,22 @@ bool StatisticalTestingTools::computeLocalChi2DistAtLevel(	const DgmOctree::octr
 
 		if (ScalarField::ValidValue(D))
 		{
-			//nNSS.theNearestPoints.clear();
-
 			unsigned k = cell.parentOctree->findNearestNeighborsStartingFromCell(nNSS, true);
 			if (k > numberOfNeighbours)
 				k = numberOfNeighbours;
 
-			neighboursCloud.clear();
 			for (unsigned j = 0; j < k; ++j)
-				neighboursCloud.addPointIndex(nNSS.pointsInNeighbourhood[j].pointIndex);
-
-			unsigned finalNumberOfChi2Classes = 0;
-			//LAZY VERSION (approximate test)
-			double Chi2Dist = static_cast<ScalarType>(computeAdaptativeChi2Dist(statModel, &neighboursCloud, numberOfChi2Classes, finalNumberOfChi2Classes, true, histoMin, histoMax, histoValues));
-			//STRICT VERSION (ultra-precise test)
-			//double Chi2Dist = static_cast<ScalarType>(computeAdaptativeChi2Dist(statModel, &neighboursCloud, numberOfChi2Classes, finalNumberOfChi2Classes, false, histoMin, histoMax, histoValues));
+				neighboursValues[j] = cloud->getPointScalarValue(nNSS.pointsInNeighbourhood[j].pointIndex);
+
+			//LAZY VERSION (approximate test, i.e. without classes compression)
+			double Chi2Dist = (k != 0 ? static_cast<ScalarType>(ComputeLocalChi2Dist(	statModel,
+																						neighboursValues.data(),
+																						k,
+																						numberOfChi2Classes,
+																						histoMin,
+																						histoMax,
+																						classProbabilities,
+																						histoValues.data())) : -1.0);
 
 			D = (Chi2Dist >= 0.0 ? static_cast<ScalarType>(sqrt(Chi2Dist)) : NAN_VALUE);
 		}
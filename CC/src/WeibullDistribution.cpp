@@ -26,6 +26,7 @@
 //local
 #include <GenericCloud.h>
 #include <ScalarField.h>
+#include <ScalarFieldStatistics.h>
 #include <ScalarFieldTools.h>
 
 using namespace CCLib;
@@ -173,32 +174,14 @@ bool WeibullDistribution::computeParameters(const ScalarContainer& values)
 		return false;
 
 	//we look for the maximum value of the SF so as to avoid overflow
-	ScalarType minValue, maxValue;
-	bool firstValue = true;
-	for (ScalarType s : values)
-	{
-		if (!ScalarField::ValidValue(s))
-			continue;
-
-		if (firstValue)
-		{
-			minValue = maxValue = s;
-			firstValue = false;
-		}
-		else
-		{
-			if (s < minValue)
-				minValue = s;
-			else if (s > maxValue)
-				maxValue = s;
-		}
-	}
-
-	if (firstValue)
+	ScalarFieldStatistics stats;
+	if (!stats.compute(values.data(), n) || stats.validCount() == 0)
 	{
 		//sf is only composed of NAN values?!
 		return false;
 	}
+	ScalarType minValue = stats.minValue();
+	ScalarType maxValue = stats.maxValue();
 
 	m_valueShift = minValue - std::numeric_limits<ScalarType>::epsilon();
 	assert(maxValue > m_valueShift);
@@ -27,11 +27,231 @@
 
 //CCLib
 #include <ConjugateGradient.h>
+#include <GenericProgressCallback.h>
 
 //Qt
 #include <QDir>
+#include <QImage>
 #include <QTextStream>
 
+//System
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+#ifdef USE_TBB
+#include <tbb/parallel_for.h>
+#endif
+
+//size of the tiles processed concurrently during resampling (in pixels)
+static const int s_resamplingTileSize = 64;
+
+//! Read-only access to the raw scanlines of an image (converted to 32 bits if necessary)
+/** The pixel centers have integer coordinates (i.e. the first pixel is (0,0) and the
+	last one (width-1,height-1)).
+**/
+class ImageSampler
+{
+public:
+
+	//! Default constructor
+	explicit ImageSampler(const QImage& image)
+		: m_image(image.format() == QImage::Format_ARGB32 || image.format() == QImage::Format_RGB32 ? image : image.convertToFormat(QImage::Format_ARGB32))
+		, m_bits(m_image.constBits())
+		, m_bytesPerLine(m_image.bytesPerLine())
+		, m_width(m_image.width())
+		, m_height(m_image.height())
+	{}
+
+	//! Returns whether the image is valid
+	inline bool isValid() const { return !m_image.isNull(); }
+	//! Returns the image width
+	inline int width() const { return m_width; }
+	//! Returns the image height
+	inline int height() const { return m_height; }
+
+	//! Returns whether a (sub-)pixel position lies inside the image
+	inline bool contains(float x, float y) const
+	{
+		//warning: also rejects NaN values
+		return (x >= -0.5f && y >= -0.5f && x < m_width - 0.5f && y < m_height - 0.5f);
+	}
+
+	//! Returns a pixel value
+	inline QRgb pixel(int x, int y) const
+	{
+		return reinterpret_cast<const QRgb*>(m_bits + static_cast<size_t>(y) * m_bytesPerLine)[x];
+	}
+
+	//! Returns a pixel value (the coordinates are clamped to the image borders)
+	inline QRgb clampedPixel(int x, int y) const
+	{
+		return pixel(std::min(std::max(x, 0), m_width - 1), std::min(std::max(y, 0), m_height - 1));
+	}
+
+	//! Samples the image at a given (sub-)pixel position
+	/** \return false if the position lies outside of the image
+	**/
+	bool sample(float x, float y, ccCameraSensor::ResamplingFilter filter, QRgb& rgb) const
+	{
+		if (!contains(x, y))
+		{
+			return false;
+		}
+
+		switch (filter)
+		{
+		case ccCameraSensor::BILINEAR:
+		{
+			float fx = std::floor(x);
+			float fy = std::floor(y);
+			int x0 = static_cast<int>(fx);
+			int y0 = static_cast<int>(fy);
+			float dx = x - fx;
+			float dy = y - fy;
+
+			QRgb colors[4] = {	clampedPixel(x0, y0), clampedPixel(x0 + 1, y0),
+								clampedPixel(x0, y0 + 1), clampedPixel(x0 + 1, y0 + 1) };
+			float weights[4] = {	(1.0f - dx) * (1.0f - dy), dx * (1.0f - dy),
+									(1.0f - dx) * dy, dx * dy };
+			rgb = Blend(colors, weights, 4);
+		}
+		break;
+
+		case ccCameraSensor::BICUBIC:
+		{
+			float fx = std::floor(x);
+			float fy = std::floor(y);
+			int x0 = static_cast<int>(fx);
+			int y0 = static_cast<int>(fy);
+			float wx[4], wy[4];
+			CatmullRomWeights(x - fx, wx);
+			CatmullRomWeights(y - fy, wy);
+
+			QRgb colors[16];
+			float weights[16];
+			for (int j = 0; j < 4; ++j)
+			{
+				for (int i = 0; i < 4; ++i)
+				{
+					colors[j * 4 + i] = clampedPixel(x0 - 1 + i, y0 - 1 + j);
+					weights[j * 4 + i] = wx[i] * wy[j];
+				}
+			}
+			rgb = Blend(colors, weights, 16);
+		}
+		break;
+
+		default:
+			assert(filter == ccCameraSensor::NEAREST_NEIGHBOUR);
+			rgb = pixel(static_cast<int>(x + 0.5f), static_cast<int>(y + 0.5f));
+			break;
+		}
+
+		return true;
+	}
+
+protected:
+
+	//! Computes the Catmull-Rom (a = -0.5) weights of the 4 neighbours of a position
+	static inline void CatmullRomWeights(float t, float w[4])
+	{
+		float t2 = t * t;
+		float t3 = t2 * t;
+		w[0] = -0.5f * t3 + t2 - 0.5f * t;
+		w[1] = 1.5f * t3 - 2.5f * t2 + 1.0f;
+		w[2] = -1.5f * t3 + 2.0f * t2 + 0.5f * t;
+		w[3] = 0.5f * t3 - 0.5f * t2;
+	}
+
+	//! Computes the weighted sum of several colors
+	static inline QRgb Blend(const QRgb* colors, const float* weights, int count)
+	{
+		float r = 0, g = 0, b = 0, a = 0;
+		for (int k = 0; k < count; ++k)
+		{
+			r += weights[k] * qRed(colors[k]);
+			g += weights[k] * qGreen(colors[k]);
+			b += weights[k] * qBlue(colors[k]);
+			a += weights[k] * qAlpha(colors[k]);
+		}
+		return qRgba(ToComponent(r), ToComponent(g), ToComponent(b), ToComponent(a));
+	}
+
+	//! Rounds and clamps a color component
+	static inline int ToComponent(float value)
+	{
+		return std::min(std::max(static_cast<int>(value + 0.5f), 0), 255);
+	}
+
+	QImage m_image;
+	const uchar* m_bits;
+	int m_bytesPerLine;
+	int m_width;
+	int m_height;
+};
+
+//! Resamples an image by tiles (processed concurrently)
+/** \param source source image
+	\param output output image (ARGB32)
+	\param sourcePos gives the position in the source image of each output pixel ('bool (int x, int y, CCVector2& P)', must be thread-safe)
+	\param filter resampling filter
+	\param outsideValue value of the output pixels with no source pixel
+	\param blackIsTransparent whether pure black pixels should be made transparent
+**/
+template <class SourcePositionFunc> static void ResampleImage(	const ImageSampler& source,
+																QImage& output,
+																const SourcePositionFunc& sourcePos,
+																ccCameraSensor::ResamplingFilter filter,
+																QRgb outsideValue,
+																bool blackIsTransparent)
+{
+	assert(output.format() == QImage::Format_ARGB32);
+
+	const int width = output.width();
+	const int height = output.height();
+	uchar* outputBits = output.bits(); //detaches the image (before the parallel loop)
+	const int outputBytesPerLine = output.bytesPerLine();
+
+	const int tilesX = (width + s_resamplingTileSize - 1) / s_resamplingTileSize;
+	const int tilesY = (height + s_resamplingTileSize - 1) / s_resamplingTileSize;
+	const int tileCount = tilesX * tilesY;
+
+#ifdef USE_TBB
+	tbb::parallel_for(0, tileCount, [&](int t)
+#else
+	for (int t = 0; t < tileCount; ++t)
+#endif
+	{
+		const int x0 = (t % tilesX) * s_resamplingTileSize;
+		const int y0 = (t / tilesX) * s_resamplingTileSize;
+		const int x1 = std::min(x0 + s_resamplingTileSize, width);
+		const int y1 = std::min(y0 + s_resamplingTileSize, height);
+
+		for (int y = y0; y < y1; ++y)
+		{
+			QRgb* line = reinterpret_cast<QRgb*>(outputBits + static_cast<size_t>(y) * outputBytesPerLine);
+			for (int x = x0; x < x1; ++x)
+			{
+				QRgb rgb = outsideValue;
+				CCVector2 P;
+				if (sourcePos(x, y, P) && source.sample(P.x, P.y, filter, rgb))
+				{
+					//pure black pixels are treated as transparent ones!
+					if (blackIsTransparent && (rgb & RGB_MASK) == 0)
+					{
+						rgb = qRgba(0, 0, 0, 0);
+					}
+				}
+				line[x] = rgb;
+			}
+		}
+	}
+#ifdef USE_TBB
+	);
+#endif
+}
+
 ccCameraSensor::IntrinsicParameters::IntrinsicParameters()
 	: vertFocal_pix(1.0f)
 	, skew(0)
@@ -214,10 +434,10 @@ ccCameraSensor::ccCameraSensor(const ccCameraSensor& sensor)
 	setIntrinsicParameters(sensor.m_intrinsicParams);
 
 	//distortion params
-	if (m_distortionParams)
+	if (sensor.m_distortionParams)
 	{
 		LensDistortionParameters::Shared clonedDistParams;
-		switch (m_distortionParams->getModel())
+		switch (sensor.m_distortionParams->getModel())
 		{
 		case SIMPLE_RADIAL_DISTORTION:
 		{
@@ -975,126 +1195,163 @@ bool ccCameraSensor::computeUncertainty(CCLib::ReferenceCloud* points, std::vect
 	return true;
 }
 
+bool ccCameraSensor::UndistortionMap::matches(int w, int h, const float params[7]) const
+{
+	return (width == w && height == h && std::equal(params, params + 7, parameters));
+}
+
 //see http://opencv.willowgarage.com/documentation/cpp/camera_calibration_and_3d_reconstruction.html
-QImage ccCameraSensor::undistort(const QImage& image) const
+ccCameraSensor::UndistortionMap::Shared ccCameraSensor::getUndistortionMap(int width, int height) const
 {
-	if (image.isNull())
+	if (width <= 0 || height <= 0 || m_intrinsicParams.arrayWidth <= 0 || m_intrinsicParams.arrayHeight <= 0)
 	{
-		ccLog::Warning("[ccCameraSensor::undistort] Invalid input image!");
-		return QImage();
+		ccLog::Warning("[ccCameraSensor::undistort] Invalid image or sensor array size!");
+		return UndistortionMap::Shared();
 	}
 
-	//nothing to do
 	//no distortion parameters?
 	if (!m_distortionParams)
 	{
 		ccLog::Warning("[ccCameraSensor::undistort] No distortion model set!");
-		return QImage();
+		return UndistortionMap::Shared();
 	}
 
-	switch (m_distortionParams->getModel())
+	if (	m_distortionParams->getModel() != SIMPLE_RADIAL_DISTORTION
+		&&	m_distortionParams->getModel() != EXTENDED_RADIAL_DISTORTION)
 	{
-	case SIMPLE_RADIAL_DISTORTION:
-	case EXTENDED_RADIAL_DISTORTION:
-		{
-			const RadialDistortionParameters* params = static_cast<RadialDistortionParameters*>(m_distortionParams.data());
-			float k1 = params->k1;
-			float k2 = params->k2;
-			if (k1 == 0 && k2 == 0)
-			{
-				ccLog::Warning("[ccCameraSensor::undistort] Invalid radial distortion coefficients!");
-				return QImage();
-			}
-			float k3 = 0;
-			if (m_distortionParams->getModel() == EXTENDED_RADIAL_DISTORTION)
-			{
-				k3 = static_cast<ExtendedRadialDistortionParameters*>(m_distortionParams.data())->k3;
-			}
+		//TODO: Brown's model
+		ccLog::Warning("[ccCameraSensor::undistort] Can't undistort the image with the current distortion model!");
+		return UndistortionMap::Shared();
+	}
 
-			int width = image.width();
-			int height = image.height();
+	const RadialDistortionParameters* distParams = static_cast<RadialDistortionParameters*>(m_distortionParams.data());
+	float k3 = 0;
+	if (m_distortionParams->getModel() == EXTENDED_RADIAL_DISTORTION)
+	{
+		k3 = static_cast<ExtendedRadialDistortionParameters*>(m_distortionParams.data())->k3;
+	}
+	if (distParams->k1 == 0 && distParams->k2 == 0 && k3 == 0)
+	{
+		ccLog::Warning("[ccCameraSensor::undistort] Invalid radial distortion coefficients!");
+		return UndistortionMap::Shared();
+	}
 
-			float xScale = image.width() / static_cast<float>(m_intrinsicParams.arrayWidth);
-			float yScale = image.height() / static_cast<float>(m_intrinsicParams.arrayHeight);
-			float rScale = sqrt(xScale * xScale + yScale * yScale);
+	//the image may be smaller or bigger than the sensor array
+	float xScale = width / static_cast<float>(m_intrinsicParams.arrayWidth);
+	float yScale = height / static_cast<float>(m_intrinsicParams.arrayHeight);
 
-			//try to reserve memory for new image
-			QImage newImage(QSize(width, height), image.format());
-			if (newImage.isNull())
-			{
-				ccLog::Warning("[ccCameraSensor::undistort] Not enough memory!");
-				return QImage();
-			}
-			newImage.fill(0);
-
-			float vertFocal_pix = getVertFocal_pix() * xScale;
-			float horizFocal_pix = getHorizFocal_pix() * yScale;
-			float vf2 = vertFocal_pix * vertFocal_pix;
-			float hf2 = horizFocal_pix * horizFocal_pix;
-			float cx = m_intrinsicParams.principal_point[0] * xScale;
-			float cy = m_intrinsicParams.principal_point[1] * yScale;
-			k1 *= rScale;
-			k2 *= rScale;
-			k3 *= rScale;
-
-			assert((image.depth() % 8) == 0);
-			int depth = image.depth() / 8;
-			int bytesPerLine = image.bytesPerLine();
-			const uchar* iImageBits = image.bits();
-			uchar* oImageBits = newImage.bits();
-
-			//image undistortion
-			{
-				for (int i = 0; i < width; ++i)
-				{
-					float x = i - cx;
-					float x2 = x*x;
-					for (int j = 0; j < height; ++j)
-					{
-						float y = j - cy;
-						float y2 = y*y;
-
-						float p2 = x2 / hf2 + y2 / vf2; //p = pix/f
-						float rp = 1.0f + p2 * (k1 + p2 * (k2 + p2 * k3)); //r(p) = 1.0 + k1 * ||p||^2 + k2 * ||p||^4 + k3 * ||p||^6
-						float eqx = rp * x + cx;
-						float eqy = rp * y + cy;
-
-						int pixx = static_cast<int>(eqx);
-						int pixy = static_cast<int>(eqy);
-						if (	pixx >= 0
-							&&	pixx < width
-							&&	pixy >= 0
-							&&	pixy < height)
-						{
-							const uchar* iPixel = iImageBits + j * bytesPerLine + i * depth;
-							uchar* oPixel = oImageBits + pixy * bytesPerLine + pixx * depth;
-							memcpy(oPixel, iPixel, depth);
-							//newImage.setPixel(i, j, image.pixel(pixx, pixy));
-						}
-					}
-				}
-			}
+	const float params[7] = {	getHorizFocal_pix() * xScale,
+								getVertFocal_pix() * yScale,
+								m_intrinsicParams.principal_point[0] * xScale,
+								m_intrinsicParams.principal_point[1] * yScale,
+								distParams->k1,
+								distParams->k2,
+								k3 };
+
+	QMutexLocker locker(&m_undistortionMapMutex);
+
+	if (m_undistortionMap && m_undistortionMap->matches(width, height, params))
+	{
+		//the cached map is still valid
+		return m_undistortionMap;
+	}
+
+	QSharedPointer<UndistortionMap> map(new UndistortionMap);
+	try
+	{
+		map->sourcePos.resize(static_cast<size_t>(width) * height);
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning("[ccCameraSensor::undistort] Not enough memory!");
+		return UndistortionMap::Shared();
+	}
+	map->width = width;
+	map->height = height;
+	std::copy(params, params + 7, map->parameters);
+
+	const float hf2 = params[0] * params[0];
+	const float vf2 = params[1] * params[1];
+	const float cx = params[2];
+	const float cy = params[3];
+	const float k1 = params[4];
+	const float k2 = params[5];
 
-			return newImage;
+	//for each pixel of the undistorted image, we look for the corresponding position in the input image
+	//(same distortion model as in ccCameraSensor::fromLocalCoordToImageCoord)
+#ifdef USE_TBB
+	tbb::parallel_for(0, height, [&](int j)
+#else
+	for (int j = 0; j < height; ++j)
+#endif
+	{
+		float y = j - cy;
+		float y2 = y * y;
+		CCVector2* sourcePos = map->sourcePos.data() + static_cast<size_t>(j) * width;
+		for (int i = 0; i < width; ++i)
+		{
+			float x = i - cx;
+			float p2 = x * x / hf2 + y2 / vf2; //p = pix/f
+			float rp = 1.0f + p2 * (k1 + p2 * (k2 + p2 * k3)); //r(p) = 1.0 + k1 * ||p||^2 + k2 * ||p||^4 + k3 * ||p||^6
+			sourcePos[i] = CCVector2(	static_cast<PointCoordinateType>(rp * x + cx),
+										static_cast<PointCoordinateType>(rp * y + cy) );
 		}
-		break;
+	}
+#ifdef USE_TBB
+	);
+#endif
 
-	case BROWN_DISTORTION:
-		//TODO
-		break;
+	m_undistortionMap = map;
 
-	default:
-		//not handled?
-		assert(false);
-		break;
+	return m_undistortionMap;
+}
+
+QImage ccCameraSensor::undistort(const QImage& image, ResamplingFilter filter/*=BILINEAR*/) const
+{
+	if (image.isNull())
+	{
+		ccLog::Warning("[ccCameraSensor::undistort] Invalid input image!");
+		return QImage();
+	}
+
+	UndistortionMap::Shared map = getUndistortionMap(image.width(), image.height());
+	if (!map)
+	{
+		//warning message should have been already issued
+		return QImage();
+	}
+
+	//try to reserve memory for new image
+	ImageSampler sampler(image);
+	QImage newImage(image.size(), QImage::Format_ARGB32);
+	if (!sampler.isValid() || newImage.isNull())
+	{
+		ccLog::Warning("[ccCameraSensor::undistort] Not enough memory!");
+		return QImage();
 	}
 
-	ccLog::Warning("[ccCameraSensor::undistort] Can't undistort the image with the current distortion model!");
+	//image undistortion
+	const int width = map->width;
+	ResampleImage(	sampler,
+					newImage,
+					[&map, width](int i, int j, CCVector2& P)
+					{
+						P = map->sourcePos[static_cast<size_t>(j) * width + i];
+						return true;
+					},
+					filter,
+					qRgba(0, 0, 0, 0),
+					false );
+
+	if (image.format() != newImage.format())
+	{
+		newImage = newImage.convertToFormat(image.format());
+	}
 
-	return QImage();
+	return newImage;
 }
 
-ccImage* ccCameraSensor::undistort(ccImage* image, bool inplace/*=true*/) const
+ccImage* ccCameraSensor::undistort(ccImage* image, bool inplace/*=true*/, ResamplingFilter filter/*=BILINEAR*/) const
 {
 	if (!image || image->data().isNull())
 	{
@@ -1102,7 +1359,7 @@ ccImage* ccCameraSensor::undistort(ccImage* image, bool inplace/*=true*/) const
 		return 0;
 	}
 
-	QImage newImage = undistort(image->data());
+	QImage newImage = undistort(image->data(), filter);
 	if (newImage.isNull())
 	{
 		//warning message should have been already issued
@@ -1737,7 +1994,8 @@ ccImage* ccCameraSensor::orthoRectifyAsImageDirect(	const ccImage* image,
 													bool undistortImages/*=true*/,
 													double* minCorner/*=0*/,
 													double* maxCorner/*=0*/,
-													double* realCorners/*=0*/) const
+													double* realCorners/*=0*/,
+													ResamplingFilter filter/*=BILINEAR*/) const
 {
 	//first, we compute the ortho-rectified image corners
 	double corners[8];
@@ -1854,38 +2112,31 @@ ccImage* ccCameraSensor::orthoRectifyAsImageDirect(	const ccImage* image,
 	unsigned w = static_cast<unsigned>(dx/_pixelSize);
 	unsigned h = static_cast<unsigned>(dy/_pixelSize);
 
-	QImage orthoImage(w,h,QImage::Format_ARGB32);
-	if (orthoImage.isNull()) //not enough memory!
+	ccIndexedTransformation sensorTrans;
+	if (!getActiveAbsoluteTransformation(sensorTrans))
 		return 0;
+	const ccGLMatrix globalToLocal = sensorTrans.inverse();
 
-	const QRgb blackValue = qRgb(0, 0, 0);
-	const QRgb blackAlphaZero = qRgba(0, 0, 0, 0);
-
-	for (unsigned i = 0; i < w; ++i)
-	{
-		PointCoordinateType xip = static_cast<PointCoordinateType>(minC[0] + i*_pixelSize);
-		for (unsigned j = 0; j < h; ++j)
-		{
-			PointCoordinateType yip = static_cast<PointCoordinateType>(minC[1] + j*_pixelSize);
-
-			QRgb rgb = blackValue; //output pixel is (transparent) black by default
-
-			CCVector3 P3D(xip,yip,Z0);
-			CCVector2 imageCoord;
-			if (fromGlobalCoordToImageCoord(P3D,imageCoord,undistortImages))
-			{
-				int x = static_cast<int>(imageCoord.x);
-				int y = static_cast<int>(imageCoord.y);
-				if (x >= 0 && x < width && y >= 0 && y < height)
-				{
-					rgb = image->data().pixel(x,y);
-				}
-			}
+	ImageSampler sampler(image->data());
+	QImage orthoImage(w,h,QImage::Format_ARGB32);
+	if (!sampler.isValid() || orthoImage.isNull()) //not enough memory!
+		return 0;
 
-			//pure black pixels are treated as transparent ones!
-			orthoImage.setPixel(i, h - 1 - j, rgb != blackValue ? rgb : blackAlphaZero);
-		}
-	}
+	//output pixels are (transparent) black by default
+	ResampleImage(	sampler,
+					orthoImage,
+					[&](int i, int row, CCVector2& imageCoord)
+					{
+						unsigned j = h - 1 - static_cast<unsigned>(row);
+						CCVector3 P(static_cast<PointCoordinateType>(minC[0] + i*_pixelSize),
+									static_cast<PointCoordinateType>(minC[1] + j*_pixelSize),
+									Z0);
+						globalToLocal.apply(P);
+						return fromLocalCoordToImageCoord(P, imageCoord, undistortImages);
+					},
+					filter,
+					qRgba(0, 0, 0, 0),
+					true );
 
 	//output pixel size (auto)
 	pixelSize = _pixelSize;
@@ -1899,7 +2150,8 @@ ccImage* ccCameraSensor::orthoRectifyAsImage(	const ccImage* image,
 												double& pixelSize,
 												double* minCorner/*=0*/,
 												double* maxCorner/*=0*/,
-												double* realCorners/*=0*/) const
+												double* realCorners/*=0*/,
+												ResamplingFilter filter/*=BILINEAR*/) const
 {
 	double a[3], b[3], c[3];
 
@@ -2002,45 +2254,33 @@ ccImage* ccCameraSensor::orthoRectifyAsImage(	const ccImage* image,
 	unsigned w = static_cast<unsigned>(dx / _pixelSize);
 	unsigned h = static_cast<unsigned>(dy / _pixelSize);
 
+	ImageSampler sampler(image->data());
 	QImage orthoImage(w, h, QImage::Format_ARGB32);
-	if (orthoImage.isNull()) //not enough memory!
+	if (!sampler.isValid() || orthoImage.isNull()) //not enough memory!
 		return 0;
 
-	const QRgb blackValue = qRgb(0, 0, 0);
-	const QRgb blackAlphaZero = qRgba(0, 0, 0, 0);
-
-	for (unsigned i = 0; i < w; ++i)
-	{
-		double xip = minC[0] + static_cast<double>(i)*_pixelSize;
-		for (unsigned j = 0; j < h; ++j)
-		{
-			QRgb rgb = blackValue; //output pixel is (transparent) black by default
-
-			double yip = minC[1] + static_cast<double>(j)*_pixelSize;
-			double q = (c2*xip - a2)*(c1*yip - b1) - (c2*yip - b2)*(c1*xip - a1);
-			double p = (a0 - xip)*(c1*yip - b1) - (b0 - yip)*(c1*xip - a1);
-			double yi = p / q;
-			yi += halfHeight;
-			int y = static_cast<int>(yi);
+	//output pixels are (transparent) black by default
+	ResampleImage(	sampler,
+					orthoImage,
+					[&](int i, int row, CCVector2& imageCoord)
+					{
+						double xip = minC[0] + static_cast<double>(i)*_pixelSize;
+						double yip = minC[1] + static_cast<double>(h - 1 - static_cast<unsigned>(row))*_pixelSize;
 
-			if (y >= 0 && y < height)
-			{
-				q = (c1*xip - a1)*(c2*yip - b2) - (c1*yip - b1)*(c2*xip - a2);
-				p = (a0 - xip)*(c2*yip - b2) - (b0 - yip)*(c2*xip - a2);
-				double  xi = p / q;
-				xi += halfWidth;
-				int x = static_cast<int>(xi);
+						double q = (c2*xip - a2)*(c1*yip - b1) - (c2*yip - b2)*(c1*xip - a1);
+						double p = (a0 - xip)*(c1*yip - b1) - (b0 - yip)*(c1*xip - a1);
+						double yi = p / q + halfHeight;
 
-				if (x >= 0 && x < width)
-				{
-					rgb = image->data().pixel(x, y);
-				}
-			}
+						q = (c1*xip - a1)*(c2*yip - b2) - (c1*yip - b1)*(c2*xip - a2);
+						p = (a0 - xip)*(c2*yip - b2) - (b0 - yip)*(c2*xip - a2);
+						double xi = p / q + halfWidth;
 
-			//pure black pixels are treated as transparent ones!
-			orthoImage.setPixel(i, h - 1 - j, rgb != blackValue ? rgb : blackAlphaZero);
-		}
-	}
+						imageCoord = CCVector2(static_cast<PointCoordinateType>(xi), static_cast<PointCoordinateType>(yi));
+						return true;
+					},
+					filter,
+					qRgba(0, 0, 0, 0),
+					true );
 
 	//output pixel size (auto)
 	pixelSize = _pixelSize;
@@ -2053,7 +2293,8 @@ bool ccCameraSensor::OrthoRectifyAsImages(	std::vector<ccImage*> images,
 											unsigned maxSize,
 											QDir* outputDir/*=0*/,
 											std::vector<ccImage*>* result/*=0*/,
-											std::vector<std::pair<double,double> >* relativePos/*=0*/)
+											std::vector<std::pair<double,double> >* relativePos/*=0*/,
+											ResamplingFilter filter/*=BILINEAR*/)
 {
 	size_t count = images.size();
 	if (count == 0)
@@ -2201,8 +2442,9 @@ bool ccCameraSensor::OrthoRectifyAsImages(	std::vector<ccImage*> images,
 		unsigned w = static_cast<unsigned>(ceil(dx/pixelSize));
 		unsigned h = static_cast<unsigned>(ceil(dy/pixelSize));
 
+		ImageSampler sampler(image->data());
 		QImage orthoImage(w,h,QImage::Format_ARGB32);
-		if (orthoImage.isNull()) //not enough memory!
+		if (!sampler.isValid() || orthoImage.isNull()) //not enough memory!
 		{
 			//clear mem.
 			if (result)
@@ -2228,38 +2470,28 @@ bool ccCameraSensor::OrthoRectifyAsImages(	std::vector<ccImage*> images,
 		const double& c1 = c[k*3+1];
 		const double& c2 = c[k*3+2];
 
-		for (unsigned i=0; i<w; ++i)
-		{
-			double xip = minC[0] + static_cast<double>(i)*pixelSize;
-			for (unsigned j=0;j<h;++j)
-			{
-				double yip = minC[1] + static_cast<double>(j)*pixelSize;
-				double q = (c2*xip-a2)*(c1*yip-b1)-(c2*yip-b2)*(c1*xip-a1);
-				double p = (a0-xip)*(c1*yip-b1)-(b0-yip)*(c1*xip-a1);
-				double yi = p/q;
+		//output pixels are transparent (magenta) by default
+		ResampleImage(	sampler,
+						orthoImage,
+						[&](int i, int row, CCVector2& imageCoord)
+						{
+							double xip = minC[0] + static_cast<double>(i)*pixelSize;
+							double yip = minC[1] + static_cast<double>(h - 1 - static_cast<unsigned>(row))*pixelSize;
 
-				q = (c1*xip-a1)*(c2*yip-b2)-(c1*yip-b1)*(c2*xip-a2);
-				p = (a0-xip)*(c2*yip-b2)-(b0-yip)*(c2*xip-a2);
-				double  xi = p/q;
+							double q = (c2*xip-a2)*(c1*yip-b1)-(c2*yip-b2)*(c1*xip-a1);
+							double p = (a0-xip)*(c1*yip-b1)-(b0-yip)*(c1*xip-a1);
+							double yi = p/q + 0.5 * height;
 
-				xi += 0.5 * width;
-				yi += 0.5 * height;
+							q = (c1*xip-a1)*(c2*yip-b2)-(c1*yip-b1)*(c2*xip-a2);
+							p = (a0-xip)*(c2*yip-b2)-(b0-yip)*(c2*xip-a2);
+							double xi = p/q + 0.5 * width;
 
-				int x = static_cast<int>(xi);
-				int y = static_cast<int>(yi);
-				if (x >= 0 && x < static_cast<int>(width) && y >= 0 && y < static_cast<int>(height))
-				{
-					QRgb rgb = image->data().pixel(x,y);
-					//pure black pixels are treated as transparent ones!
-					if (qRed(rgb) + qGreen(rgb) + qBlue(rgb) > 0)
-						orthoImage.setPixel(i, h - 1 - j, rgb);
-					else
-						orthoImage.setPixel(i, h - 1 - j, qRgba(qRed(rgb), qGreen(rgb), qBlue(rgb), 0));
-				}
-				else
-					orthoImage.setPixel(i, h - 1 - j, qRgba(255, 0, 255, 0));
-			}
-		}
+							imageCoord = CCVector2(static_cast<PointCoordinateType>(xi), static_cast<PointCoordinateType>(yi));
+							return true;
+						},
+						filter,
+						qRgba(255, 0, 255, 0),
+						true );
 
 		//eventually compute relative pos
 		if (relativePos)
@@ -2331,6 +2563,14 @@ ccPointCloud* ccCameraSensor::orthoRectifyAsCloud(	const ccImage* image,
 	}
 	proj->showColors(true);
 
+	ImageSampler sampler(image->data());
+	if (!sampler.isValid())
+	{
+		ccLog::Warning("[orthoRectifyAsCloud] Not enough memory!");
+		delete proj;
+		return 0;
+	}
+
 	unsigned realCount = 0;
 
 	//ortho rectification
@@ -2347,7 +2587,7 @@ ccPointCloud* ccCameraSensor::orthoRectifyAsCloud(	const ccImage* image,
 							defaultZ);
 
 				//and color?
-				QRgb rgb = image->data().pixel(pi, pj);
+				QRgb rgb = sampler.pixel(static_cast<int>(pi), static_cast<int>(pj));
 				int r = qRed(rgb);
 				int g = qGreen(rgb);
 				int b = qBlue(rgb);
@@ -2380,6 +2620,221 @@ ccPointCloud* ccCameraSensor::orthoRectifyAsCloud(	const ccImage* image,
 	return proj;
 }
 
+bool ccCameraSensor::ColorizeCloudFromImages(	ccPointCloud* cloud,
+												const std::vector<ccImage*>& images,
+												ResamplingFilter filter/*=BILINEAR*/,
+												float depthMapScale/*=0.25f*/,
+												float depthTolerance/*=0.01f*/,
+												CCLib::GenericProgressCallback* progressCb/*=nullptr*/,
+												unsigned* colorizedCount/*=nullptr*/)
+{
+	if (colorizedCount)
+	{
+		*colorizedCount = 0;
+	}
+
+	if (!cloud || images.empty() || depthMapScale <= 0 || depthMapScale > 1.0f || depthTolerance < 0)
+	{
+		ccLog::Warning("[ColorizeCloudFromImages] Invalid input");
+		return false;
+	}
+
+	unsigned pointCount = cloud->size();
+	if (pointCount == 0)
+	{
+		//nothing to do
+		return true;
+	}
+
+	//colors accumulated for each point
+	std::vector<float> colorSums;
+	std::vector<unsigned> viewCounts;
+	try
+	{
+		colorSums.resize(3 * static_cast<size_t>(pointCount), 0);
+		viewCounts.resize(pointCount, 0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning("[ColorizeCloudFromImages] Not enough memory!");
+		return false;
+	}
+
+	if (progressCb)
+	{
+		if (progressCb->textCanBeEdited())
+		{
+			progressCb->setMethodTitle("Colorize from images");
+			progressCb->setInfo(qPrintable(QString("Images: %1\nPoints: %L2").arg(images.size()).arg(pointCount)));
+		}
+		progressCb->update(0);
+		progressCb->start();
+	}
+	CCLib::NormalizedProgress nprogress(progressCb, static_cast<unsigned>(images.size()));
+
+	const int pointCountInt = static_cast<int>(pointCount);
+	bool cancelled = false;
+
+	for (const ccImage* image : images)
+	{
+		const ccCameraSensor* sensor = (image ? image->getAssociatedSensor() : nullptr);
+		ccIndexedTransformation sensorTrans;
+		if (	!sensor
+			||	sensor->m_intrinsicParams.arrayWidth <= 0
+			||	sensor->m_intrinsicParams.arrayHeight <= 0
+			||	!sensor->getActiveAbsoluteTransformation(sensorTrans))
+		{
+			ccLog::Warning(QString("[ColorizeCloudFromImages] Image '%1' is not (properly) calibrated: ignored").arg(image ? image->getName() : QString()));
+		}
+		else
+		{
+			ImageSampler sampler(image->data());
+			const int mapWidth = std::max(1, static_cast<int>(std::ceil(sampler.width() * depthMapScale)));
+			const int mapHeight = std::max(1, static_cast<int>(std::ceil(sampler.height() * depthMapScale)));
+			std::vector< std::atomic<float> > depthMap;
+			try
+			{
+				depthMap = std::vector< std::atomic<float> >(static_cast<size_t>(mapWidth) * mapHeight);
+			}
+			catch (const std::bad_alloc&)
+			{
+				ccLog::Warning("[ColorizeCloudFromImages] Not enough memory!");
+				return false;
+			}
+			if (!sampler.isValid())
+			{
+				ccLog::Warning("[ColorizeCloudFromImages] Not enough memory!");
+				return false;
+			}
+			for (std::atomic<float>& depth : depthMap)
+			{
+				depth.store(std::numeric_limits<float>::max());
+			}
+
+			const ccGLMatrix globalToLocal = sensorTrans.inverse();
+			//the sensor array may be smaller or bigger than the image
+			const float xScale = sampler.width() / static_cast<float>(sensor->m_intrinsicParams.arrayWidth);
+			const float yScale = sampler.height() / static_cast<float>(sensor->m_intrinsicParams.arrayHeight);
+
+			//projects a point in the image (returns the depth map cell)
+			auto projectPoint = [&](int index, CCVector2& imageCoord, float& depth) -> int
+			{
+				CCVector3 P;
+				cloud->getPoint(static_cast<unsigned>(index), P);
+				globalToLocal.apply(P);
+				depth = -static_cast<float>(P.z); //warning: the camera looks backward!
+
+				if (	!sensor->fromLocalCoordToImageCoord(P, imageCoord, true)
+					||	!sampler.contains(imageCoord.x * xScale, imageCoord.y * yScale))
+				{
+					return -1;
+				}
+				imageCoord.x *= xScale;
+				imageCoord.y *= yScale;
+
+				int x = std::min(static_cast<int>((imageCoord.x + 0.5f) * depthMapScale), mapWidth - 1);
+				int y = std::min(static_cast<int>((imageCoord.y + 0.5f) * depthMapScale), mapHeight - 1);
+				return y * mapWidth + x;
+			};
+
+			//first pass: depth map
+#ifdef USE_TBB
+			tbb::parallel_for(0, pointCountInt, [&](int i)
+#else
+			for (int i = 0; i < pointCountInt; ++i)
+#endif
+			{
+				CCVector2 imageCoord;
+				float depth;
+				int cellIndex = projectPoint(i, imageCoord, depth);
+				if (cellIndex >= 0)
+				{
+					std::atomic<float>& minDepth = depthMap[cellIndex];
+					float currentDepth = minDepth.load();
+					while (depth < currentDepth && !minDepth.compare_exchange_weak(currentDepth, depth))
+					{
+						//currentDepth has been updated, try again
+					}
+				}
+			}
+#ifdef USE_TBB
+			);
+#endif
+
+			//second pass: colors of the visible points (each point is only updated by one task)
+#ifdef USE_TBB
+			tbb::parallel_for(0, pointCountInt, [&](int i)
+#else
+			for (int i = 0; i < pointCountInt; ++i)
+#endif
+			{
+				CCVector2 imageCoord;
+				float depth;
+				int cellIndex = projectPoint(i, imageCoord, depth);
+				QRgb rgb;
+				if (	cellIndex >= 0
+					&&	depth <= depthMap[cellIndex].load() * (1.0f + depthTolerance)
+					&&	sampler.sample(imageCoord.x, imageCoord.y, filter, rgb))
+				{
+					float* sum = colorSums.data() + 3 * static_cast<size_t>(i);
+					sum[0] += qRed(rgb);
+					sum[1] += qGreen(rgb);
+					sum[2] += qBlue(rgb);
+					++viewCounts[i];
+				}
+			}
+#ifdef USE_TBB
+			);
+#endif
+		}
+
+		if (!nprogress.oneStep())
+		{
+			cancelled = true;
+			break;
+		}
+	}
+
+	if (progressCb)
+	{
+		progressCb->stop();
+	}
+
+	if (cancelled)
+	{
+		return false;
+	}
+
+	if (!cloud->hasColors() && !cloud->resizeTheRGBTable(true))
+	{
+		ccLog::Warning("[ColorizeCloudFromImages] Not enough memory!");
+		return false;
+	}
+
+	unsigned count = 0;
+	for (unsigned i = 0; i < pointCount; ++i)
+	{
+		if (viewCounts[i] != 0)
+		{
+			const float* sum = colorSums.data() + 3 * static_cast<size_t>(i);
+			float n = static_cast<float>(viewCounts[i]);
+			ccColor::Rgb C(	static_cast<ColorCompType>(sum[0] / n + 0.5f),
+							static_cast<ColorCompType>(sum[1] / n + 0.5f),
+							static_cast<ColorCompType>(sum[2] / n + 0.5f) );
+			cloud->setPointColor(i, C);
+			++count;
+		}
+	}
+	cloud->showColors(true);
+
+	if (colorizedCount)
+	{
+		*colorizedCount = count;
+	}
+
+	return true;
+}
+
 /********************************************************************/
 /*******************                              *******************/
 /*******************  ccOctreeFrustumIntersector  *******************/
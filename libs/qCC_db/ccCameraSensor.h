@@ -22,13 +22,23 @@
 #include "ccSensor.h"
 #include "ccOctree.h"
 
+//Qt
+#include <QMutex>
+
 //system
 #include <unordered_set>
+#include <vector>
 
 class ccPointCloud;
 class ccMesh;
 class ccImage;
 class QDir;
+class QImage;
+
+namespace CCLib
+{
+	class GenericProgressCallback;
+}
 
 //! Camera (projective) sensor
 class QCC_DB_LIB_API ccCameraSensor : public ccSensor
@@ -71,6 +81,12 @@ public: //general
 							EXTENDED_RADIAL_DISTORTION = 3		/**< extended radial distortion model (k1, k2, k3) **/
 	};
 
+	//! Image resampling filters
+	enum ResamplingFilter {	NEAREST_NEIGHBOUR = 0,	/**< nearest pixel **/
+							BILINEAR = 1,			/**< bilinear interpolation (2x2 pixels) **/
+							BICUBIC = 2				/**< bicubic (Catmull-Rom) interpolation (4x4 pixels) **/
+	};
+
 	//! Lens distortion parameters (interface)
 	struct LensDistortionParameters
 	{
@@ -144,6 +160,27 @@ public: //general
 		float P_BrownParams[2];				/**< tangential parameters Brown's distortion model **/
 	};
 
+	//! Undistortion (remap) table
+	/** Gives, for each pixel of the undistorted image, the position of the
+		corresponding (sub-)pixel in the original (distorted) image.
+	**/
+	struct QCC_DB_LIB_API UndistortionMap
+	{
+		//! Shared pointer type
+		typedef QSharedPointer<const UndistortionMap> Shared;
+
+		//! Default initializer
+		UndistortionMap() : width(0), height(0) {}
+
+		//! Returns whether the map has been computed with the given parameters
+		bool matches(int w, int h, const float params[7]) const;
+
+		int width;						/**< image width (in pixels) **/
+		int height;						/**< image height (in pixels) **/
+		float parameters[7];			/**< parameters used to compute the map (focals, principal point and k1, k2, k3) **/
+		std::vector<CCVector2> sourcePos;	/**< position in the original image of each pixel (row by row) **/
+	};
+
 	//! Frustum information structure
 	/** Used to draw the frustum associated to a camera sensor.
 	**/
@@ -328,7 +365,7 @@ public: //orthorectification tools
 	};
 
 	//! Projective ortho-rectification of an image (as cloud)
-	/** Requires at least 4 key points!
+	/** Requires at least 4 key points! Black pixels are ignored.
 		\param image input image
 		\param keypoints3D keypoints in 3D
 		\param keypointsImage corresponding keypoints in image
@@ -347,6 +384,7 @@ public: //orthorectification tools
 		\param minCorner (optional) outputs 3D min corner (2 values)
 		\param maxCorner (optional) outputs 3D max corner (2 values)
 		\param realCorners (optional) image real 3D corners (4*2 values)
+		\param filter resampling filter
 		\return ortho-rectified image
 	**/
 	ccImage* orthoRectifyAsImage(	const ccImage* image,
@@ -355,7 +393,8 @@ public: //orthorectification tools
 									double& pixelSize,
 									double* minCorner = nullptr,
 									double* maxCorner = nullptr,
-									double* realCorners = nullptr) const;
+									double* realCorners = nullptr,
+									ResamplingFilter filter = BILINEAR) const;
 
 	//! Direct ortho-rectification of an image (as image)
 	/** No keypoint is required. The user must specify however the
@@ -367,6 +406,7 @@ public: //orthorectification tools
 		\param minCorner (optional) outputs 3D min corner (2 values)
 		\param maxCorner (optional) outputs 3D max corner (2 values)
 		\param realCorners (optional) image real 3D corners (4*2 values)
+		\param filter resampling filter
 		\return ortho-rectified image
 	**/
 	ccImage* orthoRectifyAsImageDirect(	const ccImage* image,
@@ -375,7 +415,8 @@ public: //orthorectification tools
 										bool undistortImages = true,
 										double* minCorner = nullptr,
 										double* maxCorner = nullptr,
-										double* realCorners = nullptr) const;
+										double* realCorners = nullptr,
+										ResamplingFilter filter = BILINEAR) const;
 
 	//! Projective ortho-rectification of multiple images (as image files)
 	/** \param images set of N calibrated images (i.e. images with their associated sensor)
@@ -386,6 +427,7 @@ public: //orthorectification tools
 		\param outputDir output directory for resulting images (is successful)
 		\param[out] orthoRectifiedImages resulting images (is successful)
 		\param[out] relativePos relative positions (relatively to first image)
+		\param filter resampling filter
 		\return true if successful
 	**/
 	static bool OrthoRectifyAsImages(std::vector<ccImage*> images,
@@ -393,7 +435,8 @@ public: //orthorectification tools
 									unsigned maxSize,
 									QDir* outputDir = nullptr,
 									std::vector<ccImage*>* orthoRectifiedImages = nullptr,
-									std::vector<std::pair<double,double> >* relativePos = nullptr);
+									std::vector<std::pair<double,double> >* relativePos = nullptr,
+									ResamplingFilter filter = BILINEAR);
 
 	//! Computes ortho-rectification parameters for a given image
 	/** Requires at least 4 key points!
@@ -435,20 +478,54 @@ public: //misc
 	**/
 	bool computeUncertainty(CCLib::ReferenceCloud* points, std::vector< Vector3Tpl<ScalarType> >& accuracy/*, bool lensDistortion*/);
 
+	//! Returns the undistortion map for a given image size
+	/** The map is cached (it is only recomputed if the image size or the
+		sensor parameters change).
+		\warning Only works with the (extended) radial distortion models for now (see RadialDistortionParameters).
+		\param width image width (in pixels)
+		\param height image height (in pixels)
+		\return undistortion map (or a null pointer if an error occurred)
+	**/
+	UndistortionMap::Shared getUndistortionMap(int width, int height) const;
+
 	//! Undistorts an image based on the sensor distortion parameters
-	/** \warning Only works with the simple radial distortion model for now (see RadialDistortionParameters).
+	/** \warning Only works with the (extended) radial distortion models for now (see RadialDistortionParameters).
 		\param image input image
+		\param filter resampling filter
 		\return undistorted image (or a null one if an error occurred)
 	**/
-	QImage undistort(const QImage& image) const;
+	QImage undistort(const QImage& image, ResamplingFilter filter = BILINEAR) const;
 
 	//! Undistorts an image based on the sensor distortion parameters
-	/** \warning Only works with the simple radial distortion model for now (see RadialDistortionParameters).
+	/** \warning Only works with the (extended) radial distortion models for now (see RadialDistortionParameters).
 		\param image input image
 		\param inplace whether the undistortion should be applied in place or not
+		\param filter resampling filter
 		\return undistorted image (maybe the same as the input image if inplace is true, or even a null pointer if an error occurred)
 	**/
-	ccImage* undistort(ccImage* image, bool inplace = true) const;
+	ccImage* undistort(ccImage* image, bool inplace = true, ResamplingFilter filter = BILINEAR) const;
+
+	//! Colorizes a cloud with several calibrated images
+	/** Each image must have an associated camera sensor. The points are projected in each image
+		(with the lens distortion) and each point gets the average color of the images in which
+		it is visible. The visibility is tested with a depth map of the cloud computed for each image.
+		Points that are not visible in any image keep their color (or are white).
+		\param cloud cloud to colorize
+		\param images calibrated images
+		\param filter resampling filter
+		\param depthMapScale resolution of the depth maps relatively to the images (in ]0,1])
+		\param depthTolerance relative depth tolerance for the visibility test
+		\param progressCb optional progress callback
+		\param[out] colorizedCount optional number of colorized points
+		\return success
+	**/
+	static bool ColorizeCloudFromImages(ccPointCloud* cloud,
+										const std::vector<ccImage*>& images,
+										ResamplingFilter filter = BILINEAR,
+										float depthMapScale = 0.25f,
+										float depthTolerance = 0.01f,
+										CCLib::GenericProgressCallback* progressCb = nullptr,
+										unsigned* colorizedCount = nullptr);
 
 	//! Tests if a 3D point is in the field of view of the camera.
 	/** \param globalCoord global coordinates of the 3D point
@@ -513,6 +590,11 @@ protected:
 	ccGLMatrix m_projectionMatrix;
 	//! Whether the intrinsic matrix is valid or not
 	bool m_projectionMatrixIsValid;
+
+	//! Undistortion map (cache)
+	mutable UndistortionMap::Shared m_undistortionMap;
+	//! Undistortion map mutex
+	mutable QMutex m_undistortionMapMutex;
 };
 
 class ccOctreeFrustumIntersector
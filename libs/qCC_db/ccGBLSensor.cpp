@@ -28,9 +28,100 @@
 //Qt
 #include <QCoreApplication>
 
+//System
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+#ifdef USE_TBB
+#include <tbb/parallel_for.h>
+#endif
+
 //maximum depth buffer dimension (width or height)
 static const int s_MaxDepthBufferSize = (1 << 14); //16384
 
+//number of points projected by block
+static const unsigned s_projectionBlockSize = (1 << 16);
+
+//invalid depth buffer cell index
+static const unsigned s_invalidCellIndex = std::numeric_limits<unsigned>::max();
+
+//! Projects the points of a cloud by blocks
+/** The points of each block are projected in parallel (project(P, i, k), with i the index of
+	the point in the cloud and k its index in the block), then accumulated sequentially in the
+	points order (accumulate(i, k)). The result is therefore the same as with a
+	sequential process, whatever the number of threads.
+	Indexed clouds are read concurrently. Otherwise the cloud global iterator is used.
+**/
+template <class ProjectFunc, class AccumulateFunc> static bool ProjectByBlocks(	CCLib::GenericCloud* cloud,
+																				ProjectFunc project,
+																				AccumulateFunc accumulate,
+																				CCLib::NormalizedProgress* nProgress)
+{
+	unsigned pointCount = cloud->size();
+
+	CCLib::GenericIndexedCloud* indexedCloud = dynamic_cast<CCLib::GenericIndexedCloud*>(cloud);
+	std::vector<CCVector3> blockPoints;
+	if (!indexedCloud)
+	{
+		try
+		{
+			blockPoints.resize(std::min(pointCount, s_projectionBlockSize));
+		}
+		catch (const std::bad_alloc&)
+		{
+			return false;
+		}
+		cloud->placeIteratorAtBeginning();
+	}
+
+	for (unsigned first = 0; first < pointCount; first += s_projectionBlockSize)
+	{
+		unsigned count = std::min(s_projectionBlockSize, pointCount - first);
+		if (!indexedCloud)
+		{
+			for (unsigned k = 0; k < count; ++k)
+			{
+				blockPoints[k] = *cloud->getNextPoint();
+			}
+		}
+
+#ifdef USE_TBB
+		tbb::parallel_for(static_cast<unsigned>(0), count, [&](unsigned k)
+#else
+		for (unsigned k = 0; k < count; ++k)
+#endif
+		{
+			if (indexedCloud)
+			{
+				CCVector3 P;
+				indexedCloud->getPoint(first + k, P);
+				project(P, first + k, k);
+			}
+			else
+			{
+				project(blockPoints[k], first + k, k);
+			}
+		}
+#ifdef USE_TBB
+		);
+#endif
+
+		for (unsigned k = 0; k < count; ++k)
+		{
+			accumulate(first + k, k);
+		}
+
+		if (nProgress && !nProgress->steps(count))
+		{
+			//process cancelled by the user
+			return false;
+		}
+	}
+
+	return true;
+}
+
 enum Errors {	ERROR_BAD_INPUT      = -1,
 				ERROR_MEMORY         = -2,
 				ERROR_PROC_CANCELLED = -3,
@@ -137,22 +228,36 @@ void ccGBLSensor::setYawStep(PointCoordinateType dTheta)
 	}
 }
 
+ccGLMatrix ccGBLSensor::getWorldToSensorTransformation(double posIndex) const
+{
+	//sensor to world global transformation = sensor position * rigid transformation
+	ccIndexedTransformation sensorPos; //identity by default
+	if (m_posBuffer)
+		m_posBuffer->getInterpolatedTransformation(posIndex,sensorPos);
+	sensorPos *= m_rigidTransformation;
+
+	//inverse global transformation (i.e world to sensor)
+	return sensorPos.inverse();
+}
+
 void ccGBLSensor::projectPoint(	const CCVector3& sourcePoint,
 								CCVector2& destPoint,
 								PointCoordinateType &depth,
 								double posIndex/*=0*/) const
+{
+	projectPoint(sourcePoint, destPoint, depth, getWorldToSensorTransformation(posIndex));
+}
+
+void ccGBLSensor::projectPoint(	const CCVector3& sourcePoint,
+								CCVector2& destPoint,
+								PointCoordinateType &depth,
+								const ccGLMatrix& worldToSensor) const
 {
 	//project point in sensor world
 	CCVector3 P = sourcePoint;
 
-	//sensor to world global transformation = sensor position * rigid transformation
-	ccIndexedTransformation sensorPos; //identity by default
-	if (m_posBuffer)
-		m_posBuffer->getInterpolatedTransformation(posIndex,sensorPos);
-	sensorPos *= m_rigidTransformation;
-
 	//apply (inverse) global transformation (i.e world to sensor)
-	sensorPos.inverse().apply(P);
+	worldToSensor.apply(P);
 
 	//convert to 2D sensor field of view + compute its distance
 	switch (m_rotationOrder)
@@ -249,23 +354,39 @@ ccGBLSensor::NormalGrid* ccGBLSensor::projectNormals(	CCLib::GenericCloud* cloud
 		m_posBuffer->getInterpolatedTransformation(posIndex,sensorPos);
 	sensorPos *= m_rigidTransformation;
 
-	//poject each point + normal
+	const CCVector3 sensorCenter = sensorPos.getTranslationAsVec3D();
+	const ccGLMatrix worldToSensor = getWorldToSensorTransformation(m_activeIndex);
+
+	//temporary buffers (for each block of points)
+	unsigned blockSize = std::min(cloud->size(), s_projectionBlockSize);
+	std::vector<unsigned> cellIndexes;
+	std::vector<CCVector3> projectedNormals;
+	try
 	{
-		cloud->placeIteratorAtBeginning();
-		unsigned pointCount = cloud->size();
-		for (unsigned i=0; i<pointCount; ++i)
+		cellIndexes.resize(blockSize);
+		projectedNormals.resize(blockSize);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		delete normalGrid;
+		return nullptr;
+	}
+
+	//poject each point + normal (in parallel)
+	bool success = ProjectByBlocks(cloud,
+		[&](const CCVector3& P, unsigned i, unsigned k)
 		{
-			const CCVector3* P = cloud->getNextPoint();
 			const CCVector3& N = theNorms[i];
 
 			//project point
 			CCVector2 Q;
 			PointCoordinateType depth1;
-			projectPoint(*P, Q, depth1, m_activeIndex);
+			projectPoint(P, Q, depth1, worldToSensor);
 
 			CCVector3 S;
 
-			CCVector3 U = *P - sensorPos.getTranslationAsVec3D();
+			CCVector3 U = P - sensorCenter;
 			PointCoordinateType distToSensor = U.norm();
 
 			if (distToSensor > ZERO_TOLERANCE)
@@ -281,10 +402,10 @@ ccGBLSensor::NormalGrid* ccGBLSensor::projectNormals(	CCLib::GenericCloud* cloud
 				else
 				{
 					//and point+normal
-					CCVector3 P2 = *P + CCVector3(N);
+					CCVector3 P2 = P + CCVector3(N);
 					CCVector2 S2;
 					PointCoordinateType depth2;
-					projectPoint(P2, S2, depth2, m_activeIndex);
+					projectPoint(P2, S2, depth2, worldToSensor);
 
 					//deduce other normals components
 					PointCoordinateType coef = sqrt((1 - S.z*S.z) / (S.x*S.x + S.y*S.y));
@@ -301,16 +422,31 @@ ccGBLSensor::NormalGrid* ccGBLSensor::projectNormals(	CCLib::GenericCloud* cloud
 			unsigned x, y;
 			if (convertToDepthMapCoords(Q.x, Q.y, x, y))
 			{
-				//add the transformed normal
-				CCVector3& newN = normalGrid->at(y*m_depthBuffer.width + x);
-				newN += S;
+				cellIndexes[k] = y*m_depthBuffer.width + x;
+				projectedNormals[k] = S;
 			}
 			else
 			{
 				//shouldn't happen!
 				assert(false);
+				cellIndexes[k] = s_invalidCellIndex;
 			}
-		}
+		},
+		[&](unsigned, unsigned k)
+		{
+			//add the transformed normal
+			if (cellIndexes[k] != s_invalidCellIndex)
+			{
+				(*normalGrid)[cellIndexes[k]] += projectedNormals[k];
+			}
+		},
+		nullptr);
+
+	if (!success)
+	{
+		//not enough memory
+		delete normalGrid;
+		return nullptr;
 	}
 
 	//normalize
@@ -373,39 +509,61 @@ ccGBLSensor::ColorGrid* ccGBLSensor::projectColors(	CCLib::GenericCloud* cloud,
 		return nullptr; //not enough memory
 	}
 
-	//project colors
+	//temporary buffer (for each block of points)
+	std::vector<unsigned> cellIndexes;
+	try
 	{
-		unsigned pointCount = cloud->size();
-		cloud->placeIteratorAtBeginning();
-		{
-			for (unsigned i = 0; i < pointCount; ++i)
-			{
-				const CCVector3 *P = cloud->getNextPoint();
-				CCVector2 Q;
-				PointCoordinateType depth;
-				projectPoint(*P, Q, depth, m_activeIndex);
+		cellIndexes.resize(std::min(cloud->size(), s_projectionBlockSize));
+	}
+	catch (const std::bad_alloc&)
+	{
+		delete colorGrid;
+		return nullptr; //not enough memory
+	}
 
-				unsigned x, y;
-				if (convertToDepthMapCoords(Q.x, Q.y, x, y))
-				{
-					unsigned index = y*m_depthBuffer.width + x;
+	const ccGLMatrix worldToSensor = getWorldToSensorTransformation(m_activeIndex);
 
-					//accumulate color
-					const ccColor::Rgb& srcC = theColors[i];
-					ccColor::Rgbf& destC = colorAccumGrid[index];
+	//project colors (in parallel)
+	bool success = ProjectByBlocks(cloud,
+		[&](const CCVector3& P, unsigned, unsigned k)
+		{
+			CCVector2 Q;
+			PointCoordinateType depth;
+			projectPoint(P, Q, depth, worldToSensor);
 
-					destC.r += srcC.r;
-					destC.g += srcC.g;
-					destC.b += srcC.b;
-					++pointPerDMCell[index];
-				}
-				else
-				{
-					//shouldn't happen!
-					assert(false);
-				}
+			unsigned x, y;
+			if (convertToDepthMapCoords(Q.x, Q.y, x, y))
+			{
+				cellIndexes[k] = y*m_depthBuffer.width + x;
 			}
-		}
+			else
+			{
+				//shouldn't happen!
+				assert(false);
+				cellIndexes[k] = s_invalidCellIndex;
+			}
+		},
+		[&](unsigned i, unsigned k)
+		{
+			unsigned index = cellIndexes[k];
+			if (index != s_invalidCellIndex)
+			{
+				//accumulate color
+				const ccColor::Rgb& srcC = theColors[i];
+				ccColor::Rgbf& destC = colorAccumGrid[index];
+
+				destC.r += srcC.r;
+				destC.g += srcC.g;
+				destC.b += srcC.b;
+				++pointPerDMCell[index];
+			}
+		},
+		nullptr);
+
+	if (!success)
+	{
+		delete colorGrid;
+		return nullptr; //not enough memory
 	}
 
 	//normalize
@@ -623,6 +781,26 @@ bool ccGBLSensor::computeDepthBuffer(CCLib::GenericCloud* theCloud, int& errorCo
 		return false;
 	}
 
+	//progress bar
+	ccProgressDialog pdlg(true);
+	pdlg.setMethodTitle(QObject::tr("Depth buffer"));
+	pdlg.setInfo(QObject::tr("Points: %L1").arg(theCloud->size()));
+	pdlg.start();
+	QCoreApplication::processEvents();
+
+	return computeDepthBuffer(theCloud, errorCode, projectedCloud, &pdlg);
+}
+
+bool ccGBLSensor::computeDepthBuffer(CCLib::GenericCloud* theCloud, int& errorCode, ccPointCloud* projectedCloud, CCLib::GenericProgressCallback* progressCb)
+{
+	assert(theCloud);
+	if (!theCloud)
+	{
+		//invlalid input parameter
+		errorCode = ERROR_BAD_INPUT;
+		return false;
+	}
+
 	//clear previous Z-buffer (if any)
 	clearDepthBuffer();
 
@@ -688,45 +866,70 @@ bool ccGBLSensor::computeDepthBuffer(CCLib::GenericCloud* theCloud, int& errorCo
 			}
 		}
 
-		theCloud->placeIteratorAtBeginning();
+		//temporary buffers (for each block of points)
+		unsigned blockSize = std::min(pointCount, s_projectionBlockSize);
+		std::vector<unsigned> cellIndexes;
+		std::vector<PointCoordinateType> depths;
+		std::vector<CCVector2> projectedPoints;
+		try
+		{
+			cellIndexes.resize(blockSize);
+			depths.resize(blockSize);
+			if (projectedCloud)
+			{
+				projectedPoints.resize(blockSize);
+			}
+		}
+		catch (const std::bad_alloc&)
 		{
-			//progress bar
-			ccProgressDialog pdlg(true);
-			CCLib::NormalizedProgress nprogress(&pdlg, pointCount);
-			pdlg.setMethodTitle(QObject::tr("Depth buffer"));
-			pdlg.setInfo(QObject::tr("Points: %L1").arg(pointCount));
-			pdlg.start();
-			QCoreApplication::processEvents();
-
-			for (unsigned i = 0; i < pointCount; ++i)
+			//not enough memory
+			errorCode = ERROR_MEMORY;
+			clearDepthBuffer();
+			return false;
+		}
+
+		const ccGLMatrix worldToSensor = getWorldToSensorTransformation(m_activeIndex);
+		CCLib::NormalizedProgress nprogress(progressCb, pointCount);
+
+		//the points are projected in parallel, then the depth buffer is updated in the points order
+		bool success = ProjectByBlocks(theCloud,
+			[&](const CCVector3& P, unsigned, unsigned k)
 			{
-				const CCVector3 *P = theCloud->getNextPoint();
 				CCVector2 Q;
-				PointCoordinateType depth;
-				projectPoint(*P, Q, depth, m_activeIndex);
+				projectPoint(P, Q, depths[k], worldToSensor);
 
 				unsigned x, y;
-				if (convertToDepthMapCoords(Q.x, Q.y, x, y))
+				cellIndexes[k] = (convertToDepthMapCoords(Q.x, Q.y, x, y) ? y*m_depthBuffer.width + x : s_invalidCellIndex);
+
+				if (projectedCloud)
 				{
-					PointCoordinateType& zBuf = m_depthBuffer.zBuff[y*m_depthBuffer.width + x];
+					projectedPoints[k] = Q;
+				}
+			},
+			[&](unsigned i, unsigned k)
+			{
+				PointCoordinateType depth = depths[k];
+				if (cellIndexes[k] != s_invalidCellIndex)
+				{
+					PointCoordinateType& zBuf = m_depthBuffer.zBuff[cellIndexes[k]];
 					zBuf = std::max(zBuf, depth);
 					m_sensorRange = std::max(m_sensorRange, depth);
 				}
 
 				if (projectedCloud)
 				{
-					projectedCloud->addPoint(CCVector3(Q.x, Q.y, 0));
+					projectedCloud->addPoint(CCVector3(projectedPoints[k].x, projectedPoints[k].y, 0));
 					projectedCloud->setPointScalarValue(i, depth);
 				}
+			},
+			progressCb ? &nprogress : nullptr);
 
-				if (!nprogress.oneStep())
-				{
-					//cancelled by user
-					errorCode = ERROR_PROC_CANCELLED;
-					clearDepthBuffer();
-					return false;
-				}
-			}
+		if (!success)
+		{
+			//cancelled by user (or not enough memory)
+			errorCode = (progressCb && progressCb->isCancelRequested() ? ERROR_PROC_CANCELLED : ERROR_MEMORY);
+			clearDepthBuffer();
+			return false;
 		}
 	}
 
@@ -736,6 +939,66 @@ bool ccGBLSensor::computeDepthBuffer(CCLib::GenericCloud* theCloud, int& errorCo
 	return true;
 }
 
+bool ccGBLSensor::ComputeDepthBuffers(	const std::vector<ccGBLSensor*>& sensors,
+										CCLib::GenericIndexedCloud* cloud,
+										std::vector<int>& errorCodes,
+										CCLib::GenericProgressCallback* progressCb/*=nullptr*/)
+{
+	if (!cloud)
+	{
+		assert(false);
+		return false;
+	}
+
+	try
+	{
+		errorCodes.resize(sensors.size(), ERROR_BAD_INPUT);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+
+	if (progressCb)
+	{
+		if (progressCb->textCanBeEdited())
+		{
+			progressCb->setMethodTitle("Depth buffers");
+			progressCb->setInfo(qPrintable(QString("Sensors: %1\nPoints: %L2").arg(sensors.size()).arg(cloud->size())));
+		}
+		progressCb->update(0);
+		progressCb->start();
+	}
+	CCLib::NormalizedProgress nprogress(progressCb, static_cast<unsigned>(sensors.size()));
+
+	//each sensor only modifies its own depth buffer, and the cloud is only read (by index)
+	std::atomic<bool> allSucceeded(true);
+	int sensorCount = static_cast<int>(sensors.size());
+#ifdef USE_TBB
+	tbb::parallel_for(0, sensorCount, [&](int i)
+#else
+	for (int i = 0; i < sensorCount; ++i)
+#endif
+	{
+		ccGBLSensor* sensor = sensors[i];
+		if (!sensor || !sensor->computeDepthBuffer(cloud, errorCodes[i], nullptr, nullptr))
+		{
+			allSucceeded = false;
+		}
+		nprogress.oneStep();
+	}
+#ifdef USE_TBB
+	);
+#endif
+
+	if (progressCb)
+	{
+		progressCb->stop();
+	}
+
+	return allSucceeded;
+}
+
 unsigned char ccGBLSensor::checkVisibility(const CCVector3& P) const
 {
 	if (m_depthBuffer.zBuff.empty()) //no z-buffer?
@@ -770,6 +1033,90 @@ unsigned char ccGBLSensor::checkVisibility(const CCVector3& P) const
 	return POINT_VISIBLE;
 }
 
+bool ccGBLSensor::checkVisibility(	const CCLib::GenericIndexedCloud* cloud,
+									std::vector<unsigned char>& visibility,
+									CCLib::GenericProgressCallback* progressCb/*=nullptr*/) const
+{
+	if (!cloud)
+	{
+		assert(false);
+		return false;
+	}
+
+	unsigned pointCount = cloud->size();
+	try
+	{
+		visibility.resize(pointCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+
+	if (m_depthBuffer.zBuff.empty()) //no z-buffer?
+	{
+		std::fill(visibility.begin(), visibility.end(), static_cast<unsigned char>(POINT_VISIBLE));
+		return true;
+	}
+
+	//the transformation is only computed once
+	const ccGLMatrix worldToSensor = getWorldToSensorTransformation(m_activeIndex);
+
+	CCLib::NormalizedProgress nprogress(progressCb, pointCount);
+	std::atomic<bool> cancelled(false);
+	int blockCount = static_cast<int>((pointCount + s_projectionBlockSize - 1) / s_projectionBlockSize);
+
+#ifdef USE_TBB
+	tbb::parallel_for(0, blockCount, [&](int b)
+#else
+	for (int b = 0; b < blockCount; ++b)
+#endif
+	{
+		unsigned first = static_cast<unsigned>(b) * s_projectionBlockSize;
+		unsigned last = std::min(first + s_projectionBlockSize, pointCount);
+		for (unsigned i = first; i < last && !cancelled; ++i)
+		{
+			CCVector3 P;
+			cloud->getPoint(i, P);
+
+			CCVector2 Q;
+			PointCoordinateType depth;
+			projectPoint(P, Q, depth, worldToSensor);
+
+			unsigned x, y;
+			if (depth > m_sensorRange)
+			{
+				//out of sight
+				visibility[i] = POINT_OUT_OF_RANGE;
+			}
+			else if (!convertToDepthMapCoords(Q.x, Q.y, x, y))
+			{
+				//out of field of view
+				visibility[i] = POINT_OUT_OF_FOV;
+			}
+			else if (depth > m_depthBuffer.zBuff[y*m_depthBuffer.width + x] * (1.0f + m_uncertainty))
+			{
+				visibility[i] = POINT_HIDDEN;
+			}
+			else
+			{
+				visibility[i] = POINT_VISIBLE;
+			}
+		}
+
+		if (progressCb && !nprogress.steps(last - first))
+		{
+			cancelled = true;
+		}
+	}
+#ifdef USE_TBB
+	);
+#endif
+
+	return !cancelled;
+}
+
 void ccGBLSensor::drawMeOnly(CC_DRAW_CONTEXT& context)
 {
 	if (!MACRO_Draw3D(context))
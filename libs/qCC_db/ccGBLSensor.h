@@ -24,9 +24,15 @@
 
 //CCLib
 #include <GenericCloud.h>
+#include <GenericIndexedCloud.h>
 
 class ccPointCloud;
 
+namespace CCLib
+{
+	class GenericProgressCallback;
+}
+
 //! Ground-based Laser sensor
 /** An implementation of the ccSensor interface that can be used to represent a depth sensor
 	relying on 2 rotations relatively to two perpendicular axes, such as ground based laser
@@ -79,6 +85,18 @@ public:
 	**/
 	virtual unsigned char checkVisibility(const CCVector3& P) const override;
 
+	//! Determines the "visibility" of all the points of a cloud relatively to the sensor field of view
+	/** Same as ccGBLSensor::checkVisibility(const CCVector3&), but the points are processed in
+		parallel (and the sensor transformation is only computed once).
+		\param cloud the points to test
+		\param[out] visibility the visibility of each point (POINT_VISIBLE, POINT_HIDDEN, POINT_OUT_OF_RANGE or POINT_OUT_OF_FOV)
+		\param progressCb optional progress callback
+		\return success (false if not enough memory, or if the process has been cancelled)
+	**/
+	bool checkVisibility(	const CCLib::GenericIndexedCloud* cloud,
+							std::vector<unsigned char>& visibility,
+							CCLib::GenericProgressCallback* progressCb = nullptr) const;
+
 	//! Computes angular parameters automatically (all but the angular steps!)
 	/** WARNING: this method uses the cloud global iterator.
 	**/
@@ -204,7 +222,8 @@ public: //projection tools
 public: //depth buffer management
 
 	//! Projects a point cloud along the sensor point of view defined by this instance
-	/** WARNING: this method uses the cloud global iterator
+	/** The points are projected in parallel (by blocks).
+		WARNING: this method uses the cloud global iterator (if the cloud is not an indexed cloud)
 		\param cloud a point cloud
 		\param errorCode error code in case the returned cloud is 0
 		\param projectedCloud optional (empty) cloud to store the projected points
@@ -212,6 +231,19 @@ public: //depth buffer management
 	**/
 	bool computeDepthBuffer(CCLib::GenericCloud* cloud, int& errorCode, ccPointCloud* projectedCloud = nullptr);
 
+	//! Computes the depth buffers of several sensors relatively to the same cloud
+	/** The sensors are processed concurrently (the cloud is only read).
+		\param sensors the sensors
+		\param cloud the (common) point cloud
+		\param[out] errorCodes the error code of each sensor (0 if the depth buffer was successfully created)
+		\param progressCb optional progress callback
+		\return whether all the depth buffers were successfully created or not
+	**/
+	static bool ComputeDepthBuffers(const std::vector<ccGBLSensor*>& sensors,
+									CCLib::GenericIndexedCloud* cloud,
+									std::vector<int>& errorCodes,
+									CCLib::GenericProgressCallback* progressCb = nullptr);
+
 	//! Returns the associated depth buffer
 	/** Call ccGBLSensor::computeDepthBuffer first otherwise the returned buffer will be 0.
 	**/
@@ -230,6 +262,18 @@ protected:
 	//! Converts 2D angular coordinates (yaw,pitch) in integer depth buffer coordinates
 	bool convertToDepthMapCoords(PointCoordinateType yaw, PointCoordinateType pitch, unsigned& i, unsigned& j) const;
 
+	//! Returns the transformation from the world to the sensor frame (at a given position index)
+	ccGLMatrix getWorldToSensorTransformation(double posIndex) const;
+
+	//! Projects a point in the sensor world (with a precomputed world to sensor transformation)
+	void projectPoint(	const CCVector3& sourcePoint,
+						CCVector2& destPoint,
+						PointCoordinateType &depth,
+						const ccGLMatrix& worldToSensor) const;
+
+	//! Projects a point cloud along the sensor point of view (with an optional progress callback)
+	bool computeDepthBuffer(CCLib::GenericCloud* cloud, int& errorCode, ccPointCloud* projectedCloud, CCLib::GenericProgressCallback* progressCb);
+
 	//! Minimal pitch limit (in radians)
 	/** Phi = 0 corresponds to the scanner vertical direction (upward) **/
 	PointCoordinateType m_phiMin;
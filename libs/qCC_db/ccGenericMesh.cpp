@@ -38,8 +38,19 @@
 #include <PointCloud.h>
 #include <ReferenceCloud.h>
 
+//Qt
+#include <QImage>
+#include <QMap>
+
 //system
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cmath>
+
+#ifdef USE_TBB
+#include <tbb/parallel_for.h>
+#endif
 
 ccGenericMesh::ccGenericMesh(QString name/*=QString()*/)
 	: GenericIndexedMesh()
@@ -696,6 +707,162 @@ bool ccGenericMesh::fromFile_MeOnly(QFile& in, short dataVersion, int flags)
 	return true;
 }
 
+//! Number of sampled points processed by each task (features interpolation)
+static const unsigned s_sampledPointsChunkSize = 65536;
+
+//! Pre-decoded material textures (with mip-maps) for mesh sampling
+/** Reading the QImage pixels (see ccMesh::getColorFromMaterial) is slow and not
+	thread-safe. The textures are decoded once, along with their mip-maps (box filter).
+	The mip-map level is chosen for each triangle depending on the number of texels
+	covered by each sample, so that sparse samples get the average color of the
+	texture area they represent rather than a single (aliased) texel.
+**/
+class SamplingTextureCache
+{
+public:
+
+	//! Mip-map level
+	struct Level
+	{
+		Level() : width(0), height(0) {}
+
+		int width;
+		int height;
+		std::vector<ccColor::Rgb> texels;
+
+		inline const ccColor::Rgb& texel(int x, int y) const { return texels[static_cast<size_t>(y) * width + x]; }
+	};
+
+	//! Mip-map levels (the first one is the original texture)
+	using Pyramid = std::vector<Level>;
+
+	//! Decodes the textures of a set of materials
+	/** \return false if there's not enough memory
+	**/
+	bool init(const ccMaterialSet* materials)
+	{
+		m_pyramids.clear();
+		m_materialPyramids.clear();
+		if (!materials)
+		{
+			return true;
+		}
+
+		try
+		{
+			m_materialPyramids.resize(materials->size(), -1);
+
+			QMap<QString, int> pyramidIndexes;
+			for (size_t i = 0; i < materials->size(); ++i)
+			{
+				const ccMaterial::CShared& material = materials->at(i);
+				if (!material->hasTexture())
+				{
+					continue;
+				}
+
+				//textures shared by several materials are only decoded once
+				const QString& filename = material->getTextureFilename();
+				if (pyramidIndexes.contains(filename))
+				{
+					m_materialPyramids[i] = pyramidIndexes[filename];
+					continue;
+				}
+
+				m_pyramids.emplace_back();
+				BuildPyramid(material->getTexture(), m_pyramids.back());
+				m_materialPyramids[i] = static_cast<int>(m_pyramids.size()) - 1;
+				pyramidIndexes[filename] = m_materialPyramids[i];
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			m_pyramids.clear();
+			m_materialPyramids.clear();
+			return false;
+		}
+
+		return true;
+	}
+
+	//! Returns the decoded texture of a given material (if any)
+	inline const Pyramid* pyramid(int matIndex) const
+	{
+		int index = m_materialPyramids[matIndex];
+		return index >= 0 ? &m_pyramids[index] : nullptr;
+	}
+
+protected:
+
+	//! Decodes a texture and builds its mip-maps
+	static void BuildPyramid(const QImage& image, Pyramid& pyramid)
+	{
+		const QImage texture = image.convertToFormat(QImage::Format_RGB32);
+
+		pyramid.resize(1);
+		Level& base = pyramid.front();
+		base.width = texture.width();
+		base.height = texture.height();
+		base.texels.resize(static_cast<size_t>(base.width) * base.height);
+		for (int y = 0; y < base.height; ++y)
+		{
+			const QRgb* line = reinterpret_cast<const QRgb*>(texture.constScanLine(y));
+			ccColor::Rgb* texels = base.texels.data() + static_cast<size_t>(y) * base.width;
+			for (int x = 0; x < base.width; ++x)
+			{
+				texels[x] = ccColor::Rgb(qRed(line[x]), qGreen(line[x]), qBlue(line[x]));
+			}
+		}
+
+		while (pyramid.back().width > 1 || pyramid.back().height > 1)
+		{
+			pyramid.emplace_back();
+			const Level& previous = pyramid[pyramid.size() - 2];
+			Level& level = pyramid.back();
+			level.width = std::max(previous.width / 2, 1);
+			level.height = std::max(previous.height / 2, 1);
+			level.texels.resize(static_cast<size_t>(level.width) * level.height);
+
+			for (int y = 0; y < level.height; ++y)
+			{
+				int y0 = std::min(2 * y, previous.height - 1);
+				int y1 = std::min(2 * y + 1, previous.height - 1);
+				for (int x = 0; x < level.width; ++x)
+				{
+					int x0 = std::min(2 * x, previous.width - 1);
+					int x1 = std::min(2 * x + 1, previous.width - 1);
+
+					const ccColor::Rgb& C00 = previous.texel(x0, y0);
+					const ccColor::Rgb& C01 = previous.texel(x1, y0);
+					const ccColor::Rgb& C10 = previous.texel(x0, y1);
+					const ccColor::Rgb& C11 = previous.texel(x1, y1);
+
+					level.texels[static_cast<size_t>(y) * level.width + x] = ccColor::Rgb(	static_cast<ColorCompType>((C00.r + C01.r + C10.r + C11.r + 2) / 4),
+																							static_cast<ColorCompType>((C00.g + C01.g + C10.g + C11.g + 2) / 4),
+																							static_cast<ColorCompType>((C00.b + C01.b + C10.b + C11.b + 2) / 4) );
+				}
+			}
+		}
+	}
+
+	//! Decoded textures
+	std::vector<Pyramid> m_pyramids;
+	//! Decoded texture index of each material (or -1 if none)
+	std::vector<int> m_materialPyramids;
+};
+
+//! Wraps a texture coordinate in [0 ; 1] (see ccMesh::getColorFromMaterial)
+static inline double WrapTexCoord(double x)
+{
+	double xInt;
+	if (x > 1.0)
+		return std::modf(x, &xInt);
+	else if (x < 0.0)
+		return 1.0 + std::modf(x, &xInt);
+	return x;
+}
+
 ccPointCloud* ccGenericMesh::samplePoints(	bool densityBased,
 											double samplingParameter,
 											bool withNormals,
@@ -760,20 +927,38 @@ ccPointCloud* ccGenericMesh::samplePoints(	bool densityBased,
 
 	if (withFeatures && triIndices && triIndices->size() >= cloud->size())
 	{
+		unsigned pointCount = cloud->size();
+		int chunkCount = static_cast<int>((pointCount + s_sampledPointsChunkSize - 1) / s_sampledPointsChunkSize);
+
 		//generate normals
 		if (withNormals && hasNormals())
 		{
-			if (cloud->reserveTheNormsTable())
+			if (cloud->resizeTheNormsTable())
 			{
-				for (unsigned i = 0; i < cloud->size(); ++i)
+				NormsIndexesTableType* normals = cloud->normals();
+				ccNormalVectors::GetUniqueInstance(); //to be sure the table is initialized before the parallel loop
+
+#ifdef USE_TBB
+				tbb::parallel_for(0, chunkCount, [&](int c)
+#else
+				for (int c = 0; c < chunkCount; ++c)
+#endif
 				{
-					unsigned triIndex = triIndices->at(i);
-					const CCVector3* P = cloud->getPoint(i);
+					unsigned firstIndex = static_cast<unsigned>(c) * s_sampledPointsChunkSize;
+					unsigned lastIndex = std::min(firstIndex + s_sampledPointsChunkSize, pointCount);
+					for (unsigned i = firstIndex; i < lastIndex; ++i)
+					{
+						CCVector3 P;
+						cloud->getPoint(i, P);
 
-					CCVector3 N(0, 0, 1);
-					interpolateNormals(triIndex, *P, N);
-					cloud->addNorm(N);
+						CCVector3 N(0, 0, 1);
+						interpolateNormals(triIndices->at(i), P, N);
+						normals->setValue(i, ccNormalVectors::GetNormIndex(N));
+					}
 				}
+#ifdef USE_TBB
+				);
+#endif
 
 				cloud->showNormals(true);
 			}
@@ -786,17 +971,132 @@ ccPointCloud* ccGenericMesh::samplePoints(	bool densityBased,
 		//generate colors
 		if (withTexture && hasMaterials())
 		{
-			if (cloud->reserveTheRGBTable())
+			SamplingTextureCache textureCache;
+			if (textureCache.init(getMaterialSet()) && cloud->resizeTheRGBTable())
 			{
-				for (unsigned i = 0; i < cloud->size(); ++i)
+				ColorsTableType* colors = cloud->rgbColors();
+				const ccMaterialSet* materials = getMaterialSet();
+				bool texCoords = hasTextures();
+
+				//mean surface covered by each sample (for the mip-map level selection)
+				double sampleArea = 0.0;
+				if (densityBased)
+				{
+					sampleArea = 1.0 / samplingParameter;
+				}
+				else
 				{
-					unsigned triIndex = triIndices->at(i);
-					const CCVector3* P = cloud->getPoint(i);
+					sampleArea = CCLib::MeshSamplingTools::computeMeshArea(this) / pointCount;
+				}
+
+#ifdef USE_TBB
+				tbb::parallel_for(0, chunkCount, [&](int c)
+#else
+				for (int c = 0; c < chunkCount; ++c)
+#endif
+				{
+					//the samples of a given triangle are contiguous: we only update
+					//the triangle information when the triangle index changes
+					unsigned currentTriIndex = 0;
+					bool currentTriValid = false;
+					CCVector3 A, B, C;
+					int matIndex = -1;
+					const SamplingTextureCache::Pyramid* pyramid = nullptr;
+					const SamplingTextureCache::Level* level = nullptr;
+					TexCoords2D *T1 = nullptr, *T2 = nullptr, *T3 = nullptr;
+
+					unsigned firstIndex = static_cast<unsigned>(c) * s_sampledPointsChunkSize;
+					unsigned lastIndex = std::min(firstIndex + s_sampledPointsChunkSize, pointCount);
+					for (unsigned i = firstIndex; i < lastIndex; ++i)
+					{
+						unsigned triIndex = triIndices->at(i);
+						CCVector3 P;
+						cloud->getPoint(i, P);
 
-					ccColor::Rgb C;
-					getColorFromMaterial(triIndex, *P, C, withRGB);
-					cloud->addRGBColor(C);
+						if (!currentTriValid || triIndex != currentTriIndex)
+						{
+							currentTriIndex = triIndex;
+							currentTriValid = true;
+
+							getTriangleVertices(triIndex, A, B, C);
+							matIndex = getTriangleMtlIndex(triIndex);
+							pyramid = (matIndex >= 0 ? textureCache.pyramid(matIndex) : nullptr);
+							level = nullptr;
+							T1 = T2 = T3 = nullptr;
+							if (pyramid && texCoords)
+							{
+								getTriangleTexCoordinates(triIndex, T1, T2, T3);
+							}
+
+							if (pyramid)
+							{
+								//mip-map level: depends on the number of texels per sample
+								size_t levelIndex = 0;
+								if (T1 && T2 && T3)
+								{
+									const SamplingTextureCache::Level& base = pyramid->front();
+									double uvArea = std::abs((T2->tx - T1->tx) * (T3->ty - T1->ty) - (T3->tx - T1->tx) * (T2->ty - T1->ty)) / 2;
+									double S = (B - A).cross(C - A).normd() / 2;
+									double texelsPerSample = (S > 0 ? uvArea * base.width * base.height * std::min(sampleArea / S, 1.0) : 0.0);
+									if (texelsPerSample > 1.0)
+									{
+										levelIndex = std::min(static_cast<size_t>(std::log2(texelsPerSample) / 2), pyramid->size() - 1);
+									}
+								}
+								level = &(*pyramid)[levelIndex];
+							}
+						}
+
+						ccColor::Rgb col;
+						if (matIndex < 0)
+						{
+							if (withRGB)
+								interpolateColors(triIndex, P, col);
+						}
+						else if (!level)
+						{
+							const ccColor::Rgbaf& diffuse = materials->at(matIndex)->getDiffuseFront();
+							col.r = static_cast<ColorCompType>(diffuse.r * ccColor::MAX);
+							col.g = static_cast<ColorCompType>(diffuse.g * ccColor::MAX);
+							col.b = static_cast<ColorCompType>(diffuse.b * ccColor::MAX);
+						}
+						else
+						{
+							//barycentric interpolation weights
+							CCVector3d w(	std::sqrt(((P - B).cross(C - B)).norm2d()),
+											std::sqrt(((P - C).cross(A - C)).norm2d()),
+											std::sqrt(((P - A).cross(B - A)).norm2d()) );
+							w /= (w.x + w.y + w.z);
+
+							if (	(!T1 && w.u[0] > ZERO_TOLERANCE)
+								||	(!T2 && w.u[1] > ZERO_TOLERANCE)
+								||	(!T3 && w.u[2] > ZERO_TOLERANCE) )
+							{
+								if (withRGB)
+									interpolateColors(triIndex, P, col);
+							}
+							else
+							{
+								double x = WrapTexCoord((T1 ? T1->tx * w.u[0] : 0.0) + (T2 ? T2->tx * w.u[1] : 0.0) + (T3 ? T3->tx * w.u[2] : 0.0));
+								double y = WrapTexCoord((T1 ? T1->ty * w.u[0] : 0.0) + (T2 ? T2->ty * w.u[1] : 0.0) + (T3 ? T3->ty * w.u[2] : 0.0));
+
+								int xPix = std::min(static_cast<int>(std::floor(x * level->width)), level->width - 1);
+								int yPix = std::min(static_cast<int>(std::floor(y * level->height)), level->height - 1);
+								const ccColor::Rgb& texel = level->texel(xPix, yPix);
+
+								const ccColor::Rgbaf& diffuse = materials->at(matIndex)->getDiffuseFront();
+								col.r = static_cast<ColorCompType>(diffuse.r * texel.r);
+								col.g = static_cast<ColorCompType>(diffuse.g * texel.g);
+								col.b = static_cast<ColorCompType>(diffuse.b * texel.b);
+							}
+						}
+
+						colors->setValue(i, col);
+					}
 				}
+#ifdef USE_TBB
+				);
+#endif
 
 				cloud->showColors(true);
 			}
@@ -807,17 +1107,31 @@ ccPointCloud* ccGenericMesh::samplePoints(	bool densityBased,
 		}
 		else if (withRGB && hasColors())
 		{
-			if (cloud->reserveTheRGBTable())
+			if (cloud->resizeTheRGBTable())
 			{
-				for (unsigned i = 0; i < cloud->size(); ++i)
+				ColorsTableType* colors = cloud->rgbColors();
+
+#ifdef USE_TBB
+				tbb::parallel_for(0, chunkCount, [&](int c)
+#else
+				for (int c = 0; c < chunkCount; ++c)
+#endif
 				{
-					unsigned triIndex = triIndices->at(i);
-					const CCVector3* P = cloud->getPoint(i);
+					unsigned firstIndex = static_cast<unsigned>(c) * s_sampledPointsChunkSize;
+					unsigned lastIndex = std::min(firstIndex + s_sampledPointsChunkSize, pointCount);
+					for (unsigned i = firstIndex; i < lastIndex; ++i)
+					{
+						CCVector3 P;
+						cloud->getPoint(i, P);
 
-					ccColor::Rgb C;
-					interpolateColors(triIndex, *P, C);
-					cloud->addRGBColor(C);
+						ccColor::Rgb col;
+						interpolateColors(triIndices->at(i), P, col);
+						colors->setValue(i, col);
+					}
 				}
+#ifdef USE_TBB
+				);
+#endif
 
 				cloud->showColors(true);
 			}
@@ -40,6 +40,7 @@
 #include "ccPolyline.h"
 #include "ccQuadric.h"
 #include "ccSphere.h"
+#include "ccSubCloud.h"
 #include "ccSubMesh.h"
 #include "ccTorus.h"
 
@@ -128,6 +129,9 @@ ccHObject* ccHObject::New(CC_CLASS_ENUM objectType, const char* name/*=0*/)
 		return new ccHObject(name);
 	case CC_TYPES::POINT_CLOUD:
 		return new ccPointCloud(name);
+	case CC_TYPES::SUB_CLOUD:
+		//warning: no associated cloud --> retrieved later
+		return new ccSubCloud(nullptr, name);
 	case CC_TYPES::MESH:
 		//warning: no associated vertices --> retrieved later
 		return new ccMesh(nullptr);
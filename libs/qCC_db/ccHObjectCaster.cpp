@@ -22,6 +22,7 @@
 #include "ccShiftedObject.h"
 #include "ccGenericPointCloud.h"
 #include "ccPointCloud.h"
+#include "ccSubCloud.h"
 #include "ccGenericMesh.h"
 #include "ccMesh.h"
 #include "ccSubMesh.h"
@@ -125,6 +126,11 @@ ccShiftedObject* ccHObjectCaster::ToShifted(ccHObject* obj, bool* lockedVertices
 	return 0;
 }
 
+ccSubCloud* ccHObjectCaster::ToSubCloud(ccHObject* obj)
+{
+	return (obj && obj->isA(CC_TYPES::SUB_CLOUD) ? static_cast<ccSubCloud*>(obj) : 0);
+}
+
 ccGenericMesh* ccHObjectCaster::ToGenericMesh(ccHObject* obj)
 {
 	return (obj && obj->isKindOf(CC_TYPES::MESH) ? static_cast<ccGenericMesh*>(obj) : 0);
@@ -48,6 +48,7 @@ class ccPolyline;
 class ccSensor;
 class ccShiftedObject;
 class ccSphere;
+class ccSubCloud;
 class ccSubMesh;
 class ccTorus;
 
@@ -73,6 +74,9 @@ public:
 	**/
 	static ccShiftedObject* ToShifted(ccHObject* obj, bool* isLockedVertices = nullptr);
 
+	//! Converts current object to ccSubCloud (if possible)
+	static ccSubCloud* ToSubCloud(ccHObject* obj);
+
 	//! Converts current object to ccGenericMesh (if possible)
 	static ccGenericMesh* ToGenericMesh(ccHObject* obj);
 
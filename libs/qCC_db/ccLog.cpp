@@ -32,26 +32,16 @@
  *** Globals ***
  ***************/
 
-//buffer for formatted string generation
+//max size of formatted strings
 static const size_t s_bufferMaxSize = 4096;
-static char s_buffer[s_bufferMaxSize];
-
-//! Message
-struct Message
-{
-	Message(const QString& t, int f)
-		: text(t)
-		, flags(f)
-	{}
-
-	QString text;
-	int flags;
-};
 
 //message backup system
 static bool s_backupEnabled;
 //backuped messages
-static std::vector<Message> s_backupMessages;
+static std::vector<ccLog::Message> s_backupMessages;
+
+//messages captured for the current thread (if any)
+static thread_local std::vector<ccLog::Message>* s_threadMessages = nullptr;
 
 //unique console instance
 static ccLog* s_instance = nullptr;
@@ -76,7 +66,18 @@ void ccLog::LogMessage(const QString& message, int level)
 	}
 #endif
 
-	if (s_instance)
+	if (s_threadMessages)
+	{
+		try
+		{
+			s_threadMessages->emplace_back(message, level);
+		}
+		catch (const std::bad_alloc&)
+		{
+			//nothing to do, the message will be lost...
+		}
+	}
+	else if (s_instance)
 	{
 		s_instance->logMessage(message, level);
 	}
@@ -93,6 +94,16 @@ void ccLog::LogMessage(const QString& message, int level)
 	}
 }
 
+void ccLog::CaptureThreadMessages(std::vector<Message>* buffer)
+{
+	s_threadMessages = buffer;
+}
+
+bool ccLog::IsCapturingThreadMessages()
+{
+	return (s_threadMessages != nullptr);
+}
+
 void ccLog::RegisterInstance(ccLog* logInstance)
 {
 	s_instance = logInstance;
@@ -109,14 +120,17 @@ void ccLog::RegisterInstance(ccLog* logInstance)
 
 //Conversion from '...' parameters to QString so as to call ccLog::logMessage
 //(we get the "..." parameters as "printf" would do)
+//(the buffer is local so that messages can be logged concurrently)
 #define LOG_ARGS(flags)\
-	if (s_instance || s_backupEnabled)\
+	if (s_instance || s_backupEnabled || s_threadMessages)\
 	{\
+		char buffer[s_bufferMaxSize];\
 		va_list args;\
 		va_start(args, format);\
-		_vsnprintf(s_buffer, s_bufferMaxSize, format, args);\
+		_vsnprintf(buffer, s_bufferMaxSize, format, args);\
 		va_end(args);\
-		LogMessage(QString(s_buffer), flags);\
+		buffer[s_bufferMaxSize - 1] = 0;\
+		LogMessage(QString(buffer), flags);\
 	}\
 
 bool ccLog::Print(const char* format, ...)
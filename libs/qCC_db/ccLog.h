@@ -24,6 +24,7 @@
 //system
 #include <stdio.h>
 #include <string>
+#include <vector>
 
 //Qt
 #include <QString>
@@ -62,6 +63,30 @@ public:
 	//! Static shortcut to ccLog::logMessage
 	static void LogMessage(const QString& message, int level);
 
+	//! Logged message
+	struct Message
+	{
+		Message(const QString& t, int f)
+			: text(t)
+			, flags(f)
+		{}
+
+		QString text;
+		int flags;
+	};
+
+	//! Captures the messages logged by the current thread
+	/** While a buffer is set, the messages logged by the calling thread are
+		stored in it instead of being sent to the logging instance (the other
+		threads are not affected). This is useful to output the messages of
+		concurrent jobs in a deterministic order.
+		\param buffer message buffer (or nullptr to stop capturing)
+	**/
+	static void CaptureThreadMessages(std::vector<Message>* buffer);
+
+	//! Returns whether the messages logged by the current thread are being captured
+	static bool IsCapturingThreadMessages();
+
 	//! Generic message logging method
 	/** To be implemented by child class.
 		\warning MUST BE THREAD SAFE!
@@ -40,11 +40,19 @@
 #include <ReferenceCloud.h>
 #include <Neighbourhood.h>
 #include <Delaunay2dMesh.h>
+#include <MeshAdjacency.h>
 
 //System
 #include <string.h>
 #include <assert.h>
+#include <atomic>
 #include <cmath> //for std::modf
+#include <limits>
+#include <unordered_map>
+
+#ifdef USE_TBB
+#include <tbb/parallel_for.h>
+#endif
 
 static CCVector3 s_blankNorm(0, 0, 0);
 
@@ -59,6 +67,7 @@ ccMesh::ccMesh(ccGenericPointCloud* vertices)
 	, m_triMtlIndexes(nullptr)
 	, m_texCoordIndexes(nullptr)
 	, m_triNormalIndexes(nullptr)
+	, m_adjacency(nullptr)
 {
 	setAssociatedCloud(vertices);
 
@@ -77,6 +86,7 @@ ccMesh::ccMesh(CCLib::GenericIndexedMesh* giMesh, ccGenericPointCloud* giVertice
 	, m_triMtlIndexes(nullptr)
 	, m_texCoordIndexes(nullptr)
 	, m_triNormalIndexes(nullptr)
+	, m_adjacency(nullptr)
 {
 	setAssociatedCloud(giVertices);
 
@@ -119,11 +129,14 @@ ccMesh::~ccMesh()
 		m_triMtlIndexes->release();
 	if (m_triNormalIndexes)
 		m_triNormalIndexes->release();
+
+	invalidateAdjacency();
 }
 
 void ccMesh::setAssociatedCloud(ccGenericPointCloud* cloud)
 {
 	m_associatedCloud = cloud;
+	invalidateAdjacency();
 
 	if (m_associatedCloud)
 		m_associatedCloud->addDependency(this,DP_NOTIFY_OTHER_ON_DELETE | DP_NOTIFY_OTHER_ON_UPDATE);
@@ -566,27 +579,14 @@ bool ccMesh::laplacianSmooth(	unsigned nbIteration,
 		return false;
 	}
 
-	//compute the number of edges to which belong each vertex
-	std::vector<unsigned> edgesCount;
-	try
-	{
-		edgesCount.resize(vertCount, 0);
-	}
-	catch (const std::bad_alloc&)
+	//we need the triangles to which belong each vertex
+	const CCLib::MeshAdjacency* adjacency = getAdjacency();
+	if (!adjacency)
 	{
 		//not enough memory
 		return false;
 	}
 
-	placeIteratorAtBeginning();
-	for(unsigned j=0; j<faceCount; j++)
-	{
-		const CCLib::VerticesIndexes* tri = getNextTriangleVertIndexes();
-		edgesCount[tri->i1] += 2;
-		edgesCount[tri->i2] += 2;
-		edgesCount[tri->i3] += 2;
-	}
-
 	//progress dialog
 	CCLib::NormalizedProgress nProgress(progressCb, nbIteration);
 	if (progressCb)
@@ -599,26 +599,36 @@ bool ccMesh::laplacianSmooth(	unsigned nbIteration,
 	//repeat Laplacian smoothing iterations
 	for (unsigned iter = 0; iter < nbIteration; iter++)
 	{
-		std::fill(verticesDisplacement.begin(), verticesDisplacement.end(), CCVector3(0, 0, 0));
-
-		//for each triangle
-		placeIteratorAtBeginning();
-		for (unsigned j = 0; j < faceCount; j++)
+		//compute the displacement of each vertex (from the current positions only)
+#ifdef USE_TBB
+		tbb::parallel_for( 0, static_cast<int>(vertCount), [&](int i)
+#else
+		for (int i = 0; i < static_cast<int>(vertCount); ++i)
+#endif
 		{
-			const CCLib::VerticesIndexes* tri = getNextTriangleVertIndexes();
+			CCVector3 d(0, 0, 0);
+			const CCVector3* P = m_associatedCloud->getPoint(static_cast<unsigned>(i));
 
-			const CCVector3* A = m_associatedCloud->getPoint(tri->i1);
-			const CCVector3* B = m_associatedCloud->getPoint(tri->i2);
-			const CCVector3* C = m_associatedCloud->getPoint(tri->i3);
-
-			CCVector3 dAB = (*B-*A);
-			CCVector3 dAC = (*C-*A);
-			CCVector3 dBC = (*C-*B);
+			//each triangle contributes by its two edges starting from this vertex
+			unsigned triCount = adjacency->vertexTriangleCount(static_cast<unsigned>(i));
+			const unsigned* triIndexes = adjacency->vertexTriangles(static_cast<unsigned>(i));
+			for (unsigned j = 0; j < triCount; ++j)
+			{
+				const CCLib::VerticesIndexes& tri = m_triVertIndexes->at(triIndexes[j]);
+				for (unsigned k = 0; k < 3; ++k)
+				{
+					if (tri.i[k] != static_cast<unsigned>(i))
+					{
+						d += *m_associatedCloud->getPoint(tri.i[k]) - *P;
+					}
+				}
+			}
 
-			verticesDisplacement[tri->i1] += dAB + dAC;
-			verticesDisplacement[tri->i2] += dBC - dAB;
-			verticesDisplacement[tri->i3] -= dAC + dBC;
+			verticesDisplacement[i] = d;
 		}
+#ifdef USE_TBB
+		);
+#endif
 
 		if (!nProgress.oneStep())
 		{
@@ -627,15 +637,23 @@ bool ccMesh::laplacianSmooth(	unsigned nbIteration,
 		}
 
 		//apply displacement
-		for (unsigned i = 0; i < vertCount; i++)
+#ifdef USE_TBB
+		tbb::parallel_for( 0, static_cast<int>(vertCount), [&](int i)
+#else
+		for (int i = 0; i < static_cast<int>(vertCount); ++i)
+#endif
 		{
-			if (edgesCount[i])
+			unsigned edgesCount = 2 * adjacency->vertexTriangleCount(static_cast<unsigned>(i));
+			if (edgesCount)
 			{
 				//this is a "persistent" pointer and we know what type of cloud is behind ;)
-				CCVector3* P = const_cast<CCVector3*>(m_associatedCloud->getPointPersistentPtr(i));
-				(*P) += verticesDisplacement[i] * (factor / edgesCount[i]);
+				CCVector3* P = const_cast<CCVector3*>(m_associatedCloud->getPointPersistentPtr(static_cast<unsigned>(i)));
+				(*P) += verticesDisplacement[i] * (factor / edgesCount);
 			}
 		}
+#ifdef USE_TBB
+		);
+#endif
 	}
 
 	m_associatedCloud->notifyGeometryUpdate();
@@ -1570,6 +1588,7 @@ const ccGLMatrix& ccMesh::getGLTransformationHistory() const
 void ccMesh::addTriangle(unsigned i1, unsigned i2, unsigned i3)
 {
 	m_triVertIndexes->emplace_back(CCLib::VerticesIndexes(i1, i2, i3));
+	invalidateAdjacency();
 }
 
 bool ccMesh::reserve(size_t n)
@@ -1592,6 +1611,7 @@ bool ccMesh::reserve(size_t n)
 bool ccMesh::resize(size_t n)
 {
 	m_bBox.setValidity(false);
+	invalidateAdjacency();
 	notifyGeometryUpdate();
 
 	if (m_triMtlIndexes)
@@ -1623,6 +1643,7 @@ void ccMesh::swapTriangles(unsigned index1, unsigned index2)
 	assert(std::max(index1, index2) < size());
 
 	m_triVertIndexes->swap(index1, index2);
+	invalidateAdjacency();
 	if (m_triMtlIndexes)
 		m_triMtlIndexes->swap(index1, index2);
 	if (m_texCoordIndexes)
@@ -2566,6 +2587,54 @@ ccMesh* ccMesh::createNewMeshFromSelection(bool removeSelectedFaces)
 	return newMesh;
 }
 
+const CCLib::MeshAdjacency* ccMesh::getAdjacency() const
+{
+	unsigned vertCount = (m_associatedCloud ? m_associatedCloud->size() : 0);
+	if (	m_adjacency
+		&&	m_adjacency->isValid()
+		&&	m_adjacency->triangleCount() == size()
+		&&	m_adjacency->vertexCount() == vertCount)
+	{
+		return m_adjacency;
+	}
+
+	if (!m_associatedCloud)
+	{
+		return nullptr;
+	}
+
+	if (!m_adjacency)
+	{
+		try
+		{
+			m_adjacency = new CCLib::MeshAdjacency;
+		}
+		catch (const std::bad_alloc&)
+		{
+			return nullptr;
+		}
+	}
+
+	//the cast is safe as the mesh won't be modified
+	if (!m_adjacency->build(const_cast<ccMesh*>(this), vertCount))
+	{
+		ccLog::Warning("[ccMesh::getAdjacency] Failed to build the adjacency structure (not enough memory or invalid vertex indexes)");
+		delete m_adjacency;
+		m_adjacency = nullptr;
+	}
+
+	return m_adjacency;
+}
+
+void ccMesh::invalidateAdjacency()
+{
+	if (m_adjacency)
+	{
+		delete m_adjacency;
+		m_adjacency = nullptr;
+	}
+}
+
 void ccMesh::shiftTriangleIndexes(unsigned shift)
 {
 	for (size_t i = 0; i < m_triVertIndexes->size(); ++i)
@@ -2575,6 +2644,7 @@ void ccMesh::shiftTriangleIndexes(unsigned shift)
 		ti.i2 += shift;
 		ti.i3 += shift;
 	}
+	invalidateAdjacency();
 }
 
 /*********************************************************/
@@ -2915,6 +2985,8 @@ bool ccMesh::fromFile_MeOnly(QFile& in, short dataVersion, int flags)
 	if (!ccGenericMesh::fromFile_MeOnly(in, dataVersion, flags))
 		return false;
 
+	invalidateAdjacency();
+
 	//as the associated cloud (=vertices) can't be saved directly (as it may be shared by multiple meshes)
 	//we only store its unique ID (dataVersion>=20) --> we hope we will find it at loading time (i.e. this
 	//is the responsibility of the caller to make sure that all dependencies are saved together)
@@ -3323,183 +3395,105 @@ bool ccMesh::getColorFromMaterial(unsigned triIndex, const CCVector3& P, ccColor
 	return true;
 }
 
-//we use as many static variables as we can to limit the size of the heap used by each recursion...
-static const unsigned s_defaultSubdivideGrowRate = 50;
-static PointCoordinateType s_maxSubdivideArea = 1;
-static QMap<qint64,unsigned> s_alreadyCreatedVertices; //map to store already created edges middle points
+//! Number of (original) triangles subdivided by each task
+static const unsigned s_subdivideChunkSize = 1024;
 
-static qint64 GenerateKey(unsigned edgeIndex1, unsigned edgeIndex2)
+//! Subdivision of a set of triangles (with its own table of edge middle points)
+/** The new vertices have a local index (starting after the original vertices)
+	and are identified by the two vertices of the edge they split. They are merged
+	afterwards with the new vertices of the other chunks (see ccMesh::subdivide).
+**/
+class SubdivisionChunk
 {
-	if (edgeIndex1 > edgeIndex2)
-		std::swap(edgeIndex1, edgeIndex2);
+public:
 
-	return (static_cast<qint64>(edgeIndex1) << 32) | static_cast<qint64>(edgeIndex2);
-}
+	SubdivisionChunk(const ccPointCloud* vertices, PointCoordinateType maxArea)
+		: m_vertices(vertices)
+		, m_vertCount(vertices->size())
+		, m_maxArea(maxArea)
+	{}
 
-bool ccMesh::pushSubdivide(/*PointCoordinateType maxArea, */unsigned indexA, unsigned indexB, unsigned indexC)
-{
-	if (s_maxSubdivideArea/*maxArea*/ <= ZERO_TOLERANCE)
+	//! Subdivides a triangle (recursively) until its area falls below the max area
+	void subdivide(unsigned indexA, unsigned indexB, unsigned indexC)
 	{
-		ccLog::Error("[ccMesh::pushSubdivide] Invalid input argument!");
-		return false;
-	}
-
-	if (!getAssociatedCloud() || !getAssociatedCloud()->isA(CC_TYPES::POINT_CLOUD))
-	{
-		ccLog::Error("[ccMesh::pushSubdivide] Vertices set must be a true point cloud!");
-		return false;
-	}
-	ccPointCloud* vertices = static_cast<ccPointCloud*>(getAssociatedCloud());
-	assert(vertices);
-	const CCVector3* A = vertices->getPoint(indexA);
-	const CCVector3* B = vertices->getPoint(indexB);
-	const CCVector3* C = vertices->getPoint(indexC);
+		const CCVector3& A = point(indexA);
+		const CCVector3& B = point(indexB);
+		const CCVector3& C = point(indexC);
 
-	//do we need to sudivide this triangle?
-	PointCoordinateType area = ((*B - *A)*(*C - *A)).norm() / 2;
-	if (area > s_maxSubdivideArea/*maxArea*/)
-	{
-		//we will add 3 new vertices, so we must be sure to have enough memory
-		if (vertices->size() + 2 >= vertices->capacity())
+		//do we need to sudivide this triangle?
+		PointCoordinateType area = ((B - A)*(C - A)).norm() / 2;
+		if (area > m_maxArea)
 		{
-			assert(s_defaultSubdivideGrowRate > 2);
-			if (!vertices->reserve(vertices->size() + s_defaultSubdivideGrowRate))
-			{
-				ccLog::Error("[ccMesh::pushSubdivide] Not enough memory!");
-				return false;
-			}
-			//We have to update pointers as they may have been wrangled by the 'reserve' call
-			A = vertices->getPoint(indexA);
-			B = vertices->getPoint(indexB);
-			C = vertices->getPoint(indexC);
-		}
+			//(warning: A, B and C may be invalidated by the creation of the new vertices)
+			unsigned indexG1 = middlePoint(indexA, indexB);
+			unsigned indexG2 = middlePoint(indexB, indexC);
+			unsigned indexG3 = middlePoint(indexC, indexA);
 
-		//add new vertices
-		unsigned indexG1 = 0;
-		{
-			qint64 key = GenerateKey(indexA, indexB);
-			QMap<qint64, unsigned>::const_iterator it = s_alreadyCreatedVertices.constFind(key);
-			if (it == s_alreadyCreatedVertices.constEnd())
-			{
-				//generate new vertex
-				indexG1 = vertices->size();
-				CCVector3 G1 = (*A + *B) / 2;
-				vertices->addPoint(G1);
-				//interpolate other features?
-				//if (vertices->hasNormals())
-				//{
-				//	//vertices->reserveTheNormsTable();
-				//	CCVector3 N(0.0, 0.0, 1.0);
-				//	interpolateNormals(indexA, indexB, indexC, G1, N);
-				//	vertices->addNorm(N);
-				//}
-				if (vertices->hasColors())
-				{
-					ccColor::Rgb C;
-					interpolateColors(CCLib::VerticesIndexes(indexA, indexB, indexC), G1, C);
-					vertices->addRGBColor(C);
-				}
-				//and add it to the map
-				s_alreadyCreatedVertices.insert(key, indexG1);
-			}
-			else
-			{
-				indexG1 = it.value();
-			}
-		}
-		unsigned indexG2 = 0;
-		{
-			qint64 key = GenerateKey(indexB, indexC);
-			QMap<qint64, unsigned>::const_iterator it = s_alreadyCreatedVertices.constFind(key);
-			if (it == s_alreadyCreatedVertices.constEnd())
-			{
-				//generate new vertex
-				indexG2 = vertices->size();
-				CCVector3 G2 = (*B + *C) / 2;
-				vertices->addPoint(G2);
-				//interpolate other features?
-				//if (vertices->hasNormals())
-				//{
-				//	//vertices->reserveTheNormsTable();
-				//	CCVector3 N(0.0, 0.0, 1.0);
-				//	interpolateNormals(indexA, indexB, indexC, G2, N);
-				//	vertices->addNorm(N);
-				//}
-				if (vertices->hasColors())
-				{
-					ccColor::Rgb C;
-					interpolateColors(CCLib::VerticesIndexes(indexA, indexB, indexC), G2, C);
-					vertices->addRGBColor(C);
-				}
-				//and add it to the map
-				s_alreadyCreatedVertices.insert(key, indexG2);
-			}
-			else
-			{
-				indexG2 = it.value();
-			}
+			subdivide(indexA, indexG1, indexG3);
+			subdivide(indexB, indexG2, indexG1);
+			subdivide(indexC, indexG3, indexG2);
+			subdivide(indexG1, indexG2, indexG3);
 		}
-		unsigned indexG3 = vertices->size();
+		else
 		{
-			qint64 key = GenerateKey(indexC, indexA);
-			QMap<qint64, unsigned>::const_iterator it = s_alreadyCreatedVertices.constFind(key);
-			if (it == s_alreadyCreatedVertices.constEnd())
-			{
-				//generate new vertex
-				indexG3 = vertices->size();
-				CCVector3 G3 = (*C + *A) / 2.0;
-				vertices->addPoint(G3);
-				//interpolate other features?
-				//if (vertices->hasNormals())
-				//{
-				//	//vertices->reserveTheNormsTable();
-				//	CCVector3 N(0.0, 0.0, 1.0);
-				//	interpolateNormals(indexA, indexB, indexC, G3, N);
-				//	vertices->addNorm(N);
-				//}
-				if (vertices->hasColors())
-				{
-					ccColor::Rgb C;
-					interpolateColors(CCLib::VerticesIndexes(indexA, indexB, indexC), G3, C);
-					vertices->addRGBColor(C);
-				}
-				//and add it to the map
-				s_alreadyCreatedVertices.insert(key, indexG3);
-			}
-			else
-			{
-				indexG3 = it.value();
-			}
+			//we keep this triangle as is
+			triangles.emplace_back(indexA, indexB, indexC);
 		}
+	}
 
-		//add new triangles
-		if (!pushSubdivide(/*maxArea, */indexA, indexG1, indexG3))
-			return false;
-		if (!pushSubdivide(/*maxArea, */indexB, indexG2, indexG1))
-			return false;
-		if (!pushSubdivide(/*maxArea, */indexC, indexG3, indexG2))
-			return false;
-		if (!pushSubdivide(/*maxArea, */indexG1, indexG2, indexG3))
-			return false;
+	//! Releases the memory
+	void clear()
+	{
+		triangles.clear();
+		triangles.shrink_to_fit();
+		newPoints.clear();
+		newPoints.shrink_to_fit();
+		newPointsEdges.clear();
+		newPointsEdges.shrink_to_fit();
+		m_middlePoints.clear();
 	}
-	else
+
+	//! Output triangles (with local vertex indexes)
+	std::vector<CCLib::VerticesIndexes> triangles;
+	//! New vertices
+	std::vector<CCVector3> newPoints;
+	//! Edge split by each new vertex (local vertex indexes)
+	std::vector< std::pair<unsigned, unsigned> > newPointsEdges;
+
+protected:
+
+	//! Returns a vertex (original or new)
+	inline const CCVector3& point(unsigned index) const
+	{
+		return (index < m_vertCount ? *m_vertices->getPoint(index) : newPoints[index - m_vertCount]);
+	}
+
+	//! Returns the middle point of an edge (creates it if necessary)
+	unsigned middlePoint(unsigned index1, unsigned index2)
 	{
-		//we will add one triangle, so we must be sure to have enough memory
-		if (size() == capacity())
+		unsigned long long key = CCLib::MeshAdjacency::ComputeEdgeKey(index1, index2);
+		std::unordered_map<unsigned long long, unsigned>::const_iterator it = m_middlePoints.find(key);
+		if (it != m_middlePoints.end())
 		{
-			if (!reserve(size() + 3 * s_defaultSubdivideGrowRate))
-			{
-				ccLog::Error("[ccMesh::pushSubdivide] Not enough memory!");
-				return false;
-			}
+			return it->second;
 		}
 
-		//we keep this triangle as is
-		addTriangle(indexA, indexB, indexC);
+		//the middle point doesn't depend on the edge orientation
+		CCVector3 G = (point(index1) + point(index2)) / 2;
+		unsigned index = m_vertCount + static_cast<unsigned>(newPoints.size());
+		newPoints.push_back(G);
+		newPointsEdges.emplace_back(index1, index2);
+		m_middlePoints[key] = index;
+
+		return index;
 	}
 
-	return true;
-}
+	const ccPointCloud* m_vertices;
+	unsigned m_vertCount;
+	PointCoordinateType m_maxArea;
+	//! Middle points already created (for this chunk)
+	std::unordered_map<unsigned long long, unsigned> m_middlePoints;
+};
 
 ccMesh* ccMesh::subdivide(PointCoordinateType maxArea) const
 {
@@ -3508,7 +3502,6 @@ ccMesh* ccMesh::subdivide(PointCoordinateType maxArea) const
 		ccLog::Error("[ccMesh::subdivide] Invalid input argument!");
 		return nullptr;
 	}
-	s_maxSubdivideArea = maxArea;
 
 	unsigned triCount = size();
 	ccGenericPointCloud* vertices = getAssociatedCloud();
@@ -3529,28 +3522,137 @@ ccMesh* ccMesh::subdivide(PointCoordinateType maxArea) const
 	ccMesh* resultMesh = new ccMesh(resultVertices);
 	resultMesh->addChild(resultVertices);
 
-	if (!resultMesh->reserve(triCount))
-	{
-		ccLog::Error("[ccMesh::subdivide] Not enough memory!");
-		delete resultMesh;
-		return nullptr;
-	}
-
-	s_alreadyCreatedVertices.clear();
+	//edge middle points (global indexes)
+	std::unordered_map<unsigned long long, unsigned> middlePoints;
 
 	try
 	{
-		for (unsigned i = 0; i < triCount; ++i)
+		//1st step: each chunk of triangles is subdivided independently (in parallel)
+		int chunkCount = static_cast<int>((triCount + s_subdivideChunkSize - 1) / s_subdivideChunkSize);
+		std::vector<SubdivisionChunk> chunks(chunkCount, SubdivisionChunk(resultVertices, maxArea));
+		std::atomic<bool> memoryError(false);
+
+#ifdef USE_TBB
+		tbb::parallel_for(0, chunkCount, [&](int c)
+#else
+		for (int c = 0; c < chunkCount; ++c)
+#endif
 		{
-			const CCLib::VerticesIndexes& tri = m_triVertIndexes->getValue(i);
-			if (!resultMesh->pushSubdivide(/*maxArea,*/tri.i1, tri.i2, tri.i3))
+			if (!memoryError)
+			{
+				unsigned firstIndex = static_cast<unsigned>(c) * s_subdivideChunkSize;
+				unsigned lastIndex = std::min(firstIndex + s_subdivideChunkSize, triCount);
+				try
+				{
+					for (unsigned i = firstIndex; i < lastIndex; ++i)
+					{
+						const CCLib::VerticesIndexes& tri = m_triVertIndexes->getValue(i);
+						chunks[c].subdivide(tri.i1, tri.i2, tri.i3);
+					}
+				}
+				catch (const std::bad_alloc&)
+				{
+					memoryError = true;
+				}
+			}
+		}
+#ifdef USE_TBB
+		);
+#endif
+
+		if (memoryError)
+		{
+			ccLog::Error("[ccMesh::subdivide] Not enough memory!");
+			delete resultMesh;
+			return nullptr;
+		}
+
+		//2nd step: merge the chunks (in order, so that the result doesn't depend on the number of threads)
+		{
+			size_t maxNewPointCount = 0;
+			size_t newTriCount = 0;
+			for (const SubdivisionChunk& chunk : chunks)
+			{
+				maxNewPointCount += chunk.newPoints.size();
+				newTriCount += chunk.triangles.size();
+			}
+			if (vertCount + maxNewPointCount > std::numeric_limits<unsigned>::max() || newTriCount > std::numeric_limits<unsigned>::max())
+			{
+				ccLog::Error("[ccMesh::subdivide] Too many vertices or triangles!");
+				delete resultMesh;
+				return nullptr;
+			}
+
+			if (	!resultVertices->reserve(vertCount + static_cast<unsigned>(maxNewPointCount))
+				||	!resultMesh->reserve(static_cast<unsigned>(newTriCount)))
 			{
 				ccLog::Error("[ccMesh::subdivide] Not enough memory!");
 				delete resultMesh;
 				return nullptr;
 			}
+
+			//at least one middle point per (split) edge of the original mesh
+			const CCLib::MeshAdjacency* adjacency = getAdjacency();
+			if (adjacency)
+			{
+				middlePoints.reserve(adjacency->edgeCount());
+			}
+
+			bool withColors = resultVertices->hasColors();
+			std::vector<unsigned> localToGlobal;
+			for (SubdivisionChunk& chunk : chunks)
+			{
+				localToGlobal.resize(chunk.newPoints.size());
+				auto toGlobal = [&](unsigned index) { return (index < vertCount ? index : localToGlobal[index - vertCount]); };
+
+				//the new vertices are created after the vertices of the edge they split
+				for (size_t j = 0; j < chunk.newPoints.size(); ++j)
+				{
+					unsigned index1 = toGlobal(chunk.newPointsEdges[j].first);
+					unsigned index2 = toGlobal(chunk.newPointsEdges[j].second);
+					unsigned long long key = CCLib::MeshAdjacency::ComputeEdgeKey(index1, index2);
+
+					std::unordered_map<unsigned long long, unsigned>::const_iterator it = middlePoints.find(key);
+					if (it == middlePoints.end())
+					{
+						//generate new vertex
+						unsigned index = resultVertices->size();
+						resultVertices->addPoint(chunk.newPoints[j]);
+						//interpolate other features?
+						if (withColors)
+						{
+							const ccColor::Rgb& C1 = resultVertices->getPointColor(index1);
+							const ccColor::Rgb& C2 = resultVertices->getPointColor(index2);
+							ccColor::Rgb C(	static_cast<ColorCompType>(floor(C1.r * 0.5 + C2.r * 0.5)),
+											static_cast<ColorCompType>(floor(C1.g * 0.5 + C2.g * 0.5)),
+											static_cast<ColorCompType>(floor(C1.b * 0.5 + C2.b * 0.5)));
+							resultVertices->addRGBColor(C);
+						}
+						//and add it to the map
+						middlePoints[key] = index;
+						localToGlobal[j] = index;
+					}
+					else
+					{
+						localToGlobal[j] = it->second;
+					}
+				}
+
+				for (const CCLib::VerticesIndexes& tri : chunk.triangles)
+				{
+					resultMesh->addTriangle(toGlobal(tri.i1), toGlobal(tri.i2), toGlobal(tri.i3));
+				}
+
+				chunk.clear();
+			}
 		}
 	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Error("[ccMesh::subdivide] Not enough memory!");
+		delete resultMesh;
+		return nullptr;
+	}
 	catch(...)
 	{
 		ccLog::Error("[ccMesh::subdivide] An error occurred!");
@@ -3562,132 +3664,147 @@ ccMesh* ccMesh::subdivide(PointCoordinateType maxArea) const
 	try
 	{
 		unsigned newTriCount = resultMesh->size();
-		for (unsigned i = 0; i < newTriCount; ++i)
-		{
-			CCLib::VerticesIndexes& tri = resultMesh->m_triVertIndexes->getValue(i); //warning: array might change at each call to reallocate!
-			unsigned indexA = tri.i1;
-			unsigned indexB = tri.i2;
-			unsigned indexC = tri.i3;
+		int chunkCount = static_cast<int>((newTriCount + s_subdivideChunkSize - 1) / s_subdivideChunkSize);
+		//the additional triangles of each chunk
+		std::vector< std::vector<CCLib::VerticesIndexes> > addedTriangles(chunkCount);
+		std::atomic<bool> memoryError(false);
 
-			//test all edges
-			int indexG1 = -1;
-			{
-				QMap<qint64, unsigned>::const_iterator it = s_alreadyCreatedVertices.constFind(GenerateKey(indexA, indexB));
-				if (it != s_alreadyCreatedVertices.constEnd())
-					indexG1 = (int)it.value();
-			}
-			int indexG2 = -1;
-			{
-				QMap<qint64, unsigned>::const_iterator it = s_alreadyCreatedVertices.constFind(GenerateKey(indexB, indexC));
-				if (it != s_alreadyCreatedVertices.constEnd())
-					indexG2 = (int)it.value();
-			}
-			int indexG3 = -1;
-			{
-				QMap<qint64, unsigned>::const_iterator it = s_alreadyCreatedVertices.constFind(GenerateKey(indexC, indexA));
-				if (it != s_alreadyCreatedVertices.constEnd())
-					indexG3 = (int)it.value();
-			}
+		auto findMiddlePoint = [&middlePoints](unsigned index1, unsigned index2) -> int
+		{
+			std::unordered_map<unsigned long long, unsigned>::const_iterator it = middlePoints.find(CCLib::MeshAdjacency::ComputeEdgeKey(index1, index2));
+			return (it != middlePoints.end() ? static_cast<int>(it->second) : -1);
+		};
 
-			//at least one edge is 'wrong'
-			unsigned brokenEdges =	(indexG1 < 0 ? 0:1)
-								+	(indexG2 < 0 ? 0:1)
-								+	(indexG3 < 0 ? 0:1);
+#ifdef USE_TBB
+		tbb::parallel_for(0, chunkCount, [&](int c)
+#else
+		for (int c = 0; c < chunkCount; ++c)
+#endif
+		{
+			unsigned firstIndex = static_cast<unsigned>(c) * s_subdivideChunkSize;
+			unsigned lastIndex = std::min(firstIndex + s_subdivideChunkSize, newTriCount);
+			std::vector<CCLib::VerticesIndexes>& newTriangles = addedTriangles[c];
 
-			if (brokenEdges == 1)
+			try
 			{
-				int indexG = indexG1;
-				unsigned char i1 = 2; //relative index facing the broken edge
-				if (indexG2 >= 0)
-				{
-					indexG = indexG2;
-					i1 = 0;
-				}
-				else if (indexG3 >= 0)
+				for (unsigned i = firstIndex; i < lastIndex && !memoryError; ++i)
 				{
-					indexG = indexG3;
-					i1 = 1;
-				}
-				assert(indexG >= 0);
-				assert(i1<3);
+					CCLib::VerticesIndexes& tri = resultMesh->m_triVertIndexes->getValue(i);
+					unsigned indexA = tri.i1;
+					unsigned indexB = tri.i2;
+					unsigned indexC = tri.i3;
+
+					//test all edges
+					int indexG1 = findMiddlePoint(indexA, indexB);
+					int indexG2 = findMiddlePoint(indexB, indexC);
+					int indexG3 = findMiddlePoint(indexC, indexA);
+
+					//at least one edge is 'wrong'
+					unsigned brokenEdges =	(indexG1 < 0 ? 0:1)
+										+	(indexG2 < 0 ? 0:1)
+										+	(indexG3 < 0 ? 0:1);
+
+					//(the area of the new triangles is necessarily ok)
+					if (brokenEdges == 1)
+					{
+						int indexG = indexG1;
+						unsigned char i1 = 2; //relative index facing the broken edge
+						if (indexG2 >= 0)
+						{
+							indexG = indexG2;
+							i1 = 0;
+						}
+						else if (indexG3 >= 0)
+						{
+							indexG = indexG3;
+							i1 = 1;
+						}
+						assert(indexG >= 0);
+						assert(i1<3);
 
-				unsigned indexes[3] = { indexA, indexB, indexC };
+						unsigned indexes[3] = { indexA, indexB, indexC };
 
-				//replace current triangle by one half
-				tri.i1 = indexes[i1];
-				tri.i2 = indexG;
-				tri.i3 = indexes[(i1 + 2) % 3];
-				//and add the other half (we can use pushSubdivide as the area should alredy be ok!)
-				if (!resultMesh->pushSubdivide(/*maxArea,*/indexes[i1], indexes[(i1 + 1) % 3], indexG))
-				{
-					ccLog::Error("[ccMesh::subdivide] Not enough memory!");
-					delete resultMesh;
-					return nullptr;
-				}
-			}
-			else if (brokenEdges == 2)
-			{
-				if (indexG1 < 0) //broken edges: BC and CA
-				{
-					//replace current triangle by the 'pointy' part
-					tri.i1 = indexC;
-					tri.i2 = indexG3;
-					tri.i3 = indexG2;
-					//split the remaining 'trapezoid' in 2
-					if (!resultMesh->pushSubdivide(/*maxArea, */indexA, indexG2, indexG3) ||
-						!resultMesh->pushSubdivide(/*maxArea, */indexA, indexB, indexG2))
-					{
-						ccLog::Error("[ccMesh::subdivide] Not enough memory!");
-						delete resultMesh;
-						return nullptr;
+						//replace current triangle by one half
+						tri.i1 = indexes[i1];
+						tri.i2 = indexG;
+						tri.i3 = indexes[(i1 + 2) % 3];
+						//and add the other half
+						newTriangles.emplace_back(indexes[i1], indexes[(i1 + 1) % 3], indexG);
 					}
-				}
-				else if (indexG2 < 0) //broken edges: AB and CA
-				{
-					//replace current triangle by the 'pointy' part
-					tri.i1 = indexA;
-					tri.i2 = indexG1;
-					tri.i3 = indexG3;
-					//split the remaining 'trapezoid' in 2
-					if (!resultMesh->pushSubdivide(/*maxArea, */indexB, indexG3, indexG1) ||
-						!resultMesh->pushSubdivide(/*maxArea, */indexB, indexC, indexG3))
+					else if (brokenEdges == 2)
 					{
-						ccLog::Error("[ccMesh::subdivide] Not enough memory!");
-						delete resultMesh;
-						return nullptr;
+						if (indexG1 < 0) //broken edges: BC and CA
+						{
+							//replace current triangle by the 'pointy' part
+							tri.i1 = indexC;
+							tri.i2 = indexG3;
+							tri.i3 = indexG2;
+							//split the remaining 'trapezoid' in 2
+							newTriangles.emplace_back(indexA, indexG2, indexG3);
+							newTriangles.emplace_back(indexA, indexB, indexG2);
+						}
+						else if (indexG2 < 0) //broken edges: AB and CA
+						{
+							//replace current triangle by the 'pointy' part
+							tri.i1 = indexA;
+							tri.i2 = indexG1;
+							tri.i3 = indexG3;
+							//split the remaining 'trapezoid' in 2
+							newTriangles.emplace_back(indexB, indexG3, indexG1);
+							newTriangles.emplace_back(indexB, indexC, indexG3);
+						}
+						else /*if (indexG3 < 0)*/ //broken edges: AB and BC
+						{
+							//replace current triangle by the 'pointy' part
+							tri.i1 = indexB;
+							tri.i2 = indexG2;
+							tri.i3 = indexG1;
+							//split the remaining 'trapezoid' in 2
+							newTriangles.emplace_back(indexC, indexG1, indexG2);
+							newTriangles.emplace_back(indexC, indexA, indexG1);
+						}
 					}
-				}
-				else /*if (indexG3 < 0)*/ //broken edges: AB and BC
-				{
-					//replace current triangle by the 'pointy' part
-					tri.i1 = indexB;
-					tri.i2 = indexG2;
-					tri.i3 = indexG1;
-					//split the remaining 'trapezoid' in 2
-					if (!resultMesh->pushSubdivide(/*maxArea, */indexC, indexG1, indexG2) ||
-						!resultMesh->pushSubdivide(/*maxArea, */indexC, indexA, indexG1))
+					else if (brokenEdges == 3) //works just as a standard subdivision in fact!
 					{
-						ccLog::Error("[ccMesh::subdivide] Not enough memory!");
-						delete resultMesh;
-						return nullptr;
+						//replace current triangle by one quarter
+						tri.i1 = indexA;
+						tri.i2 = indexG1;
+						tri.i3 = indexG3;
+						//and add the other 3 quarters
+						newTriangles.emplace_back(indexB, indexG2, indexG1);
+						newTriangles.emplace_back(indexC, indexG3, indexG2);
+						newTriangles.emplace_back(indexG1, indexG2, indexG3);
 					}
 				}
 			}
-			else if (brokenEdges == 3) //works just as a standard subdivision in fact!
+			catch (const std::bad_alloc&)
 			{
-				//replace current triangle by one quarter
-				tri.i1 = indexA;
-				tri.i2 = indexG1;
-				tri.i3 = indexG3;
-				//and add the other 3 quarters (we can use pushSubdivide as the area should alredy be ok!)
-				if (!resultMesh->pushSubdivide(/*maxArea, */indexB, indexG2, indexG1) ||
-					!resultMesh->pushSubdivide(/*maxArea, */indexC, indexG3, indexG2) ||
-					!resultMesh->pushSubdivide(/*maxArea, */indexG1, indexG2, indexG3))
-				{
-					ccLog::Error("[ccMesh::subdivide] Not enough memory!");
-					delete resultMesh;
-					return nullptr;
-				}
+				memoryError = true;
+			}
+		}
+#ifdef USE_TBB
+		);
+#endif
+
+		size_t addedCount = 0;
+		for (const std::vector<CCLib::VerticesIndexes>& newTriangles : addedTriangles)
+		{
+			addedCount += newTriangles.size();
+		}
+
+		if (memoryError || !resultMesh->reserve(newTriCount + static_cast<unsigned>(addedCount)))
+		{
+			ccLog::Error("[ccMesh::subdivide] Not enough memory!");
+			delete resultMesh;
+			return nullptr;
+		}
+
+		//add the new triangles (in order)
+		for (const std::vector<CCLib::VerticesIndexes>& newTriangles : addedTriangles)
+		{
+			for (const CCLib::VerticesIndexes& tri : newTriangles)
+			{
+				resultMesh->addTriangle(tri.i1, tri.i2, tri.i3);
 			}
 		}
 	}
@@ -3698,8 +3815,6 @@ ccMesh* ccMesh::subdivide(PointCoordinateType maxArea) const
 		return nullptr;
 	}
 
-	s_alreadyCreatedVertices.clear();
-
 	resultMesh->shrinkToFit();
 	resultVertices->shrinkToFit();
 
@@ -28,6 +28,11 @@
 class ccProgressDialog;
 class ccPolyline;
 
+namespace CCLib
+{
+	class MeshAdjacency;
+}
+
 //! Triangular mesh
 class QCC_DB_LIB_API ccMesh : public ccGenericMesh
 {
@@ -378,6 +383,22 @@ public:
 	//! Transforms the mesh per-triangle normals
 	void transformTriNormals(const ccGLMatrix& trans);
 
+	//! Returns the adjacency structure of the mesh
+	/** The structure is built on the first call and then cached. It is
+		automatically invalidated when the triangles are modified through
+		the ccMesh methods (addTriangle, resize, swapTriangles, merge, etc.)
+		or when the number of vertices changes.
+		\warning Not thread-safe (build it first if it's shared by several threads)
+		\return adjacency structure (or nullptr if not enough memory)
+	**/
+	const CCLib::MeshAdjacency* getAdjacency() const;
+
+	//! Invalidates the cached adjacency structure
+	/** To be called if the triangles vertex indexes are modified directly
+		(e.g. via getTriangleVertIndexes).
+	**/
+	void invalidateAdjacency();
+
 protected:
 
 	//inherited from ccHObject
@@ -395,9 +416,6 @@ protected:
 	//! Same as other 'interpolateColors' method with a set of 3 vertices indexes
 	bool interpolateColors(const CCLib::VerticesIndexes& vertIndexes, const CCVector3& P, ccColor::Rgb& C);
 
-	//! Used internally by 'subdivide'
-	bool pushSubdivide(/*PointCoordinateType maxArea, */unsigned indexA, unsigned indexB, unsigned indexC);
-
 	/*** EXTENDED CALL SCRIPTS (FOR CC_SUB_MESHES) ***/
 	
 	//0 parameter
@@ -460,6 +478,9 @@ protected:
 	using triangleNormalsIndexesSet = ccArray<Tuple3i, 3, int>;
 	//! Mesh normals indexes (per-triangle)
 	triangleNormalsIndexesSet* m_triNormalIndexes;
+
+	//! Adjacency structure (built on demand, see getAdjacency)
+	mutable CCLib::MeshAdjacency* m_adjacency;
 };
 
 #endif //CC_MESH_HEADER
@@ -25,6 +25,9 @@
 #include <QSharedPointer>
 #include <QVariant>
 
+//system
+#include <atomic>
+
 
 //! Object state flag
 enum CC_OBJECT_FLAG {	//CC_UNUSED			= 1, //DGM: not used anymore (former CC_FATHER_DEPENDENT)
@@ -67,7 +70,7 @@ enum CC_OBJECT_FLAG {	//CC_UNUSED			= 1, //DGM: not used anymore (former CC_FATH
 #define CC_TEX_COORDS_BIT				0x00000080000000	//Texture coordinates (u,v)
 #define CC_CAMERA_BIT					0x00000100000000	//For camera sensors (projective sensors)
 #define CC_QUADRIC_BIT					0x00000200000000	//Quadric (primitive)
-//#define CC_FREE_BIT					0x00000400000000
+#define CC_SUB_CLOUD_BIT				0x00000400000000	//Sub-cloud (view on another cloud)
 //#define CC_FREE_BIT					0x00000800000000
 //#define CC_FREE_BIT					0x00000400000000
 //#define CC_FREE_BIT					0x00001000000000
@@ -87,6 +90,7 @@ namespace CC_TYPES
 		OBJECT = 0,
 		HIERARCHY_OBJECT	=	CC_HIERARCH_BIT,
 		POINT_CLOUD			=	HIERARCHY_OBJECT	| CC_CLOUD_BIT,
+		SUB_CLOUD			=	POINT_CLOUD			| CC_SUB_CLOUD_BIT,
 		MESH				=	HIERARCHY_OBJECT	| CC_MESH_BIT,
 		SUB_MESH			=	HIERARCHY_OBJECT	| CC_MESH_BIT				| CC_LEAF_BIT,
 		MESH_GROUP			=	MESH				| CC_GROUP_BIT,								//DEPRECATED; DEFINITION REMAINS FOR BACKWARD COMPATIBILITY ONLY
@@ -145,6 +149,8 @@ namespace CC_TYPES
 }
 
 //! Unique ID generator (should be unique for the whole application instance - with plugins, etc.)
+/** Thread-safe (entities may be created concurrently).
+**/
 class QCC_DB_LIB_API ccUniqueIDGenerator
 {
 public:
@@ -162,10 +168,16 @@ public:
 	//! Returns the value of the last generated unique ID
 	unsigned getLast() const { return m_lastUniqueID; }
 	//! Updates the value of the last generated unique ID with the current one
-	void update(unsigned ID) { if (ID > m_lastUniqueID) m_lastUniqueID = ID; }
+	void update(unsigned ID)
+	{
+		unsigned last = m_lastUniqueID;
+		while (ID > last && !m_lastUniqueID.compare_exchange_weak(last, ID))
+		{
+		}
+	}
 
 protected:
-	unsigned m_lastUniqueID;
+	std::atomic<unsigned> m_lastUniqueID;
 };
 
 //! Generic "CloudCompare Object" template
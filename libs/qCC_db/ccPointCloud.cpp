@@ -23,6 +23,7 @@
 //CCLib
 #include <GeometricalAnalysisTools.h>
 #include <ManualSegmentationTools.h>
+#include <QuantizedCoordinates.h>
 #include <ReferenceCloud.h>
 
 //local
@@ -35,6 +36,7 @@
 #include "ccGBLSensor.h"
 #include "ccGenericGLDisplay.h"
 #include "ccGenericMesh.h"
+#include "ccHObjectCaster.h"
 #include "ccImage.h"
 #include "ccKdTree.h"
 #include "ccMaterial.h"
@@ -46,6 +48,7 @@
 #include "ccPolyline.h"
 #include "ccProgressDialog.h"
 #include "ccScalarField.h"
+#include "ccSubCloud.h"
 
 //Qt
 #include <QCoreApplication>
@@ -53,11 +56,32 @@
 #include <QSharedPointer>
 
 //system
+#include <algorithm>
 #include <cassert>
+#include <limits>
 #include <queue>
 
+#ifdef USE_TBB
+#include <tbb/parallel_for.h>
+#endif
+
 static const char s_deviationSFName[] = "Deviation";
 
+//! Quantization step used to save the points in BIN files (disabled if <= 0)
+/** Per thread, as several files may be saved concurrently with different steps.
+**/
+static thread_local double s_binQuantizationStep = 0;
+
+void ccPointCloud::SetBinQuantizationStep(double step)
+{
+	s_binQuantizationStep = step;
+}
+
+double ccPointCloud::GetBinQuantizationStep()
+{
+	return s_binQuantizationStep;
+}
+
 ccPointCloud::ccPointCloud(QString name) throw()
 	: CCLib::PointCloudTpl<ccGenericPointCloud>()
 	, m_rgbColors(nullptr)
@@ -433,6 +457,20 @@ ccPointCloud* ccPointCloud::partialClone(const CCLib::ReferenceCloud* selection,
 
 ccPointCloud::~ccPointCloud()
 {
+	//the sub-clouds below this cloud will be deleted along with it (no need to copy their points)
+	{
+		ccHObject::Container subClouds;
+		filterChildren(subClouds, true, CC_TYPES::SUB_CLOUD, true);
+		for (ccHObject* child : subClouds)
+		{
+			ccSubCloud* subCloud = ccHObjectCaster::ToSubCloud(child);
+			if (subCloud->getAssociatedCloud() == this)
+			{
+				subCloud->setAssociatedCloud(nullptr);
+			}
+		}
+	}
+
 	clear();
 
 	if (m_lod)
@@ -452,6 +490,7 @@ void ccPointCloud::clear()
 
 void ccPointCloud::unalloactePoints()
 {
+	materializeSubClouds();
 	clearLOD();	// we have to clear the LOD structure before clearing the colors / SFs, so we can't leave it to notifyGeometryUpdate()
 	showSFColorsScale(false); //SFs will be destroyed
 	BaseClass::reset();
@@ -898,6 +937,44 @@ const ccPointCloud& ccPointCloud::append(ccPointCloud* addedCloud, unsigned poin
 		}
 	}
 
+	//grid structures
+	importGridsFrom(addedCloud, pointCountBefore);
+
+	//has the cloud been recentered/rescaled?
+	{
+		if (addedCloud->isShifted())
+		{
+			if (!isShifted())
+			{
+				//we can keep the global shift information of the merged cloud
+				setGlobalShift(addedCloud->getGlobalShift());
+				setGlobalScale(addedCloud->getGlobalScale());
+			}
+			else if (	getGlobalScale() != addedCloud->getGlobalScale()
+					||	(getGlobalShift() - addedCloud->getGlobalShift()).norm2d() > 1.0e-6)
+			{
+				//the clouds have different shift & scale information!
+				ccLog::Warning(QString("[ccPointCloud::fusion] Global shift/scale information conflict: shift/scale of cloud '%1' will be ignored!").arg(addedCloud->getName()));
+			}
+		}
+	}
+
+	//children (not yet reserved)
+	if (!ignoreChildren)
+	{
+		importChildrenFrom(addedCloud, pointCountBefore);
+	}
+
+	//We should update the VBOs (just in case)
+	releaseVBOs();
+	//As well as the LOD structure
+	clearLOD();
+
+	return *this;
+}
+
+void ccPointCloud::importGridsFrom(ccPointCloud* addedCloud, unsigned pointCountBefore)
+{
 	//if the merged cloud has grid structures AND this one is blank or also has grid structures
 	if (addedCloud->gridCount() != 0 && (gridCount() != 0 || pointCountBefore == 0))
 	{
@@ -950,107 +1027,535 @@ const ccPointCloud& ccPointCloud::append(ccPointCloud* addedCloud, unsigned poin
 		ccLog::Warning(QString("[ccPointCloud::fusion] Grid structure(s) will be dropped as the merged cloud is unstructured"));
 		m_grids.clear();
 	}
+}
 
-	//has the cloud been recentered/rescaled?
+void ccPointCloud::importChildrenFrom(ccPointCloud* addedCloud, unsigned pointCountBefore)
+{
+	unsigned childrenCount = addedCloud->getChildrenNumber();
+	for (unsigned c = 0; c < childrenCount; ++c)
 	{
-		if (addedCloud->isShifted())
+		ccHObject* child = addedCloud->getChild(c);
+		if (!child)
 		{
-			if (!isShifted())
+			assert(false);
+			continue;
+		}
+		if (child->isA(CC_TYPES::MESH)) //mesh --> FIXME: what for the other types of MESH?
+		{
+			ccMesh* mesh = static_cast<ccMesh*>(child);
+
+			//detach from father?
+			//addedCloud->detachChild(mesh);
+			//ccGenericMesh* addedTri = mesh;
+
+			//or clone?
+			ccMesh* cloneMesh = mesh->cloneMesh(mesh->getAssociatedCloud() == addedCloud ? this : 0);
+			if (cloneMesh)
 			{
-				//we can keep the global shift information of the merged cloud
-				setGlobalShift(addedCloud->getGlobalShift());
-				setGlobalScale(addedCloud->getGlobalScale());
+				//change mesh vertices
+				if (cloneMesh->getAssociatedCloud() == this)
+				{
+					cloneMesh->shiftTriangleIndexes(pointCountBefore);
+				}
+				addChild(cloneMesh);
 			}
-			else if (	getGlobalScale() != addedCloud->getGlobalScale()
-					||	(getGlobalShift() - addedCloud->getGlobalShift()).norm2d() > 1.0e-6)
+			else
 			{
-				//the clouds have different shift & scale information!
-				ccLog::Warning(QString("[ccPointCloud::fusion] Global shift/scale information conflict: shift/scale of cloud '%1' will be ignored!").arg(addedCloud->getName()));
+				ccLog::Warning(QString("[ccPointCloud::fusion] Not enough memory: failed to clone sub mesh %1!").arg(mesh->getName()));
+			}
+		}
+		else if (child->isKindOf(CC_TYPES::IMAGE))
+		{
+			//ccImage* image = static_cast<ccImage*>(child);
+
+			//DGM FIXME: take image ownership! (dirty)
+			addedCloud->transferChild(child, *this);
+		}
+		else if (child->isA(CC_TYPES::LABEL_2D))
+		{
+			//clone label and update points if necessary
+			cc2DLabel* label = static_cast<cc2DLabel*>(child);
+			cc2DLabel* newLabel = new cc2DLabel(label->getName());
+			for (unsigned j = 0; j < label->size(); ++j)
+			{
+				const cc2DLabel::PickedPoint& P = label->getPoint(j);
+				if (P.cloud == addedCloud)
+					newLabel->addPoint(this, pointCountBefore + P.index);
+				else
+					newLabel->addPoint(P.cloud, P.index);
 			}
+			newLabel->displayPointLegend(label->isPointLegendDisplayed());
+			newLabel->setDisplayedIn2D(label->isDisplayedIn2D());
+			newLabel->setCollapsed(label->isCollapsed());
+			newLabel->setPosition(label->getPosition()[0], label->getPosition()[1]);
+			newLabel->setVisible(label->isVisible());
+			newLabel->setDisplay(getDisplay());
+			addChild(newLabel);
+		}
+		else if (child->isA(CC_TYPES::GBL_SENSOR))
+		{
+			//copy sensor object
+			ccGBLSensor* sensor = new ccGBLSensor(*static_cast<ccGBLSensor*>(child));
+			addChild(sensor);
+			sensor->setDisplay(getDisplay());
+			sensor->setVisible(child->isVisible());
 		}
 	}
+}
 
-	//children (not yet reserved)
-	if (!ignoreChildren)
+//number of points copied by each task (when appending several clouds at once)
+static const unsigned s_appendBlockSize = (1 << 16);
+
+bool ccPointCloud::append(const std::vector<ccPointCloud*>& clouds, bool ignoreChildren/*=false*/)
+{
+	if (isLocked())
 	{
-		unsigned childrenCount = addedCloud->getChildrenNumber();
-		for (unsigned c = 0; c < childrenCount; ++c)
+		ccLog::Error("[ccPointCloud::fusion] Cloud is locked");
+		return false;
+	}
+
+	std::vector<ccPointCloud*> sources;
+	bool withWaveforms = hasFWF();
+	try
+	{
+		sources.reserve(clouds.size());
+		for (ccPointCloud* cloud : clouds)
 		{
-			ccHObject* child = addedCloud->getChild(c);
-			if (!child)
+			if (!cloud || cloud == this)
 			{
 				assert(false);
 				continue;
 			}
-			if (child->isA(CC_TYPES::MESH)) //mesh --> FIXME: what for the other types of MESH?
+			sources.push_back(cloud);
+			withWaveforms |= cloud->hasFWF();
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Error("[ccPointCloud::fusion] Not enough memory!");
+		return false;
+	}
+
+	if (sources.empty())
+	{
+		//nothing to do
+		return true;
+	}
+
+	if (withWaveforms)
+	{
+		//the waveform containers and descriptors can only be merged by the standard process
+		for (ccPointCloud* cloud : sources)
+		{
+			unsigned countBefore = size();
+			append(cloud, countBefore, ignoreChildren);
+			if (size() != countBefore + cloud->size())
 			{
-				ccMesh* mesh = static_cast<ccMesh*>(child);
+				return false;
+			}
+		}
+		return true;
+	}
 
-				//detach from father?
-				//addedCloud->detachChild(mesh);
-				//ccGenericMesh* addedTri = mesh;
+	const unsigned pointCountBefore = size();
+	const unsigned sfCountBefore = getNumberOfScalarFields();
 
-				//or clone?
-				ccMesh* cloneMesh = mesh->cloneMesh(mesh->getAssociatedCloud() == addedCloud ? this : 0);
-				if (cloneMesh)
-				{
-					//change mesh vertices
-					if (cloneMesh->getAssociatedCloud() == this)
-					{
-						cloneMesh->shiftTriangleIndexes(pointCountBefore);
-					}
-					addChild(cloneMesh);
-				}
-				else
+	//final layout
+	std::vector<unsigned> firstIndexes;
+	try
+	{
+		firstIndexes.resize(sources.size());
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Error("[ccPointCloud::fusion] Not enough memory!");
+		return false;
+	}
+	uint64_t totalCount = pointCountBefore;
+	bool withColors = hasColors();
+	bool withNormals = hasNormals();
+	for (size_t k = 0; k < sources.size(); ++k)
+	{
+		firstIndexes[k] = static_cast<unsigned>(totalCount); //checked below
+		totalCount += sources[k]->size();
+		withColors |= sources[k]->hasColors();
+		withNormals |= sources[k]->hasNormals();
+	}
+	if (totalCount > std::numeric_limits<unsigned>::max())
+	{
+		ccLog::Error("[ccPointCloud::fusion] Too many points!");
+		return false;
+	}
+
+	//global shift & scale of the merged cloud
+	const ccPointCloud* reference = this;
+	if (!isShifted())
+	{
+		for (const ccPointCloud* cloud : sources)
+		{
+			if (cloud->isShifted())
+			{
+				//we can keep the global shift information of the merged cloud
+				reference = cloud;
+				break;
+			}
+		}
+	}
+	const CCVector3d refShift = reference->getGlobalShift();
+	const double refScale = reference->getGlobalScale();
+
+	//local coordinates conversion: Pmerged = (P/scale - shift + refShift) * refScale
+	struct CoordinatesConversion
+	{
+		bool required;
+		double scale;
+		CCVector3d translation;
+	};
+	auto conversionFrom = [&](const ccPointCloud* cloud) -> CoordinatesConversion
+	{
+		CoordinatesConversion conversion;
+		conversion.required = (		cloud->getGlobalScale() != refScale
+								||	(cloud->getGlobalShift() - refShift).norm2d() > 1.0e-6);
+		conversion.scale = refScale / cloud->getGlobalScale();
+		conversion.translation = (refShift - cloud->getGlobalShift()) * refScale;
+		if (conversion.required && cloud->size() != 0)
+		{
+			ccLog::Warning(QString("[ccPointCloud::fusion] Cloud '%1' has a different global shift/scale: its points will be expressed in the shift/scale of the merged cloud").arg(cloud->getName()));
+		}
+		return conversion;
+	};
+	std::vector<CoordinatesConversion> conversions;
+	try
+	{
+		conversions.reserve(sources.size());
+		for (const ccPointCloud* cloud : sources)
+		{
+			conversions.push_back(conversionFrom(cloud));
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Error("[ccPointCloud::fusion] Not enough memory!");
+		return false;
+	}
+
+	//scalar fields: the ones of this cloud first, then the new ones (by order of appearance)
+	QMap<QString, int> sfIndexByName;
+	std::vector<const ccScalarField*> newSFTemplates;
+	{
+		for (unsigned j = 0; j < sfCountBefore; ++j)
+		{
+			QString name = getScalarField(static_cast<int>(j))->getName();
+			if (!sfIndexByName.contains(name))
+			{
+				sfIndexByName.insert(name, static_cast<int>(j));
+			}
+		}
+		for (const ccPointCloud* cloud : sources)
+		{
+			for (unsigned j = 0; j < cloud->getNumberOfScalarFields(); ++j)
+			{
+				const ccScalarField* sf = static_cast<const ccScalarField*>(cloud->getScalarField(static_cast<int>(j)));
+				QString name = sf->getName();
+				if (!sfIndexByName.contains(name))
 				{
-					ccLog::Warning(QString("[ccPointCloud::fusion] Not enough memory: failed to clone sub mesh %1!").arg(mesh->getName()));
+					sfIndexByName.insert(name, -1); //not created yet
+					newSFTemplates.push_back(sf);
 				}
 			}
-			else if (child->isKindOf(CC_TYPES::IMAGE))
+		}
+	}
+
+	//we remove structures that are not compatible with fusion process
+	deleteOctree();
+	unallocateVisibilityArray();
+
+	//allocate everything at once
+	if (!resize(static_cast<unsigned>(totalCount)))
+	{
+		ccLog::Error("[ccPointCloud::fusion] Not enough memory!");
+		resize(pointCountBefore);
+		return false;
+	}
+	if (withColors && !hasColors())
+	{
+		//the points of this cloud will be white
+		if (!resizeTheRGBTable(true))
+		{
+			ccLog::Warning("[ccPointCloud::fusion] Not enough memory: failed to allocate colors!");
+		}
+	}
+	if (withNormals && !hasNormals())
+	{
+		if (!resizeTheNormsTable())
+		{
+			ccLog::Warning("[ccPointCloud::fusion] Not enough memory: failed to allocate normals!");
+		}
+	}
+	for (const ccScalarField* sf : newSFTemplates)
+	{
+		ccScalarField* newSF = new ccScalarField(sf->getName());
+		newSF->setGlobalShift(sf->getGlobalShift());
+		//we fill the beginning with NaN (as there is no equivalent in the current cloud)
+		if (newSF->resizeSafe(static_cast<unsigned>(totalCount), true, NAN_VALUE))
+		{
+			//copy display parameters
+			newSF->importParametersFrom(sf);
+
+			//add scalar field to this cloud
+			int sfIdx = addScalarField(newSF);
+			assert(sfIdx >= 0);
+			sfIndexByName[sf->getName()] = sfIdx;
+		}
+		else
+		{
+			newSF->release();
+			newSF = nullptr;
+			ccLog::Warning("[ccPointCloud::fusion] Not enough memory: failed to allocate a copy of scalar field '%s'", sf->getName());
+		}
+	}
+
+	//for each cloud, the index of its scalar field corresponding to each scalar field of the merged cloud (or -1)
+	const unsigned sfCount = getNumberOfScalarFields();
+	std::vector<int> sourceSFIndexes;
+	try
+	{
+		sourceSFIndexes.resize(sources.size() * sfCount, -1);
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Error("[ccPointCloud::fusion] Not enough memory!");
+		resize(pointCountBefore);
+		return false;
+	}
+	for (size_t k = 0; k < sources.size(); ++k)
+	{
+		int* sfIndexes = sourceSFIndexes.data() + k * sfCount;
+		for (unsigned j = 0; j < sources[k]->getNumberOfScalarFields(); ++j)
+		{
+			int sfIdx = sfIndexByName.value(sources[k]->getScalarField(static_cast<int>(j))->getName(), -1);
+			if (sfIdx >= 0 && sfIndexes[sfIdx] < 0)
+			{
+				sfIndexes[sfIdx] = static_cast<int>(j);
+			}
+		}
+	}
+
+	//the points of this cloud may have to be expressed in the new global shift/scale as well
+	if (reference != this)
+	{
+		CoordinatesConversion conversion = conversionFrom(this);
+		if (conversion.required)
+		{
+#ifdef USE_TBB
+			tbb::parallel_for(0, static_cast<int>(pointCountBefore), [&](int i)
+#else
+			for (int i = 0; i < static_cast<int>(pointCountBefore); ++i)
+#endif
+			{
+				CCVector3* P = point(static_cast<unsigned>(i));
+				CCVector3d Pd = CCVector3d::fromArray(P->u) * conversion.scale + conversion.translation;
+				*P = CCVector3(	static_cast<PointCoordinateType>(Pd.x),
+								static_cast<PointCoordinateType>(Pd.y),
+								static_cast<PointCoordinateType>(Pd.z) );
+			}
+#ifdef USE_TBB
+			);
+#endif
+		}
+	}
+
+	//copy tasks (each one copies a block of points of a cloud in its slot)
+	struct CopyTask
+	{
+		size_t cloudIndex;
+		unsigned first;
+		unsigned last;
+	};
+	std::vector<CopyTask> tasks;
+	try
+	{
+		for (size_t k = 0; k < sources.size(); ++k)
+		{
+			unsigned count = sources[k]->size();
+			for (unsigned first = 0; first < count; first += s_appendBlockSize)
+			{
+				CopyTask task;
+				task.cloudIndex = k;
+				task.first = first;
+				task.last = std::min(first + s_appendBlockSize, count);
+				tasks.push_back(task);
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Error("[ccPointCloud::fusion] Not enough memory!");
+		resize(pointCountBefore);
+		return false;
+	}
+
+	//each task writes in its own range of the merged cloud
+#ifdef USE_TBB
+	tbb::parallel_for(0, static_cast<int>(tasks.size()), [&](int t)
+#else
+	for (int t = 0; t < static_cast<int>(tasks.size()); ++t)
+#endif
+	{
+		const CopyTask& task = tasks[t];
+		ccPointCloud* source = sources[task.cloudIndex];
+		const unsigned offset = firstIndexes[task.cloudIndex];
+		const CoordinatesConversion& conversion = conversions[task.cloudIndex];
+
+		//3D points
+		if (conversion.required)
+		{
+			for (unsigned i = task.first; i < task.last; ++i)
+			{
+				CCVector3d Pd = CCVector3d::fromArray(source->point(i)->u) * conversion.scale + conversion.translation;
+				*point(offset + i) = CCVector3(	static_cast<PointCoordinateType>(Pd.x),
+												static_cast<PointCoordinateType>(Pd.y),
+												static_cast<PointCoordinateType>(Pd.z) );
+			}
+		}
+		else
+		{
+			std::copy(source->point(task.first), source->point(task.first) + (task.last - task.first), point(offset + task.first));
+		}
+
+		//colors
+		if (hasColors())
+		{
+			ccColor::Rgb* colors = m_rgbColors->data() + offset;
+			if (source->hasColors())
+			{
+				std::copy(source->m_rgbColors->data() + task.first, source->m_rgbColors->data() + task.last, colors + task.first);
+			}
+			else
+			{
+				std::fill(colors + task.first, colors + task.last, ccColor::white);
+			}
+		}
+
+		//normals
+		if (hasNormals())
+		{
+			CompressedNormType* normals = m_normals->data() + offset;
+			if (source->hasNormals())
+			{
+				std::copy(source->m_normals->data() + task.first, source->m_normals->data() + task.last, normals + task.first);
+			}
+			else
+			{
+				std::fill(normals + task.first, normals + task.last, static_cast<CompressedNormType>(0));
+			}
+		}
+
+		//scalar fields
+		const int* sfIndexes = sourceSFIndexes.data() + task.cloudIndex * sfCount;
+		for (unsigned j = 0; j < sfCount; ++j)
+		{
+			ccScalarField* sf = static_cast<ccScalarField*>(getScalarField(static_cast<int>(j)));
+			ScalarType* values = sf->data() + offset;
+			if (sfIndexes[j] < 0)
 			{
-				//ccImage* image = static_cast<ccImage*>(child);
+				//we fill the slot with NaN (as there is no equivalent in the added cloud)
+				std::fill(values + task.first, values + task.last, NAN_VALUE);
+				continue;
+			}
 
-				//DGM FIXME: take image ownership! (dirty)
-				addedCloud->transferChild(child, *this);
+			const ccScalarField* sourceSF = static_cast<const ccScalarField*>(source->getScalarField(sfIndexes[j]));
+			double shift = sourceSF->getGlobalShift() - sf->getGlobalShift();
+			if (shift == 0)
+			{
+				std::copy(sourceSF->data() + task.first, sourceSF->data() + task.last, values + task.first);
 			}
-			else if (child->isA(CC_TYPES::LABEL_2D))
+			else
 			{
-				//clone label and update points if necessary
-				cc2DLabel* label = static_cast<cc2DLabel*>(child);
-				cc2DLabel* newLabel = new cc2DLabel(label->getName());
-				for (unsigned j = 0; j < label->size(); ++j)
+				for (unsigned i = task.first; i < task.last; ++i)
 				{
-					const cc2DLabel::PickedPoint& P = label->getPoint(j);
-					if (P.cloud == addedCloud)
-						newLabel->addPoint(this, pointCountBefore + P.index);
-					else
-						newLabel->addPoint(P.cloud, P.index);
+					values[i] = static_cast<ScalarType>(shift + sourceSF->getValue(i)); //FIXME: we could have accuracy issues here
 				}
-				newLabel->displayPointLegend(label->isPointLegendDisplayed());
-				newLabel->setDisplayedIn2D(label->isDisplayedIn2D());
-				newLabel->setCollapsed(label->isCollapsed());
-				newLabel->setPosition(label->getPosition()[0], label->getPosition()[1]);
-				newLabel->setVisible(label->isVisible());
-				newLabel->setDisplay(getDisplay());
-				addChild(newLabel);
 			}
-			else if (child->isA(CC_TYPES::GBL_SENSOR))
+		}
+	}
+#ifdef USE_TBB
+	);
+#endif
+
+	for (unsigned j = 0; j < sfCount; ++j)
+	{
+		getScalarField(static_cast<int>(j))->computeMinAndMax();
+	}
+
+	//merge display parameters
+	for (const ccPointCloud* cloud : sources)
+	{
+		setVisible(isVisible() || cloud->isVisible());
+		if (hasColors())
+		{
+			showColors(colorsShown() || cloud->colorsShown());
+		}
+		if (hasNormals())
+		{
+			showNormals(normalsShown() || cloud->normalsShown());
+		}
+		if (sfCount != 0)
+		{
+			//if there was no scalar field before
+			if (sfCountBefore == 0 && !getCurrentDisplayedScalarField())
 			{
-				//copy sensor object
-				ccGBLSensor* sensor = new ccGBLSensor(*static_cast<ccGBLSensor*>(child));
-				addChild(sensor);
-				sensor->setDisplay(getDisplay());
-				sensor->setVisible(child->isVisible());
+				//and if the added cloud has one displayed
+				const ccScalarField* dispSF = cloud->getCurrentDisplayedScalarField();
+				if (dispSF)
+				{
+					//we set it as displayed on the current cloud also
+					setCurrentDisplayedScalarField(sfIndexByName.value(dispSF->getName(), -1)); //same name!
+				}
 			}
+			showSF(sfShown() || cloud->sfShown());
 		}
 	}
+	if (!hasColors())
+	{
+		showColors(false);
+	}
+	if (!hasNormals())
+	{
+		showNormals(false);
+	}
+	if (sfCount == 0)
+	{
+		setCurrentDisplayedScalarField(-1);
+		showSF(false);
+	}
 
-	//We should update the VBOs (just in case)
-	releaseVBOs();
-	//As well as the LOD structure
-	clearLOD();
+	//grid structures
+	for (size_t k = 0; k < sources.size(); ++k)
+	{
+		importGridsFrom(sources[k], firstIndexes[k]);
+	}
 
-	return *this;
+	//global shift & scale
+	if (reference != this)
+	{
+		setGlobalShift(refShift);
+		setGlobalScale(refScale);
+	}
+
+	//children
+	if (!ignoreChildren)
+	{
+		for (size_t k = 0; k < sources.size(); ++k)
+		{
+			importChildrenFrom(sources[k], firstIndexes[k]);
+		}
+	}
+
+	//deprecate internal structures
+	invalidateBoundingBox(); //calls notifyGeometryUpdate + releaseVBOs + clearLOD
+
+	return true;
 }
 
 void ccPointCloud::unallocateNorms()
@@ -1407,6 +1912,12 @@ bool ccPointCloud::resize(unsigned newNumberOfPoints)
 	if (newNumberOfPoints < size() && isLocked())
 		return false;
 
+	if (newNumberOfPoints < size())
+	{
+		//the sub-clouds may reference some of the removed points
+		materializeSubClouds();
+	}
+
 	//call parent method first (for points + scalar fields)
 	if (!BaseClass::resize(newNumberOfPoints))
 	{
@@ -1834,57 +2345,166 @@ void ccPointCloud::applyGLTransformation(const ccGLMatrix& trans)
 	return applyRigidTransformation(trans);
 }
 
+//! Whether the rotation part of a transformation is the identity
+static bool IsPureTranslation(const ccGLMatrix& trans)
+{
+	const float* mat = trans.data();
+	return	mat[0] == 1.0f && mat[1] == 0.0f && mat[2] == 0.0f
+		&&	mat[4] == 0.0f && mat[5] == 1.0f && mat[6] == 0.0f
+		&&	mat[8] == 0.0f && mat[9] == 0.0f && mat[10] == 1.0f;
+}
+
+//! Number of points processed by each task (for parallel transformations)
+static const unsigned s_transformationBlockSize = (1 << 16);
+
 void ccPointCloud::applyRigidTransformation(const ccGLMatrix& trans)
 {
 	//transparent call
 	ccGenericPointCloud::applyGLTransformation(trans);
 
+	const bool translationOnly = IsPureTranslation(trans);
+	const CCVector3 T = CCVector3::fromArray(trans.getTranslation());
+	if (translationOnly && T.norm2() == 0)
+	{
+		//nothing to do
+		return;
+	}
+
+	//transform the points and compute the new bounding-box in the same pass
 	unsigned count = size();
-	for (unsigned i=0; i<count; i++)
+	if (count != 0)
 	{
-		trans.apply(*point(i));
+		const int blockCount = static_cast<int>((count + s_transformationBlockSize - 1) / s_transformationBlockSize);
+		std::vector<CCLib::BoundingBox> blockBBoxes;
+		try
+		{
+			blockBBoxes.resize(blockCount);
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory: the bounding-box will be recomputed later
+		}
+
+#ifdef USE_TBB
+		tbb::parallel_for(0, blockCount, [&](int b)
+#else
+		for (int b = 0; b < blockCount; ++b)
+#endif
+		{
+			unsigned first = static_cast<unsigned>(b) * s_transformationBlockSize;
+			unsigned last = std::min(first + s_transformationBlockSize, count);
+			if (blockBBoxes.empty())
+			{
+				for (unsigned i = first; i < last; ++i)
+				{
+					trans.apply(*point(i));
+				}
+			}
+			else
+			{
+				CCLib::BoundingBox& box = blockBBoxes[b];
+				for (unsigned i = first; i < last; ++i)
+				{
+					CCVector3* P = point(i);
+					trans.apply(*P);
+					box.add(*P);
+				}
+			}
+		}
+#ifdef USE_TBB
+		);
+#endif
+
+		if (!blockBBoxes.empty())
+		{
+			m_bbox.clear();
+			for (const CCLib::BoundingBox& box : blockBBoxes)
+			{
+				m_bbox += box;
+			}
+		}
+		else
+		{
+			m_bbox.setValidity(false);
+		}
+	}
+	else
+	{
+		m_bbox.setValidity(false);
 	}
 
-	//we must also take care of the normals!
-	if (hasNormals())
+	//we must also take care of the normals! (not affected by translations)
+	if (hasNormals() && !translationOnly)
 	{
+		const unsigned normalCount = static_cast<unsigned>(m_normals->size());
+		const unsigned codebookSize = ccNormalVectors::GetNumberOfVectors(); //also instantiates the codebook (not thread-safe)
 		bool recoded = false;
 
-		//if there is more points than the size of the compressed normals array,
-		//we recompress the array instead of recompressing each normal
-		if (count > ccNormalVectors::GetNumberOfVectors())
+		//if there is more normals than the size of the compressed normals array,
+		//we rotate the codebook once and then simply look the new indexes up
+		if (normalCount > codebookSize)
 		{
-			NormsIndexesTableType newNorms;
-			if (newNorms.reserveSafe(ccNormalVectors::GetNumberOfVectors()))
+			std::vector<CompressedNormType> rotatedCodebook;
+			try
+			{
+				rotatedCodebook.resize(codebookSize);
+			}
+			catch (const std::bad_alloc&)
+			{
+				//not enough memory
+			}
+
+			if (!rotatedCodebook.empty())
 			{
-				for (unsigned i = 0; i < ccNormalVectors::GetNumberOfVectors(); i++)
+#ifdef USE_TBB
+				tbb::parallel_for(0, static_cast<int>(codebookSize), [&](int i)
+#else
+				for (int i = 0; i < static_cast<int>(codebookSize); ++i)
+#endif
 				{
-					CCVector3 new_n(ccNormalVectors::GetNormal(i));
+					CCVector3 new_n(ccNormalVectors::GetNormal(static_cast<unsigned>(i)));
 					trans.applyRotation(new_n);
-					CompressedNormType newNormIndex = ccNormalVectors::GetNormIndex(new_n.u);
-					newNorms.emplace_back(newNormIndex);
+					rotatedCodebook[i] = ccNormalVectors::GetNormIndex(new_n.u);
 				}
+#ifdef USE_TBB
+				);
+#endif
 
-				for (unsigned j = 0; j < count; j++)
+#ifdef USE_TBB
+				tbb::parallel_for(0, static_cast<int>(normalCount), [&](int j)
+#else
+				for (int j = 0; j < static_cast<int>(normalCount); ++j)
+#endif
 				{
-					m_normals->setValue(j, newNorms[m_normals->at(j)]);
+					CompressedNormType& normIndex = m_normals->at(j);
+					normIndex = rotatedCodebook[normIndex];
 				}
+#ifdef USE_TBB
+				);
+#endif
 				recoded = true;
 			}
 		}
 
-		//if there is less points than the compressed normals array size
+		//if there is less normals than the compressed normals array size
 		//(or if there is not enough memory to instantiate the temporary
 		//array), we recompress each normal ...
 		if (!recoded)
 		{
-			//on recode direct chaque normale
-			for (CompressedNormType& _theNormIndex : *m_normals)
+#ifdef USE_TBB
+			tbb::parallel_for(0, static_cast<int>(normalCount), [&](int j)
+#else
+			for (int j = 0; j < static_cast<int>(normalCount); ++j)
+#endif
 			{
-				CCVector3 new_n(ccNormalVectors::GetNormal(_theNormIndex));
+				CompressedNormType& normIndex = m_normals->at(j);
+				CCVector3 new_n(ccNormalVectors::GetNormal(normIndex));
 				trans.applyRotation(new_n);
-				_theNormIndex = ccNormalVectors::GetNormIndex(new_n.u);
+				normIndex = ccNormalVectors::GetNormIndex(new_n.u);
 			}
+#ifdef USE_TBB
+			);
+#endif
 		}
 	}
 
@@ -1912,11 +2532,31 @@ void ccPointCloud::applyRigidTransformation(const ccGLMatrix& trans)
 		}
 	}
 
-	//the octree is invalidated by rotation...
-	deleteOctree();
+	if (translationOnly)
+	{
+		//a translation doesn't change the octree structure
+		ccOctree::Shared octree = getOctree();
+		if (octree)
+		{
+			octree->translateBoundingBox(T);
+		}
 
-	// ... as the bounding box
-	refreshBB(); //calls notifyGeometryUpdate + releaseVBOs
+		//nor the Kd-tree(s)
+		ccHObject::Container kdtrees;
+		filterChildren(kdtrees, false, CC_TYPES::POINT_KDTREE);
+		for (ccHObject* kdtree : kdtrees)
+		{
+			static_cast<ccKdTree*>(kdtree)->translateBoundingBox(T);
+		}
+	}
+	else
+	{
+		//the octree is invalidated by rotation...
+		deleteOctree();
+	}
+
+	//the bounding-box has already been updated
+	notifyGeometryUpdate(); //calls releaseVBOs()
 }
 
 void ccPointCloud::translate(const CCVector3& T)
@@ -3290,6 +3930,7 @@ ccGenericPointCloud* ccPointCloud::createNewCloudFromVisibilitySelection(bool re
 		//we drop the octree before modifying this cloud's contents
 		deleteOctree();
 		clearLOD();
+		materializeSubClouds();
 
 		unsigned count = size();
 
@@ -3346,6 +3987,29 @@ ccGenericPointCloud* ccPointCloud::createNewCloudFromVisibilitySelection(bool re
 	return result;
 }
 
+void ccPointCloud::materializeSubClouds()
+{
+	//the dependencies are modified by ccSubCloud::materialize
+	std::vector<ccSubCloud*> subClouds;
+	for (std::map<ccHObject*, int>::const_iterator it = m_dependencies.begin(); it != m_dependencies.end(); ++it)
+	{
+		ccSubCloud* subCloud = ccHObjectCaster::ToSubCloud(it->first);
+		if (subCloud && subCloud->getAssociatedCloud() == this)
+		{
+			subClouds.push_back(subCloud);
+		}
+	}
+
+	for (ccSubCloud* subCloud : subClouds)
+	{
+		if (!subCloud->materialize())
+		{
+			ccLog::Warning(QString("[ccPointCloud] Not enough memory to preserve the points of sub-cloud '%1' (it will be emptied)").arg(subCloud->getName()));
+			subCloud->clear();
+		}
+	}
+}
+
 ccScalarField* ccPointCloud::getCurrentDisplayedScalarField() const
 {
 	return static_cast<ccScalarField*>(getScalarField(m_currentDisplayedScalarFieldIndex));
@@ -4103,9 +4767,75 @@ bool ccPointCloud::toFile_MeOnly(QFile& out) const
 	if (!ccGenericPointCloud::toFile_MeOnly(out))
 		return false;
 
+	//quantized points (dataVersion>=49)
+	CCLib::QuantizedCoordinates quantizedPoints;
+	if (s_binQuantizationStep > 0 && !m_points.empty())
+	{
+		CCVector3d scale(s_binQuantizationStep, s_binQuantizationStep, s_binQuantizationStep);
+		if (!quantizedPoints.encode(m_points.data(), size(), scale))
+		{
+			ccLog::Warning(QString("[ccPointCloud::toFile_MeOnly] Failed to quantize the points of cloud '%1' (step too small or not enough memory): they will be saved as is").arg(getName()));
+		}
+	}
+	bool quantized = (quantizedPoints.size() != 0);
+	if (out.write((const char*)&quantized, sizeof(bool)) < 0)
+		return WriteError();
+
+	if (quantized)
+	{
+		//quantization step and origin (dataVersion>=49)
+		if (	out.write((const char*)quantizedPoints.scale().u, sizeof(double) * 3) < 0
+			||	out.write((const char*)quantizedPoints.offset().u, sizeof(double) * 3) < 0)
+		{
+			return WriteError();
+		}
+
+		//number of points (dataVersion>=49)
+		uint32_t pointCount = static_cast<uint32_t>(quantizedPoints.size());
+		if (out.write((const char*)&pointCount, 4) < 0)
+			return WriteError();
+
+		//blocks descriptors (dataVersion>=49)
+		{
+			const std::vector<CCLib::QuantizedCoordinates::Block>& blocks = quantizedPoints.blocks();
+			std::vector<Tuple3i> blockBases;
+			std::vector<Tuple3ub> blockBits;
+			try
+			{
+				blockBases.reserve(blocks.size());
+				blockBits.reserve(blocks.size());
+			}
+			catch (const std::bad_alloc&)
+			{
+				return MemoryError();
+			}
+			for (const CCLib::QuantizedCoordinates::Block& block : blocks)
+			{
+				blockBases.emplace_back(block.base[0], block.base[1], block.base[2]);
+				blockBits.emplace_back(block.bits[0], block.bits[1], block.bits[2]);
+			}
+			if (	!ccSerializationHelper::GenericArrayToFile<Tuple3i, 3, int>(blockBases, out)
+				||	!ccSerializationHelper::GenericArrayToFile<Tuple3ub, 3, unsigned char>(blockBits, out))
+			{
+				return false;
+			}
+		}
+
+		//bit-packed coordinates (dataVersion>=49)
+		{
+			//the stream is empty if all the points are quantized to the same position
+			uint32_t wordCount = static_cast<uint32_t>(quantizedPoints.stream().size());
+			if (out.write((const char*)&wordCount, 4) < 0)
+				return WriteError();
+			if (wordCount != 0 && !ccSerializationHelper::GenericArrayToFile<uint64_t, 1, uint64_t>(quantizedPoints.stream(), out))
+				return false;
+		}
+	}
 	//points array (dataVersion>=20)
-	if (!ccSerializationHelper::GenericArrayToFile<CCVector3, 3, PointCoordinateType>(m_points, out))
+	else if (!ccSerializationHelper::GenericArrayToFile<CCVector3, 3, PointCoordinateType>(m_points, out))
+	{
 		return false;
+	}
 
 	//colors array (dataVersion>=20)
 	{
@@ -4277,7 +5007,92 @@ bool ccPointCloud::fromFile_MeOnly(QFile& in, short dataVersion, int flags)
 	if (!ccGenericPointCloud::fromFile_MeOnly(in, dataVersion, flags))
 		return false;
 
+	//quantized points (dataVersion>=49)
+	bool quantized = false;
+	if (dataVersion >= 49)
+	{
+		if (in.read((char*)&quantized, sizeof(bool)) < 0)
+			return ReadError();
+	}
+
+	if (quantized)
+	{
+		//quantization step and origin (dataVersion>=49)
+		CCVector3d scale, offset;
+		if (	in.read((char*)scale.u, sizeof(double) * 3) < 0
+			||	in.read((char*)offset.u, sizeof(double) * 3) < 0)
+		{
+			return ReadError();
+		}
+
+		//number of points (dataVersion>=49)
+		uint32_t pointCount = 0;
+		if (in.read((char*)&pointCount, 4) < 0)
+			return ReadError();
+
+		//blocks descriptors (dataVersion>=49)
+		std::vector<CCLib::QuantizedCoordinates::Block> blocks;
+		{
+			std::vector<Tuple3i> blockBases;
+			std::vector<Tuple3ub> blockBits;
+			if (	!ccSerializationHelper::GenericArrayFromFile<Tuple3i, 3, int>(blockBases, in, dataVersion)
+				||	!ccSerializationHelper::GenericArrayFromFile<Tuple3ub, 3, unsigned char>(blockBits, in, dataVersion))
+			{
+				return false;
+			}
+			if (blockBases.size() != blockBits.size())
+				return CorruptError();
+
+			try
+			{
+				blocks.resize(blockBases.size());
+			}
+			catch (const std::bad_alloc&)
+			{
+				return MemoryError();
+			}
+			for (size_t i = 0; i < blocks.size(); ++i)
+			{
+				for (unsigned d = 0; d < 3; ++d)
+				{
+					blocks[i].base[d] = blockBases[i].u[d];
+					blocks[i].bits[d] = blockBits[i].u[d];
+				}
+			}
+		}
+
+		//bit-packed coordinates (dataVersion>=49)
+		std::vector<uint64_t> stream;
+		{
+			uint32_t wordCount = 0;
+			if (in.read((char*)&wordCount, 4) < 0)
+				return ReadError();
+			if (wordCount != 0)
+			{
+				if (!ccSerializationHelper::GenericArrayFromFile<uint64_t, 1, uint64_t>(stream, in, dataVersion))
+					return false;
+				if (stream.size() != wordCount)
+					return CorruptError();
+			}
+		}
+
+		CCLib::QuantizedCoordinates quantizedPoints;
+		if (!quantizedPoints.assign(pointCount, scale, offset, blocks, stream))
+			return CorruptError();
+
+		//decode the points (block by block, in parallel)
+		try
+		{
+			m_points.resize(quantizedPoints.size());
+		}
+		catch (const std::bad_alloc&)
+		{
+			return MemoryError();
+		}
+		quantizedPoints.decode(m_points.data());
+	}
 	//points array (dataVersion>=20)
+	else
 	{
 		bool result = false;
 		bool fileCoordIsDouble = (flags & ccSerializableObject::DF_POINT_COORDS_64_BITS);
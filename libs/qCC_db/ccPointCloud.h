@@ -106,6 +106,26 @@ public: //clone, copy, etc.
 	**/
 	static ccPointCloud* From(CCLib::GenericCloud* cloud, const ccGenericPointCloud* sourceCloud = nullptr);
 
+	//! Sets the quantization step used by the current thread to save the points in BIN files
+	/** If strictly positive, the points are saved as quantized coordinates
+		(see CCLib::QuantizedCoordinates), i.e. each point may be moved by
+		up to half a step. Otherwise (default) they are saved as is.
+		See also BinQuantizationScope.
+	**/
+	static void SetBinQuantizationStep(double step);
+	//! Returns the quantization step used by the current thread to save the points in BIN files
+	static double GetBinQuantizationStep();
+
+	//! Sets the BIN quantization step of the current thread until the end of the scope
+	class BinQuantizationScope
+	{
+	public:
+		explicit BinQuantizationScope(double step) : m_previousStep(GetBinQuantizationStep()) { SetBinQuantizationStep(step); }
+		~BinQuantizationScope() { SetBinQuantizationStep(m_previousStep); }
+	protected:
+		double m_previousStep;
+	};
+
 	//! Warnings for the partialClone method (bit flags)
 	enum CLONE_WARNINGS {	WRN_OUT_OF_MEM_FOR_COLORS		= 1,
 							WRN_OUT_OF_MEM_FOR_NORMALS		= 2,
@@ -702,6 +722,19 @@ public: //other methods
 	**/
 	const ccPointCloud& append(ccPointCloud* cloud, unsigned pointCountBefore, bool ignoreChildren = false);
 
+	//! Appends several clouds to this one at once
+	/** Much faster than appending the clouds one by one: the final layout is computed first,
+		the memory is allocated once, and each cloud is then copied (concurrently) in its slot.
+		Scalar fields are matched by name (NaN values are used for the points of the clouds
+		that don't have a given field). The points of clouds with a different global shift/scale
+		are expressed in the global shift/scale of the merged cloud.
+		\warning Clouds with waveforms are appended one by one (see ccPointCloud::append).
+		\param clouds clouds to be added
+		\param ignoreChildren whether to copy input clouds' children or not
+		\return success
+	**/
+	bool append(const std::vector<ccPointCloud*>& clouds, bool ignoreChildren = false);
+
 	//! Enhances the RGB colors with the current scalar field (assuming it's intensities)
 	bool enhanceRGBWithIntensitySF(int sfIdx, bool useCustomIntensityRange = false, double minI = 0.0, double maxI = 1.0);
 
@@ -722,6 +755,17 @@ protected:
 	**/
 	void swapPoints(unsigned firstIndex, unsigned secondIndex) override;
 
+	//! Gives their own copy of the points to the sub-clouds referencing this cloud
+	/** Must be called before points are removed or moved (see ccSubCloud).
+	**/
+	void materializeSubClouds();
+
+	//! Copies (or drops) the scan grids when a cloud is appended to this one (see append)
+	void importGridsFrom(ccPointCloud* addedCloud, unsigned pointCountBefore);
+
+	//! Copies the children of a cloud appended to this one (see append)
+	void importChildrenFrom(ccPointCloud* addedCloud, unsigned pointCountBefore);
+
 	//! Colors
 	ColorsTableType* m_rgbColors;
 
@@ -21,11 +21,19 @@
 #include "ccPointCloud.h"
 
 //CCLib
+#include <CCConst.h>
 #include <DgmOctree.h>
 #include <DistanceComputationTools.h>
 #include <GenericProgressCallback.h>
 #include <ccScalarField.h>
 
+//System
+#include <algorithm>
+
+#ifdef USE_TBB
+#include <tbb/parallel_for.h>
+#endif
+
 struct SFPair
 {
 	SFPair(const CCLib::ScalarField* sfIn = 0, CCLib::ScalarField* sfOut = 0) : in(sfIn), out(sfOut) {}
@@ -33,6 +41,100 @@ struct SFPair
 	CCLib::ScalarField* out;
 };
 
+//! Interpolates the scalar values of one destination point from its neighbors (all the scalar fields at once)
+/** \param neighborValues pointer on the scalar values (sfCount contiguous values) of each neighbor
+	\param neighborSquareDists square distance of each neighbor
+	\param neighborCount number of neighbors
+	\param scalarFields input/output scalar fields
+	\param outPointIndex destination point index
+	\param params interpolation parameters
+	\param buffer temporary buffer (median)
+	\param sumValues temporary buffer (weighted sum of each scalar field)
+	\param sumWeights temporary buffer (sum of the weights of each scalar field)
+**/
+static void InterpolatePointValues(	const ScalarType* const* neighborValues,
+									const double* neighborSquareDists,
+									unsigned neighborCount,
+									const std::vector<SFPair>& scalarFields,
+									unsigned outPointIndex,
+									const ccPointCloudInterpolator::Parameters& params,
+									std::vector<ScalarType>& buffer,
+									std::vector<double>& sumValues,
+									std::vector<double>& sumWeights)
+{
+	size_t sfCount = scalarFields.size();
+
+	if (params.algo == ccPointCloudInterpolator::Parameters::MEDIAN)
+	{
+		for (size_t j = 0; j < sfCount; ++j)
+		{
+			//we only keep the valid values
+			unsigned validCount = 0;
+			for (unsigned k = 0; k < neighborCount; ++k)
+			{
+				ScalarType v = neighborValues[k][j];
+				if (CCLib::ScalarField::ValidValue(v))
+				{
+					buffer[validCount++] = v;
+				}
+			}
+			if (validCount)
+			{
+				unsigned medianIndex = std::max(validCount / 2, 1u) - 1;
+				std::nth_element(buffer.begin(), buffer.begin() + medianIndex, buffer.begin() + validCount);
+				scalarFields[j].out->setValue(outPointIndex, buffer[medianIndex]);
+			}
+		}
+		return;
+	}
+
+	//average or weighted average
+	double interpSigma2x2 = 2 * params.sigma * params.sigma;
+	bool normalDistWeighting = (params.algo == ccPointCloudInterpolator::Parameters::NORMAL_DIST && interpSigma2x2 > 0);
+	bool inverseDistWeighting = (params.algo == ccPointCloudInterpolator::Parameters::INVERSE_DISTANCE);
+	//we use the square distances (hence the half power)
+	double halfPower = params.power / 2;
+	static const double s_minSquareDist = ZERO_TOLERANCE * ZERO_TOLERANCE;
+
+	std::fill(sumValues.begin(), sumValues.end(), 0.0);
+	std::fill(sumWeights.begin(), sumWeights.end(), 0.0);
+	for (unsigned k = 0; k < neighborCount; ++k)
+	{
+		double w = 1.0;
+		if (normalDistWeighting)
+		{
+			w = exp(-neighborSquareDists[k] / interpSigma2x2);
+		}
+		else if (inverseDistWeighting)
+		{
+			//(coincident points will have a huge weight, but not an infinite one)
+			w = 1.0 / pow(std::max(neighborSquareDists[k], s_minSquareDist), halfPower);
+		}
+
+		const ScalarType* values = neighborValues[k];
+		for (size_t j = 0; j < sfCount; ++j)
+		{
+			if (CCLib::ScalarField::ValidValue(values[j]))
+			{
+				sumValues[j] += w * values[j];
+				sumWeights[j] += w;
+			}
+		}
+	}
+
+	for (size_t j = 0; j < sfCount; ++j)
+	{
+		if (sumWeights[j] > 0)
+		{
+			scalarFields[j].out->setValue(outPointIndex, static_cast<ScalarType>(sumValues[j] / sumWeights[j]));
+		}
+		else
+		{
+			//we assume the scalar fields have all been initialized to NAN_VALUE
+		}
+	}
+}
+
 bool cellSFInterpolator(const CCLib::DgmOctree::octreeCell& cell,
 						void** additionalParameters,
 						CCLib::NormalizedProgress* nProgress/*=0*/)
@@ -40,16 +142,11 @@ bool cellSFInterpolator(const CCLib::DgmOctree::octreeCell& cell,
 	//additional parameters
 //	const ccPointCloud* srcCloud = reinterpret_cast<ccPointCloud*>(additionalParameters[0]);
 	const CCLib::DgmOctree* srcOctree = reinterpret_cast<CCLib::DgmOctree*>(additionalParameters[1]);
-	std::vector<SFPair>* scalarFields = reinterpret_cast<std::vector< SFPair >*>(additionalParameters[2]);
+	const std::vector<SFPair>* scalarFields = reinterpret_cast<std::vector< SFPair >*>(additionalParameters[2]);
 	const ccPointCloudInterpolator::Parameters* params = reinterpret_cast<const ccPointCloudInterpolator::Parameters*>(additionalParameters[3]);
 	
-	bool normalDistWeighting = false;
-	double interpSigma2x2 = 0;
-	if (params->algo == ccPointCloudInterpolator::Parameters::NORMAL_DIST)
-	{
-		interpSigma2x2 = 2 * params->sigma * params->sigma;
-		normalDistWeighting = (interpSigma2x2 > 0);
-	}
+	size_t sfCount = scalarFields->size();
+	assert(sfCount != 0);
 
 	//structure for nearest neighbors search
 	bool useKNN = (params->method == ccPointCloudInterpolator::Parameters::K_NEAREST_NEIGHBORS);
@@ -68,88 +165,90 @@ bool cellSFInterpolator(const CCLib::DgmOctree::octreeCell& cell,
 		cell.parentOctree->computeCellCenter(nNSS.cellPos, cell.level, nNSS.cellCenter);
 	}
 
-	std::vector<double> sumValues;
-	size_t sfCount = scalarFields->size();
-	assert(sfCount != 0);
-	sumValues.resize(sfCount);
+	//neighbor candidates shared by all the points of the cell (RADIUS method)
+	std::vector<CCVector3> candidatePoints;
+	std::vector<ScalarType> candidateValues;
+	if (!useKNN)
+	{
+		//all the neighbors of the cell points are inside the sphere centered on the cell center
+		//with a radius equal to the search radius + half the cell diagonal
+		PointCoordinateType cs = cell.parentOctree->getCellSize(cell.level);
+		nNSS.queryPoint = nNSS.cellCenter;
+		unsigned candidateCount = static_cast<unsigned>(srcOctree->findNeighborsInASphereStartingFromCell(nNSS, params->radius + cs * (SQRT_3 / 2), false));
+
+		candidatePoints.resize(candidateCount);
+		candidateValues.resize(candidateCount * sfCount);
+		for (unsigned k = 0; k < candidateCount; ++k)
+		{
+			const CCLib::DgmOctree::PointDescriptor& P = nNSS.pointsInNeighbourhood[k];
+			candidatePoints[k] = *P.point;
+			//gather the scalar values of the candidate (contiguous)
+			ScalarType* values = &candidateValues[k * sfCount];
+			for (size_t j = 0; j < sfCount; ++j)
+			{
+				values[j] = (*scalarFields)[j].in->getValue(P.pointIndex);
+			}
+		}
+	}
+	else
+	{
+		candidateValues.resize(params->knn * sfCount);
+	}
+
+	size_t maxNeighborCount = (useKNN ? params->knn : candidatePoints.size());
+	std::vector<const ScalarType*> neighborValues(maxNeighborCount);
+	std::vector<double> neighborSquareDists(maxNeighborCount);
+	std::vector<ScalarType> buffer(maxNeighborCount);
+	std::vector<double> sumValues(sfCount), sumWeights(sfCount);
+
+	const double squareRadius = static_cast<double>(params->radius) * params->radius;
 
 	//for each point of the current cell (destination octree) we look for its nearest neighbours in the source cloud
 	unsigned pointCount = cell.points->size();
 	for (unsigned i = 0; i < pointCount; i++)
 	{
 		unsigned outPointIndex = cell.points->getPointGlobalIndex(i);
-		cell.points->getPoint(i, nNSS.queryPoint);
+		const CCVector3* Q = cell.points->getPoint(i);
 
-		//look for neighbors (either inside a sphere or the k nearest ones)
-		//warning: there may be more points at the end of nNSS.pointsInNeighbourhood than the actual nearest neighbors (neighborCount)!
 		unsigned neighborCount = 0;
-
 		if (useKNN)
 		{
+			nNSS.queryPoint = *Q;
+			//warning: there may be more points at the end of nNSS.pointsInNeighbourhood than the actual nearest neighbors (neighborCount)!
 			neighborCount = srcOctree->findNearestNeighborsStartingFromCell(nNSS);
 			neighborCount = std::min(neighborCount, params->knn);
-		}
-		else
-		{
-			neighborCount = srcOctree->findNeighborsInASphereStartingFromCell(nNSS, params->radius, false);
-		}
 
-		if (neighborCount)
-		{
-			if (params->algo == ccPointCloudInterpolator::Parameters::MEDIAN)
+			for (unsigned k = 0; k < neighborCount; ++k)
 			{
-				//median
-				std::vector<ScalarType> values;
-				values.resize(neighborCount);
-				unsigned medianIndex = std::max(neighborCount / 2, 1u) - 1;
-
-				for (unsigned j = 0; j < sfCount; ++j)
+				const CCLib::DgmOctree::PointDescriptor& P = nNSS.pointsInNeighbourhood[k];
+				ScalarType* values = &candidateValues[k * sfCount];
+				for (size_t j = 0; j < sfCount; ++j)
 				{
-					const CCLib::ScalarField* sf = scalarFields->at(j).in;
-					for (unsigned k = 0; k < neighborCount; ++k)
-					{
-						CCLib::DgmOctree::PointDescriptor& P = nNSS.pointsInNeighbourhood[k];
-						values[k] = sf->getValue(P.pointIndex);
-					}
-					std::sort(values.begin(), values.end());
-					
-					ScalarType median = values[medianIndex];
-					scalarFields->at(j).out->setValue(outPointIndex, median);
+					values[j] = (*scalarFields)[j].in->getValue(P.pointIndex);
 				}
+				neighborValues[k] = values;
+				neighborSquareDists[k] = P.squareDistd;
 			}
-			else //average or weighted average
+		}
+		else
+		{
+			//scan the cell candidates
+			for (size_t k = 0; k < candidatePoints.size(); ++k)
 			{
-				double sumW = 0;
-				std::fill(sumValues.begin(), sumValues.end(), 0);
-				for (unsigned k = 0; k < neighborCount; ++k)
+				double squareDist = (candidatePoints[k] - *Q).norm2d();
+				if (squareDist <= squareRadius)
 				{
-					CCLib::DgmOctree::PointDescriptor& P = nNSS.pointsInNeighbourhood[k];
-					double w = 1.0;
-					if (normalDistWeighting)
-					{
-						w = exp(-P.squareDistd / interpSigma2x2);
-					}
-					sumW += w;
-					for (unsigned j = 0; j < sfCount; ++j)
-					{
-						sumValues[j] += w * scalarFields->at(j).in->getValue(P.pointIndex);
-					}
-				}
-
-				if (sumW > 0)
-				{
-					for (unsigned j = 0; j < sfCount; ++j)
-					{
-						ScalarType s = static_cast<ScalarType>(sumValues[j] / sumW);
-						scalarFields->at(j).out->setValue(outPointIndex, s);
-					}
-				}
-				else
-				{
-					//we assume the scalar fields have all been initialized to NAN_VALUE
+					neighborValues[neighborCount] = &candidateValues[k * sfCount];
+					neighborSquareDists[neighborCount] = squareDist;
+					++neighborCount;
 				}
 			}
 		}
+
+		if (neighborCount)
+		{
+			InterpolatePointValues(neighborValues.data(), neighborSquareDists.data(), neighborCount, *scalarFields, outPointIndex, *params, buffer, sumValues, sumWeights);
+		}
 		else
 		{
 			//we assume the scalar fields have all been initialized to NAN_VALUE
@@ -250,20 +349,28 @@ bool ccPointCloudInterpolator::InterpolateScalarFieldsFrom(	ccPointCloud* destCl
 		unsigned CPSetSize = CPSet->size();
 		assert(CPSetSize == destCloud->size());
 
-		//now copy the scalar fields
-		for (SFPair& sfPair : scalarFields)
+		//now copy the scalar fields (all at once)
+#ifdef USE_TBB
+		tbb::parallel_for(static_cast<unsigned>(0), CPSetSize, [&](unsigned i)
+#else
+		for (unsigned i = 0; i < CPSetSize; ++i)
+#endif
 		{
-			for (unsigned i = 0; i < CPSetSize; ++i)
+			unsigned pointIndex = CPSet->getPointGlobalIndex(i);
+			for (SFPair& sfPair : scalarFields)
 			{
-				unsigned pointIndex = CPSet->getPointGlobalIndex(i);
 				sfPair.out->setValue(i, sfPair.in->getValue(pointIndex));
 			}
 		}
+#ifdef USE_TBB
+		);
+#endif
 	}
 	else
 	{
 		if ((params.method == Parameters::K_NEAREST_NEIGHBORS && params.knn == 0) ||
-			(params.method == Parameters::RADIUS && params.radius <= 0))
+			(params.method == Parameters::RADIUS && params.radius <= 0) ||
+			(params.algo == Parameters::INVERSE_DISTANCE && params.power < 0))
 		{
 			//invalid input
 			ccLog::Warning("[InterpolateScalarFieldsFrom] Invalid input");
@@ -39,16 +39,25 @@ public:
 	struct Parameters
 	{
 		enum Method { NEAREST_NEIGHBOR, K_NEAREST_NEIGHBORS, RADIUS };
-		enum Algo { AVERAGE, MEDIAN, NORMAL_DIST };
+		enum Algo { AVERAGE, MEDIAN, NORMAL_DIST, INVERSE_DISTANCE };
 
 		Method method = NEAREST_NEIGHBOR;
 		Algo algo = AVERAGE;
 		unsigned knn = 0;
 		float radius = 0;
+		//! Kernel of the Normal distribution (NORMAL_DIST)
 		double sigma = 0;
+		//! Power of the inverse distance weights (INVERSE_DISTANCE)
+		double power = 2.0;
 	};
 
 	//! Interpolate scalar fields from another cloud
+	/** The destination points are processed in parallel, by cells of the (destination) octree.
+		For the RADIUS method, the source neighbors of a whole cell are extracted once, and their
+		scalar values are gathered in a contiguous buffer shared by all the points of the cell.
+		All the scalar fields are interpolated at once (one neighbor extraction per point).
+		Invalid (NaN) source values are ignored.
+	**/
 	static bool InterpolateScalarFieldsFrom(ccPointCloud* destCloud,
 											ccPointCloud* srccloud,
 											const std::vector<int>& sfIndexes,
@@ -162,61 +162,67 @@ void ccScalarField::setLogScale(bool state)
 
 void ccScalarField::computeMinAndMax()
 {
-	ScalarField::computeMinAndMax();
+	//the statistics and the histogram are computed at the same time
+	unsigned count = currentSize();
+	unsigned numberOfClasses = static_cast<unsigned>(ceil(sqrt(static_cast<double>(count))));
+	numberOfClasses = std::max<unsigned>(std::min<unsigned>(numberOfClasses, MAX_HISTOGRAM_SIZE), 4);
 
-	m_displayRange.setBounds(m_minVal, m_maxVal);
-
-	//update histogram
+	if (!computeStatistics(numberOfClasses))
 	{
-		if (m_displayRange.maxRange() == 0 || currentSize() == 0)
-		{
-			//can't build histogram of a flat field
-			m_histogram.clear();
-		}
-		else
-		{
-			unsigned count = currentSize();
-			unsigned numberOfClasses = static_cast<unsigned>(ceil(sqrt(static_cast<double>(count))));
-			numberOfClasses = std::max<unsigned>(std::min<unsigned>(numberOfClasses, MAX_HISTOGRAM_SIZE), 4);
+		ccLog::Warning("[ccScalarField::computeMinAndMax] Failed to update associated histogram!");
+		//we still need the min and max values
+		computeStatistics(0);
+	}
 
-			m_histogram.maxValue = 0;
+	m_displayRange.setBounds(m_minVal, m_maxVal);
 
-			//reserve memory
-			try
-			{
-				m_histogram.resize(numberOfClasses);
-			}
-			catch (const std::bad_alloc&)
-			{
-				ccLog::Warning("[ccScalarField::computeMinAndMax] Failed to update associated histogram!");
-				m_histogram.clear();
-			}
+	updateHistogram();
 
-			if (!m_histogram.empty())
-			{
-				std::fill(m_histogram.begin(), m_histogram.end(), 0);
+	m_modified = true;
 
-				//compute histogram
-				{
-					ScalarType step = static_cast<ScalarType>(numberOfClasses) / m_displayRange.maxRange();
-					for (unsigned i = 0; i < count; ++i)
-					{
-						const ScalarType& val = getValue(i);
+	updateSaturationBounds();
+}
 
-						unsigned bin = static_cast<unsigned>(floor((val - m_displayRange.min())*step));
-						++m_histogram[std::min(bin, numberOfClasses - 1)];
-					}
-				}
+void ccScalarField::updateValue(std::size_t index, ScalarType value)
+{
+	ScalarField::updateValue(index, value);
 
-				//update 'maxValue'
-				m_histogram.maxValue = *std::max_element(m_histogram.begin(), m_histogram.end());
-			}
-		}
+	if (m_minVal < m_displayRange.min() || m_maxVal > m_displayRange.max())
+	{
+		//the histogram must be computed again anyway
+		computeMinAndMax();
+		return;
 	}
 
+	updateHistogram();
+
 	m_modified = true;
+}
 
-	updateSaturationBounds();
+void ccScalarField::updateHistogram()
+{
+	const std::vector<unsigned>& histogram = m_statistics.histogram();
+
+	if (m_displayRange.maxRange() == 0 || histogram.empty())
+	{
+		//can't build histogram of a flat field
+		m_histogram.clear();
+		m_histogram.maxValue = 0;
+		return;
+	}
+
+	try
+	{
+		m_histogram.assign(histogram.begin(), histogram.end());
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning("[ccScalarField::computeMinAndMax] Failed to update associated histogram!");
+		m_histogram.clear();
+	}
+
+	//update 'maxValue'
+	m_histogram.maxValue = (m_histogram.empty() ? 0 : *std::max_element(m_histogram.begin(), m_histogram.end()));
 }
 
 void ccScalarField::updateSaturationBounds()
@@ -171,6 +171,7 @@ public:
 
 	//inherited
 	QCC_DB_LIB_API virtual void computeMinAndMax() override;
+	QCC_DB_LIB_API virtual void updateValue(std::size_t index, ScalarType value) override;
 
 	//! Returns associated color scale
 	inline const ccColorScale::Shared& getColorScale() const { return m_colorScale; }
@@ -234,6 +235,9 @@ protected: //methods
 	//! Updates saturation values
 	QCC_DB_LIB_API void updateSaturationBounds();
 
+	//! Updates the histogram (for display) from the cached statistics
+	void updateHistogram();
+
 	//! Normalizes a scalar value between 0 and 1 (wrt to current parameters)
 	/**	\param val scalar value
 		\return a number between 0 and 1 if inside displayed range or -1 otherwise
@@ -26,8 +26,15 @@
 #include <CCPlatform.h>
 
 //System
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifdef USE_TBB
+#include <tbb/parallel_for.h>
+#endif
 
 //Qt
 #include <QFile>
@@ -217,22 +224,11 @@ public:
 			}
 
 			//array data (dataVersion>=20)
+			assert(sizeof(ComponentType) * N == sizeof(Type));
+			qint64 byteCount = static_cast<qint64>(data.size()) * (sizeof(ComponentType) * N);
+			if (!ReadRawData(in, (char*)data.data(), byteCount))
 			{
-				//Apparently Qt and/or Windows don't like to read too many bytes in a row...
-				static const qint64 MaxElementPerChunk = (static_cast<qint64>(1) << 24);
-				assert(sizeof(ComponentType) * N == sizeof(Type));
-				qint64 byteCount = static_cast<qint64>(data.size()) * (sizeof(ComponentType) * N);
-				char* dest = (char*)data.data();
-				while (byteCount > 0)
-				{
-					qint64 chunkSize = std::min(MaxElementPerChunk, byteCount);
-					if (in.read(dest, chunkSize) < 0)
-					{
-						return ccSerializableObject::ReadError();
-					}
-					byteCount -= chunkSize;
-					dest += chunkSize;
-				}
+				return false;
 			}
 		}
 
@@ -271,23 +267,47 @@ public:
 			}
 
 			//array data (dataVersion>=20)
-			//--> saldy we can't read it as a block...
-			//we must convert each element, value by value!
-			FileComponentType dummyArray[N] = { 0 };
-
+			//--> we can't read it as a block, we must convert each value
+			//(but we still read/map the file by large blocks!)
+			const qint64 fileValueCount = static_cast<qint64>(elementCount) * N;
 			ComponentType* _data = (ComponentType*)data.data();
-			for (unsigned i = 0; i < elementCount; ++i)
+
+			qint64 pos = in.pos();
+			const qint64 byteCount = fileValueCount * static_cast<qint64>(sizeof(FileComponentType));
+			uchar* mapped = (byteCount >= MinMappedByteCount() ? in.map(pos, byteCount) : nullptr);
+			if (mapped)
 			{
-				if (in.read((char*)dummyArray, sizeof(FileComponentType) * N) >= 0)
+				ConvertValues(reinterpret_cast<const FileComponentType*>(mapped), _data, fileValueCount);
+				in.unmap(mapped);
+				if (!in.seek(pos + byteCount))
 				{
-					for (unsigned k = 0; k < N; ++k)
-					{
-						*_data++ = static_cast<ComponentType>(dummyArray[k]);
-					}
+					return ccSerializableObject::ReadError();
 				}
-				else
+			}
+			else
+			{
+				static const qint64 MaxValuePerChunk = (static_cast<qint64>(1) << 20);
+				std::vector<FileComponentType> buffer;
+				try
 				{
-					return ccSerializableObject::ReadError();
+					buffer.resize(static_cast<size_t>(std::min(MaxValuePerChunk, fileValueCount)));
+				}
+				catch (const std::bad_alloc&)
+				{
+					return ccSerializableObject::MemoryError();
+				}
+
+				for (qint64 remaining = fileValueCount; remaining > 0; )
+				{
+					qint64 chunkSize = std::min(MaxValuePerChunk, remaining);
+					qint64 chunkByteCount = chunkSize * static_cast<qint64>(sizeof(FileComponentType));
+					if (in.read((char*)buffer.data(), chunkByteCount) != chunkByteCount)
+					{
+						return ccSerializableObject::ReadError();
+					}
+					ConvertValues(buffer.data(), _data, chunkSize);
+					_data += chunkSize;
+					remaining -= chunkSize;
 				}
 			}
 		}
@@ -297,6 +317,99 @@ public:
 
 protected:
 
+	//! Minimum size of an array (in bytes) for it to be read through a memory-mapped view of the file
+	static inline qint64 MinMappedByteCount() { return (static_cast<qint64>(1) << 20); } //1 Mb
+
+	//! Size of the blocks copied/converted concurrently
+	static inline qint64 ParallelBlockSize() { return (static_cast<qint64>(1) << 22); } //4 Mb
+
+	//! Copies a (potentially big) block of memory
+	/** Done in parallel by blocks if possible.
+	**/
+	static void CopyRawData(char* dest, const uchar* source, qint64 byteCount)
+	{
+		const qint64 blockSize = ParallelBlockSize();
+		const qint64 blockCount = (byteCount + blockSize - 1) / blockSize;
+#ifdef USE_TBB
+		tbb::parallel_for(static_cast<qint64>(0), blockCount, [&](qint64 i)
+#else
+		for (qint64 i = 0; i < blockCount; ++i)
+#endif
+		{
+			qint64 start = i * blockSize;
+			qint64 size = std::min(blockSize, byteCount - start);
+			memcpy(dest + start, source + start, static_cast<size_t>(size));
+		}
+#ifdef USE_TBB
+		);
+#endif
+	}
+
+	//! Converts values read from a file to the current type
+	/** Done in parallel by blocks if possible.
+	**/
+	template <class ComponentType, class FileComponentType> static void ConvertValues(const FileComponentType* source, ComponentType* dest, qint64 count)
+	{
+		const qint64 valuesPerBlock = ParallelBlockSize() / static_cast<qint64>(sizeof(FileComponentType));
+		const qint64 blockCount = (count + valuesPerBlock - 1) / valuesPerBlock;
+#ifdef USE_TBB
+		tbb::parallel_for(static_cast<qint64>(0), blockCount, [&](qint64 i)
+#else
+		for (qint64 i = 0; i < blockCount; ++i)
+#endif
+		{
+			qint64 start = i * valuesPerBlock;
+			qint64 stop = std::min(start + valuesPerBlock, count);
+			for (qint64 j = start; j < stop; ++j)
+			{
+				dest[j] = static_cast<ComponentType>(source[j]);
+			}
+		}
+#ifdef USE_TBB
+		);
+#endif
+	}
+
+	//! Reads a block of raw data from a file directly into its final buffer
+	/** Big blocks are read through a memory-mapped view of the file (which avoids
+		the intermediate buffering and the numerous system calls of QFile::read).
+		Falls back to standard reading (by chunks) if the file can't be mapped.
+		\param in input file (must be already opened)
+		\param dest destination buffer (must be already allocated)
+		\param byteCount number of bytes to read
+		\return success
+	**/
+	static bool ReadRawData(QFile& in, char* dest, qint64 byteCount)
+	{
+		qint64 pos = in.pos();
+		uchar* mapped = (byteCount >= MinMappedByteCount() ? in.map(pos, byteCount) : nullptr);
+		if (mapped)
+		{
+			CopyRawData(dest, mapped, byteCount);
+			in.unmap(mapped);
+			if (!in.seek(pos + byteCount))
+			{
+				return ccSerializableObject::ReadError();
+			}
+			return true;
+		}
+
+		//Apparently Qt and/or Windows don't like to read too many bytes in a row...
+		static const qint64 MaxBytePerChunk = (static_cast<qint64>(1) << 24);
+		while (byteCount > 0)
+		{
+			qint64 chunkSize = std::min(MaxBytePerChunk, byteCount);
+			if (in.read(dest, chunkSize) != chunkSize)
+			{
+				return ccSerializableObject::ReadError();
+			}
+			byteCount -= chunkSize;
+			dest += chunkSize;
+		}
+
+		return true;
+	}
+
 	static bool ReadArrayHeader(QFile& in,
 								short dataVersion,
 								::uint8_t &componentCount,
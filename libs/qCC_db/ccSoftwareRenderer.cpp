@@ -0,0 +1,701 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+//Always first
+#include "ccIncludeGL.h"
+
+#include "ccSoftwareRenderer.h"
+
+//Local
+#include "ccGenericMesh.h"
+#include "ccGenericPointCloud.h"
+#include "ccHObjectCaster.h"
+#include "ccLog.h"
+
+//System
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_set>
+
+#ifdef USE_TBB
+#include <tbb/parallel_for.h>
+#endif
+
+//number of points (or triangles) drawn by block
+static const unsigned s_drawingBlockSize = (1 << 14);
+
+//maximum frame buffer dimension (width or height)
+static const int s_maxFrameBufferSize = (1 << 14); //16384
+
+//'empty' pixel value (farthest depth)
+static const std::uint64_t s_emptyPixel = std::numeric_limits<std::uint64_t>::max();
+
+//shading: ambient and diffuse coefficients (headlight)
+static const float s_ambientCoef = 0.25f;
+static const float s_diffuseCoef = 0.75f;
+
+ccSoftwareRenderer::Parameters::Parameters()
+	: width(1920)
+	, height(1080)
+	, backgroundColor(ccColor::defaultBkgColor)
+	, pointSize(0.0f)
+	, maxPointCount(0)
+	, shading(true)
+{
+}
+
+struct ccSoftwareRenderer::Projector
+{
+	Projector(const ccGLCameraParameters& camera, const ccGLMatrix& entityTrans)
+		: width(camera.viewport[2])
+		, height(camera.viewport[3])
+	{
+		ccGLMatrixd modelView = camera.modelViewMat * ccGLMatrixd(entityTrans.data());
+		ccGLMatrixd mvp = camera.projectionMat * modelView;
+		memcpy(M, mvp.data(), 16 * sizeof(double));
+
+		//to compute the 'z' coordinate of the normals in the eye coordinate system
+		const double* MV = modelView.data();
+		normalZ = CCVector3d(MV[2], MV[6], MV[10]);
+		normalZ.normalize();
+	}
+
+	//! Projects a point in the image (+ depth in [0 ; 1])
+	/** \return false if the point is outside of the view frustum depth range
+	**/
+	inline bool project(const CCVector3& P, double& x, double& y, float& depth) const
+	{
+		double w = M[3] * P.x + M[7] * P.y + M[11] * P.z + M[15];
+		if (w <= 0)
+		{
+			//behind the camera
+			return false;
+		}
+
+		double z = (M[2] * P.x + M[6] * P.y + M[10] * P.z + M[14]) / w;
+		if (z < -1.0 || z > 1.0)
+		{
+			return false;
+		}
+
+		x = ((M[0] * P.x + M[4] * P.y + M[8] * P.z + M[12]) / w + 1.0) * (width / 2.0);
+		y = (1.0 - (M[1] * P.x + M[5] * P.y + M[9] * P.z + M[13]) / w) * (height / 2.0); //image rows go downward
+		depth = static_cast<float>((z + 1.0) / 2.0);
+
+		return true;
+	}
+
+	//! Returns the light intensity for a given normal (headlight)
+	inline float shade(const CCVector3& N) const
+	{
+		double nz = normalZ.x * N.x + normalZ.y * N.y + normalZ.z * N.z;
+		return s_ambientCoef + s_diffuseCoef * static_cast<float>(std::min(std::abs(nz), 1.0));
+	}
+
+	//! Modelview-projection matrix
+	double M[16];
+	//! 3rd row of the modelview matrix (normalized)
+	CCVector3d normalZ;
+	//! Image width
+	int width;
+	//! Image height
+	int height;
+};
+
+//! Returns a color as a QRgb value (optionally shaded)
+static inline QRgb ToQRgb(const ccColor::Rgb& color, float intensity = 1.0f)
+{
+	return qRgb(static_cast<int>(color.r * intensity),
+				static_cast<int>(color.g * intensity),
+				static_cast<int>(color.b * intensity));
+}
+
+ccSoftwareRenderer::ccSoftwareRenderer()
+	: m_width(0)
+	, m_height(0)
+{
+}
+
+void ccSoftwareRenderer::CollectDisplayedEntities(const ccHObject::Container& entities, ccHObject::Container& displayedEntities)
+{
+	std::unordered_set<const ccHObject*> alreadyCollected;
+	ccHObject::Container toProcess = entities;
+	while (!toProcess.empty())
+	{
+		ccHObject* entity = toProcess.back();
+		toProcess.pop_back();
+
+		if (!entity || !entity->isEnabled() || alreadyCollected.find(entity) != alreadyCollected.end())
+		{
+			continue;
+		}
+		alreadyCollected.insert(entity);
+
+		if (entity->isVisible())
+		{
+			if (entity->isKindOf(CC_TYPES::MESH))
+			{
+				displayedEntities.push_back(entity);
+			}
+			else if (entity->isKindOf(CC_TYPES::POINT_CLOUD))
+			{
+				//mesh vertices are drawn with the mesh
+				ccHObject* parent = entity->getParent();
+				if (!parent || !parent->isKindOf(CC_TYPES::MESH) || ccHObjectCaster::ToGenericMesh(parent)->getAssociatedCloud() != entity)
+				{
+					displayedEntities.push_back(entity);
+				}
+			}
+		}
+
+		for (unsigned i = 0; i < entity->getChildrenNumber(); ++i)
+		{
+			toProcess.push_back(entity->getChild(i));
+		}
+	}
+}
+
+ccBBox ccSoftwareRenderer::ComputeSceneBox(const ccHObject::Container& displayedEntities)
+{
+	ccBBox box;
+	for (ccHObject* entity : displayedEntities)
+	{
+		ccBBox entityBox = entity->getOwnBB();
+		if (!entityBox.isValid())
+		{
+			continue;
+		}
+
+		ccGLMatrix trans;
+		if (entity->getAbsoluteGLTransformation(trans))
+		{
+			entityBox = entityBox * trans;
+		}
+		box += entityBox;
+	}
+
+	return box;
+}
+
+ccGLCameraParameters ccSoftwareRenderer::ComputeCameraParameters(	const ccViewportParameters& viewport,
+																	int width,
+																	int height,
+																	const ccBBox& sceneBox)
+{
+	ccGLCameraParameters camera;
+	camera.viewport[0] = 0;
+	camera.viewport[1] = 0;
+	camera.viewport[2] = width;
+	camera.viewport[3] = height;
+	camera.perspective = viewport.perspectiveView;
+	camera.fov_deg = viewport.fov;
+	camera.pixelSize = viewport.pixelSize;
+
+	//in orthographic mode, the camera is at the center of the visible objects (along the viewing direction)
+	CCVector3d cameraCenter = viewport.cameraCenter;
+	if (!viewport.perspectiveView)
+	{
+		cameraCenter.z = (sceneBox.isValid() ? sceneBox.getCenter().z : 0.0);
+	}
+
+	//modelview matrix (see ccGLWindow::computeModelViewMatrix)
+	{
+		ccGLMatrixd viewMatd;
+		viewMatd.toIdentity();
+
+		if (viewport.objectCenteredView)
+		{
+			//place origin on pivot point
+			viewMatd.setTranslation(-viewport.pivotPoint);
+			//rotation (viewMat is simply a rotation matrix around the pivot here!)
+			viewMatd = viewport.viewMat * viewMatd;
+			//go back to initial origin, then place origin on camera center
+			viewMatd.setTranslation(viewMatd.getTranslationAsVec3D() + viewport.pivotPoint - cameraCenter);
+		}
+		else
+		{
+			//place origin on camera center
+			viewMatd.setTranslation(-cameraCenter);
+			//rotation (viewMat is the rotation around the camera center here - no pivot)
+			viewMatd = viewport.viewMat * viewMatd;
+		}
+
+		ccGLMatrixd scaleMatd;
+		scaleMatd.toIdentity();
+		if (viewport.perspectiveView)
+		{
+			//for proper aspect ratio handling
+			if (height != 0)
+			{
+				double ar = width / (height * static_cast<double>(viewport.perspectiveAspectRatio));
+				if (ar < 1.0)
+				{
+					scaleMatd.data()[0] = ar;
+					scaleMatd.data()[5] = ar;
+				}
+			}
+		}
+		else
+		{
+			//apply zoom
+			double totalZoom = static_cast<double>(viewport.zoom / viewport.pixelSize);
+			scaleMatd.data()[0] = totalZoom;
+			scaleMatd.data()[5] = totalZoom;
+			scaleMatd.data()[10] = totalZoom;
+		}
+
+		camera.modelViewMat = scaleMatd * viewMatd;
+	}
+
+	//projection matrix (see ccGLWindow::computeProjectionMatrix)
+	{
+		double bbHalfDiag = 1.0;
+		CCVector3d bbCenter(0, 0, 0);
+		if (sceneBox.isValid())
+		{
+			bbCenter = CCVector3d::fromArray(sceneBox.getCenter().u);
+			bbHalfDiag = sceneBox.getDiagNormd() / 2;
+		}
+
+		//virtual pivot point (i.e. to handle viewer-based mode smoothly)
+		CCVector3d pivotPoint = (viewport.objectCenteredView ? viewport.pivotPoint : cameraCenter);
+
+		//distance between the camera center and the pivot point
+		double CP = (cameraCenter - pivotPoint).norm();
+		//distance between the pivot point and DB farthest point
+		double MP = ((bbCenter - pivotPoint).norm() + bbHalfDiag) * 1.01; //for round-off issues
+
+		if (viewport.perspectiveView)
+		{
+			double zFar = std::max(CP + MP, 1.0);
+			double zNear = zFar * viewport.zNearCoef;
+
+			double ar = static_cast<double>(width) / height;
+			double yMax = zNear * std::tan(static_cast<double>(viewport.fov) / 2.0 * CC_DEG_TO_RAD);
+			double xMax = yMax * ar;
+
+			camera.projectionMat = ccGL::Frustum(-xMax, xMax, -yMax, yMax, zNear, zFar);
+		}
+		else
+		{
+			//max distance (camera to 'farthest' point)
+			double maxDist_pix = (CP + MP) / viewport.pixelSize * viewport.zoom;
+			maxDist_pix = std::max(maxDist_pix, 1.0);
+
+			double halfW = width / 2.0;
+			double halfH = height / 2.0 * viewport.orthoAspectRatio;
+
+			camera.projectionMat = ccGL::Ortho(halfW, halfH, maxDist_pix);
+		}
+	}
+
+	return camera;
+}
+
+bool ccSoftwareRenderer::FitViewport(	ccViewportParameters& viewport,
+										const ccBBox& box,
+										int width,
+										int height)
+{
+	if (!box.isValid())
+	{
+		return false;
+	}
+
+	double bbDiag = box.getDiagNormd();
+	if (bbDiag < ZERO_TOLERANCE)
+	{
+		return false;
+	}
+
+	viewport.zoom = 1.0f;
+
+	//pixel size (in world coordinates)
+	int minScreenSize = std::min(width, height);
+	viewport.pixelSize = (minScreenSize > 0 ? static_cast<float>(bbDiag / minScreenSize) : 1.0f);
+
+	//pivot point on the box center
+	CCVector3d P = CCVector3d::fromArray(box.getCenter().u);
+	viewport.pivotPoint = P;
+
+	CCVector3d cameraPos = P;
+	if (viewport.perspectiveView) //camera is on the pivot in ortho mode
+	{
+		//we must go backward so as to see the object!
+		double d = bbDiag / std::tan(static_cast<double>(viewport.fov) * CC_DEG_TO_RAD);
+
+		CCVector3d cameraDir(0, 0, -1);
+		if (!viewport.objectCenteredView)
+		{
+			//view direction is (the opposite of) the 3rd line of the view matrix
+			const double* M = viewport.viewMat.data();
+			cameraDir = CCVector3d(-M[2], -M[6], -M[10]);
+			cameraDir.normalize();
+		}
+
+		cameraPos -= cameraDir * d;
+	}
+	viewport.cameraCenter = cameraPos;
+
+	return true;
+}
+
+bool ccSoftwareRenderer::initFrameBuffer(int width, int height)
+{
+	if (width <= 0 || height <= 0 || width > s_maxFrameBufferSize || height > s_maxFrameBufferSize)
+	{
+		ccLog::Warning(QString("[ccSoftwareRenderer] Invalid image size (%1 x %2)").arg(width).arg(height));
+		return false;
+	}
+
+	std::size_t pixelCount = static_cast<std::size_t>(width) * height;
+	if (!m_frameBuffer || width != m_width || height != m_height)
+	{
+		m_frameBuffer.reset();
+		m_width = m_height = 0;
+		try
+		{
+			m_frameBuffer.reset(new std::atomic<std::uint64_t>[pixelCount]);
+		}
+		catch (const std::bad_alloc&)
+		{
+			ccLog::Warning("[ccSoftwareRenderer] Not enough memory");
+			return false;
+		}
+		m_width = width;
+		m_height = height;
+	}
+
+	for (std::size_t i = 0; i < pixelCount; ++i)
+	{
+		m_frameBuffer[i].store(s_emptyPixel, std::memory_order_relaxed);
+	}
+
+	return true;
+}
+
+inline void ccSoftwareRenderer::writeFragment(int x, int y, float depth, QRgb color)
+{
+	//the depth is positive: the order of its bit representation is the same as the order of the values
+	std::uint32_t depthBits = 0;
+	memcpy(&depthBits, &depth, sizeof(float));
+	std::uint64_t fragment = (static_cast<std::uint64_t>(depthBits) << 32) | static_cast<std::uint32_t>(color);
+
+	//atomic 'min'
+	std::atomic<std::uint64_t>& pixel = m_frameBuffer[static_cast<std::size_t>(y) * m_width + x];
+	std::uint64_t current = pixel.load(std::memory_order_relaxed);
+	while (fragment < current && !pixel.compare_exchange_weak(current, fragment, std::memory_order_relaxed))
+	{
+	}
+}
+
+void ccSoftwareRenderer::drawCloud(ccGenericPointCloud* cloud, const Projector& projector, float pointSize, unsigned step, bool shading)
+{
+	glDrawParams glParams;
+	cloud->getDrawingParameters(glParams);
+	shading &= glParams.showNorms;
+
+	const ccGenericPointCloud::VisibilityTableType* visibilityTable = (cloud->isVisibilityTableInstantiated() ? &cloud->getTheVisibilityArray() : nullptr);
+	const ccColor::Rgb defaultColor = (cloud->isColorOverriden() ? cloud->getTempColor() : ccColor::defaultColor);
+
+	const int splatSize = std::max(1, static_cast<int>(pointSize + 0.5f));
+	const double splatHalfSize = splatSize / 2.0;
+
+	const unsigned pointCount = cloud->size();
+	const unsigned drawnCount = (pointCount + step - 1) / step;
+	const int blockCount = static_cast<int>((drawnCount + s_drawingBlockSize - 1) / s_drawingBlockSize);
+
+#ifdef USE_TBB
+	tbb::parallel_for(0, blockCount, [&](int b)
+#else
+	for (int b = 0; b < blockCount; ++b)
+#endif
+	{
+		std::size_t first = static_cast<std::size_t>(b) * s_drawingBlockSize * step;
+		std::size_t last = std::min(first + static_cast<std::size_t>(s_drawingBlockSize) * step, static_cast<std::size_t>(pointCount));
+		for (std::size_t j = first; j < last; j += step)
+		{
+			unsigned i = static_cast<unsigned>(j);
+			if (visibilityTable && visibilityTable->at(i) != POINT_VISIBLE)
+			{
+				continue;
+			}
+
+			double x = 0, y = 0;
+			float depth = 0;
+			if (!projector.project(*cloud->getPoint(i), x, y, depth))
+			{
+				continue;
+			}
+
+			//point color
+			const ccColor::Rgb* color = &defaultColor;
+			if (glParams.showSF)
+			{
+				color = cloud->getPointScalarValueColor(i);
+				if (!color)
+				{
+					//hidden value
+					continue;
+				}
+			}
+			else if (glParams.showColors && !cloud->isColorOverriden())
+			{
+				color = &cloud->getPointColor(i);
+			}
+			QRgb rgb = ToQRgb(*color, shading ? projector.shade(cloud->getPointNormal(i)) : 1.0f);
+
+			//square splat
+			int x0 = static_cast<int>(std::floor(x - splatHalfSize + 0.5));
+			int y0 = static_cast<int>(std::floor(y - splatHalfSize + 0.5));
+			int x1 = std::min(x0 + splatSize, m_width);
+			int y1 = std::min(y0 + splatSize, m_height);
+			for (int v = std::max(y0, 0); v < y1; ++v)
+			{
+				for (int u = std::max(x0, 0); u < x1; ++u)
+				{
+					writeFragment(u, v, depth, rgb);
+				}
+			}
+		}
+	}
+#ifdef USE_TBB
+	);
+#endif
+}
+
+void ccSoftwareRenderer::drawMesh(ccGenericMesh* mesh, const Projector& projector, bool shading)
+{
+	ccGenericPointCloud* vertices = mesh->getAssociatedCloud();
+	if (!vertices)
+	{
+		assert(false);
+		return;
+	}
+
+	glDrawParams glParams;
+	mesh->getDrawingParameters(glParams);
+
+	const ccGenericPointCloud::VisibilityTableType* visibilityTable = (vertices->isVisibilityTableInstantiated() ? &vertices->getTheVisibilityArray() : nullptr);
+	const ccColor::Rgb defaultColor = (mesh->isColorOverriden() ? mesh->getTempColor() : ccColor::FromRgbf(ccColor::defaultMeshFrontDiff));
+	const bool perVertexColors = !mesh->isColorOverriden() && (glParams.showSF || glParams.showColors);
+
+	const unsigned triCount = mesh->size();
+	const int blockCount = static_cast<int>((triCount + s_drawingBlockSize - 1) / s_drawingBlockSize);
+
+#ifdef USE_TBB
+	tbb::parallel_for(0, blockCount, [&](int b)
+#else
+	for (int b = 0; b < blockCount; ++b)
+#endif
+	{
+		unsigned first = static_cast<unsigned>(b) * s_drawingBlockSize;
+		unsigned last = std::min(first + s_drawingBlockSize, triCount);
+		for (unsigned t = first; t < last; ++t)
+		{
+			const CCLib::VerticesIndexes* tsi = mesh->getTriangleVertIndexes(t);
+
+			if (visibilityTable
+				&& (	visibilityTable->at(tsi->i1) != POINT_VISIBLE
+					||	visibilityTable->at(tsi->i2) != POINT_VISIBLE
+					||	visibilityTable->at(tsi->i3) != POINT_VISIBLE))
+			{
+				continue;
+			}
+
+			//triangles crossing the near or far planes are ignored (no clipping)
+			const CCVector3* P[3] = { vertices->getPoint(tsi->i1), vertices->getPoint(tsi->i2), vertices->getPoint(tsi->i3) };
+			double x[3], y[3];
+			float z[3];
+			if (	!projector.project(*P[0], x[0], y[0], z[0])
+				||	!projector.project(*P[1], x[1], y[1], z[1])
+				||	!projector.project(*P[2], x[2], y[2], z[2]))
+			{
+				continue;
+			}
+
+			double area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+			if (std::abs(area) < 1.0e-12)
+			{
+				//degenerate triangle
+				continue;
+			}
+
+			//vertex colors
+			const ccColor::Rgb* C[3] = { &defaultColor, &defaultColor, &defaultColor };
+			if (perVertexColors)
+			{
+				if (glParams.showSF)
+				{
+					C[0] = vertices->getPointScalarValueColor(tsi->i1);
+					C[1] = vertices->getPointScalarValueColor(tsi->i2);
+					C[2] = vertices->getPointScalarValueColor(tsi->i3);
+					if (!C[0] || !C[1] || !C[2])
+					{
+						//hidden values
+						continue;
+					}
+				}
+				else
+				{
+					C[0] = &vertices->getPointColor(tsi->i1);
+					C[1] = &vertices->getPointColor(tsi->i2);
+					C[2] = &vertices->getPointColor(tsi->i3);
+				}
+			}
+
+			//flat shading
+			float intensity = 1.0f;
+			if (shading)
+			{
+				CCVector3 N = (*P[1] - *P[0]).cross(*P[2] - *P[0]);
+				N.normalize();
+				intensity = projector.shade(N);
+			}
+			QRgb flatColor = ToQRgb(*C[0], intensity);
+
+			int xMin = std::max(static_cast<int>(std::floor(std::min(x[0], std::min(x[1], x[2])))), 0);
+			int xMax = std::min(static_cast<int>(std::ceil(std::max(x[0], std::max(x[1], x[2])))), m_width - 1);
+			int yMin = std::max(static_cast<int>(std::floor(std::min(y[0], std::min(y[1], y[2])))), 0);
+			int yMax = std::min(static_cast<int>(std::ceil(std::max(y[0], std::max(y[1], y[2])))), m_height - 1);
+
+			for (int v = yMin; v <= yMax; ++v)
+			{
+				double py = v + 0.5;
+				for (int u = xMin; u <= xMax; ++u)
+				{
+					double px = u + 0.5;
+
+					//barycentric coordinates
+					double w0 = ((x[1] - px) * (y[2] - py) - (x[2] - px) * (y[1] - py)) / area;
+					double w1 = ((x[2] - px) * (y[0] - py) - (x[0] - px) * (y[2] - py)) / area;
+					double w2 = 1.0 - w0 - w1;
+					if (w0 < 0 || w1 < 0 || w2 < 0)
+					{
+						continue;
+					}
+
+					float depth = static_cast<float>(w0 * z[0] + w1 * z[1] + w2 * z[2]);
+
+					QRgb rgb = flatColor;
+					if (perVertexColors)
+					{
+						ccColor::Rgb color(	static_cast<ColorCompType>(w0 * C[0]->r + w1 * C[1]->r + w2 * C[2]->r),
+											static_cast<ColorCompType>(w0 * C[0]->g + w1 * C[1]->g + w2 * C[2]->g),
+											static_cast<ColorCompType>(w0 * C[0]->b + w1 * C[1]->b + w2 * C[2]->b));
+						rgb = ToQRgb(color, intensity);
+					}
+
+					writeFragment(u, v, std::max(depth, 0.0f), rgb);
+				}
+			}
+		}
+	}
+#ifdef USE_TBB
+	);
+#endif
+}
+
+bool ccSoftwareRenderer::render(const ccHObject::Container& entities,
+								const ccViewportParameters& viewport,
+								const Parameters& params,
+								QImage& image)
+{
+	if (!initFrameBuffer(params.width, params.height))
+	{
+		return false;
+	}
+
+	ccHObject::Container displayedEntities;
+	CollectDisplayedEntities(entities, displayedEntities);
+
+	ccGLCameraParameters camera = ComputeCameraParameters(viewport, m_width, m_height, ComputeSceneBox(displayedEntities));
+
+	//decimation step (same for all clouds, so as to keep the same relative density)
+	unsigned step = 1;
+	if (params.maxPointCount != 0)
+	{
+		std::size_t totalPointCount = 0;
+		for (ccHObject* entity : displayedEntities)
+		{
+			if (entity->isKindOf(CC_TYPES::POINT_CLOUD))
+			{
+				totalPointCount += ccHObjectCaster::ToGenericPointCloud(entity)->size();
+			}
+		}
+		if (totalPointCount > params.maxPointCount)
+		{
+			step = static_cast<unsigned>((totalPointCount + params.maxPointCount - 1) / params.maxPointCount);
+		}
+	}
+
+	for (ccHObject* entity : displayedEntities)
+	{
+		ccGLMatrix trans;
+		entity->getAbsoluteGLTransformation(trans);
+		Projector projector(camera, trans);
+
+		if (entity->isKindOf(CC_TYPES::MESH))
+		{
+			drawMesh(ccHObjectCaster::ToGenericMesh(entity), projector, params.shading);
+		}
+		else
+		{
+			ccGenericPointCloud* cloud = ccHObjectCaster::ToGenericPointCloud(entity);
+			float pointSize = params.pointSize;
+			if (pointSize <= 0)
+			{
+				pointSize = (cloud->getPointSize() != 0 ? static_cast<float>(cloud->getPointSize()) : viewport.defaultPointSize);
+			}
+			drawCloud(cloud, projector, pointSize, step, params.shading);
+		}
+	}
+
+	//convert the frame buffer to an image
+	image = QImage(m_width, m_height, QImage::Format_RGB32);
+	if (image.isNull())
+	{
+		ccLog::Warning("[ccSoftwareRenderer] Not enough memory");
+		return false;
+	}
+
+	const QRgb backgroundColor = qRgb(params.backgroundColor.r, params.backgroundColor.g, params.backgroundColor.b);
+	uchar* bits = image.bits();
+	const int bytesPerLine = image.bytesPerLine();
+
+#ifdef USE_TBB
+	tbb::parallel_for(0, m_height, [&](int v)
+#else
+	for (int v = 0; v < m_height; ++v)
+#endif
+	{
+		QRgb* line = reinterpret_cast<QRgb*>(bits + static_cast<std::size_t>(v) * bytesPerLine);
+		const std::atomic<std::uint64_t>* pixels = m_frameBuffer.get() + static_cast<std::size_t>(v) * m_width;
+		for (int u = 0; u < m_width; ++u)
+		{
+			std::uint64_t value = pixels[u].load(std::memory_order_relaxed);
+			line[u] = (value != s_emptyPixel ? static_cast<QRgb>(value & 0xFFFFFFFF) : backgroundColor);
+		}
+	}
+#ifdef USE_TBB
+	);
+#endif
+
+	return true;
+}
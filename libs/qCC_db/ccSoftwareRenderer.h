@@ -0,0 +1,145 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_SOFTWARE_RENDERER_HEADER
+#define CC_SOFTWARE_RENDERER_HEADER
+
+//Local
+#include "ccBBox.h"
+#include "ccColorTypes.h"
+#include "ccGenericGLDisplay.h"
+#include "ccHObject.h"
+
+//Qt
+#include <QImage>
+
+//System
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+class ccGenericMesh;
+class ccGenericPointCloud;
+
+//! CPU renderer for point clouds and meshes (no OpenGL context required)
+/** Meant to render snapshots or animation frames on headless machines (e.g. in command line mode).
+	The camera follows the same conventions as ccGLWindow (see ccViewportParameters) so that
+	the viewports saved in the GUI can be used as is.
+
+	Points are splatted as squares and triangles are rasterized (flat shading) in parallel.
+	Each pixel of the frame buffer stores the depth and the color of the closest fragment in a
+	single 64 bits word updated with an atomic 'min' operation: no lock is required and the
+	result doesn't depend on the number of threads.
+
+	Not supported: textures and materials, labels and other 2D/overlay items, GL filters (EDL, etc.).
+**/
+class QCC_DB_LIB_API ccSoftwareRenderer
+{
+public:
+
+	//! Rendering parameters
+	struct QCC_DB_LIB_API Parameters
+	{
+		//! Default constructor
+		Parameters();
+
+		//! Image width (in pixels)
+		int width;
+		//! Image height (in pixels)
+		int height;
+		//! Background color
+		ccColor::Rgbub backgroundColor;
+		//! Point size (in pixels - 0 = point size of each cloud, or the viewport default point size)
+		float pointSize;
+		//! Maximum number of rendered points (0 = no limit)
+		/** If the displayed clouds have more points, they are regularly decimated
+			(the same way as when the LOD is disabled in the 3D views).
+		**/
+		unsigned maxPointCount;
+		//! Whether to shade the meshes (and the clouds with displayed normals)
+		bool shading;
+	};
+
+	//! Default constructor
+	ccSoftwareRenderer();
+
+	//! Renders entities
+	/** The enabled and visible clouds and meshes are rendered (as well as their children).
+		The frame buffer is kept between two calls (i.e. rendering several frames of the
+		same size doesn't require new allocations).
+		\param entities entities to render
+		\param viewport viewport parameters (camera)
+		\param params rendering parameters
+		\param[out] image rendered image
+		\return false if the parameters are invalid or if there's not enough memory
+	**/
+	bool render(const ccHObject::Container& entities,
+				const ccViewportParameters& viewport,
+				const Parameters& params,
+				QImage& image);
+
+	//! Collects the displayed clouds and meshes (enabled and visible, children included)
+	/** Mesh vertices are not collected as clouds.
+	**/
+	static void CollectDisplayedEntities(const ccHObject::Container& entities, ccHObject::Container& displayedEntities);
+
+	//! Returns the bounding-box of a set of entities (see CollectDisplayedEntities)
+	static ccBBox ComputeSceneBox(const ccHObject::Container& displayedEntities);
+
+	//! Computes the camera parameters (modelview and projection matrices) equivalent to a viewport
+	/** Same as ccGLWindow (the scene bounding-box is used to set the depth range).
+	**/
+	static ccGLCameraParameters ComputeCameraParameters(const ccViewportParameters& viewport,
+														int width,
+														int height,
+														const ccBBox& sceneBox);
+
+	//! Zooms and centers a viewport on a given box (keeps the current orientation)
+	/** Same as ccGLWindow::updateConstellationCenterAndZoom.
+		\return false if the box is invalid
+	**/
+	static bool FitViewport(ccViewportParameters& viewport,
+							const ccBBox& box,
+							int width,
+							int height);
+
+protected:
+
+	//! Projection (modelview + projection + viewport) of one entity
+	struct Projector;
+
+	//! Resets the frame buffer
+	bool initFrameBuffer(int width, int height);
+
+	//! Splats the points of a cloud
+	void drawCloud(ccGenericPointCloud* cloud, const Projector& projector, float pointSize, unsigned step, bool shading);
+
+	//! Rasterizes the triangles of a mesh
+	void drawMesh(ccGenericMesh* mesh, const Projector& projector, bool shading);
+
+	//! Writes a fragment in the frame buffer (if it's the closest one)
+	inline void writeFragment(int x, int y, float depth, QRgb color);
+
+	//! Frame buffer (depth and color of each pixel)
+	std::unique_ptr<std::atomic<std::uint64_t>[]> m_frameBuffer;
+	//! Frame buffer width
+	int m_width;
+	//! Frame buffer height
+	int m_height;
+};
+
+#endif //CC_SOFTWARE_RENDERER_HEADER
@@ -0,0 +1,941 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include "ccIncludeGL.h"
+#include "ccSubCloud.h"
+
+//Local
+#include "ccHObjectCaster.h"
+#include "ccMaterial.h"
+#include "ccPointCloud.h"
+#include "ccScalarField.h"
+
+//CCLib
+#include <ReferenceCloud.h>
+
+//system
+#include <cassert>
+#include <cmath>
+
+ccSubCloud::ccSubCloud(ccPointCloud* associatedCloud, QString name/*=QString()*/)
+	: ccGenericPointCloud(name.isEmpty() ? QString("Sub-cloud") : name)
+	, m_associatedCloud(nullptr)
+	, m_ownsCloud(false)
+	, m_globalIterator(0)
+{
+	setAssociatedCloud(associatedCloud); //must be called so as to set the right dependency!
+
+	if (associatedCloud)
+	{
+		importParametersFrom(associatedCloud);
+		showColors(associatedCloud->colorsShown());
+		showNormals(associatedCloud->normalsShown());
+		showSF(associatedCloud->sfShown());
+	}
+}
+
+ccSubCloud::~ccSubCloud()
+{
+	if (m_ownsCloud && m_associatedCloud)
+	{
+		//we must unlink the private copy first (otherwise it would try to materialize this sub-cloud!)
+		m_associatedCloud->removeDependencyWith(this);
+		delete m_associatedCloud;
+		m_associatedCloud = nullptr;
+	}
+}
+
+ccSubCloud* ccSubCloud::From(const CCLib::ReferenceCloud* selection, ccGenericPointCloud* sourceCloud)
+{
+	if (!selection || !sourceCloud)
+	{
+		assert(false);
+		return nullptr;
+	}
+	assert(selection->getAssociatedCloud() == static_cast<CCLib::GenericIndexedCloudPersist*>(sourceCloud));
+
+	ccPointCloud* cloud = nullptr;
+	ccSubCloud* sourceSubCloud = nullptr;
+	if (sourceCloud->isA(CC_TYPES::POINT_CLOUD))
+	{
+		cloud = ccHObjectCaster::ToPointCloud(sourceCloud);
+	}
+	else if (sourceCloud->isA(CC_TYPES::SUB_CLOUD))
+	{
+		//we directly reference the points of the original cloud
+		sourceSubCloud = ccHObjectCaster::ToSubCloud(sourceCloud);
+		cloud = sourceSubCloud->getAssociatedCloud();
+	}
+
+	if (!cloud)
+	{
+		ccLog::Warning(QString("[ccSubCloud::From] Unhandled source cloud ('%1')").arg(sourceCloud->getName()));
+		return nullptr;
+	}
+
+	ccSubCloud* subCloud = new ccSubCloud(cloud, sourceCloud->getName() + QString(".extract"));
+
+	unsigned count = selection->size();
+	if (!subCloud->reserve(count))
+	{
+		ccLog::Warning("[ccSubCloud::From] Not enough memory!");
+		delete subCloud;
+		return nullptr;
+	}
+
+	for (unsigned i = 0; i < count; ++i)
+	{
+		unsigned index = selection->getPointGlobalIndex(i);
+		subCloud->m_pointIndexes.push_back(sourceSubCloud ? sourceSubCloud->getPointGlobalIndex(index) : index);
+	}
+
+	subCloud->importParametersFrom(sourceCloud);
+	subCloud->setDisplay(sourceCloud->getDisplay());
+	subCloud->showColors(sourceCloud->colorsShown());
+	subCloud->showNormals(sourceCloud->normalsShown());
+	subCloud->showSF(sourceCloud->sfShown());
+
+	//the private copy of a materialized sub-cloud can't be shared
+	if (sourceSubCloud && sourceSubCloud->isMaterialized() && !subCloud->materialize())
+	{
+		delete subCloud;
+		return nullptr;
+	}
+
+	return subCloud;
+}
+
+void ccSubCloud::setAssociatedCloud(ccPointCloud* cloud, bool unlinkPreviousOne/*=true*/)
+{
+	if (m_associatedCloud == cloud)
+		return;
+
+	if (m_associatedCloud && unlinkPreviousOne)
+	{
+		m_associatedCloud->removeDependencyWith(this);
+		if (m_ownsCloud)
+		{
+			delete m_associatedCloud;
+		}
+	}
+
+	m_associatedCloud = cloud;
+	m_ownsCloud = false;
+	m_bBox.setValidity(false);
+
+	if (m_associatedCloud)
+		m_associatedCloud->addDependency(this, DP_NOTIFY_OTHER_ON_UPDATE);
+}
+
+bool ccSubCloud::materialize()
+{
+	if (m_ownsCloud)
+	{
+		//already done
+		return true;
+	}
+
+	if (m_pointIndexes.empty())
+	{
+		//nothing to copy
+		setAssociatedCloud(nullptr);
+		return true;
+	}
+
+	if (!m_associatedCloud)
+	{
+		assert(false);
+		return false;
+	}
+
+	CCLib::ReferenceCloud selection(m_associatedCloud);
+	if (!selection.reserve(size()))
+	{
+		ccLog::Warning(QString("[ccSubCloud::materialize] Not enough memory to copy the points of '%1'").arg(getName()));
+		return false;
+	}
+	for (unsigned globalIndex : m_pointIndexes)
+	{
+		selection.addPointIndex(globalIndex);
+	}
+
+	ccPointCloud* copy = m_associatedCloud->partialClone(&selection);
+	if (!copy)
+	{
+		ccLog::Warning(QString("[ccSubCloud::materialize] Not enough memory to copy the points of '%1'").arg(getName()));
+		return false;
+	}
+
+	//the copy keeps the points order
+	for (unsigned i = 0; i < size(); ++i)
+	{
+		m_pointIndexes[i] = i;
+	}
+
+	setAssociatedCloud(copy);
+	m_ownsCloud = true;
+
+	return true;
+}
+
+bool ccSubCloud::addPointIndex(unsigned globalIndex)
+{
+	try
+	{
+		m_pointIndexes.emplace_back(globalIndex);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not engough memory
+		return false;
+	}
+
+	m_bBox.setValidity(false);
+
+	return true;
+}
+
+bool ccSubCloud::reserve(unsigned n)
+{
+	try
+	{
+		m_pointIndexes.reserve(n);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not engough memory
+		return false;
+	}
+	return true;
+}
+
+void ccSubCloud::onUpdateOf(ccHObject* obj)
+{
+	if (obj == m_associatedCloud)
+		m_bBox.setValidity(false);
+}
+
+#define CC_SUB_CLOUD_TRANSIENT_CONST_TEST(method) bool ccSubCloud::method() const { return m_associatedCloud ? m_associatedCloud->method() : false; }
+
+CC_SUB_CLOUD_TRANSIENT_CONST_TEST(hasColors);
+CC_SUB_CLOUD_TRANSIENT_CONST_TEST(hasNormals);
+CC_SUB_CLOUD_TRANSIENT_CONST_TEST(hasScalarFields);
+CC_SUB_CLOUD_TRANSIENT_CONST_TEST(hasDisplayedScalarField);
+CC_SUB_CLOUD_TRANSIENT_CONST_TEST(isScalarFieldEnabled);
+
+ccGenericPointCloud* ccSubCloud::clone(ccGenericPointCloud* destCloud/*=nullptr*/, bool ignoreChildren/*=false*/)
+{
+	if (destCloud)
+	{
+		ccLog::Error("[ccSubCloud::clone] A sub-cloud can't be cloned in an existing cloud");
+		return nullptr;
+	}
+
+	if (!m_associatedCloud || m_pointIndexes.empty())
+	{
+		ccLog::Warning(QString("[ccSubCloud::clone] Sub-cloud '%1' is empty").arg(getName()));
+		return nullptr;
+	}
+
+	CCLib::ReferenceCloud selection(m_associatedCloud);
+	if (!selection.reserve(size()))
+	{
+		ccLog::Error("[ccSubCloud::clone] Not enough memory!");
+		return nullptr;
+	}
+	for (unsigned globalIndex : m_pointIndexes)
+	{
+		selection.addPointIndex(globalIndex);
+	}
+
+	ccPointCloud* cloud = m_associatedCloud->partialClone(&selection);
+	if (!cloud)
+	{
+		ccLog::Error("[ccSubCloud::clone] Not enough memory!");
+		return nullptr;
+	}
+
+	cloud->setName(getName() + QString(".clone"));
+	cloud->importParametersFrom(this);
+	cloud->setDisplay(getDisplay());
+	cloud->showColors(colorsShown());
+	cloud->showNormals(normalsShown());
+	cloud->showSF(sfShown());
+	cloud->setVisible(isVisible());
+	cloud->setEnabled(isEnabled());
+
+	return cloud;
+}
+
+void ccSubCloud::clear()
+{
+	setAssociatedCloud(nullptr);
+
+	m_pointIndexes.clear();
+	m_pointIndexes.shrink_to_fit();
+	m_globalIterator = 0;
+	m_bBox.setValidity(false);
+
+	ccGenericPointCloud::clear();
+
+	notifyGeometryUpdate();
+}
+
+const ccColor::Rgb* ccSubCloud::geScalarValueColor(ScalarType d) const
+{
+	assert(m_associatedCloud);
+	return m_associatedCloud->geScalarValueColor(d);
+}
+
+const ccColor::Rgb* ccSubCloud::getPointScalarValueColor(unsigned pointIndex) const
+{
+	assert(m_associatedCloud && pointIndex < size());
+	return m_associatedCloud->getPointScalarValueColor(m_pointIndexes[pointIndex]);
+}
+
+ScalarType ccSubCloud::getPointDisplayedDistance(unsigned pointIndex) const
+{
+	assert(m_associatedCloud && pointIndex < size());
+	return m_associatedCloud->getPointDisplayedDistance(m_pointIndexes[pointIndex]);
+}
+
+const ccColor::Rgb& ccSubCloud::getPointColor(unsigned pointIndex) const
+{
+	assert(m_associatedCloud && pointIndex < size());
+	return m_associatedCloud->getPointColor(m_pointIndexes[pointIndex]);
+}
+
+const CompressedNormType& ccSubCloud::getPointNormalIndex(unsigned pointIndex) const
+{
+	assert(m_associatedCloud && pointIndex < size());
+	return m_associatedCloud->getPointNormalIndex(m_pointIndexes[pointIndex]);
+}
+
+const CCVector3& ccSubCloud::getPointNormal(unsigned pointIndex) const
+{
+	assert(m_associatedCloud && pointIndex < size());
+	return m_associatedCloud->getPointNormal(m_pointIndexes[pointIndex]);
+}
+
+void ccSubCloud::refreshBB()
+{
+	m_bBox.clear();
+
+	if (m_associatedCloud)
+	{
+		for (unsigned globalIndex : m_pointIndexes)
+		{
+			m_bBox.add(*m_associatedCloud->getPoint(globalIndex));
+		}
+	}
+
+	notifyGeometryUpdate();
+}
+
+ccBBox ccSubCloud::getOwnBB(bool withGLFeatures/*=false*/)
+{
+	//force BB refresh if necessary
+	if (!m_bBox.isValid() && size() != 0)
+	{
+		refreshBB();
+	}
+
+	return m_bBox;
+}
+
+void ccSubCloud::getBoundingBox(CCVector3& bbMin, CCVector3& bbMax)
+{
+	//force BB refresh if necessary
+	if (!m_bBox.isValid() && size() != 0)
+	{
+		refreshBB();
+	}
+
+	bbMin = m_bBox.minCorner();
+	bbMax = m_bBox.maxCorner();
+}
+
+ccGenericPointCloud* ccSubCloud::createNewCloudFromVisibilitySelection(bool removeSelectedPoints/*=false*/, VisibilityTableType* visTable/*=nullptr*/)
+{
+	if (!visTable)
+	{
+		if (!isVisibilityTableInstantiated())
+		{
+			ccLog::Error(QString("[Sub-cloud %1] Visibility table not instantiated!").arg(getName()));
+			return nullptr;
+		}
+		visTable = &m_pointsVisibility;
+	}
+	else
+	{
+		if (visTable->size() != size())
+		{
+			ccLog::Error(QString("[Sub-cloud %1] Invalid input visibility table").arg(getName()));
+			return nullptr;
+		}
+	}
+
+	//we only need to select the references of the "visible" points
+	ccSubCloud* result = nullptr;
+	{
+		CCLib::ReferenceCloud* rc = getTheVisiblePoints(visTable);
+		if (!rc)
+		{
+			//a warning message has already been issued by getTheVisiblePoints!
+			return nullptr;
+		}
+
+		result = From(rc, this);
+
+		delete rc;
+		rc = nullptr;
+	}
+
+	if (!result)
+	{
+		ccLog::Warning("[ccSubCloud] Failed to generate a subset cloud");
+		return nullptr;
+	}
+
+	result->setName(getName() + QString(".segmented"));
+
+	//shall the visible points be removed from this sub-cloud?
+	if (removeSelectedPoints && !isLocked())
+	{
+		deleteOctree();
+
+		//the points themselves are left untouched
+		unsigned count = size();
+		unsigned lastPoint = 0;
+		for (unsigned i = 0; i < count; ++i)
+		{
+			if (visTable->at(i) != POINT_VISIBLE)
+			{
+				m_pointIndexes[lastPoint++] = m_pointIndexes[i];
+			}
+		}
+		m_pointIndexes.resize(lastPoint);
+
+		unallocateVisibilityArray();
+		m_bBox.setValidity(false);
+		notifyGeometryUpdate();
+	}
+
+	return result;
+}
+
+void ccSubCloud::applyGLTransformation(const ccGLMatrix& trans)
+{
+	if (!m_ownsCloud && m_associatedCloud && m_associatedCloud->isAncestorOf(this))
+	{
+		//the associated cloud has already been transformed (see ccHObject::applyGLTransformation_recursive)
+		ccGenericPointCloud::applyGLTransformation(trans);
+		deleteOctree();
+		m_bBox.setValidity(false);
+		return;
+	}
+
+	applyRigidTransformation(trans);
+}
+
+void ccSubCloud::applyRigidTransformation(const ccGLMatrix& trans)
+{
+	//copy-on-write
+	if (!materialize())
+	{
+		ccLog::Warning(QString("[ccSubCloud] Sub-cloud '%1' can't be transformed").arg(getName()));
+		return;
+	}
+
+	//transparent call
+	ccGenericPointCloud::applyGLTransformation(trans);
+
+	if (m_associatedCloud)
+	{
+		m_associatedCloud->applyRigidTransformation(trans);
+	}
+
+	//the octree is invalidated by rotation...
+	deleteOctree();
+
+	// ... as the bounding box
+	m_bBox.setValidity(false);
+	notifyGeometryUpdate();
+}
+
+CCLib::ReferenceCloud* ccSubCloud::crop(const ccBBox& box, bool inside/*=true*/)
+{
+	if (!box.isValid())
+	{
+		ccLog::Warning("[ccSubCloud::crop] Invalid bounding-box");
+		return nullptr;
+	}
+
+	unsigned count = size();
+	if (count == 0 || !m_associatedCloud)
+	{
+		ccLog::Warning("[ccSubCloud::crop] Cloud is empty!");
+		return nullptr;
+	}
+
+	CCLib::ReferenceCloud* ref = new CCLib::ReferenceCloud(this);
+	if (!ref->reserve(count))
+	{
+		ccLog::Warning("[ccSubCloud::crop] Not enough memory!");
+		delete ref;
+		return nullptr;
+	}
+
+	for (unsigned i = 0; i < count; ++i)
+	{
+		const CCVector3* P = m_associatedCloud->getPoint(m_pointIndexes[i]);
+		bool pointIsInside = box.contains(*P);
+		if (inside == pointIsInside)
+		{
+			ref->addPointIndex(i);
+		}
+	}
+
+	if (ref->size() == 0)
+	{
+		//no points inside selection!
+		ref->clear(true);
+	}
+	else
+	{
+		ref->resize(ref->size());
+	}
+
+	return ref;
+}
+
+void ccSubCloud::scale(PointCoordinateType fx, PointCoordinateType fy, PointCoordinateType fz, CCVector3 center/*=CCVector3(0,0,0)*/)
+{
+	//copy-on-write
+	if (!materialize())
+	{
+		ccLog::Warning(QString("[ccSubCloud] Sub-cloud '%1' can't be scaled").arg(getName()));
+		return;
+	}
+
+	if (m_associatedCloud)
+	{
+		m_associatedCloud->scale(fx, fy, fz, center);
+	}
+
+	deleteOctree();
+	m_bBox.setValidity(false);
+	notifyGeometryUpdate();
+}
+
+void ccSubCloud::forEach(genericPointAction action)
+{
+	if (!m_associatedCloud)
+		return;
+
+	unsigned count = size();
+	for (unsigned i = 0; i < count; ++i)
+	{
+		ScalarType d = m_associatedCloud->getPointScalarValue(m_pointIndexes[i]);
+		ScalarType d2 = d;
+		action(*m_associatedCloud->getPointPersistentPtr(m_pointIndexes[i]), d2);
+		if (d != d2)
+		{
+			//copy-on-write (the indexes are preserved)
+			if (!m_ownsCloud && !materialize())
+				return;
+			m_associatedCloud->setPointScalarValue(m_pointIndexes[i], d2);
+		}
+	}
+}
+
+const CCVector3* ccSubCloud::getNextPoint()
+{
+	return (m_associatedCloud && m_globalIterator < size() ? m_associatedCloud->getPoint(m_pointIndexes[m_globalIterator++]) : nullptr);
+}
+
+bool ccSubCloud::enableScalarField()
+{
+	//copy-on-write: the scalar field is allocated in the private copy
+	if (!materialize() || !m_associatedCloud)
+		return false;
+
+	return m_associatedCloud->enableScalarField();
+}
+
+void ccSubCloud::setPointScalarValue(unsigned pointIndex, ScalarType value)
+{
+	assert(pointIndex < size());
+
+	//copy-on-write
+	if (!m_ownsCloud && !materialize())
+		return;
+
+	if (m_associatedCloud)
+		m_associatedCloud->setPointScalarValue(m_pointIndexes[pointIndex], value);
+}
+
+ScalarType ccSubCloud::getPointScalarValue(unsigned pointIndex) const
+{
+	assert(m_associatedCloud && pointIndex < size());
+	return m_associatedCloud->getPointScalarValue(m_pointIndexes[pointIndex]);
+}
+
+const CCVector3* ccSubCloud::getPoint(unsigned index)
+{
+	assert(m_associatedCloud && index < size());
+	return m_associatedCloud->getPoint(m_pointIndexes[index]);
+}
+
+void ccSubCloud::getPoint(unsigned index, CCVector3& P) const
+{
+	assert(m_associatedCloud && index < size());
+	m_associatedCloud->getPoint(m_pointIndexes[index], P);
+}
+
+const CCVector3* ccSubCloud::getPointPersistentPtr(unsigned index)
+{
+	assert(m_associatedCloud && index < size());
+	return m_associatedCloud->getPointPersistentPtr(m_pointIndexes[index]);
+}
+
+//! Max number of points per draw call
+static const unsigned MAX_POINT_COUNT_PER_DRAW_CALL = (1 << 16);
+//! Display buffers
+static CCVector3 s_pointBuffer[MAX_POINT_COUNT_PER_DRAW_CALL];
+static CCVector3 s_normalBuffer[MAX_POINT_COUNT_PER_DRAW_CALL];
+static ccColor::Rgb s_colorBuffer[MAX_POINT_COUNT_PER_DRAW_CALL];
+
+static GLenum GL_COORD_TYPE = sizeof(PointCoordinateType) == 4 ? GL_FLOAT : GL_DOUBLE;
+
+void ccSubCloud::drawMeOnly(CC_DRAW_CONTEXT& context)
+{
+	if (!m_associatedCloud || m_pointIndexes.empty())
+		return;
+
+	//get the set of OpenGL functions (version 2.1)
+	QOpenGLFunctions_2_1* glFunc = context.glFunctions<QOpenGLFunctions_2_1>();
+	assert(glFunc != nullptr);
+
+	if (glFunc == nullptr)
+		return;
+
+	if (MACRO_Draw3D(context))
+	{
+		//we get display parameters
+		glDrawParams glParams;
+		getDrawingParameters(glParams);
+		//no normals shading without light!
+		if (!MACRO_LightIsEnabled(context))
+		{
+			glParams.showNorms = false;
+		}
+
+		//the displayed scalar field is the one of the associated cloud
+		ccScalarField* sf = (glParams.showSF ? m_associatedCloud->getCurrentDisplayedScalarField() : nullptr);
+		glParams.showSF = (sf != nullptr);
+
+		//standard case: list names pushing
+		bool pushName = MACRO_DrawEntityNames(context);
+		if (pushName)
+		{
+			//not fast at all!
+			if (MACRO_DrawFastNamesOnly(context))
+			{
+				return;
+			}
+
+			glFunc->glPushName(getUniqueIDForDisplay());
+			//minimal display for picking mode!
+			glParams.showNorms = false;
+			glParams.showColors = false;
+			if (glParams.showSF && sf->areNaNValuesShownInGrey())
+			{
+				glParams.showSF = false; //--> we keep it only if SF 'NaN' values are potentially hidden
+			}
+		}
+
+		//decimation (no LoD structure for sub-clouds)
+		unsigned count = size();
+		unsigned decimStep = 1;
+		if (	!pushName
+			&&	context.decimateCloudOnMove
+			&&	count > context.minLODPointCount
+			&&	MACRO_LODActivated(context)
+			)
+		{
+			//we can only display points at level 0!
+			if (context.currentLODLevel != 0)
+			{
+				return;
+			}
+			if (context.minLODPointCount)
+			{
+				decimStep = static_cast<unsigned>(ceil(static_cast<float>(count) / context.minLODPointCount));
+			}
+		}
+
+		bool colorMaterialEnabled = false;
+
+		if (glParams.showSF || glParams.showColors)
+		{
+			glFunc->glColorMaterial(GL_FRONT_AND_BACK, GL_DIFFUSE);
+			glFunc->glEnable(GL_COLOR_MATERIAL);
+			colorMaterialEnabled = true;
+		}
+
+		if (glParams.showColors && isColorOverriden())
+		{
+			ccGL::Color3v(glFunc, m_tempColor.rgb);
+			glParams.showColors = false;
+		}
+		else
+		{
+			ccGL::Color3v(glFunc, context.pointsDefaultCol.rgb);
+		}
+
+		//in the case we need normals (i.e. lighting)
+		if (glParams.showNorms)
+		{
+			glFunc->glEnable(GL_RESCALE_NORMAL);
+			glFunc->glMaterialfv(GL_FRONT_AND_BACK,	GL_AMBIENT,		CC_DEFAULT_CLOUD_AMBIENT_COLOR.rgba  );
+			glFunc->glMaterialfv(GL_FRONT_AND_BACK,	GL_SPECULAR,	CC_DEFAULT_CLOUD_SPECULAR_COLOR.rgba );
+			glFunc->glMaterialfv(GL_FRONT_AND_BACK,	GL_DIFFUSE,		CC_DEFAULT_CLOUD_DIFFUSE_COLOR.rgba  );
+			glFunc->glMaterialfv(GL_FRONT_AND_BACK,	GL_EMISSION,	CC_DEFAULT_CLOUD_EMISSION_COLOR.rgba );
+			glFunc->glMaterialf (GL_FRONT_AND_BACK,	GL_SHININESS,	CC_DEFAULT_CLOUD_SHININESS);
+			glFunc->glEnable(GL_LIGHTING);
+
+			if (glParams.showSF)
+			{
+				//we must get rid of lights 'color' if a scalar field is displayed!
+				glFunc->glPushAttrib(GL_LIGHTING_BIT);
+				ccMaterial::MakeLightsNeutral(context.qGLContext);
+			}
+		}
+
+		/*** DISPLAY ***/
+
+		glFunc->glPushAttrib(GL_COLOR_BUFFER_BIT | GL_POINT_BIT);
+
+		//rounded points
+		if (context.drawRoundedPoints)
+		{
+			glFunc->glDisable(GL_BLEND);
+			glFunc->glEnable(GL_POINT_SMOOTH);
+		}
+
+		//custom point size?
+		if (m_pointSize != 0)
+		{
+			glFunc->glPointSize(static_cast<GLfloat>(m_pointSize));
+		}
+
+		//the points are gathered in chunks (as they are not contiguous in memory)
+		{
+			//if some points are hidden (= visibility table instantiated), we must test each point
+			const VisibilityTableType* visTable = (isVisibilityTableInstantiated() ? &m_pointsVisibility : nullptr);
+
+			glFunc->glEnableClientState(GL_VERTEX_ARRAY);
+			glFunc->glVertexPointer(3, GL_COORD_TYPE, 0, s_pointBuffer);
+			if (glParams.showNorms)
+			{
+				glFunc->glEnableClientState(GL_NORMAL_ARRAY);
+				glFunc->glNormalPointer(GL_COORD_TYPE, 0, s_normalBuffer);
+			}
+			if (glParams.showSF || glParams.showColors)
+			{
+				glFunc->glEnableClientState(GL_COLOR_ARRAY);
+				glFunc->glColorPointer(3, GL_UNSIGNED_BYTE, 0, s_colorBuffer);
+			}
+
+			unsigned chunkSize = 0;
+			for (unsigned i = 0; i < count; i += decimStep)
+			{
+				if (visTable && visTable->at(i) != POINT_VISIBLE)
+				{
+					continue;
+				}
+
+				unsigned globalIndex = m_pointIndexes[i];
+				if (glParams.showSF)
+				{
+					const ccColor::Rgb* col = sf->getValueColor(globalIndex);
+					if (!col)
+					{
+						//points hidden because of their scalar field value are only
+						//displayed (in grey) if the visibility table is instantiated
+						//(to be sure that the user doesn't miss them during manual segmentation for instance)
+						if (!visTable)
+						{
+							continue;
+						}
+						col = &ccColor::lightGrey;
+					}
+					s_colorBuffer[chunkSize] = *col;
+				}
+				else if (glParams.showColors)
+				{
+					s_colorBuffer[chunkSize] = m_associatedCloud->getPointColor(globalIndex);
+				}
+				if (glParams.showNorms)
+				{
+					s_normalBuffer[chunkSize] = m_associatedCloud->getPointNormal(globalIndex);
+				}
+				m_associatedCloud->getPoint(globalIndex, s_pointBuffer[chunkSize]);
+
+				if (++chunkSize == MAX_POINT_COUNT_PER_DRAW_CALL)
+				{
+					glFunc->glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(chunkSize));
+					chunkSize = 0;
+				}
+			}
+
+			if (chunkSize != 0)
+			{
+				glFunc->glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(chunkSize));
+			}
+
+			glFunc->glDisableClientState(GL_VERTEX_ARRAY);
+			if (glParams.showNorms)
+				glFunc->glDisableClientState(GL_NORMAL_ARRAY);
+			if (glParams.showSF || glParams.showColors)
+				glFunc->glDisableClientState(GL_COLOR_ARRAY);
+		}
+
+		/*** END DISPLAY ***/
+
+		if (context.drawRoundedPoints)
+		{
+			glFunc->glDisable(GL_POINT_SPRITE);
+		}
+		glFunc->glPopAttrib(); //GL_COLOR_BUFFER_BIT | GL_POINT_BIT
+
+		if (colorMaterialEnabled)
+		{
+			glFunc->glDisable(GL_COLOR_MATERIAL);
+		}
+
+		//we can now switch the light off
+		if (glParams.showNorms)
+		{
+			if (glParams.showSF)
+			{
+				glFunc->glPopAttrib(); //GL_LIGHTING_BIT
+			}
+
+			glFunc->glDisable(GL_RESCALE_NORMAL);
+			glFunc->glDisable(GL_LIGHTING);
+		}
+
+		if (pushName)
+		{
+			glFunc->glPopName();
+		}
+	}
+	else if (MACRO_Draw2D(context))
+	{
+		if (MACRO_Foreground(context) && !context.sfColorScaleToDisplay)
+		{
+			if (m_associatedCloud->sfColorScaleShown() && sfShown() && hasDisplayedScalarField())
+			{
+				m_associatedCloud->addColorRampInfo(context);
+			}
+		}
+	}
+}
+
+bool ccSubCloud::toFile_MeOnly(QFile& out) const
+{
+	if (!ccGenericPointCloud::toFile_MeOnly(out))
+		return false;
+
+	//whether the associated cloud is a private copy (dataVersion>=48)
+	bool ownsCloud = (m_ownsCloud && m_associatedCloud);
+	if (out.write((const char*)&ownsCloud, sizeof(bool)) < 0)
+		return WriteError();
+
+	if (ownsCloud)
+	{
+		//the private copy is saved along with the sub-cloud
+		if (!m_associatedCloud->toFile(out))
+			return false;
+	}
+	else
+	{
+		//we can't save the associated cloud here (as it may already be saved)
+		//so instead we save it's unique ID (dataVersion>=48)
+		//WARNING: the cloud must be saved in the same BIN file! (responsibility of the caller)
+		uint32_t cloudUniqueID = (m_associatedCloud ? static_cast<uint32_t>(m_associatedCloud->getUniqueID()) : 0);
+		if (out.write((const char*)&cloudUniqueID, 4) < 0)
+			return WriteError();
+	}
+
+	//references (dataVersion>=48)
+	if (!ccSerializationHelper::GenericArrayToFile<unsigned, 1, unsigned>(m_pointIndexes, out))
+		return WriteError();
+
+	return true;
+}
+
+bool ccSubCloud::fromFile_MeOnly(QFile& in, short dataVersion, int flags)
+{
+	if (!ccGenericPointCloud::fromFile_MeOnly(in, dataVersion, flags))
+		return false;
+
+	if (dataVersion < 48)
+		return CorruptError();
+
+	//whether the associated cloud is a private copy (dataVersion>=48)
+	bool ownsCloud = false;
+	if (in.read((char*)&ownsCloud, sizeof(bool)) < 0)
+		return ReadError();
+
+	if (ownsCloud)
+	{
+		CC_CLASS_ENUM classID = ReadClassIDFromFile(in, dataVersion);
+		if (classID != CC_TYPES::POINT_CLOUD)
+			return CorruptError();
+
+		ccPointCloud* cloud = new ccPointCloud();
+		if (!cloud->fromFile(in, dataVersion, flags))
+		{
+			delete cloud;
+			return false;
+		}
+		//the private copy is not part of the DB tree (its unique ID won't be updated by the caller)
+		cloud->setUniqueID(GetNextUniqueID());
+		setAssociatedCloud(cloud);
+		m_ownsCloud = true;
+	}
+	else
+	{
+		//as the associated cloud can't be saved directly
+		//we only store its unique ID (dataVersion>=48) --> we hope we will find it at loading time (i.e. this
+		//is the responsibility of the caller to make sure that all dependencies are saved together)
+		uint32_t cloudUniqueID = 0;
+		if (in.read((char*)&cloudUniqueID, 4) < 0)
+			return ReadError();
+		//[DIRTY] WARNING: temporarily, we set the cloud unique ID in the 'm_associatedCloud' pointer!!!
+		*(uint32_t*)(&m_associatedCloud) = cloudUniqueID;
+	}
+
+	//references (dataVersion>=48)
+	if (!ccSerializationHelper::GenericArrayFromFile<unsigned, 1, unsigned>(m_pointIndexes, in, dataVersion))
+		return ReadError();
+
+	return true;
+}
@@ -0,0 +1,157 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_SUB_CLOUD_HEADER
+#define CC_SUB_CLOUD_HEADER
+
+//Local
+#include "ccGenericPointCloud.h"
+#include "ccBBox.h"
+
+class ccPointCloud;
+
+//! A sub-cloud (i.e. a view on a subset of the points of a cloud)
+/** Equivalent to a CCLib::ReferenceCloud for a ccPointCloud: only the indexes of the points
+	are stored. The coordinates, colors, normals and scalar fields are read from the associated
+	cloud (and the currently displayed scalar field of the associated cloud is displayed).
+
+	Copy-on-write: editing a sub-cloud (transformation, scaling, scalar values) first replaces
+	the associated cloud by a private copy of the referenced points. The associated cloud does
+	the same for its sub-clouds before removing points or being deleted.
+**/
+class QCC_DB_LIB_API ccSubCloud : public ccGenericPointCloud
+{
+public:
+
+	//! Default constructor
+	explicit ccSubCloud(ccPointCloud* associatedCloud, QString name = QString());
+	//! Destructor
+	~ccSubCloud() override;
+
+	//! Creates a sub-cloud from a selection
+	/** If the source cloud is itself a sub-cloud, the new sub-cloud is directly
+		associated to the same cloud (i.e. the indexes are composed).
+		\param selection the selected points
+		\param sourceCloud the cloud on which the selection is based
+		\return the sub-cloud (or nullptr if not enough memory)
+	**/
+	static ccSubCloud* From(const CCLib::ReferenceCloud* selection, ccGenericPointCloud* sourceCloud);
+
+	//! Returns class ID
+	CC_CLASS_ENUM getClassID() const override { return CC_TYPES::SUB_CLOUD; }
+
+	//! Returns the associated cloud
+	/** \warning Once the sub-cloud has been materialized, this is its private copy.
+	**/
+	inline ccPointCloud* getAssociatedCloud() const { return m_associatedCloud; }
+
+	//! Sets the associated cloud
+	/** \param cloud parent cloud
+		\param unlinkPreviousOne whether to remove any dependency with the previous cloud (if any)
+	**/
+	void setAssociatedCloud(ccPointCloud* cloud, bool unlinkPreviousOne = true);
+
+	//! Returns whether the sub-cloud has its own copy of the points
+	inline bool isMaterialized() const { return m_ownsCloud; }
+
+	//! Replaces the associated cloud by a private copy of the referenced points
+	/** Called automatically before any modification of the sub-cloud (copy-on-write).
+		\return false if not enough memory
+	**/
+	bool materialize();
+
+	//! Returns the global index (i.e. relative to the associated cloud) of a given point
+	inline unsigned getPointGlobalIndex(unsigned localIndex) const { return m_pointIndexes[localIndex]; }
+
+	//! Point global index insertion mechanism
+	/** \param globalIndex a point global index
+		\return false if not enough memory
+	**/
+	bool addPointIndex(unsigned globalIndex);
+
+	//! Reserves some memory for hosting the point references
+	bool reserve(unsigned n);
+
+	//inherited methods (ccHObject)
+	ccBBox getOwnBB(bool withGLFeatures = false) override;
+
+	//inherited methods (ccDrawableObject)
+	bool hasColors() const override;
+	bool hasNormals() const override;
+	bool hasScalarFields() const override;
+	bool hasDisplayedScalarField() const override;
+
+	//inherited methods (ccGenericPointCloud)
+	/** \warning Returns a standard (i.e. standalone) ccPointCloud with a copy of the points.
+	**/
+	ccGenericPointCloud* clone(ccGenericPointCloud* destCloud = nullptr, bool ignoreChildren = false) override;
+	void clear() override;
+	const ccColor::Rgb* geScalarValueColor(ScalarType d) const override;
+	const ccColor::Rgb* getPointScalarValueColor(unsigned pointIndex) const override;
+	ScalarType getPointDisplayedDistance(unsigned pointIndex) const override;
+	const ccColor::Rgb& getPointColor(unsigned pointIndex) const override;
+	const CompressedNormType& getPointNormalIndex(unsigned pointIndex) const override;
+	const CCVector3& getPointNormal(unsigned pointIndex) const override;
+	void refreshBB() override;
+	ccGenericPointCloud* createNewCloudFromVisibilitySelection(bool removeSelectedPoints = false, VisibilityTableType* visTable = nullptr) override;
+	void applyRigidTransformation(const ccGLMatrix& trans) override;
+	CCLib::ReferenceCloud* crop(const ccBBox& box, bool inside = true) override;
+	void scale(PointCoordinateType fx, PointCoordinateType fy, PointCoordinateType fz, CCVector3 center = CCVector3(0, 0, 0)) override;
+
+	//inherited methods (GenericIndexedCloudPersist)
+	inline unsigned size() const override { return static_cast<unsigned>(m_pointIndexes.size()); }
+	void forEach(genericPointAction action) override;
+	void getBoundingBox(CCVector3& bbMin, CCVector3& bbMax) override;
+	inline void placeIteratorAtBeginning() override { m_globalIterator = 0; }
+	const CCVector3* getNextPoint() override;
+	bool enableScalarField() override;
+	bool isScalarFieldEnabled() const override;
+	void setPointScalarValue(unsigned pointIndex, ScalarType value) override;
+	ScalarType getPointScalarValue(unsigned pointIndex) const override;
+	const CCVector3* getPoint(unsigned index) override;
+	void getPoint(unsigned index, CCVector3& P) const override;
+	const CCVector3* getPointPersistentPtr(unsigned index) override;
+
+protected:
+
+	//inherited from ccHObject
+	void drawMeOnly(CC_DRAW_CONTEXT& context) override;
+	void applyGLTransformation(const ccGLMatrix& trans) override;
+	bool toFile_MeOnly(QFile& out) const override;
+	bool fromFile_MeOnly(QFile& in, short dataVersion, int flags) override;
+	void onUpdateOf(ccHObject* obj) override;
+
+	//! Associated cloud
+	ccPointCloud* m_associatedCloud;
+
+	//! Whether the associated cloud is a private copy (owned by this sub-cloud)
+	bool m_ownsCloud;
+
+	//! Container of point indexes
+	typedef std::vector<unsigned> ReferencesContainer;
+
+	//! Indexes of (some of) the associated cloud points
+	ReferencesContainer m_pointIndexes;
+
+	//! Iterator on the points references container
+	unsigned m_globalIterator;
+
+	//! Bounding-box
+	ccBBox m_bBox;
+};
+
+#endif //CC_SUB_CLOUD_HEADER
@@ -51,6 +51,23 @@ AsciiSaveDlg* AsciiFilter::GetSaveDialog(QWidget* parentWidget/*=0*/)
 	return s_saveDialog.ptr;
 }
 
+AsciiFilter::SaveOptions AsciiFilter::GetSaveOptions()
+{
+	AsciiSaveDlg* saveDialog = GetSaveDialog();
+	assert(saveDialog);
+
+	SaveOptions options;
+	options.coordsPrecision = saveDialog->coordsPrecision();
+	options.sfPrecision = saveDialog->sfPrecision();
+	options.separator = saveDialog->getSeparator();
+	options.swapColorAndSF = saveDialog->swapColorAndSF();
+	options.saveColumnsNamesHeader = saveDialog->saveColumnsNamesHeader();
+	options.savePointCountHeader = saveDialog->savePointCountHeader();
+	options.saveFloatColors = saveDialog->saveFloatColors();
+
+	return options;
+}
+
 AsciiOpenDlg* AsciiFilter::GetOpenDialog(QWidget* parentWidget/*=0*/)
 {
 	if (!s_openDialog.ptr)
@@ -97,6 +114,13 @@ CC_FILE_ERROR AsciiFilter::saveToFile(ccHObject* entity, const QString& filename
 		return CC_FERR_CANCELED_BY_USER;
 	}
 
+	return saveToFile(entity, filename, GetSaveOptions(), parameters.parentWidget);
+}
+
+CC_FILE_ERROR AsciiFilter::saveToFile(ccHObject* entity, const QString& filename, const SaveOptions& options, QWidget* parentWidget/*=nullptr*/)
+{
+	assert(entity && !filename.isEmpty());
+
 	if (!entity->isKindOf(CC_TYPES::POINT_CLOUD))
 	{
 		if (entity->isA(CC_TYPES::HIERARCHY_OBJECT)) //multiple clouds?
@@ -122,12 +146,6 @@ CC_FILE_ERROR AsciiFilter::saveToFile(ccHObject* entity, const QString& filename
 			if (cloudCount > 1)
 			{
 				unsigned counter = 0;
-				//disable the save dialog so that it doesn't appear again!
-				AsciiSaveDlg* saveDialog = GetSaveDialog();
-				assert(saveDialog);
-
-				bool autoShow = saveDialog->autoShow();
-				saveDialog->setAutoShow(false);
 
 				for (unsigned i=0; i<count; ++i)
 				{
@@ -142,7 +160,7 @@ CC_FILE_ERROR AsciiFilter::saveToFile(ccHObject* entity, const QString& filename
 						if (!extension.isEmpty())
 							subFilename += QString(".") + extension;
 						
-						CC_FILE_ERROR result = saveToFile(entity->getChild(i),subFilename,parameters);
+						CC_FILE_ERROR result = saveToFile(entity->getChild(i), subFilename, options, parentWidget);
 						if (result != CC_FERR_NO_ERROR)
 						{
 							return result;
@@ -158,9 +176,6 @@ CC_FILE_ERROR AsciiFilter::saveToFile(ccHObject* entity, const QString& filename
 					}
 				}
 
-				//restore previous state
-				saveDialog->setAutoShow(autoShow);
-
 				return CC_FERR_NO_ERROR;
 			}
 		}
@@ -181,7 +196,7 @@ CC_FILE_ERROR AsciiFilter::saveToFile(ccHObject* entity, const QString& filename
 	bool writeColors = cloud->hasColors();
 	bool writeNorms = cloud->hasNormals();
 	std::vector<ccScalarField*> theScalarFields;
-	if (cloud->isKindOf(CC_TYPES::POINT_CLOUD))
+	if (cloud->isA(CC_TYPES::POINT_CLOUD))
 	{
 		ccPointCloud* ccCloud = static_cast<ccPointCloud*>(cloud);
 		for (unsigned i = 0; i < ccCloud->getNumberOfScalarFields(); ++i)
@@ -191,9 +206,9 @@ CC_FILE_ERROR AsciiFilter::saveToFile(ccHObject* entity, const QString& filename
 
 	//progress dialog
 	QScopedPointer<ccProgressDialog> pDlg(nullptr);
-	if (parameters.parentWidget)
+	if (parentWidget)
 	{
-		pDlg.reset(new ccProgressDialog(true, parameters.parentWidget));
+		pDlg.reset(new ccProgressDialog(true, parentWidget));
 		pDlg->setMethodTitle(QObject::tr("Saving cloud [%1]").arg(cloud->getName()));
 		pDlg->setInfo(QObject::tr("Number of points: %1").arg(numberOfPoints));
 		pDlg->start();
@@ -201,16 +216,16 @@ CC_FILE_ERROR AsciiFilter::saveToFile(ccHObject* entity, const QString& filename
 	CCLib::NormalizedProgress nprogress(pDlg.data(), numberOfPoints);
 
 	//output precision
-	const int s_coordPrecision = saveDialog->coordsPrecision();
-	const int s_sfPrecision = saveDialog->sfPrecision(); 
+	const int s_coordPrecision = options.coordsPrecision;
+	const int s_sfPrecision = options.sfPrecision;
 	const int s_nPrecision = 2+sizeof(PointCoordinateType);
 
 	//other parameters
-	bool saveColumnsHeader = saveDialog->saveColumnsNamesHeader();
-	bool savePointCountHeader = saveDialog->savePointCountHeader();
-	bool swapColorAndSFs = saveDialog->swapColorAndSF();
-	QChar separator(saveDialog->getSeparator());
-	bool saveFloatColors = saveDialog->saveFloatColors();
+	bool saveColumnsHeader = options.saveColumnsNamesHeader;
+	bool savePointCountHeader = options.savePointCountHeader;
+	bool swapColorAndSFs = options.swapColorAndSF;
+	QChar separator(options.separator);
+	bool saveFloatColors = options.saveFloatColors;
 
 	if (saveColumnsHeader)
 	{
@@ -68,6 +68,46 @@ public:
 	//! Returns associated dialog (creates it if necessary)
 	static AsciiSaveDlg* GetSaveDialog(QWidget* parentWidget = nullptr);
 
+	//! Save options (see AsciiSaveDlg)
+	struct SaveOptions
+	{
+		//! Default constructor (same values as the dialog defaults)
+		SaveOptions()
+			: coordsPrecision(8)
+			, sfPrecision(6)
+			, separator(' ')
+			, swapColorAndSF(false)
+			, saveColumnsNamesHeader(false)
+			, savePointCountHeader(false)
+			, saveFloatColors(false)
+		{}
+
+		int coordsPrecision;
+		int sfPrecision;
+		unsigned char separator;
+		bool swapColorAndSF;
+		bool saveColumnsNamesHeader;
+		bool savePointCountHeader;
+		bool saveFloatColors;
+	};
+
+	//! Returns the current save options (i.e. the save dialog state)
+	/** \warning Must be called from the main thread (as the save dialog may be created).
+	**/
+	static SaveOptions GetSaveOptions();
+
+	//! Saves an entity with explicit options
+	/** Contrary to the standard saveToFile method, the save dialog is never used,
+		so that this method can be called from any thread.
+		\param entity entity to save (cloud or group of clouds)
+		\param filename output filename
+		\param options save options
+		\param parentWidget parent widget for the progress dialog (nullptr = no progress dialog)
+		
+eturn error code
+	**/
+	CC_FILE_ERROR saveToFile(ccHObject* entity, const QString& filename, const SaveOptions& options, QWidget* parentWidget = nullptr);
+
 protected:
 
 	//! Internal use only
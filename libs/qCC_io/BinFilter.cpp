@@ -30,6 +30,7 @@
 #include <ccProgressDialog.h>
 #include <ccMesh.h>
 #include <ccSubMesh.h>
+#include <ccSubCloud.h>
 #include <ccPolyline.h>
 #include <ccMaterialSet.h>
 #include <cc2DLabel.h>
@@ -136,6 +137,7 @@ static int ReadEntityHeader(QFile& in, unsigned &numberOfPoints, HeaderFlags& he
 static QFile* s_file = 0;
 static int s_flags = 0;
 static ccHObject* s_container = 0;
+static double s_quantizationStep = 0;
 
 CC_FILE_ERROR _LoadFileV2()
 {
@@ -144,7 +146,7 @@ CC_FILE_ERROR _LoadFileV2()
 
 CC_FILE_ERROR _SaveFileV2()
 {
-	return (s_file && s_container ? BinFilter::SaveFileV2(*s_file,s_container) : CC_FERR_BAD_ARGUMENT);
+	return (s_file && s_container ? BinFilter::SaveFileV2(*s_file, s_container, s_quantizationStep) : CC_FERR_BAD_ARGUMENT);
 }
 
 CC_FILE_ERROR BinFilter::saveToFile(ccHObject* root, const QString& filename, const SaveParameters& parameters)
@@ -156,20 +158,24 @@ CC_FILE_ERROR BinFilter::saveToFile(ccHObject* root, const QString& filename, co
 	if (!out.open(QIODevice::WriteOnly))
 		return CC_FERR_WRITING;
 
-	QScopedPointer<ccProgressDialog> pDlg(0);
-	if (parameters.parentWidget)
+	if (!parameters.parentWidget)
 	{
-		pDlg.reset(new ccProgressDialog(false, parameters.parentWidget));
-		pDlg->setMethodTitle(QObject::tr("BIN file"));
-		pDlg->setInfo(QObject::tr("Please wait... saving in progress"));
-		pDlg->setRange(0, 0);
-		pDlg->setModal(true);
-		pDlg->start();
+		//no need to keep a GUI alive: direct call
+		//(this is also safe if several files are saved concurrently)
+		return SaveFileV2(out, root, parameters.binQuantizationStep);
 	}
 
+	QScopedPointer<ccProgressDialog> pDlg(new ccProgressDialog(false, parameters.parentWidget));
+	pDlg->setMethodTitle(QObject::tr("BIN file"));
+	pDlg->setInfo(QObject::tr("Please wait... saving in progress"));
+	pDlg->setRange(0, 0);
+	pDlg->setModal(true);
+	pDlg->start();
+
 	//concurrent call
 	s_file = &out;
 	s_container = root;
+	s_quantizationStep = parameters.binQuantizationStep;
 
 	QFuture<CC_FILE_ERROR> future = QtConcurrent::run(_SaveFileV2);
 
@@ -195,11 +201,14 @@ CC_FILE_ERROR BinFilter::saveToFile(ccHObject* root, const QString& filename, co
 	return result;
 }
 
-CC_FILE_ERROR BinFilter::SaveFileV2(QFile& out, ccHObject* object)
+CC_FILE_ERROR BinFilter::SaveFileV2(QFile& out, ccHObject* object, double quantizationStep/*=0*/)
 {
 	if (!object)
 		return CC_FERR_BAD_ARGUMENT;
 
+	//the clouds are serialized by the current thread
+	ccPointCloud::BinQuantizationScope quantizationScope(quantizationStep);
+
 	//About BIN versions:
 	//- 'original' version (file starts by the number of clouds - no header)
 	//- 'new' evolutive version, starts by 4 bytes ("CCB2") + save the current ccObject version
@@ -256,6 +265,13 @@ CC_FILE_ERROR BinFilter::SaveFileV2(QFile& out, ccHObject* object)
 		{
 			dependencies.insert(currentObject->getParent());
 		}
+		else if (currentObject->isA(CC_TYPES::SUB_CLOUD))
+		{
+			ccSubCloud* subCloud = ccHObjectCaster::ToSubCloud(currentObject);
+			//a materialized sub-cloud saves its own copy of the points
+			if (!subCloud->isMaterialized() && subCloud->getAssociatedCloud())
+				dependencies.insert(subCloud->getAssociatedCloud());
+		}
 		else if (currentObject->isKindOf(CC_TYPES::POLY_LINE))
 		{
 			CCLib::GenericIndexedCloudPersist* cloud = static_cast<ccPolyline*>(currentObject)->getAssociatedCloud();
@@ -778,6 +794,32 @@ CC_FILE_ERROR BinFilter::LoadFileV2(QFile& in, ccHObject& container, int flags)
 				}
 			}
 		}
+		else if (currentObject->isA(CC_TYPES::SUB_CLOUD))
+		{
+			ccSubCloud* subCloud = ccHObjectCaster::ToSubCloud(currentObject);
+			//a materialized sub-cloud already has its own copy of the points
+			if (!subCloud->isMaterialized())
+			{
+				intptr_t cloudID = (intptr_t)subCloud->getAssociatedCloud();
+				if (cloudID > 0)
+				{
+					ccHObject* cloud = FindRobust(root, subCloud, static_cast<unsigned>(cloudID), CC_TYPES::POINT_CLOUD);
+					ccPointCloud* pc = ccHObjectCaster::ToPointCloud(cloud);
+					if (pc && pc == cloud)
+					{
+						subCloud->setAssociatedCloud(pc, false); //'false' because previous cloud is not null (= real cloud ID)!!!
+					}
+					else
+					{
+						//we have a problem here ;)
+						subCloud->setAssociatedCloud(0, false); //'false' because previous cloud is not null (= real cloud ID)!!!
+						//can't delete it, too dangerous (bad pointers ;)
+						ccLog::Warning(QString("[BIN] Couldn't find associated cloud (ID=%1) for sub-cloud '%2' in the file!").arg(cloudID).arg(subCloud->getName()));
+						return CC_FERR_MALFORMED_FILE;
+					}
+				}
+			}
+		}
 		else if (currentObject->isKindOf(CC_TYPES::POLY_LINE))
 		{
 			ccPolyline* poly = ccHObjectCaster::ToPolyline(currentObject);
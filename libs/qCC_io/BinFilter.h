@@ -47,7 +47,7 @@ public:
 	static CC_FILE_ERROR LoadFileV2(QFile& in, ccHObject& container, int flags);
 
 	//! new style BIN saving
-	static CC_FILE_ERROR SaveFileV2(QFile& out, ccHObject* object);
+	static CC_FILE_ERROR SaveFileV2(QFile& out, ccHObject* object, double quantizationStep = 0);
 
 };
 
@@ -99,12 +99,15 @@ public: //initialization
 		SaveParameters()
 			: alwaysDisplaySaveDialog(true)
 			, parentWidget(nullptr)
+			, binQuantizationStep(0)
 		{}
 
 		//! Wether to always display a dialog (if any), even if automatic guess is possible
 		bool alwaysDisplaySaveDialog;
 		//! Parent widget (if any)
 		QWidget* parentWidget;
+		//! Quantization step of the points coordinates in BIN files (0 = no quantization)
+		double binQuantizationStep;
 	};
 
 	//! Shared type
@@ -15,6 +15,7 @@
 #include <QDir>
 
 //System
+#include <functional>
 #include <vector>
 
 class ccProgressDialog;
@@ -144,8 +145,12 @@ public: //constructor
 	ccCommandLineInterface()
 		: m_silentMode(false)
 		, m_autoSaveMode(true)
+		, m_asyncSaveMode(false)
 		, m_addTimestamp(true)
 		, m_precision(12)
+		, m_maxParallelEntities(1)
+		, m_parallelMemoryBudget_MB(0)
+		, m_binQuantizationStep(0)
 	{}
 
 public: //commands
@@ -214,6 +219,11 @@ public: //virtual methods
 	**/
 	virtual bool saveMeshes(QString suffix = QString(), bool allAtOnce = false, const QString* allAtOnceFileName = 0) = 0;
 
+	//! Waits for the files being saved in the background (see toggleAsyncSaveMode)
+	/** \return false if at least one file couldn't be saved (the errors are reported by this method)
+	**/
+	virtual bool waitForPendingSaves() { return true; }
+
 	//! Removes all clouds (or only the last one ;)
 	virtual void removeClouds(bool onlyLast = false) = 0;
 
@@ -230,6 +240,63 @@ public: //virtual methods
 	//! Returns a (widget) parent (if any is available)
 	virtual QDialog* widgetParent() { return 0; }
 
+public: //batch processing
+
+	//! Per-entity job
+	/** \param index entity index
+		\return success
+	**/
+	using EntityJob = std::function<bool(size_t index)>;
+
+	//! Per-entity memory footprint estimation (in bytes)
+	using EntityFootprint = std::function<qint64(size_t index)>;
+
+	//! Runs independent per-entity jobs
+	/** The default implementation runs the jobs sequentially and stops at the
+		first failure. Implementations may run them concurrently (see
+		setMaxParallelEntities). In this case jobs must not use any GUI element
+		(progress dialog, etc.) and must only modify their own entity. They can
+		call exportEntity (filters that may use dialogs are run on the main thread).
+		\param count number of entities
+		\param job per-entity job
+		\param footprint per-entity memory footprint estimation (optional)
+		\return true if all the jobs succeeded
+	**/
+	virtual bool processEntities(size_t count, EntityJob job, EntityFootprint footprint = EntityFootprint())
+	{
+		Q_UNUSED(footprint);
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (!job(i))
+				return false;
+		}
+		return true;
+	}
+
+	//! Enables the profiling mode
+	/** The wall time, CPU time, peak memory, etc. of the next commands (and of their
+		main phases) will be recorded and saved at the end of the process.
+		\param filename report filename
+		\return success
+	**/
+	virtual bool enableProfiling(const QString& filename) { Q_UNUSED(filename); return false; }
+
+	//! Returns a rough estimation of the memory used by a cloud (in bytes)
+	static qint64 EstimateCloudFootprint(const ccPointCloud* cloud)
+	{
+		if (!cloud)
+			return 0;
+
+		qint64 bytesPerPoint = sizeof(CCVector3);
+		if (cloud->hasColors())
+			bytesPerPoint += sizeof(ccColor::Rgb);
+		if (cloud->hasNormals())
+			bytesPerPoint += sizeof(CompressedNormType);
+		bytesPerPoint += cloud->getNumberOfScalarFields() * sizeof(ScalarType);
+
+		return static_cast<qint64>(cloud->size()) * bytesPerPoint;
+	}
+
 public: //file I/O
 
 	//Extended file loading parameters
@@ -304,6 +371,14 @@ public: //access to data
 	//! Returns whether files should be automatically saved (after each process) or not
 	bool autoSaveMode() const { return m_autoSaveMode; }
 
+	//! Sets whether files should be saved in the background or not
+	/** In this mode, a copy of each saved cloud or mesh is written by a
+		background thread while the next commands are processed.
+	**/
+	void toggleAsyncSaveMode(bool state) { m_asyncSaveMode = state; }
+	//! Returns whether files should be saved in the background or not
+	bool asyncSaveMode() const { return m_asyncSaveMode; }
+
 	//! Sets whether a timestamp should be automatically added to output files or not
 	void toggleAddTimestamp(bool state) { m_addTimestamp = state; }
 	//! Returns whether a timestamp should be automatically added to output files or not
@@ -314,6 +389,28 @@ public: //access to data
 	//! Returns the numerical precision
 	int numericalPrecision() const { return m_precision; }
 
+	//! Sets the maximum number of entities that can be processed concurrently
+	/** Only used by the commands that support it (see processEntities).
+		\param count max number of entities (1 = sequential processing, 0 = one per core)
+	**/
+	void setMaxParallelEntities(int count) { m_maxParallelEntities = count; }
+	//! Returns the maximum number of entities that can be processed concurrently
+	int maxParallelEntities() const { return m_maxParallelEntities; }
+	//! Returns whether several entities may be processed concurrently
+	bool parallelEntitiesMode() const { return m_maxParallelEntities != 1; }
+
+	//! Sets the memory budget for concurrent processing (in MB, 0 = no limit)
+	void setParallelMemoryBudget(qint64 MB) { m_parallelMemoryBudget_MB = MB; }
+	//! Returns the memory budget for concurrent processing (in MB, 0 = no limit)
+	qint64 parallelMemoryBudget() const { return m_parallelMemoryBudget_MB; }
+
+	//! Sets the quantization step of the points coordinates in BIN files (0 = no quantization)
+	/** Only applies to the files saved afterwards (see FileIOFilter::SaveParameters).
+	**/
+	void setBinQuantizationStep(double step) { m_binQuantizationStep = step; }
+	//! Returns the quantization step of the points coordinates in BIN files (0 = no quantization)
+	double binQuantizationStep() const { return m_binQuantizationStep; }
+
 protected: //members
 
 	//! Currently opened point clouds and their filename
@@ -328,12 +425,24 @@ protected: //members
 	//! Whether files should be automatically saved (after each process) or not
 	bool m_autoSaveMode;
 
+	//! Whether files should be saved in the background or not
+	bool m_asyncSaveMode;
+
 	//! Whether a timestamp should be automatically added to output files or not
 	bool m_addTimestamp;
 
 	//! Default numerical precision for ASCII output
 	int m_precision;
 
+	//! Max number of entities processed concurrently
+	int m_maxParallelEntities;
+
+	//! Memory budget for concurrent processing (in MB)
+	qint64 m_parallelMemoryBudget_MB;
+
+	//! Quantization step of the points coordinates in BIN files
+	double m_binQuantizationStep;
+
 	//! File loading parameters
 	CLLoadParameters m_loadingParameters;
 
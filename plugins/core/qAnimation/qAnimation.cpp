@@ -18,6 +18,7 @@
 #include "qAnimation.h"
 
 //Local
+#include "qAnimationCommands.h"
 #include "qAnimationDlg.h"
 
 //qCC_db
@@ -87,6 +88,16 @@ QList<QAction *> qAnimation::getActions()
 	return QList<QAction *>{ m_action };
 }
 
+void qAnimation::registerCommands(ccCommandLineInterface* cmd)
+{
+	if (!cmd)
+	{
+		assert(false);
+		return;
+	}
+	cmd->registerCommand(ccCommandLineInterface::Command::Shared(new CommandAnimation));
+}
+
 //what to do when clicked.
 void qAnimation::doAction()
 {
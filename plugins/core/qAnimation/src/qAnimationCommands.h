@@ -0,0 +1,251 @@
+//##########################################################################
+//#                                                                        #
+//#                   CLOUDCOMPARE PLUGIN: qAnimation                      #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#             COPYRIGHT: Ryan Wicks, 2G Robotics Inc., 2015              #
+//#                                                                        #
+//##########################################################################
+
+#ifndef Q_ANIMATION_PLUGIN_COMMANDS_HEADER
+#define Q_ANIMATION_PLUGIN_COMMANDS_HEADER
+
+//CloudCompare
+#include "ccCommandLineInterface.h"
+
+//Local
+#include "ViewInterpolate.h"
+
+//qCC_db
+#include <cc2DViewportObject.h>
+#include <ccSoftwareRenderer.h>
+
+//qCC_io
+#include <BinFilter.h>
+
+//Qt
+#include <QDir>
+#include <QElapsedTimer>
+#include <QScopedPointer>
+
+static const char COMMAND_ANIMATION[]				= "ANIMATION";
+static const char COMMAND_ANIMATION_FPS[]			= "FPS";
+static const char COMMAND_ANIMATION_DURATION[]		= "STEP_DURATION";
+static const char COMMAND_ANIMATION_LOOP[]			= "LOOP";
+static const char COMMAND_ANIMATION_WIDTH[]			= "WIDTH";
+static const char COMMAND_ANIMATION_HEIGHT[]		= "HEIGHT";
+static const char COMMAND_ANIMATION_POINT_SIZE[]	= "POINT_SIZE";
+static const char COMMAND_ANIMATION_MAX_POINTS[]	= "MAX_POINTS";
+
+//! Headless animation: -ANIMATION {viewports BIN file} {output folder} [-FPS fps] [-STEP_DURATION sec] [-LOOP] [-WIDTH w] [-HEIGHT h] [-POINT_SIZE s] [-MAX_POINTS n]
+/** The loaded clouds and meshes are rendered on the CPU (see ccSoftwareRenderer) along the path
+	interpolated between the viewports saved in the BIN file (same as the plugin dialog). The frames
+	are saved as separate images (frame_000000.png, etc.) in the output folder.
+**/
+struct CommandAnimation : public ccCommandLineInterface::Command
+{
+	CommandAnimation() : ccCommandLineInterface::Command("Animation", COMMAND_ANIMATION) {}
+
+	//helper
+	bool readPositiveNumber(ccCommandLineInterface& cmd, const char* option, double& value)
+	{
+		if (cmd.arguments().empty())
+		{
+			return cmd.error(QString("Missing parameter: value after \"-%1\"").arg(option));
+		}
+
+		bool ok = false;
+		value = cmd.arguments().takeFirst().toDouble(&ok);
+		if (!ok || value <= 0)
+		{
+			return cmd.error(QString("Invalid value after \"-%1\" (should be strictly positive)").arg(option));
+		}
+
+		return true;
+	}
+
+	virtual bool process(ccCommandLineInterface& cmd) override
+	{
+		cmd.print("[ANIMATION]");
+		if (cmd.arguments().size() < 2)
+		{
+			return cmd.error(QString("Missing parameters: viewports filename and output folder after \"-%1\"").arg(COMMAND_ANIMATION));
+		}
+
+		QString viewportsFilename = cmd.arguments().takeFirst();
+		QDir outputDir(cmd.arguments().takeFirst());
+
+		ccSoftwareRenderer::Parameters params;
+		double fps = 25.0;
+		double defaultStepDuration_sec = 2.0; //same default as the plugin dialog
+		bool customStepDuration = false;
+		bool loop = false;
+
+		//look for additional parameters
+		while (!cmd.arguments().empty())
+		{
+			QString argument = cmd.arguments().front();
+			double value = 0;
+			if (ccCommandLineInterface::IsCommand(argument, COMMAND_ANIMATION_FPS))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+				if (!readPositiveNumber(cmd, COMMAND_ANIMATION_FPS, fps))
+				{
+					return false;
+				}
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_ANIMATION_DURATION))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+				if (!readPositiveNumber(cmd, COMMAND_ANIMATION_DURATION, defaultStepDuration_sec))
+				{
+					return false;
+				}
+				customStepDuration = true;
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_ANIMATION_LOOP))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+				loop = true;
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_ANIMATION_WIDTH))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+				if (!readPositiveNumber(cmd, COMMAND_ANIMATION_WIDTH, value))
+				{
+					return false;
+				}
+				params.width = static_cast<int>(value);
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_ANIMATION_HEIGHT))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+				if (!readPositiveNumber(cmd, COMMAND_ANIMATION_HEIGHT, value))
+				{
+					return false;
+				}
+				params.height = static_cast<int>(value);
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_ANIMATION_POINT_SIZE))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+				if (!readPositiveNumber(cmd, COMMAND_ANIMATION_POINT_SIZE, value))
+				{
+					return false;
+				}
+				params.pointSize = static_cast<float>(value);
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_ANIMATION_MAX_POINTS))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+				if (!readPositiveNumber(cmd, COMMAND_ANIMATION_MAX_POINTS, value))
+				{
+					return false;
+				}
+				params.maxPointCount = static_cast<unsigned>(value);
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		ccHObject::Container entities;
+		for (const CLCloudDesc& desc : cmd.clouds())
+		{
+			entities.push_back(desc.pc);
+		}
+		for (const CLMeshDesc& desc : cmd.meshes())
+		{
+			entities.push_back(desc.mesh);
+		}
+		if (entities.empty())
+		{
+			return cmd.error(QString("No entity loaded (clouds or meshes must be loaded before \"-%1\")").arg(COMMAND_ANIMATION));
+		}
+
+		//load the viewports
+		FileIOFilter::LoadParameters loadParameters;
+		loadParameters.alwaysDisplayLoadDialog = false;
+		loadParameters.shiftHandlingMode = ccGlobalShiftManager::NO_DIALOG;
+		CC_FILE_ERROR result = CC_FERR_NO_ERROR;
+		QScopedPointer<ccHObject> viewportDB(FileIOFilter::LoadFromFile(viewportsFilename, loadParameters, result, BinFilter::GetFileFilter()));
+		if (!viewportDB)
+		{
+			return cmd.error(QString("Failed to load the viewports file '%1'").arg(viewportsFilename));
+		}
+
+		ccHObject::Container viewports;
+		viewportDB->filterChildren(viewports, true, CC_TYPES::VIEWPORT_2D_OBJECT, true);
+		if (viewports.size() < 2)
+		{
+			return cmd.error(QString("File '%1' should contain at least 2 viewports").arg(viewportsFilename));
+		}
+		cmd.print(QString("Viewports: %1").arg(viewports.size()));
+
+		if (!outputDir.exists() && !outputDir.mkpath("."))
+		{
+			return cmd.error(QString("Failed to create the output folder '%1'").arg(outputDir.absolutePath()));
+		}
+
+		QElapsedTimer timer;
+		timer.start();
+
+		ccSoftwareRenderer renderer;
+		int frameIndex = 0;
+		size_t segmentCount = (loop ? viewports.size() : viewports.size() - 1);
+		for (size_t i = 0; i < segmentCount; ++i)
+		{
+			cc2DViewportObject* vp1 = static_cast<cc2DViewportObject*>(viewports[i]);
+			cc2DViewportObject* vp2 = static_cast<cc2DViewportObject*>(viewports[(i + 1) % viewports.size()]);
+
+			//the step duration may have been saved as meta data by the plugin dialog
+			double duration_sec = defaultStepDuration_sec;
+			if (!customStepDuration && vp1->hasMetaData("StepDurationSec"))
+			{
+				duration_sec = vp1->getMetaData("StepDurationSec").toDouble();
+			}
+
+			ViewInterpolate interpolator(vp1, vp2);
+			interpolator.setMaxStep(static_cast<unsigned>(fps * duration_sec));
+
+			cc2DViewportObject currentViewport;
+			while (interpolator.nextView(currentViewport))
+			{
+				QImage image;
+				if (!renderer.render(entities, currentViewport.getParameters(), params, image))
+				{
+					return cmd.error(QString("Failed to render frame #%1 (not enough memory?)").arg(frameIndex + 1));
+				}
+
+				QString filename = QString("frame_%1.png").arg(frameIndex, 6, 10, QChar('0'));
+				if (!image.save(outputDir.filePath(filename)))
+				{
+					return cmd.error(QString("Failed to save frame #%1").arg(frameIndex + 1));
+				}
+				++frameIndex;
+			}
+		}
+
+		cmd.print(QString("%1 frames rendered (%2 x %3) in %4 s").arg(frameIndex).arg(params.width).arg(params.height).arg(timer.elapsed() / 1000.0, 0, 'f', 1));
+
+		return true;
+	}
+};
+
+#endif //Q_ANIMATION_PLUGIN_COMMANDS_HEADER
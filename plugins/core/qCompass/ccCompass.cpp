@@ -27,7 +27,9 @@
 #include <ccPickingHub.h>
 
 //qCC_db
+#include <ccHObjectCaster.h>
 #include <ccProgressDialog.h>
+#include <ccSubCloud.h>
 
 #include "ccCompass.h"
 #include "ccCompassDlg.h"
@@ -680,7 +682,19 @@ void ccCompass::pointPicked(ccHObject* entity, unsigned itemIdx, int x, int y, c
 	if (entity->isKindOf(CC_TYPES::POINT_CLOUD))
 	{
 		//get point cloud
-		ccPointCloud* cloud = static_cast<ccPointCloud*>(entity); //cast to point cloud
+		ccPointCloud* cloud = ccHObjectCaster::ToPointCloud(entity); //cast to point cloud
+		unsigned pointIdx = itemIdx;
+
+		if (!cloud)
+		{
+			//sub-clouds only reference the points of their associated cloud
+			ccSubCloud* subCloud = ccHObjectCaster::ToSubCloud(entity);
+			if (subCloud && subCloud->getAssociatedCloud())
+			{
+				cloud = subCloud->getAssociatedCloud();
+				pointIdx = subCloud->getPointGlobalIndex(itemIdx);
+			}
+		}
 
 		if (!cloud)
 		{
@@ -689,7 +703,7 @@ void ccCompass::pointPicked(ccHObject* entity, unsigned itemIdx, int x, int y, c
 		}
 
 		//pass picked point, cloud & insert point to relevant tool
-		m_activeTool->pointPicked(parentNode, itemIdx, cloud, P);
+		m_activeTool->pointPicked(parentNode, pointIdx, cloud, P);
 	}
 
 	//redraw
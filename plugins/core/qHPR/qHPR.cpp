@@ -17,6 +17,8 @@
 
 #include "qHPR.h"
 #include "ccHprDlg.h"
+#include "qHPRCommands.h"
+#include "qHPRTools.h"
 
 //Qt
 #include <QtGui>
@@ -35,11 +37,8 @@
 //CCLib
 #include <CloudSamplingTools.h>
 
-//Qhull
-extern "C"
-{
-#include <qhull_a.h>
-}
+//system
+#include <algorithm>
 
 qHPR::qHPR(QObject* parent)
 	: QObject(parent)
@@ -72,6 +71,16 @@ void qHPR::onNewSelection(const ccHObject::Container& selectedEntities)
 	}
 }
 
+void qHPR::registerCommands(ccCommandLineInterface* cmd)
+{
+	if (!cmd)
+	{
+		assert(false);
+		return;
+	}
+	cmd->registerCommand(ccCommandLineInterface::Command::Shared(new CommandHPR));
+}
+
 CCLib::ReferenceCloud* qHPR::removeHiddenPoints(CCLib::GenericIndexedCloudPersist* theCloud, const CCVector3d& viewPoint, double fParam)
 {
 	assert(theCloud);
@@ -80,132 +89,44 @@ CCLib::ReferenceCloud* qHPR::removeHiddenPoints(CCLib::GenericIndexedCloudPersis
 	if (nbPoints == 0)
 		return nullptr;
 
-	//less than 4 points? no need for calculation, we return the whole cloud
-	if (nbPoints < 4)
+	std::vector<CCVector3> points;
+	std::vector<bool> pointBelongsToCvxHull;
+	std::vector<double> buffer;
+	try
 	{
-		CCLib::ReferenceCloud* visiblePoints = new CCLib::ReferenceCloud(theCloud);
-		if (!visiblePoints->addPointIndex(0,nbPoints)) //well even for less than 4 points we never know ;)
-		{
-			//not enough memory!
-			delete visiblePoints;
-			visiblePoints = nullptr;
-		}
-		return visiblePoints;
+		points.resize(nbPoints);
 	}
-
-	double maxRadius = 0;
-
-	//convert point cloud to an array of double triplets (for qHull)
-	coordT* pt_array = new coordT[(nbPoints+1)*3];
+	catch (const std::bad_alloc&)
 	{
-		coordT* _pt_array = pt_array;
-
-		for (unsigned i=0; i<nbPoints; ++i)
-		{
-			CCVector3d P = CCVector3d::fromArray(theCloud->getPoint(i)->u) - viewPoint;
-			*_pt_array++ = static_cast<coordT>(P.x);
-			*_pt_array++ = static_cast<coordT>(P.y);
-			*_pt_array++ = static_cast<coordT>(P.z);
-
-			//we keep track of the highest 'radius'
-			double r2 = P.norm2();
-			if (maxRadius < r2)
-				maxRadius = r2;
-		}
-		
-		//we add the view point (Cf. HPR)
-		*_pt_array++ = 0;
-		*_pt_array++ = 0;
-		*_pt_array++ = 0;
-
-		maxRadius = sqrt(maxRadius);
+		//not enough memory!
+		return nullptr;
 	}
-
-	//apply spherical flipping
+	for (unsigned i=0; i<nbPoints; ++i)
 	{
-		maxRadius *= pow(10.0,fParam) * 2;
-	
-		coordT* _pt_array = pt_array;
-		for (unsigned i=0; i<nbPoints; ++i)
-		{
-			CCVector3d P = CCVector3d::fromArray(theCloud->getPoint(i)->u) - viewPoint;
-
-			double r = (maxRadius/P.norm()) - 1.0;
-			*_pt_array++ *= r;
-			*_pt_array++ *= r;
-			*_pt_array++ *= r;
-		}
+		theCloud->getPoint(i, points[i]);
 	}
 
-	//array to flag points on the convex hull
-	std::vector<bool> pointBelongsToCvxHull;
-
-	static char qHullCommand[] = "qhull QJ Qci";
-	if (!qh_new_qhull(3,nbPoints+1,pt_array,False,qHullCommand,nullptr,stderr))
+	if (!qHPRTools::FlagVisiblePoints(points, nullptr, viewPoint, fParam, pointBelongsToCvxHull, buffer))
 	{
-		try
-		{
-			pointBelongsToCvxHull.resize(nbPoints+1,false);
-		}
-		catch (const std::bad_alloc&)
-		{
-			//not enough memory!
-			delete[] pt_array;
-			return nullptr;
-		}
-
-		vertexT *vertex = nullptr;
-		vertexT **vertexp = nullptr;
-		facetT *facet = nullptr;
-
-		FORALLfacets
-		{
-			//if (!facet->simplicial)
-			//	error("convhulln: non-simplicial facet"); // should never happen with QJ
-
-			setT* vertices = qh_facet3vertex(facet);
-			FOREACHvertex_(vertices)
-			{
-				pointBelongsToCvxHull[qh_pointid(vertex->point)] = true;
-			}
-			qh_settempfree(&vertices);
-		}
+		return nullptr;
 	}
 
-	delete[] pt_array;
-	pt_array = nullptr;
+	//compute the number of points belonging to the convex hull
+	unsigned cvxHullSize = static_cast<unsigned>(std::count(pointBelongsToCvxHull.begin(), pointBelongsToCvxHull.end(), true));
 
-	qh_freeqhull(!qh_ALL);
-	//free long memory
-	int curlong, totlong;
-	qh_memfreeshort (&curlong, &totlong);
-	//free short memory and memory allocator
-
-	if (!pointBelongsToCvxHull.empty())
+	CCLib::ReferenceCloud* visiblePoints = new CCLib::ReferenceCloud(theCloud);
+	if (cvxHullSize!=0 && visiblePoints->reserve(cvxHullSize))
 	{
-		//compute the number of points belonging to the convex hull
-		unsigned cvxHullSize = 0;
-		{
-			for (unsigned i=0; i<nbPoints; ++i)
-				if (pointBelongsToCvxHull[i])
-					++cvxHullSize;
-		}
-
-		CCLib::ReferenceCloud* visiblePoints = new CCLib::ReferenceCloud(theCloud);
-		if (cvxHullSize!=0 && visiblePoints->reserve(cvxHullSize))
-		{
-			for (unsigned i=0; i<nbPoints; ++i)
-				if (pointBelongsToCvxHull[i])
-					visiblePoints->addPointIndex(i); //can't fail, see above
-
-			return visiblePoints;
+		for (unsigned i=0; i<nbPoints; ++i)
+			if (pointBelongsToCvxHull[i])
+				visiblePoints->addPointIndex(i); //can't fail, see above
 
-		}
-		else //not enough memory
-		{
-			delete visiblePoints;
-			visiblePoints = nullptr;
-		}
+		return visiblePoints;
+	}
+	else //not enough memory
+	{
+		delete visiblePoints;
+		visiblePoints = nullptr;
 	}
 
 	return nullptr;
@@ -0,0 +1,163 @@
+//##########################################################################
+//#                                                                        #
+//#                       CLOUDCOMPARE PLUGIN: qHPR                        #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                  COPYRIGHT: Daniel Girardeau-Montaut                   #
+//#                                                                        #
+//##########################################################################
+
+#ifndef Q_HPR_PLUGIN_COMMANDS_HEADER
+#define Q_HPR_PLUGIN_COMMANDS_HEADER
+
+//CloudCompare
+#include "ccCommandLineInterface.h"
+
+//Local
+#include "qHPRTools.h"
+
+//qCC_db
+#include <ccPointCloud.h>
+#include <ccProgressDialog.h>
+
+static const char COMMAND_HPR[]					= "HPR";
+static const char COMMAND_HPR_OCTREE_LEVEL[]	= "OCTREE_LEVEL";
+static const char COMMAND_HPR_MAX_RANGE[]		= "MAX_RANGE";
+static const char COMMAND_HPR_FLIP_PARAM[]		= "FLIP_PARAM";
+static const char COMMAND_HPR_BIT_MASKS[]		= "BIT_MASKS";
+
+//! Batch Hidden Point Removal: -HPR {viewpoints file} [-OCTREE_LEVEL level] [-MAX_RANGE range] [-FLIP_PARAM value] [-BIT_MASKS]
+struct CommandHPR : public ccCommandLineInterface::Command
+{
+	CommandHPR() : ccCommandLineInterface::Command("Hidden Point Removal", COMMAND_HPR) {}
+
+	virtual bool process(ccCommandLineInterface& cmd) override
+	{
+		cmd.print("[HIDDEN POINT REMOVAL]");
+		if (cmd.arguments().empty())
+		{
+			return cmd.error(QString("Missing parameter: viewpoints filename after \"-%1\"").arg(COMMAND_HPR));
+		}
+
+		QString viewPointsFilename = cmd.arguments().takeFirst();
+
+		qHPRTools::BatchParameters params;
+
+		//look for additional parameters
+		while (!cmd.arguments().empty())
+		{
+			QString argument = cmd.arguments().front();
+			if (ccCommandLineInterface::IsCommand(argument, COMMAND_HPR_OCTREE_LEVEL))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+				if (cmd.arguments().empty())
+				{
+					return cmd.error(QString("Missing parameter: octree level after \"-%1\"").arg(COMMAND_HPR_OCTREE_LEVEL));
+				}
+
+				bool ok = false;
+				int level = cmd.arguments().takeFirst().toInt(&ok);
+				if (!ok || level < 0 || level > CCLib::DgmOctree::MAX_OCTREE_LEVEL)
+				{
+					return cmd.error(QString("Invalid octree level (should be between 0 and %1)").arg(CCLib::DgmOctree::MAX_OCTREE_LEVEL));
+				}
+				params.octreeLevel = static_cast<unsigned char>(level);
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_HPR_MAX_RANGE))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+				if (cmd.arguments().empty())
+				{
+					return cmd.error(QString("Missing parameter: range after \"-%1\"").arg(COMMAND_HPR_MAX_RANGE));
+				}
+
+				bool ok = false;
+				params.maxRange = cmd.arguments().takeFirst().toDouble(&ok);
+				if (!ok || params.maxRange <= 0)
+				{
+					return cmd.error("Invalid maximum range (should be strictly positive)");
+				}
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_HPR_FLIP_PARAM))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+				if (cmd.arguments().empty())
+				{
+					return cmd.error(QString("Missing parameter: value after \"-%1\"").arg(COMMAND_HPR_FLIP_PARAM));
+				}
+
+				bool ok = false;
+				params.fParam = cmd.arguments().takeFirst().toDouble(&ok);
+				if (!ok)
+				{
+					return cmd.error("Invalid spherical flip parameter");
+				}
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_HPR_BIT_MASKS))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+				params.bitMasks = true;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		if (cmd.clouds().empty())
+		{
+			return cmd.error(QString("No cloud loaded (a cloud must be loaded before \"-%1\")").arg(COMMAND_HPR));
+		}
+
+		std::vector<CCVector3d> globalViewPoints;
+		QString errorMessage;
+		if (!qHPRTools::LoadViewPoints(viewPointsFilename, globalViewPoints, errorMessage))
+		{
+			return cmd.error(errorMessage);
+		}
+		cmd.print(QString("Viewpoints: %1").arg(globalViewPoints.size()));
+
+		ccProgressDialog pDlg(true, cmd.widgetParent());
+
+		for (CLCloudDesc& desc : cmd.clouds())
+		{
+			//the viewpoints are expressed in the same coordinate system as the input files
+			std::vector<CCVector3d> viewPoints;
+			viewPoints.reserve(globalViewPoints.size());
+			for (const CCVector3d& P : globalViewPoints)
+			{
+				viewPoints.push_back(desc.pc->toLocal3d(P));
+			}
+
+			if (!qHPRTools::ComputeBatchVisibility(desc.pc, viewPoints, params, errorMessage, cmd.silentMode() ? nullptr : &pDlg))
+			{
+				return cmd.error(QString("Failed to compute the visibility of cloud '%1': %2").arg(desc.pc->getName(), errorMessage));
+			}
+
+			if (cmd.autoSaveMode())
+			{
+				QString errorStr = cmd.exportEntity(desc, "HPR");
+				if (!errorStr.isEmpty())
+				{
+					return cmd.error(errorStr);
+				}
+			}
+		}
+
+		return true;
+	}
+};
+
+#endif //Q_HPR_PLUGIN_COMMANDS_HEADER
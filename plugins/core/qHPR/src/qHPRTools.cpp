@@ -0,0 +1,496 @@
+//##########################################################################
+//#                                                                        #
+//#                       CLOUDCOMPARE PLUGIN: qHPR                        #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                  COPYRIGHT: Daniel Girardeau-Montaut                   #
+//#                                                                        #
+//##########################################################################
+
+#include "qHPRTools.h"
+
+//qCC_db
+#include <ccLog.h>
+#include <ccOctree.h>
+#include <ccPointCloud.h>
+#include <ccScalarField.h>
+
+//Qt
+#include <QFile>
+#include <QMutex>
+#include <QRegExp>
+#include <QStringList>
+#include <QTextStream>
+
+//system
+#include <algorithm>
+#include <atomic>
+#include <type_traits>
+
+#ifdef USE_TBB
+#include <tbb/parallel_for.h>
+#endif
+
+//Qhull
+extern "C"
+{
+#include <qhull_a.h>
+}
+
+static_assert(std::is_same<coordT, double>::value, "Qhull must be compiled with double coordinates");
+
+//Qhull relies on a global state (it's not re-entrant)
+static QMutex s_qhullMutex;
+
+//number of viewpoints processed by each task (the task buffers are reused for all of them)
+static const int s_viewPointsPerTask = 8;
+
+bool qHPRTools::FlagVisiblePoints(	const std::vector<CCVector3>& points,
+									const std::vector<unsigned>* subset,
+									const CCVector3d& viewPoint,
+									double fParam,
+									std::vector<bool>& visible,
+									std::vector<double>& buffer)
+{
+	unsigned nbPoints = static_cast<unsigned>(subset ? subset->size() : points.size());
+
+	try
+	{
+		visible.resize(nbPoints);
+		buffer.resize((nbPoints + 1) * 3);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+
+	//less than 4 points? no need for calculation, all the points are visible
+	if (nbPoints < 4)
+	{
+		std::fill(visible.begin(), visible.end(), true);
+		return true;
+	}
+
+	//convert the points to an array of double triplets (for qHull)
+	double maxRadius = 0;
+	{
+		double* _pt_array = buffer.data();
+		for (unsigned i = 0; i < nbPoints; ++i)
+		{
+			CCVector3d P = CCVector3d::fromArray(points[subset ? subset->at(i) : i].u) - viewPoint;
+			*_pt_array++ = P.x;
+			*_pt_array++ = P.y;
+			*_pt_array++ = P.z;
+
+			//we keep track of the highest 'radius'
+			maxRadius = std::max(maxRadius, P.norm2());
+		}
+
+		//we add the view point (Cf. HPR)
+		*_pt_array++ = 0;
+		*_pt_array++ = 0;
+		*_pt_array++ = 0;
+
+		maxRadius = sqrt(maxRadius);
+	}
+
+	//apply spherical flipping
+	{
+		maxRadius *= pow(10.0, fParam) * 2;
+
+		double* _pt_array = buffer.data();
+		for (unsigned i = 0; i < nbPoints; ++i, _pt_array += 3)
+		{
+			double norm = sqrt(_pt_array[0] * _pt_array[0] + _pt_array[1] * _pt_array[1] + _pt_array[2] * _pt_array[2]);
+			double r = (norm > 0 ? (maxRadius / norm) - 1.0 : 0.0);
+			_pt_array[0] *= r;
+			_pt_array[1] *= r;
+			_pt_array[2] *= r;
+		}
+	}
+
+	std::fill(visible.begin(), visible.end(), false);
+
+	//flag the points on the convex hull
+	bool success = false;
+	{
+		QMutexLocker locker(&s_qhullMutex);
+
+		static char qHullCommand[] = "qhull QJ Qci";
+		if (!qh_new_qhull(3, nbPoints + 1, buffer.data(), False, qHullCommand, nullptr, stderr))
+		{
+			vertexT *vertex = nullptr;
+			vertexT **vertexp = nullptr;
+			facetT *facet = nullptr;
+
+			FORALLfacets
+			{
+				setT* vertices = qh_facet3vertex(facet);
+				FOREACHvertex_(vertices)
+				{
+					int pointId = qh_pointid(vertex->point);
+					//the viewpoint itself is the last point
+					if (pointId >= 0 && static_cast<unsigned>(pointId) < nbPoints)
+					{
+						visible[pointId] = true;
+					}
+				}
+				qh_settempfree(&vertices);
+			}
+
+			success = true;
+		}
+
+		qh_freeqhull(!qh_ALL);
+		//free long memory
+		int curlong, totlong;
+		qh_memfreeshort(&curlong, &totlong);
+		//free short memory and memory allocator
+	}
+
+	return success;
+}
+
+bool qHPRTools::ComputeBatchVisibility(	ccPointCloud* cloud,
+										const std::vector<CCVector3d>& viewPoints,
+										const BatchParameters& params,
+										QString& errorMessage,
+										CCLib::GenericProgressCallback* progressCb/*=nullptr*/)
+{
+	if (!cloud || cloud->size() == 0 || viewPoints.empty())
+	{
+		errorMessage = "Invalid input";
+		return false;
+	}
+	if (params.octreeLevel > CCLib::DgmOctree::MAX_OCTREE_LEVEL)
+	{
+		errorMessage = "Invalid octree level";
+		return false;
+	}
+
+	unsigned pointCount = cloud->size();
+
+	//shape approximation: one point per octree cell (the nearest to the cell center)
+	std::vector<CCVector3> cellPoints;
+	std::vector<unsigned> pointCells;
+	if (params.octreeLevel != 0)
+	{
+		ccOctree::Shared octree = cloud->getOctree();
+		if (!octree)
+		{
+			octree = cloud->computeOctree(progressCb);
+			if (!octree)
+			{
+				errorMessage = "Failed to compute the octree";
+				return false;
+			}
+		}
+
+		const CCLib::DgmOctree::cellsContainer& codes = octree->pointsAndTheirCellCodes();
+		unsigned char bitShift = CCLib::DgmOctree::GET_BIT_SHIFT(params.octreeLevel);
+		try
+		{
+			pointCells.resize(pointCount);
+			cellPoints.reserve(octree->getCellNumber(params.octreeLevel));
+
+			CCLib::DgmOctree::CellCode currentCode = (codes.front().theCode >> bitShift);
+			CCVector3 cellCenter;
+			octree->computeCellCenter(currentCode, params.octreeLevel, cellCenter, true);
+			PointCoordinateType minDist2 = -1;
+			unsigned cellIndex = 0;
+			for (const CCLib::DgmOctree::IndexAndCode& ic : codes)
+			{
+				CCLib::DgmOctree::CellCode code = (ic.theCode >> bitShift);
+				if (code != currentCode)
+				{
+					currentCode = code;
+					octree->computeCellCenter(currentCode, params.octreeLevel, cellCenter, true);
+					minDist2 = -1;
+					++cellIndex;
+				}
+
+				const CCVector3* P = cloud->getPoint(ic.theIndex);
+				PointCoordinateType dist2 = (*P - cellCenter).norm2();
+				if (minDist2 < 0)
+				{
+					cellPoints.push_back(*P);
+					minDist2 = dist2;
+				}
+				else if (dist2 < minDist2)
+				{
+					cellPoints.back() = *P;
+					minDist2 = dist2;
+				}
+				pointCells[ic.theIndex] = cellIndex;
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			errorMessage = "Not enough memory";
+			return false;
+		}
+	}
+	else
+	{
+		//all the points are used
+		try
+		{
+			cellPoints.resize(pointCount);
+		}
+		catch (const std::bad_alloc&)
+		{
+			errorMessage = "Not enough memory";
+			return false;
+		}
+		for (unsigned i = 0; i < pointCount; ++i)
+		{
+			cloud->getPoint(i, cellPoints[i]);
+		}
+	}
+
+	unsigned cellCount = static_cast<unsigned>(cellPoints.size());
+	unsigned viewPointCount = static_cast<unsigned>(viewPoints.size());
+	unsigned maskCount = (params.bitMasks ? (viewPointCount + ViewPointsPerMask - 1) / ViewPointsPerMask : 0);
+
+	//visibility counters and masks (per cell)
+	std::vector< std::atomic<unsigned> > cellCounts;
+	std::vector< std::atomic<unsigned> > cellMasks;
+	try
+	{
+		std::vector< std::atomic<unsigned> >(cellCount).swap(cellCounts);
+		std::vector< std::atomic<unsigned> >(static_cast<size_t>(cellCount) * maskCount).swap(cellMasks);
+	}
+	catch (const std::bad_alloc&)
+	{
+		errorMessage = "Not enough memory";
+		return false;
+	}
+
+	if (progressCb)
+	{
+		if (progressCb->textCanBeEdited())
+		{
+			progressCb->setMethodTitle("Hidden Point Removal");
+			progressCb->setInfo(qPrintable(QString("Viewpoints: %1\nCells: %L2").arg(viewPointCount).arg(cellCount)));
+		}
+		progressCb->update(0);
+		progressCb->start();
+	}
+	CCLib::NormalizedProgress nprogress(progressCb, viewPointCount);
+
+	std::atomic<bool> cancelled(false);
+	std::atomic<bool> notEnoughMemory(false);
+	std::atomic<unsigned> failedViewPoints(0);
+	const double maxRange2 = params.maxRange * params.maxRange;
+
+	int taskCount = static_cast<int>((viewPointCount + s_viewPointsPerTask - 1) / s_viewPointsPerTask);
+#ifdef USE_TBB
+	tbb::parallel_for(0, taskCount, [&](int t)
+#else
+	for (int t = 0; t < taskCount; ++t)
+#endif
+	{
+		//buffers (reused for all the viewpoints of this task)
+		std::vector<unsigned> candidates;
+		std::vector<bool> visible;
+		std::vector<double> buffer;
+
+		unsigned firstViewPoint = static_cast<unsigned>(t) * s_viewPointsPerTask;
+		unsigned lastViewPoint = std::min(firstViewPoint + s_viewPointsPerTask, viewPointCount);
+		for (unsigned v = firstViewPoint; v < lastViewPoint && !cancelled && !notEnoughMemory; ++v)
+		{
+			const CCVector3d& viewPoint = viewPoints[v];
+
+			//range culling
+			bool useCandidates = (params.maxRange > 0);
+			if (useCandidates)
+			{
+				candidates.clear();
+				try
+				{
+					for (unsigned k = 0; k < cellCount; ++k)
+					{
+						if ((CCVector3d::fromArray(cellPoints[k].u) - viewPoint).norm2() <= maxRange2)
+						{
+							candidates.push_back(k);
+						}
+					}
+				}
+				catch (const std::bad_alloc&)
+				{
+					notEnoughMemory = true;
+					break;
+				}
+			}
+
+			if (!useCandidates || !candidates.empty())
+			{
+				if (FlagVisiblePoints(cellPoints, useCandidates ? &candidates : nullptr, viewPoint, params.fParam, visible, buffer))
+				{
+					unsigned maskIndex = v / ViewPointsPerMask;
+					unsigned bit = (1u << (v % ViewPointsPerMask));
+					for (size_t j = 0; j < visible.size(); ++j)
+					{
+						if (visible[j])
+						{
+							unsigned k = (useCandidates ? candidates[j] : static_cast<unsigned>(j));
+							++cellCounts[k];
+							if (maskCount)
+							{
+								cellMasks[static_cast<size_t>(k) * maskCount + maskIndex] |= bit;
+							}
+						}
+					}
+				}
+				else
+				{
+					++failedViewPoints;
+				}
+			}
+
+			if (!nprogress.oneStep())
+			{
+				cancelled = true;
+			}
+		}
+	}
+#ifdef USE_TBB
+	);
+#endif
+
+	if (progressCb)
+	{
+		progressCb->stop();
+	}
+
+	if (cancelled)
+	{
+		errorMessage = "Process cancelled by the user";
+		return false;
+	}
+	if (notEnoughMemory)
+	{
+		errorMessage = "Not enough memory";
+		return false;
+	}
+	if (failedViewPoints != 0)
+	{
+		ccLog::Warning(QString("[HPR] Failed to process %1 viewpoint(s) (not enough memory or degenerate configuration)").arg(failedViewPoints.load()));
+	}
+
+	//output scalar fields
+	std::vector<ccScalarField*> sfs;
+	for (unsigned m = 0; m <= maskCount; ++m)
+	{
+		QString sfName;
+		if (m == 0)
+		{
+			sfName = "HPR visibility count";
+		}
+		else
+		{
+			unsigned first = (m - 1) * ViewPointsPerMask;
+			sfName = QString("HPR visibility mask [%1-%2]").arg(first).arg(std::min(first + ViewPointsPerMask, viewPointCount) - 1);
+		}
+
+		int sfIdx = cloud->getScalarFieldIndexByName(qPrintable(sfName));
+		if (sfIdx < 0)
+		{
+			sfIdx = cloud->addScalarField(qPrintable(sfName));
+			if (sfIdx < 0)
+			{
+				errorMessage = "Not enough memory";
+				return false;
+			}
+		}
+		sfs.push_back(static_cast<ccScalarField*>(cloud->getScalarField(sfIdx)));
+	}
+
+	for (unsigned i = 0; i < pointCount; ++i)
+	{
+		unsigned k = (pointCells.empty() ? i : pointCells[i]);
+		sfs[0]->setValue(i, static_cast<ScalarType>(cellCounts[k].load()));
+		for (unsigned m = 0; m < maskCount; ++m)
+		{
+			sfs[m + 1]->setValue(i, static_cast<ScalarType>(cellMasks[static_cast<size_t>(k) * maskCount + m].load()));
+		}
+	}
+
+	for (ccScalarField* sf : sfs)
+	{
+		sf->computeMinAndMax();
+	}
+	cloud->setCurrentDisplayedScalarField(cloud->getScalarFieldIndexByName(sfs[0]->getName()));
+	cloud->showSF(true);
+
+	return true;
+}
+
+bool qHPRTools::LoadViewPoints(const QString& filename, std::vector<CCVector3d>& viewPoints, QString& errorMessage)
+{
+	QFile file(filename);
+	if (!file.open(QFile::ReadOnly | QFile::Text))
+	{
+		errorMessage = QString("Failed to open file '%1'").arg(filename);
+		return false;
+	}
+
+	viewPoints.clear();
+
+	QTextStream stream(&file);
+	unsigned lineNumber = 0;
+	while (!stream.atEnd())
+	{
+		QString line = stream.readLine().trimmed();
+		++lineNumber;
+		if (line.isEmpty() || line.startsWith("#") || line.startsWith("//"))
+		{
+			continue;
+		}
+
+		QStringList tokens = line.split(QRegExp("[\\s,;]+"), QString::SkipEmptyParts);
+		if (tokens.size() < 3)
+		{
+			errorMessage = QString("Malformed line %1 (X Y Z expected)").arg(lineNumber);
+			return false;
+		}
+
+		CCVector3d P;
+		bool ok[3] = { false, false, false };
+		P.x = tokens[0].toDouble(ok);
+		P.y = tokens[1].toDouble(ok + 1);
+		P.z = tokens[2].toDouble(ok + 2);
+		if (!ok[0] || !ok[1] || !ok[2])
+		{
+			errorMessage = QString("Invalid coordinates on line %1").arg(lineNumber);
+			return false;
+		}
+
+		try
+		{
+			viewPoints.push_back(P);
+		}
+		catch (const std::bad_alloc&)
+		{
+			errorMessage = "Not enough memory";
+			return false;
+		}
+	}
+
+	if (viewPoints.empty())
+	{
+		errorMessage = QString("No viewpoint found in file '%1'").arg(filename);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,108 @@
+//##########################################################################
+//#                                                                        #
+//#                       CLOUDCOMPARE PLUGIN: qHPR                        #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                  COPYRIGHT: Daniel Girardeau-Montaut                   #
+//#                                                                        #
+//##########################################################################
+
+#ifndef Q_HPR_TOOLS_HEADER
+#define Q_HPR_TOOLS_HEADER
+
+//CCLib
+#include <CCGeom.h>
+#include <GenericProgressCallback.h>
+
+//Qt
+#include <QString>
+
+//system
+#include <vector>
+
+class ccPointCloud;
+
+//! Hidden Point Removal tools (Katz et al. algorithm)
+class qHPRTools
+{
+public:
+
+	//! Flags the points that are visible from a given viewpoint
+	/** The points are 'spherically flipped' relatively to the viewpoint, then the points
+		lying on the convex hull of the flipped points (and the viewpoint) are visible.
+		\warning Qhull is not re-entrant: the convex hull extraction is serialized if this
+		method is called by several threads (the spherical flip is not).
+		\param points input points
+		\param subset optional subset of the input points (indexes). All the points are used if null.
+		\param viewPoint viewpoint
+		\param fParam spherical flip parameter (the flip radius is 2 x 10^fParam x the max distance)
+		\param[out] visible visibility flag of each input point (or of each point of the subset)
+		\param buffer coordinates buffer (can be reused from one call to the next)
+		\return success
+	**/
+	static bool FlagVisiblePoints(	const std::vector<CCVector3>& points,
+									const std::vector<unsigned>* subset,
+									const CCVector3d& viewPoint,
+									double fParam,
+									std::vector<bool>& visible,
+									std::vector<double>& buffer);
+
+	//! Batch HPR parameters
+	struct BatchParameters
+	{
+		//! Default constructor
+		BatchParameters()
+			: fParam(3.5)
+			, octreeLevel(7)
+			, maxRange(0)
+			, bitMasks(false)
+		{}
+
+		//! Spherical flip parameter
+		double fParam;
+		//! Octree level for the cloud shape approximation (0 = all the points are used)
+		unsigned char octreeLevel;
+		//! Maximum range (the cells farther than this from a viewpoint are ignored for this viewpoint). Ignored if <= 0.
+		double maxRange;
+		//! Whether to output the visibility bit masks
+		bool bitMasks;
+	};
+
+	//! Number of viewpoints per bit mask scalar field (so as to be exactly representable by a float)
+	static const unsigned ViewPointsPerMask = 24;
+
+	//! Computes the visibility of the points of a cloud from several viewpoints
+	/** The cloud shape is approximated once (one point per octree cell, as in the interactive
+		tool), then the viewpoints are processed in parallel.
+		Outputs (scalar fields):
+		- 'HPR visibility count': number of viewpoints from which each point is visible
+		- 'HPR visibility mask [i-j]' (optional): bit k is set if the point is visible from the viewpoint i+k
+		\param cloud point cloud
+		\param viewPoints viewpoints (in the cloud local coordinate system)
+		\param params parameters
+		\param[out] errorMessage error message (if any)
+		\param progressCb optional progress callback
+		\return success
+	**/
+	static bool ComputeBatchVisibility(	ccPointCloud* cloud,
+										const std::vector<CCVector3d>& viewPoints,
+										const BatchParameters& params,
+										QString& errorMessage,
+										CCLib::GenericProgressCallback* progressCb = nullptr);
+
+	//! Loads a list of viewpoints from an ASCII file
+	/** One viewpoint per line (X Y Z, other columns are ignored). Empty lines and
+		lines starting with '#' or '//' are skipped.
+	**/
+	static bool LoadViewPoints(const QString& filename, std::vector<CCVector3d>& viewPoints, QString& errorMessage);
+};
+
+#endif //Q_HPR_TOOLS_HEADER
@@ -32,6 +32,14 @@
 
 //Qt
 #include <QMessageBox>
+#include <QThread>
+
+//system
+#include <atomic>
+
+#ifdef USE_TBB
+#include <tbb/parallel_for.h>
+#endif
 
 //Last contour unique ID
 static std::vector<unsigned> s_lastContourUniqueIDs;
@@ -494,6 +502,336 @@ static unsigned ComputeGridDimensions(	const ccBBox& localBox,
 	return cellCount;
 }
 
+//! Default number of points processed by a single task
+static const unsigned s_pointsChunkSize = 65536;
+
+//! Regular grid of slices (expressed in the clipping box local coordinate system)
+struct SlicesGrid
+{
+	ccGLMatrix localTrans;
+	CCVector3 origin;
+	CCVector3 cellSize;
+	CCVector3 cellSizePlusGap;
+	bool repeatDimensions[3];
+	bool withGap;
+	bool cropToBox;
+	int indexMins[3];
+	int indexMaxs[3];
+	int gridDim[3];
+	unsigned cellCount;
+
+	//! Returns the index of the cell in which a point falls (or -1 if it falls in a gap or outside of the box)
+	inline int cellIndex(const CCVector3& Pglobal) const
+	{
+		CCVector3 P = Pglobal;
+		localTrans.apply(P);
+
+		//relative coordinates (between 0 and 1)
+		P -= origin;
+		P.x /= cellSizePlusGap.x;
+		P.y /= cellSizePlusGap.y;
+		P.z /= cellSizePlusGap.z;
+
+		if (cropToBox)
+		{
+			//the points must be inside the box along the dimensions that are not repeated
+			for (unsigned char d = 0; d < 3; ++d)
+			{
+				if (!repeatDimensions[d] && (P.u[d] < 0 || P.u[d] * cellSizePlusGap.u[d] > cellSize.u[d]))
+				{
+					return -1;
+				}
+			}
+		}
+
+		int xi = static_cast<int>(floor(P.x));
+		xi = std::min(std::max(xi, indexMins[0]), indexMaxs[0]);
+		int yi = static_cast<int>(floor(P.y));
+		yi = std::min(std::max(yi, indexMins[1]), indexMaxs[1]);
+		int zi = static_cast<int>(floor(P.z));
+		zi = std::min(std::max(zi, indexMins[2]), indexMaxs[2]);
+
+		if (withGap &&
+			!(	(P.x - static_cast<PointCoordinateType>(xi))*cellSizePlusGap.x <= cellSize.x
+			&&	(P.y - static_cast<PointCoordinateType>(yi))*cellSizePlusGap.y <= cellSize.y
+			&&	(P.z - static_cast<PointCoordinateType>(zi))*cellSizePlusGap.z <= cellSize.z))
+		{
+			return -1;
+		}
+
+		return ((zi - indexMins[2]) * gridDim[1] + (yi - indexMins[1])) * gridDim[0] + (xi - indexMins[0]);
+	}
+};
+
+//! Computes the bounding box of a cloud in a local coordinate system (in parallel if possible)
+static ccBBox ComputeLocalBoundingBox(const ccGenericPointCloud* cloud, const ccGLMatrix& localTrans)
+{
+	unsigned pointCount = cloud->size();
+	int chunkCount = static_cast<int>((pointCount + s_pointsChunkSize - 1) / s_pointsChunkSize);
+	std::vector<ccBBox> chunkBoxes(chunkCount);
+
+#ifdef USE_TBB
+	tbb::parallel_for(0, chunkCount, [&](int c)
+#else
+	for (int c = 0; c < chunkCount; ++c)
+#endif
+	{
+		unsigned firstIndex = static_cast<unsigned>(c) * s_pointsChunkSize;
+		unsigned lastIndex = std::min(firstIndex + s_pointsChunkSize, pointCount);
+		ccBBox& box = chunkBoxes[c];
+		for (unsigned i = firstIndex; i < lastIndex; ++i)
+		{
+			CCVector3 P = *cloud->getPoint(i);
+			localTrans.apply(P);
+			box.add(P);
+		}
+	}
+#ifdef USE_TBB
+	);
+#endif
+
+	ccBBox localBox;
+	for (const ccBBox& box : chunkBoxes)
+	{
+		if (box.isValid())
+			localBox += box;
+	}
+	return localBox;
+}
+
+//! Indexes of the points of a cloud, sorted by slice (CSR layout)
+struct CloudSlicesIndexes
+{
+	//! Start of each slice in the 'indexes' array (size = cell count + 1)
+	std::vector<unsigned> offsets;
+	//! Points indexes (sorted by slice, then by increasing index)
+	std::vector<unsigned> indexes;
+
+	//! Returns the number of points in a given slice
+	inline unsigned count(unsigned cellIndex) const { return offsets[cellIndex + 1] - offsets[cellIndex]; }
+};
+
+//! Sorts the points of a cloud by slice (in parallel if possible)
+/** Two passes: the points are first counted (per chunk of points and per slice),
+	then scattered in a single array. The output doesn't depend on the number of threads.
+	\return false if the process has been canceled
+**/
+static bool SortPointsBySlice(	const ccGenericPointCloud* cloud,
+								const SlicesGrid& grid,
+								CloudSlicesIndexes& slices,
+								CCLib::GenericProgressCallback* progressCb)
+{
+	const unsigned pointCount = cloud->size();
+	const unsigned cellCount = grid.cellCount;
+
+	//each chunk has its own histogram: we limit the memory they use
+	unsigned chunkSize = s_pointsChunkSize;
+	{
+		size_t maxChunkCount = std::max<size_t>(1, (static_cast<size_t>(1) << 24) / cellCount);
+		if ((pointCount + chunkSize - 1) / chunkSize > maxChunkCount)
+		{
+			chunkSize = static_cast<unsigned>((pointCount + maxChunkCount - 1) / maxChunkCount);
+		}
+	}
+	int chunkCount = static_cast<int>((static_cast<size_t>(pointCount) + chunkSize - 1) / chunkSize);
+
+	//number of points per chunk and per cell (then write position)
+	std::vector<unsigned> chunkCellPos;
+	chunkCellPos.resize(static_cast<size_t>(chunkCount) * cellCount, 0);
+
+	CCLib::NormalizedProgress nProgress(progressCb, 2 * static_cast<unsigned>(chunkCount));
+	std::atomic<bool> canceled(false);
+
+	//first pass: count the points
+#ifdef USE_TBB
+	tbb::parallel_for(0, chunkCount, [&](int c)
+#else
+	for (int c = 0; c < chunkCount; ++c)
+#endif
+	{
+		if (!canceled)
+		{
+			unsigned firstIndex = static_cast<unsigned>(c) * chunkSize;
+			unsigned lastIndex = std::min(firstIndex + chunkSize, pointCount);
+			unsigned* histogram = chunkCellPos.data() + static_cast<size_t>(c) * cellCount;
+			for (unsigned i = firstIndex; i < lastIndex; ++i)
+			{
+				int cellIndex = grid.cellIndex(*cloud->getPoint(i));
+				if (cellIndex >= 0)
+				{
+					++histogram[cellIndex];
+				}
+			}
+
+			if (!nProgress.oneStep())
+			{
+				canceled = true;
+			}
+		}
+	}
+#ifdef USE_TBB
+	);
+#endif
+
+	if (canceled)
+	{
+		return false;
+	}
+
+	//convert the counts to write positions (the points are sorted by cell, then by chunk)
+	slices.offsets.resize(static_cast<size_t>(cellCount) + 1);
+	unsigned totalCount = 0;
+	for (unsigned k = 0; k < cellCount; ++k)
+	{
+		slices.offsets[k] = totalCount;
+		for (int c = 0; c < chunkCount; ++c)
+		{
+			unsigned& pos = chunkCellPos[static_cast<size_t>(c) * cellCount + k];
+			unsigned count = pos;
+			pos = totalCount;
+			totalCount += count;
+		}
+	}
+	slices.offsets[cellCount] = totalCount;
+	slices.indexes.resize(totalCount);
+
+	//second pass: scatter the points indexes
+#ifdef USE_TBB
+	tbb::parallel_for(0, chunkCount, [&](int c)
+#else
+	for (int c = 0; c < chunkCount; ++c)
+#endif
+	{
+		if (!canceled)
+		{
+			unsigned firstIndex = static_cast<unsigned>(c) * chunkSize;
+			unsigned lastIndex = std::min(firstIndex + chunkSize, pointCount);
+			unsigned* writePos = chunkCellPos.data() + static_cast<size_t>(c) * cellCount;
+			for (unsigned i = firstIndex; i < lastIndex; ++i)
+			{
+				int cellIndex = grid.cellIndex(*cloud->getPoint(i));
+				if (cellIndex >= 0)
+				{
+					slices.indexes[writePos[cellIndex]++] = i;
+				}
+			}
+
+			if (!nProgress.oneStep())
+			{
+				canceled = true;
+			}
+		}
+	}
+#ifdef USE_TBB
+	);
+#endif
+
+	return !canceled;
+}
+
+//! Contour extraction parameters
+struct ContourParams
+{
+	bool multiPass;
+	PointCoordinateType maxEdgeLength;
+	bool splitContours;
+	const PointCoordinateType* preferredOrientation;
+	bool visualDebugMode;
+};
+
+//! Extracts the contour(s) of several slices (in parallel if possible)
+/** \return false if warnings were issued
+**/
+static bool ExtractContours(const std::vector<ccPointCloud*>& slices,
+							const ContourParams& params,
+							std::vector< std::vector<ccPolyline*> >& contours)
+{
+	contours.clear();
+	contours.resize(slices.size());
+
+	//0 = success, 1 = points too far from each other, 2 = failure
+	std::vector<int> status(slices.size(), 0);
+
+	auto extractContour = [&](int i)
+	{
+		ccPointCloud* sliceCloud = slices[i];
+		assert(sliceCloud);
+
+		std::vector<ccPolyline*>& polys = contours[i];
+		if (!ccContourExtractor::ExtractFlatContour(sliceCloud,
+													params.multiPass,
+													params.maxEdgeLength,
+													polys,
+													params.splitContours,
+													params.preferredOrientation,
+													params.visualDebugMode))
+		{
+			status[i] = 2;
+			return;
+		}
+		if (polys.empty())
+		{
+			status[i] = 1;
+			return;
+		}
+
+		for (size_t p = 0; p < polys.size(); ++p)
+		{
+			ccPolyline* poly = polys[p];
+			poly->setColor(ccColor::green);
+			poly->showColors(true);
+			poly->setGlobalScale(sliceCloud->getGlobalScale());
+			poly->setGlobalShift(sliceCloud->getGlobalShift());
+			QString contourName = sliceCloud->getName();
+			contourName.replace("slice", "contour");
+			if (polys.size() > 1)
+			{
+				contourName += QString(" (part %1)").arg(p + 1);
+			}
+			poly->setName(contourName);
+		}
+	};
+
+	int sliceCount = static_cast<int>(slices.size());
+	if (params.visualDebugMode)
+	{
+		//the debug window can only be used by the main thread
+		for (int i = 0; i < sliceCount; ++i)
+		{
+			extractContour(i);
+		}
+	}
+	else
+	{
+#ifdef USE_TBB
+		tbb::parallel_for(0, sliceCount, extractContour);
+#else
+		for (int i = 0; i < sliceCount; ++i)
+		{
+			extractContour(i);
+		}
+#endif
+	}
+
+	//report the warnings (in order)
+	bool success = true;
+	for (size_t i = 0; i < slices.size(); ++i)
+	{
+		if (status[i] == 1)
+		{
+			ccLog::Warning(QString("%1: points are too far from each other! Increase the max edge length").arg(slices[i]->getName()));
+			success = false;
+		}
+		else if (status[i] == 2)
+		{
+			ccLog::Warning(QString("%1: contour extraction failed!").arg(slices[i]->getName()));
+			success = false;
+		}
+	}
+
+	return success;
+}
+
 bool ccClippingBoxTool::ExtractSlicesAndContours
 (
 	const std::vector<ccGenericPointCloud*>& clouds,
@@ -511,7 +849,9 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 	bool projectOnBestFitPlane/*=false*/,
 	bool visualDebugMode/*=false*/,
 	bool generateRandomColors/*=false*/,
-	ccProgressDialog* progressDialog/*=0*/)
+	ccProgressDialog* progressDialog/*=0*/,
+	bool cropToBox/*=false*/,
+	SliceCallback sliceCallback/*=SliceCallback()*/)
 {
 	//check input
 	if (clouds.empty() && meshes.empty())
@@ -545,12 +885,30 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 	CCVector3 cellSize = clipBox.getOwnBB().getDiagVec();
 	CCVector3 cellSizePlusGap = cellSize + CCVector3(gap, gap, gap);
 
+	//contour extraction parameters
+	ContourParams contourParams;
+	contourParams.multiPass = multiPass;
+	contourParams.maxEdgeLength = maxEdgeLength;
+	contourParams.splitContours = splitContours;
+	contourParams.visualDebugMode = visualDebugMode;
+	contourParams.preferredOrientation = 0;
+
+	//preferred dimension?
+	ccGLMatrix invLocalTrans = localTrans.inverse();
+	if (repeatDimensionsSum == 1 && !projectOnBestFitPlane)
+	{
+		int preferredDim = -1;
+		for (int i = 0; i < 3; ++i)
+			if (repeatDimensions[i])
+				preferredDim = i;
+		contourParams.preferredOrientation = invLocalTrans.getColumn(preferredDim);
+	}
+
 	//apply process
 	try
 	{
 		bool error = false;
 		bool warningsIssued = false;
-		size_t cloudSliceCount = 0;
 
 		if (singleContourMode)
 		{
@@ -571,30 +929,53 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 				//error message already issued
 				return false;
 			}
-			cloudSliceCount = outputSlices.size();
+
+			//extract contour polylines (optionaly)
+			if (extractContours)
+			{
+				std::vector<ccPointCloud*> sliceClouds;
+				for (ccHObject* slice : outputSlices)
+				{
+					sliceClouds.push_back(ccHObjectCaster::ToPointCloud(slice));
+				}
+
+				std::vector< std::vector<ccPolyline*> > contours;
+				warningsIssued |= !ExtractContours(sliceClouds, contourParams, contours);
+				for (std::vector<ccPolyline*>& polys : contours)
+				{
+					outputContours.insert(outputContours.end(), polys.begin(), polys.end());
+				}
+			}
 		}
 		else //repeat mode
 		{
 			if (!clouds.empty()) //extract sections from clouds
 			{
+				SlicesGrid grid;
+				grid.localTrans = localTrans;
+				grid.origin = gridOrigin;
+				grid.cellSize = cellSize;
+				grid.cellSizePlusGap = cellSizePlusGap;
+				grid.withGap = (gap != 0);
+				grid.cropToBox = cropToBox;
+				for (int d = 0; d < 3; ++d)
+					grid.repeatDimensions[d] = repeatDimensions[d];
+
 				//compute 'grid' extents in the local clipping box ref.
 				ccBBox localBox;
 				for (ccGenericPointCloud* cloud : clouds)
 				{
-					for (unsigned i = 0; i < cloud->size(); ++i)
-					{
-						CCVector3 P = *cloud->getPoint(i);
-						localTrans.apply(P);
-						localBox.add(P);
-					}
+					ccBBox box = ComputeLocalBoundingBox(cloud, localTrans);
+					if (box.isValid())
+						localBox += box;
 				}
 
-				int indexMins[3], indexMaxs[3], gridDim[3];
-				unsigned cellCount = ComputeGridDimensions(localBox, repeatDimensions, indexMins, indexMaxs, gridDim, gridOrigin, cellSizePlusGap);
-
-				//we'll potentially create up to one (ref.) cloud per input loud and per cell
-				std::vector<CCLib::ReferenceCloud*> refClouds;
-				refClouds.resize(cellCount * clouds.size(), 0);
+				grid.cellCount = ComputeGridDimensions(localBox, repeatDimensions, grid.indexMins, grid.indexMaxs, grid.gridDim, gridOrigin, cellSizePlusGap);
+				if (grid.cellCount == 0)
+				{
+					//error message already issued
+					return false;
+				}
 
 				if (progressDialog)
 				{
@@ -604,166 +985,239 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 					progressDialog->setAutoClose(false);
 				}
 
-				unsigned subCloudsCount = 0;
-
-				//project points into grid
-				for (size_t ci = 0; ci != clouds.size(); ++ci)
+				//sort the points of each cloud by slice
+				std::vector<CloudSlicesIndexes> cloudsSlices(clouds.size());
+				for (size_t ci = 0; ci != clouds.size() && !error; ++ci)
 				{
 					ccGenericPointCloud* cloud = clouds[ci];
-					unsigned pointCount = cloud->size();
 
 					QString infos = tr("Cloud '%1").arg(cloud->getName());
-					infos += tr("Points: %L1").arg( pointCount );
+					infos += tr("Points: %L1").arg(cloud->size());
 					if (progressDialog)
 					{
 						progressDialog->setInfo(infos);
 					}
 					QApplication::processEvents();
 
-					CCLib::NormalizedProgress nProgress(progressDialog, pointCount);
-					for (unsigned i = 0; i < pointCount; ++i)
+					if (!SortPointsBySlice(cloud, grid, cloudsSlices[ci], progressDialog))
 					{
-						CCVector3 P = *cloud->getPoint(i);
-						localTrans.apply(P);
+						error = true;
+						ccLog::Warning(QString("[ExtractSlicesAndContours] Process canceled by user"));
+					}
+				}
 
-						//relative coordinates (between 0 and 1)
-						P -= gridOrigin;
-						P.x /= cellSizePlusGap.x;
-						P.y /= cellSizePlusGap.y;
-						P.z /= cellSizePlusGap.z;
-
-						int xi = static_cast<int>(floor(P.x));
-						xi = std::min(std::max(xi, indexMins[0]), indexMaxs[0]);
-						int yi = static_cast<int>(floor(P.y));
-						yi = std::min(std::max(yi, indexMins[1]), indexMaxs[1]);
-						int zi = static_cast<int>(floor(P.z));
-						zi = std::min(std::max(zi, indexMins[2]), indexMaxs[2]);
-
-						if (gap == 0 ||
-							(	(P.x - static_cast<PointCoordinateType>(xi))*cellSizePlusGap.x <= cellSize.x
-							&&	(P.y - static_cast<PointCoordinateType>(yi))*cellSizePlusGap.y <= cellSize.y
-							&&	(P.z - static_cast<PointCoordinateType>(zi))*cellSizePlusGap.z <= cellSize.z))
+				//list the (non empty) slices, in the same order as before
+				struct SliceDesc
+				{
+					size_t cloudIndex;
+					unsigned cellIndex;
+					int i, j, k;
+				};
+				std::vector<SliceDesc> slices;
+				for (int i = grid.indexMins[0]; i <= grid.indexMaxs[0] && !error; ++i)
+				{
+					for (int j = grid.indexMins[1]; j <= grid.indexMaxs[1]; ++j)
+					{
+						for (int k = grid.indexMins[2]; k <= grid.indexMaxs[2]; ++k)
 						{
-							int cloudIndex = ((zi - indexMins[2]) * static_cast<int>(gridDim[1]) + (yi - indexMins[1])) * static_cast<int>(gridDim[0]) + (xi - indexMins[0]);
-							assert(cloudIndex >= 0 && static_cast<size_t>(cloudIndex)* clouds.size() + ci < refClouds.size());
-
-							CCLib::ReferenceCloud*& destCloud = refClouds[cloudIndex * clouds.size() + ci];
-							if (!destCloud)
-							{
-								destCloud = new CCLib::ReferenceCloud(cloud);
-								++subCloudsCount;
-							}
+							int cellIndex = ((k - grid.indexMins[2]) * grid.gridDim[1] + (j - grid.indexMins[1])) * grid.gridDim[0] + (i - grid.indexMins[0]);
+							assert(cellIndex >= 0 && static_cast<unsigned>(cellIndex) < grid.cellCount);
 
-							if (!destCloud->addPointIndex(i))
+							for (size_t ci = 0; ci != clouds.size(); ++ci)
 							{
-								ccLog::Error("Not enough memory!");
-								error = true;
-								break;
+								if (cloudsSlices[ci].count(cellIndex) != 0) //some slices can be empty!
+								{
+									SliceDesc desc;
+									desc.cloudIndex = ci;
+									desc.cellIndex = static_cast<unsigned>(cellIndex);
+									desc.i = i;
+									desc.j = j;
+									desc.k = k;
+									slices.push_back(desc);
+								}
 							}
 						}
 					}
+				}
 
-					nProgress.oneStep();
-				} //project points into grid
+				//random colors are drawn beforehand (so that they don't depend on the processing order)
+				std::vector<ccColor::Rgb> sliceColors;
+				if (generateRandomColors)
+				{
+					sliceColors.resize(slices.size());
+					for (ccColor::Rgb& col : sliceColors)
+					{
+						col = ccColor::Generator::Random();
+					}
+				}
 
 				if (progressDialog)
 				{
 					progressDialog->setWindowTitle(QObject::tr("Section extraction"));
-					progressDialog->setInfo(QObject::tr("Section(s): %L1").arg(subCloudsCount));
-					progressDialog->setMaximum(static_cast<int>(subCloudsCount));
+					progressDialog->setInfo(QObject::tr("Section(s): %L1").arg(slices.size()));
+					progressDialog->setMaximum(static_cast<int>(slices.size()));
 					progressDialog->setValue(0);
 					QApplication::processEvents();
 				}
 
-				//reset count
-				subCloudsCount = 0;
+				//the slices are created (and their contours extracted) by batches
+				//(only one batch if they are all kept in memory)
+				size_t batchSize = slices.size();
+				if (sliceCallback)
+				{
+					batchSize = std::max<size_t>(1, 4 * static_cast<size_t>(QThread::idealThreadCount()));
+				}
 
-				//now create the real clouds
-				for (int i = indexMins[0]; i <= indexMaxs[0]; ++i)
+				for (size_t batchStart = 0; batchStart < slices.size() && !error; batchStart += batchSize)
 				{
-					for (int j = indexMins[1]; j <= indexMaxs[1]; ++j)
+					size_t batchEnd = std::min(batchStart + batchSize, slices.size());
+					int batchCount = static_cast<int>(batchEnd - batchStart);
+
+					//generate the slices from the sorted indexes
+					std::vector<ccPointCloud*> batchSlices(batchCount, nullptr);
+					std::vector<int> batchWarnings(batchCount, 0);
+					std::atomic<bool> batchError(false);
+
+#ifdef USE_TBB
+					tbb::parallel_for(0, batchCount, [&](int n)
+#else
+					for (int n = 0; n < batchCount; ++n)
+#endif
 					{
-						for (int k = indexMins[2]; k <= indexMaxs[2]; ++k)
-						{
-							int cloudIndex = ((k - indexMins[2]) * static_cast<int>(gridDim[1]) + (j - indexMins[1])) * static_cast<int>(gridDim[0]) + (i - indexMins[0]);
-							assert(cloudIndex >= 0 && static_cast<size_t>(cloudIndex)* clouds.size() < refClouds.size());
+						const SliceDesc& desc = slices[batchStart + n];
+						ccGenericPointCloud* cloud = clouds[desc.cloudIndex];
+						const CloudSlicesIndexes& cloudSlices = cloudsSlices[desc.cloudIndex];
 
-							for (size_t ci = 0; ci != clouds.size(); ++ci)
+						ccPointCloud* sliceCloud = nullptr;
+						try
+						{
+							CCLib::ReferenceCloud selection(cloud);
+							unsigned firstIndex = cloudSlices.offsets[desc.cellIndex];
+							unsigned lastIndex = cloudSlices.offsets[desc.cellIndex + 1];
+							if (selection.reserve(lastIndex - firstIndex))
 							{
-								ccGenericPointCloud* cloud = clouds[ci];
-								CCLib::ReferenceCloud* destCloud = refClouds[cloudIndex * clouds.size() + ci];
-								if (destCloud) //some slices can be empty!
+								for (unsigned index = firstIndex; index < lastIndex; ++index)
 								{
-									//generate slice from previous selection
-									int warnings = 0;
-									ccPointCloud* sliceCloud = cloud->isA(CC_TYPES::POINT_CLOUD) ? static_cast<ccPointCloud*>(cloud)->partialClone(destCloud, &warnings) : ccPointCloud::From(destCloud, cloud);
-									warningsIssued |= (warnings != 0);
+									selection.addPointIndex(cloudSlices.indexes[index]);
+								}
 
-									if (sliceCloud)
-									{
-										if (generateRandomColors)
-										{
-											ccColor::Rgb col = ccColor::Generator::Random();
-											if (!sliceCloud->setRGBColor(col))
-											{
-												ccLog::Error("Not enough memory!");
-												error = true;
-												i = indexMaxs[0];
-												j = indexMaxs[1];
-												k = indexMaxs[2];
-											}
-											sliceCloud->showColors(true);
-										}
+								sliceCloud = cloud->isA(CC_TYPES::POINT_CLOUD) ? static_cast<ccPointCloud*>(cloud)->partialClone(&selection, &batchWarnings[n]) : ccPointCloud::From(&selection, cloud);
+							}
+						}
+						catch (const std::bad_alloc&)
+						{
+							sliceCloud = nullptr;
+						}
 
-										sliceCloud->setEnabled(true);
-										sliceCloud->setVisible(true);
-										sliceCloud->setDisplay(cloud->getDisplay());
+						if (sliceCloud && generateRandomColors)
+						{
+							if (!sliceCloud->setRGBColor(sliceColors[batchStart + n]))
+							{
+								delete sliceCloud;
+								sliceCloud = nullptr;
+							}
+							else
+							{
+								sliceCloud->showColors(true);
+							}
+						}
 
-										CCVector3 cellOrigin(	gridOrigin.x + i * cellSizePlusGap.x,
-																gridOrigin.y + j * cellSizePlusGap.y,
-																gridOrigin.z + k * cellSizePlusGap.z);
-										QString slicePosStr = QString("(%1 ; %2 ; %3)").arg(cellOrigin.x).arg(cellOrigin.y).arg(cellOrigin.z);
-										sliceCloud->setName(QString("slice @ ") + slicePosStr);
+						if (sliceCloud)
+						{
+							sliceCloud->setEnabled(true);
+							sliceCloud->setVisible(true);
+							sliceCloud->setDisplay(cloud->getDisplay());
+
+							CCVector3 cellOrigin(	gridOrigin.x + desc.i * cellSizePlusGap.x,
+													gridOrigin.y + desc.j * cellSizePlusGap.y,
+													gridOrigin.z + desc.k * cellSizePlusGap.z);
+							QString slicePosStr = QString("(%1 ; %2 ; %3)").arg(cellOrigin.x).arg(cellOrigin.y).arg(cellOrigin.z);
+							sliceCloud->setName(QString("slice @ ") + slicePosStr);
+						}
+						else
+						{
+							batchError = true;
+						}
 
-										//add slice to group
-										outputSlices.push_back(sliceCloud);
-										++subCloudsCount;
+						batchSlices[n] = sliceCloud;
+					}
+#ifdef USE_TBB
+					);
+#endif
 
-										if (progressDialog)
-										{
-											progressDialog->setValue(static_cast<int>(subCloudsCount));
-										}
-									}
+					for (int warnings : batchWarnings)
+					{
+						warningsIssued |= (warnings != 0);
+					}
 
-									if (progressDialog && progressDialog->wasCanceled())
-									{
-										error = true;
-										ccLog::Warning(QString("[ExtractSlicesAndContours] Process canceled by user"));
-										//early stop
-										i = indexMaxs[0];
-										j = indexMaxs[1];
-										k = indexMaxs[2];
-										break;
-									}
-								}
+					if (batchError)
+					{
+						ccLog::Error("Not enough memory!");
+						error = true;
+					}
+
+					//extract contour polylines (optionaly)
+					std::vector< std::vector<ccPolyline*> > batchContours;
+					if (!error && extractContours)
+					{
+						if (progressDialog && !visualDebugMode)
+						{
+							QApplication::processEvents();
+						}
+						warningsIssued |= !ExtractContours(batchSlices, contourParams, batchContours);
+					}
+					batchContours.resize(batchCount);
+
+					//output the slices (and their contours) in order
+					for (int n = 0; n < batchCount; ++n)
+					{
+						ccPointCloud* sliceCloud = batchSlices[n];
+						std::vector<ccPolyline*>& polys = batchContours[n];
+
+						if (error || !sliceCloud)
+						{
+							delete sliceCloud;
+							for (ccPolyline* poly : polys)
+								delete poly;
+							continue;
+						}
+
+						if (sliceCallback)
+						{
+							const SliceDesc& desc = slices[batchStart + n];
+							CCVector3 cellOrigin(	gridOrigin.x + desc.i * cellSizePlusGap.x,
+													gridOrigin.y + desc.j * cellSizePlusGap.y,
+													gridOrigin.z + desc.k * cellSizePlusGap.z);
+
+							//the callback takes the ownership of the slice and its contours
+							if (!sliceCallback(sliceCloud, polys, cellOrigin))
+							{
+								error = true;
 							}
 						}
+						else
+						{
+							//add slice to group
+							outputSlices.push_back(sliceCloud);
+							outputContours.insert(outputContours.end(), polys.begin(), polys.end());
+						}
 					}
-				} //now create the real clouds
 
-				//release memory
-				{
-					for (size_t i = 0; i < refClouds.size(); ++i)
-						if (refClouds[i])
-							delete refClouds[i];
-					refClouds.clear();
+					if (progressDialog)
+					{
+						progressDialog->setValue(static_cast<int>(batchEnd));
+						QApplication::processEvents();
+						if (progressDialog->wasCanceled())
+						{
+							error = true;
+							ccLog::Warning(QString("[ExtractSlicesAndContours] Process canceled by user"));
+						}
+					}
 				}
 
-				cloudSliceCount = outputSlices.size();
-
 			} //extract sections from clouds
 
-			if (!meshes.empty()) //extract sections from meshes
+			if (!meshes.empty() && !error) //extract sections from meshes
 			{
 				//compute 'grid' extents in the local clipping box ref.
 				ccBBox localBox;
@@ -868,95 +1322,6 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 
 		} //repeat mode
 
-		//extract contour polylines (optionaly)
-		if (!error && extractContours && cloudSliceCount != 0)
-		{
-			if (progressDialog)
-			{
-				progressDialog->setWindowTitle("Contour extraction");
-				progressDialog->setInfo(QObject::tr("Contour(s): %L1").arg(cloudSliceCount));
-				progressDialog->setMaximum(static_cast<int>(cloudSliceCount));
-				if (!visualDebugMode)
-				{
-					progressDialog->show();
-					QApplication::processEvents();
-				}
-			}
-
-			//preferred dimension?
-			int preferredDim = -1;
-			if (repeatDimensionsSum == 1 && !projectOnBestFitPlane)
-			{
-				for (int i = 0; i < 3; ++i)
-					if (repeatDimensions[i])
-						preferredDim = i;
-			}
-			ccGLMatrix invLocalTrans = localTrans.inverse();
-			PointCoordinateType* preferredOrientation = (preferredDim != -1 ? invLocalTrans.getColumn(preferredDim) : 0);
-
-			assert(cloudSliceCount < outputSlices.size());
-
-			//process all the slices originating from point clouds
-			for (size_t i = 0; i < cloudSliceCount; ++i)
-			{
-				ccPointCloud* sliceCloud = ccHObjectCaster::ToPointCloud(outputSlices[i]);
-				assert(sliceCloud);
-
-				std::vector<ccPolyline*> polys;
-				if (ccContourExtractor::ExtractFlatContour(sliceCloud,
-					multiPass,
-					maxEdgeLength,
-					polys,
-					splitContours,
-					preferredOrientation,
-					visualDebugMode))
-				{
-					if (!polys.empty())
-					{
-						for (size_t p = 0; p < polys.size(); ++p)
-						{
-							ccPolyline* poly = polys[p];
-							poly->setColor(ccColor::green);
-							poly->showColors(true);
-							poly->setGlobalScale(sliceCloud->getGlobalScale());
-							poly->setGlobalShift(sliceCloud->getGlobalShift());
-							QString contourName = sliceCloud->getName();
-							contourName.replace("slice", "contour");
-							if (polys.size() > 1)
-							{
-								contourName += QString(" (part %1)").arg(p + 1);
-							}
-							poly->setName(contourName);
-							outputContours.push_back(poly);
-						}
-					}
-					else
-					{
-						ccLog::Warning(QString("%1: points are too far from each other! Increase the max edge length").arg(sliceCloud->getName()));
-						warningsIssued = true;
-					}
-				}
-				else
-				{
-					ccLog::Warning(QString("%1: contour extraction failed!").arg(sliceCloud->getName()));
-					warningsIssued = true;
-				}
-
-				if (progressDialog && !visualDebugMode)
-				{
-					if (progressDialog->wasCanceled())
-					{
-						error = true;
-						ccLog::Warning(QString("[ExtractSlicesAndContours] Process canceled by user"));
-						//early stop
-						break;
-					}
-					progressDialog->setValue(static_cast<int>(i));
-				}
-			}
-
-		} //extract contour polylines
-
 		//release memory
 		if (error || singleContourMode)
 		{
@@ -973,6 +1338,7 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 			{
 				delete poly;
 			}
+			outputContours.clear();
 			return false;
 		}
 		else if (warningsIssued)
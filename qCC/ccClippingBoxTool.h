@@ -27,6 +27,7 @@
 #include <ccGLUtils.h>
 
 //system
+#include <functional>
 #include <vector>
 
 class ccGenericPointCloud;
@@ -66,6 +67,18 @@ public:
 	//! Returns the current number of associated entities
 	unsigned getNumberOfAssociatedEntity() const;
 
+	//! Callback called for each slice extracted from a cloud (in repeat mode)
+	/** The callback takes the ownership of the slice and of its contours (if any).
+		If set, the slices and contours are not stored in the output vectors: they are
+		generated (in parallel) by small batches and passed to the callback in order,
+		so that only a few slices are in memory at the same time.
+		\param slice slice (cloud)
+		\param contours slice contours (if any)
+		\param cellOrigin origin of the slice cell (in the clipping box local coordinate system)
+		\return false to stop the process
+	**/
+	using SliceCallback = std::function<bool(ccHObject* slice, std::vector<ccPolyline*>& contours, const CCVector3& cellOrigin)>;
+
 	//! Extract slices and optionally contours from various clouds and/or clouds
 	/** \param clouds input clouds (may be empty if meshes are defined)
 		\param meshes input meshes (may be empty if clouds are defined)
@@ -83,6 +96,8 @@ public:
 		\param visualDebugMode displays a 'debugging' window during the contour extraction process
 		\param generateRandomColors randomly colors the extracted slices
 		\param progressDialog optional progress dialog
+		\param cropToBox in repeat mode, whether to ignore the points that lie outside of the box along the dimensions that are not repeated
+		\param sliceCallback optional callback (see SliceCallback)
 	**/
 	static bool ExtractSlicesAndContours
 		(
@@ -101,7 +116,9 @@ public:
 		bool projectOnBestFitPlane = false,
 		bool visualDebugMode = false,
 		bool generateRandomColors = false,
-		ccProgressDialog* progressDialog = 0);
+		ccProgressDialog* progressDialog = 0,
+		bool cropToBox = false,
+		SliceCallback sliceCallback = SliceCallback());
 
 protected slots:
 
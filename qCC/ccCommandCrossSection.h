@@ -3,6 +3,12 @@
 
 #include "ccCommandLineInterface.h"
 
+//to extract the slices of clouds
+#include "ccClippingBoxTool.h"
+
+//qCC_db
+#include <ccClipBox.h>
+
 //to read the 'Cross Section' tool XML parameters file
 #include <QXmlStreamReader>
 
@@ -351,6 +357,65 @@ struct CommandCrossSection : public ccCommandLineInterface::Command
 
 					cmd.print(QString("Will extract up to (%1 x %2 x %3) = %4 sections").arg(steps[0]).arg(steps[1]).arg(steps[2]).arg(steps[0] * steps[1] * steps[2]));
 
+					if (i < cmd.clouds().size() && repeatGap >= 0)
+					{
+						//for clouds, the points are sorted by slice in a single (parallel) pass
+						//and the slices are generated and saved by small batches
+						ccClipBox clipBox;
+						clipBox.setBox(ccBBox(C0 - boxThickness / 2, C0 + boxThickness / 2));
+
+						QString errorStr;
+						ccClippingBoxTool::SliceCallback saveSlice = [&](ccHObject* slice, std::vector<ccPolyline*>& contours, const CCVector3& cellOrigin) -> bool
+						{
+							assert(contours.empty());
+							CCVector3 C = cellOrigin + boxThickness / 2;
+							cmd.print(QString("Box (%1;%2;%3) --> (%4;%5;%6)")
+								.arg(cellOrigin.x).arg(cellOrigin.y).arg(cellOrigin.z)
+								.arg(cellOrigin.x + boxThickness.x).arg(cellOrigin.y + boxThickness.y).arg(cellOrigin.z + boxThickness.z)
+								);
+
+							QString outputBasename = basename + QString("_%1_%2_%3").arg(C.x).arg(C.y).arg(C.z);
+							CLCloudDesc desc(static_cast<ccPointCloud*>(slice),
+								outputBasename,
+								outputDir.absolutePath(),
+								entities.size() > 1 ? static_cast<int>(i) : -1);
+							errorStr = cmd.exportEntity(desc);
+
+							delete slice;
+							slice = 0;
+
+							return errorStr.isEmpty();
+						};
+
+						std::vector<ccGenericPointCloud*> clouds(1, cmd.clouds()[i].pc);
+						std::vector<ccHObject*> outputSlices;
+						std::vector<ccPolyline*> outputContours;
+						if (!ccClippingBoxTool::ExtractSlicesAndContours(clouds,
+																		std::vector<ccGenericMesh*>(),
+																		clipBox,
+																		false,
+																		repeatDim,
+																		outputSlices,
+																		false,
+																		0,
+																		outputContours,
+																		static_cast<PointCoordinateType>(repeatGap),
+																		false,
+																		false,
+																		false,
+																		false,
+																		false,
+																		0,
+																		true,
+																		saveSlice))
+						{
+							if (!errorStr.isEmpty())
+								return cmd.error(errorStr);
+							return cmd.error(QString("Failed to extract the sections of cloud '%1'").arg(ent->getName()));
+						}
+						continue;
+					}
+
 					//now extract the slices
 					for (unsigned dx = 0; dx < steps[0]; ++dx)
 					{
@@ -7,7 +7,9 @@
 #include <AutoSegmentationTools.h>
 #include <CCConst.h>
 #include <CloudSamplingTools.h>
+#include <NearestNeighboursTable.h>
 #include <NormalDistribution.h>
+#include <QuantizedCoordinates.h>
 #include <StatisticalTestingTools.h>
 #include <WeibullDistribution.h>
 #include <MeshSamplingTools.h>
@@ -22,6 +24,7 @@
 
 //qCC_io
 #include <AsciiFilter.h>
+#include <BinFilter.h>
 #include <FBXFilter.h>
 #include <PlyFilter.h>
 
@@ -33,11 +36,18 @@
 #include "ccLibAlgorithms.h"
 #include "ccRegistrationTools.h"
 #include "ccScalarFieldArithmeticsDlg.h"
+#include "ccScalarFieldExpression.h"
+#include "ccPointCloudInterpolator.h"
 
 #include <ui_commandLineDlg.h>
 
 //Qt
 #include <QDateTime>
+#include <QElapsedTimer>
+#include <QTemporaryFile>
+
+//system
+#include <algorithm>
 
 //commands
 static const char COMMAND_CLOUD_EXPORT_FORMAT[]				= "C_EXPORT_FMT";
@@ -76,6 +86,8 @@ static const char COMMAND_BEST_FIT_PLANE_KEEP_LOADED[]		= "KEEP_LOADED";
 static const char COMMAND_ORIENT_NORMALS[]					= "ORIENT_NORMS_MST";
 static const char COMMAND_SOR_FILTER[]						= "SOR";
 static const char COMMAND_SAMPLE_MESH[]						= "SAMPLE_MESH";
+static const char COMMAND_LAPLACIAN_SMOOTH[]				= "LAPLACIAN_SMOOTH";	//+ iterations + factor
+static const char COMMAND_SUBDIVIDE[]						= "SUBDIVIDE";			//+ max triangle area
 static const char COMMAND_CROSS_SECTION[]					= "CROSS_SECTION";
 static const char COMMAND_CROP[]							= "CROP";
 static const char COMMAND_CROP_OUTSIDE[]					= "OUTSIDE";
@@ -95,6 +107,14 @@ static const char COMMAND_DELAUNAY_BF[]						= "BEST_FIT";
 static const char COMMAND_DELAUNAY_MAX_EDGE_LENGTH[]		= "MAX_EDGE_LENGTH";
 static const char COMMAND_SF_ARITHMETIC[]					= "SF_ARITHMETIC";
 static const char COMMAND_SF_OP[]							= "SF_OP";
+static const char COMMAND_SF_EXPRESSION[]					= "SF_EXPR";
+static const char COMMAND_SF_INTERP[]						= "SF_INTERP";			//+ SF index (or 'ALL')
+static const char COMMAND_SF_INTERP_SOURCE_IS_LAST[]		= "SOURCE_IS_LAST";
+static const char COMMAND_SF_INTERP_RADIUS[]				= "RADIUS";
+static const char COMMAND_SF_INTERP_KNN[]					= "KNN";
+static const char COMMAND_SF_INTERP_ALGO[]					= "ALGO";				//+ AVG/MEDIAN/GAUSS/IDW
+static const char COMMAND_SF_INTERP_SIGMA[]					= "SIGMA";
+static const char COMMAND_SF_INTERP_POWER[]					= "POWER";
 static const char COMMAND_COORD_TO_SF[]						= "COORD_TO_SF";
 static const char COMMAND_EXTRACT_VERTICES[]				= "EXTRACT_VERTICES";
 static const char COMMAND_ICP[]								= "ICP";
@@ -110,6 +130,8 @@ static const char COMMAND_ICP_USE_DATA_SF_AS_WEIGHT[]		= "DATA_SF_AS_WEIGHTS";
 static const char COMMAND_ICP_ROT[]				= "ROT";
 static const char COMMAND_FBX_EXPORT_FORMAT[]				= "FBX_EXPORT_FMT";
 static const char COMMAND_PLY_EXPORT_FORMAT[]				= "PLY_EXPORT_FMT";
+static const char COMMAND_BIN_QUANTIZATION[]				= "BIN_QUANTIZE";			//+ step (0 = disabled)
+static const char COMMAND_QUANTIZATION_BENCHMARK[]			= "QUANTIZATION_BENCH";		//+ step
 static const char COMMAND_COMPUTE_GRIDDED_NORMALS[]			= "COMPUTE_NORMALS";
 static const char COMMAND_COMPUTE_OCTREE_NORMALS[]			= "OCTREE_NORMALS";
 static const char COMMAND_CLEAR_NORMALS[]					= "CLEAR_NORMALS";
@@ -118,22 +140,34 @@ static const char COMMAND_VOLUME_TO_FILE[]					= "TO_FILE";
 static const char COMMAND_SAVE_CLOUDS[]						= "SAVE_CLOUDS";
 static const char COMMAND_SAVE_MESHES[]						= "SAVE_MESHES";
 static const char COMMAND_AUTO_SAVE[]						= "AUTO_SAVE";
+static const char COMMAND_ASYNC_SAVE[]						= "ASYNC_SAVE";
 static const char COMMAND_LOG_FILE[]						= "LOG_FILE";
+static const char COMMAND_PROFILE[]							= "PROFILE";			//+ report filename
 static const char COMMAND_CLEAR[]							= "CLEAR";
 static const char COMMAND_CLEAR_CLOUDS[]					= "CLEAR_CLOUDS";
 static const char COMMAND_POP_CLOUDS[]						= "POP_CLOUDS";
 static const char COMMAND_CLEAR_MESHES[]					= "CLEAR_MESHES";
 static const char COMMAND_POP_MESHES[]						= "POP_MESHES";
 static const char COMMAND_NO_TIMESTAMP[]					= "NO_TIMESTAMP";
+static const char COMMAND_PARALLEL_ENTITIES[]				= "PARALLEL_ENTITIES";	//+ max number of entities processed concurrently
 
 //options / modifiers
 static const char COMMAND_MAX_THREAD_COUNT[]				= "MAX_TCOUNT";
+static const char COMMAND_PARALLEL_MEM_BUDGET[]				= "MEM_BUDGET";		//+ memory budget (in MB)
 static const char OPTION_ALL_AT_ONCE[]						= "ALL_AT_ONCE";
 static const char OPTION_ON[]								= "ON";
 static const char OPTION_OFF[]								= "OFF";
 static const char OPTION_LAST[]								= "LAST";
 static const char OPTION_FILE_NAMES[]						= "FILE";
 
+//! Returns the (rough) memory footprint of a job processing one of the loaded clouds
+/** The job is expected to (at most) duplicate the cloud.
+**/
+static ccCommandLineInterface::EntityFootprint CloudJobFootprint(ccCommandLineInterface& cmd)
+{
+	return [&cmd](size_t index) { return 2 * ccCommandLineInterface::EstimateCloudFootprint(cmd.clouds()[index].pc); };
+}
+
 struct CommandChangeOutputFormat : public ccCommandLineInterface::Command
 {
 	CommandChangeOutputFormat(QString name, QString keyword) : ccCommandLineInterface::Command(name, keyword) {}
@@ -599,7 +633,7 @@ struct CommandSubsample : public ccCommandLineInterface::Command
 			}
 			cmd.print(QObject::tr("\tOutput points: %1").arg(count));
 
-			for (size_t i = 0; i < cmd.clouds().size(); ++i)
+			bool success = cmd.processEntities(cmd.clouds().size(), [&](size_t i) -> bool
 			{
 				ccPointCloud* cloud = cmd.clouds()[i].pc;
 				cmd.print(QObject::tr("\tProcessing cloud #%1 (%2)").arg(i + 1).arg(!cloud->getName().isEmpty() ? cloud->getName() : "no name"));
@@ -640,6 +674,13 @@ struct CommandSubsample : public ccCommandLineInterface::Command
 				{
 					return cmd.error("Not enough memory!");
 				}
+
+				return true;
+			}, CloudJobFootprint(cmd));
+
+			if (!success)
+			{
+				return false;
 			}
 		}
 		else if (method == "SPATIAL")
@@ -656,7 +697,7 @@ struct CommandSubsample : public ccCommandLineInterface::Command
 			}
 			cmd.print(QObject::tr("\tSpatial step: %1").arg(step));
 
-			for (size_t i = 0; i < cmd.clouds().size(); ++i)
+			bool success = cmd.processEntities(cmd.clouds().size(), [&](size_t i) -> bool
 			{
 				ccPointCloud* cloud = cmd.clouds()[i].pc;
 				cmd.print(QObject::tr("\tProcessing cloud #%1 (%2)").arg(i + 1).arg(!cloud->getName().isEmpty() ? cloud->getName() : "no name"));
@@ -698,6 +739,13 @@ struct CommandSubsample : public ccCommandLineInterface::Command
 				{
 					return cmd.error("Not enough memory!");
 				}
+
+				return true;
+			}, CloudJobFootprint(cmd));
+
+			if (!success)
+			{
+				return false;
 			}
 		}
 		else if (method == "OCTREE")
@@ -716,13 +764,13 @@ struct CommandSubsample : public ccCommandLineInterface::Command
 			cmd.print(QObject::tr("\tOctree level: %1").arg(octreeLevel));
 
 			QScopedPointer<ccProgressDialog> progressDialog(0);
-			if (!cmd.silentMode())
+			if (!cmd.silentMode() && !cmd.parallelEntitiesMode())
 			{
 				progressDialog.reset(new ccProgressDialog(false, cmd.widgetParent()));
 				progressDialog->setAutoClose(false);
 			}
 
-			for (size_t i = 0; i < cmd.clouds().size(); ++i)
+			bool success = cmd.processEntities(cmd.clouds().size(), [&](size_t i) -> bool
 			{
 				ccPointCloud* cloud = cmd.clouds()[i].pc;
 				cmd.print(QObject::tr("\tProcessing cloud #%1 (%2)").arg(i + 1).arg(!cloud->getName().isEmpty() ? cloud->getName() : "no name"));
@@ -766,13 +814,20 @@ struct CommandSubsample : public ccCommandLineInterface::Command
 				{
 					return cmd.error("Not enough memory!");
 				}
-			}
+
+				return true;
+			}, CloudJobFootprint(cmd));
 
 			if (progressDialog)
 			{
 				progressDialog->close();
 				QCoreApplication::processEvents();
 			}
+
+			if (!success)
+			{
+				return false;
+			}
 		}
 		else
 		{
@@ -941,6 +996,30 @@ struct CommandExtractCCs : public ccCommandLineInterface::Command
 	}
 };
 
+//! Applies a CCLib algorithm on each loaded cloud (concurrently if possible)
+static bool ApplyCCLibAlgorithmOnClouds(ccCommandLineInterface& cmd, ccLibAlgorithms::CC_LIB_ALGORITHM algo, void** additionalParameters, const QString& suffix)
+{
+	return cmd.processEntities(cmd.clouds().size(), [&](size_t i) -> bool
+	{
+		//Call MainWindow generic method
+		ccHObject::Container entities;
+		entities.push_back(cmd.clouds()[i].pc);
+
+		if (ccLibAlgorithms::ApplyCCLibAlgorithm(algo, entities, cmd.widgetParent(), additionalParameters))
+		{
+			//save output
+			if (cmd.autoSaveMode())
+			{
+				QString errorStr = cmd.exportEntity(cmd.clouds()[i], suffix);
+				if (!errorStr.isEmpty())
+					return cmd.error(errorStr);
+			}
+		}
+
+		return true;
+	}, CloudJobFootprint(cmd));
+}
+
 struct CommandCurvature : public ccCommandLineInterface::Command
 {
 	CommandCurvature() : ccCommandLineInterface::Command("Curvature", COMMAND_CURVATURE) {}
@@ -984,20 +1063,8 @@ struct CommandCurvature : public ccCommandLineInterface::Command
 		if (cmd.clouds().empty())
 			return cmd.error(QObject::tr("No point cloud on which to compute curvature! (be sure to open one with \"-%1 [cloud filename]\" before \"-%2\")").arg(COMMAND_OPEN, COMMAND_CURVATURE));
 
-		//Call MainWindow generic method
 		void* additionalParameters[2] = { &curvType, &kernelSize };
-		ccHObject::Container entities;
-		entities.resize(cmd.clouds().size());
-		for (size_t i = 0; i < cmd.clouds().size(); ++i)
-			entities[i] = cmd.clouds()[i].pc;
-
-		if (ccLibAlgorithms::ApplyCCLibAlgorithm(ccLibAlgorithms::CCLIB_ALGO_CURVATURE, entities, cmd.widgetParent(), additionalParameters))
-		{
-			//save output
-			if (cmd.autoSaveMode() && !cmd.saveClouds(QObject::tr("%1_CURVATURE_KERNEL_%2").arg(curvTypeStr).arg(kernelSize)))
-				return false;
-		}
-		return true;
+		return ApplyCCLibAlgorithmOnClouds(cmd, ccLibAlgorithms::CCLIB_ALGO_CURVATURE, additionalParameters, QObject::tr("%1_CURVATURE_KERNEL_%2").arg(curvTypeStr).arg(kernelSize));
 	}
 };
 
@@ -1038,12 +1105,6 @@ struct CommandApproxDensity : public ccCommandLineInterface::Command
 		if (cmd.clouds().empty())
 			return cmd.error(QObject::tr("No point cloud on which to compute approx. density! (be sure to open one with \"-%1 [cloud filename]\" before \"-%2\")").arg(COMMAND_OPEN, COMMAND_APPROX_DENSITY));
 
-		//Call MainWindow generic method
-		ccHObject::Container entities;
-		entities.resize(cmd.clouds().size());
-		for (size_t i = 0; i < cmd.clouds().size(); ++i)
-			entities[i] = cmd.clouds()[i].pc;
-
 		//optional parameter: density type
 		CCLib::GeometricalAnalysisTools::Density densityType = CCLib::GeometricalAnalysisTools::DENSITY_3D;
 		if (!cmd.arguments().empty())
@@ -1061,15 +1122,7 @@ struct CommandApproxDensity : public ccCommandLineInterface::Command
 			}
 		}
 		void* additionalParameters[] = { &densityType };
-
-		if (ccLibAlgorithms::ApplyCCLibAlgorithm(ccLibAlgorithms::CCLIB_ALGO_APPROX_DENSITY, entities, cmd.widgetParent(), additionalParameters))
-		{
-			//save output
-			if (cmd.autoSaveMode() && !cmd.saveClouds("APPROX_DENSITY"))
-				return false;
-		}
-
-		return true;
+		return ApplyCCLibAlgorithmOnClouds(cmd, ccLibAlgorithms::CCLIB_ALGO_APPROX_DENSITY, additionalParameters, "APPROX_DENSITY");
 	}
 };
 
@@ -1111,21 +1164,8 @@ struct CommandDensity : public ccCommandLineInterface::Command
 		if (cmd.clouds().empty())
 			return cmd.error(QObject::tr("No point cloud on which to compute density! (be sure to open one with \"-%1 [cloud filename]\" before \"-%2\")").arg(COMMAND_OPEN, COMMAND_DENSITY));
 
-		//Call MainWindow generic method
 		void* additionalParameters[] = { &kernelSize, &densityType };
-		ccHObject::Container entities;
-		entities.resize(cmd.clouds().size());
-		for (size_t i = 0; i < cmd.clouds().size(); ++i)
-			entities[i] = cmd.clouds()[i].pc;
-
-		if (ccLibAlgorithms::ApplyCCLibAlgorithm(ccLibAlgorithms::CCLIB_ALGO_ACCURATE_DENSITY, entities, cmd.widgetParent(), additionalParameters))
-		{
-			//save output
-			if (cmd.autoSaveMode() && !cmd.saveClouds("DENSITY"))
-				return false;
-		}
-
-		return true;
+		return ApplyCCLibAlgorithmOnClouds(cmd, ccLibAlgorithms::CCLIB_ALGO_ACCURATE_DENSITY, additionalParameters, "DENSITY");
 	}
 };
 
@@ -1212,21 +1252,8 @@ struct CommandRoughness : public ccCommandLineInterface::Command
 		if (cmd.clouds().empty())
 			return cmd.error(QObject::tr("No point cloud on which to compute roughness! (be sure to open one with \"-%1 [cloud filename]\" before \"-%2\")").arg(COMMAND_OPEN, COMMAND_ROUGHNESS));
 
-		//Call MainWindow generic method
 		void* additionalParameters[1] = { &kernelSize };
-		ccHObject::Container entities;
-		entities.resize(cmd.clouds().size());
-		for (size_t i = 0; i < cmd.clouds().size(); ++i)
-			entities[i] = cmd.clouds()[i].pc;
-
-		if (ccLibAlgorithms::ApplyCCLibAlgorithm(ccLibAlgorithms::CCLIB_ALGO_ROUGHNESS, entities, cmd.widgetParent(), additionalParameters))
-		{
-			//save output
-			if (cmd.autoSaveMode() && !cmd.saveClouds(QObject::tr("ROUGHNESS_KERNEL_%2").arg(kernelSize)))
-				return false;
-		}
-
-		return true;
+		return ApplyCCLibAlgorithmOnClouds(cmd, ccLibAlgorithms::CCLIB_ALGO_ROUGHNESS, additionalParameters, QObject::tr("ROUGHNESS_KERNEL_%2").arg(kernelSize));
 	}
 };
 
@@ -1730,24 +1757,27 @@ struct CommandMergeClouds : public ccCommandLineInterface::Command
 			return true;
 		}
 
-		//merge clouds
+		//merge clouds (all at once)
 		{
+			std::vector<ccPointCloud*> clouds;
+			clouds.reserve(cmd.clouds().size() - 1);
+			unsigned expectedPts = cmd.clouds().front().pc->size();
 			for (size_t i = 1; i < cmd.clouds().size(); ++i)
 			{
-				unsigned beforePts = cmd.clouds().front().pc->size();
-				unsigned newPts = cmd.clouds()[i].pc->size();
-				*cmd.clouds().front().pc += cmd.clouds()[i].pc;
+				clouds.push_back(cmd.clouds()[i].pc);
+				expectedPts += cmd.clouds()[i].pc->size();
+			}
+
+			//success?
+			if (!cmd.clouds().front().pc->append(clouds) || cmd.clouds().front().pc->size() != expectedPts)
+			{
+				return cmd.error("Fusion failed! (not enough memory?)");
+			}
 
-				//success?
-				if (cmd.clouds().front().pc->size() == beforePts + newPts)
-				{
-					delete cmd.clouds()[i].pc;
-					cmd.clouds()[i].pc = nullptr;
-				}
-				else
-				{
-					return cmd.error("Fusion failed! (not enough memory?)");
-				}
+			for (size_t i = 1; i < cmd.clouds().size(); ++i)
+			{
+				delete cmd.clouds()[i].pc;
+				cmd.clouds()[i].pc = nullptr;
 			}
 		}
 
@@ -2055,102 +2085,110 @@ struct CommandOrientNormalsMST : public ccCommandLineInterface::Command
 		if (cmd.arguments().empty())
 			return cmd.error(QObject::tr("Missing parameter: number of neighbors after \"-%1\"").arg(COMMAND_ORIENT_NORMALS));
 
+		//several values can be given (comma separated) for a parameter sweep
 		QString knnStr = cmd.arguments().takeFirst();
-		bool ok;
-		int knn = knnStr.toInt(&ok);
-		if (!ok || knn <= 0)
+		std::vector<int> knnValues;
+		for (const QString& token : knnStr.split(',', QString::SkipEmptyParts))
+		{
+			bool ok;
+			int knn = token.toInt(&ok);
+			if (!ok || knn <= 0)
+				return cmd.error(QObject::tr("Invalid parameter: number of neighbors (%1)").arg(token));
+			knnValues.push_back(knn);
+		}
+		if (knnValues.empty())
 			return cmd.error(QObject::tr("Invalid parameter: number of neighbors (%1)").arg(knnStr));
 
+		if (cmd.arguments().empty())
+			return cmd.error(QObject::tr("Missing parameter: sigma multiplier after number of neighbors (SOR)"));
+		QString sigmaStr = cmd.arguments().takeFirst();
+		std::vector<double> sigmaValues;
+		for (const QString& token : sigmaStr.split(',', QString::SkipEmptyParts))
+		{
+			bool ok;
+			double nSigma = token.toDouble(&ok);
+			if (!ok || nSigma < 0)
+				return cmd.error(QObject::tr("Invalid parameter: sigma multiplier (%1)").arg(token));
+			sigmaValues.push_back(nSigma);
+		}
+		if (sigmaValues.empty())
+			return cmd.error(QObject::tr("Invalid parameter: sigma multiplier (%1)").arg(sigmaStr));
+
 		if (cmd.clouds().empty())
 			return cmd.error(QObject::tr("No cloud available. Be sure to open one first!"));
 
 		QScopedPointer<ccProgressDialog> progressDialog(0);
-		if (!cmd.silentMode())
+		if (!cmd.silentMode() && !cmd.parallelEntitiesMode())
 		{
 			progressDialog.reset(new ccProgressDialog(false, cmd.widgetParent()));
 			progressDialog->setAutoClose(false);
 		}
 
-		for (size_t i = 0; i < cmd.clouds().size(); ++i)
+		bool sweep = (knnValues.size() > 1 || sigmaValues.size() > 1);
+		//sweep mode: the filtered clouds are added to the loaded clouds (once all the clouds have been processed)
+		std::vector< std::vector<CLCloudDesc> > sweepOutputs(sweep ? cmd.clouds().size() : 0);
+		
+		bool success = cmd.processEntities(cmd.clouds().size(), [&](size_t i) -> bool
 		{
 			ccPointCloud* cloud = cmd.clouds()[i].pc;
 			assert(cloud);
 
-			if (!cloud->hasNormals())
-			{
-				continue;
-			}
-
-			//computation
-			if (cloud->orientNormalsWithMST(knn, progressDialog.data()))
+			if (sweep)
 			{
-				cmd.clouds()[i].basename += QObject::tr("_NORMS_REORIENTED");
-				if (cmd.autoSaveMode())
+				//the neighbors are extracted only once (for the biggest number of neighbors)
+				int maxKnn = *std::max_element(knnValues.begin(), knnValues.end());
+				if (cloud->size() <= static_cast<unsigned>(maxKnn))
 				{
-					QString errorStr = cmd.exportEntity(cmd.clouds()[i]);
-					if (!errorStr.isEmpty())
-						cmd.warning(errorStr);
+					return cmd.error(QObject::tr("Cloud '%1' has not enough points").arg(cloud->getName()));
+				}
+				CCLib::NearestNeighboursTable table;
+				if (maxKnn > 1 && !table.compute(cloud, static_cast<unsigned>(maxKnn - 1), false, nullptr, progressDialog.data()))
+				{
+					return cmd.error(QObject::tr("Failed to extract the neighbors of cloud '%1'! (not enough memory?)").arg(cloud->getName()));
 				}
-			}
-			else
-			{
-				return cmd.error(QObject::tr("Failed to orient the normals of cloud '%1'!").arg(cloud->getName()));
-			}
-		}
-
-		if (progressDialog)
-		{
-			progressDialog->close();
-			QCoreApplication::processEvents();
-		}
-
-		return true;
-	}
-};
-
-struct CommandSORFilter : public ccCommandLineInterface::Command
-{
-	CommandSORFilter() : ccCommandLineInterface::Command("S.O.R. filter", COMMAND_SOR_FILTER) {}
-
-	virtual bool process(ccCommandLineInterface& cmd) override
-	{
-		cmd.print("[SOR FILTER]");
-
-		if (cmd.arguments().empty())
-			return cmd.error(QObject::tr("Missing parameter: number of neighbors mode after \"-%1\"").arg(COMMAND_SOR_FILTER));
-
-		QString knnStr = cmd.arguments().takeFirst();
-		bool ok;
-		int knn = knnStr.toInt(&ok);
-		if (!ok || knn <= 0)
-			return cmd.error(QObject::tr("Invalid parameter: number of neighbors (%1)").arg(knnStr));
 
-		if (cmd.arguments().empty())
-			return cmd.error(QObject::tr("Missing parameter: sigma multiplier after number of neighbors (SOR)"));
-		QString sigmaStr = cmd.arguments().takeFirst();
-		double nSigma = sigmaStr.toDouble(&ok);
-		if (!ok || nSigma < 0)
-			return cmd.error(QObject::tr("Invalid parameter: sigma multiplier (%1)").arg(nSigma));
+				for (int knn : knnValues)
+				{
+					for (double nSigma : sigmaValues)
+					{
+						QString suffix = QString("SOR_K%1_S%2").arg(knn).arg(nSigma);
+
+						CCLib::ReferenceCloud* selection = CCLib::CloudSamplingTools::sorFilter(cloud,
+																								table,
+																								knn,
+																								nSigma,
+																								progressDialog.data());
+						ccPointCloud* cleanCloud = (selection ? cloud->partialClone(selection) : nullptr);
+						delete selection;
+						selection = nullptr;
+						if (!cleanCloud)
+						{
+							return cmd.error(QObject::tr("Failed to apply SOR filter on cloud '%1'! (not enough memory?)").arg(cloud->getName()));
+						}
+						cleanCloud->setName(cloud->getName() + QString(".clean_K%1_S%2").arg(knn).arg(nSigma));
 
-		if (cmd.clouds().empty())
-			return cmd.error(QObject::tr("No cloud available. Be sure to open one first!"));
+						CLCloudDesc cloudDesc(cleanCloud, cmd.clouds()[i].basename, cmd.clouds()[i].path, cmd.clouds()[i].indexInFile);
+						if (cmd.autoSaveMode())
+						{
+							QString errorStr = cmd.exportEntity(cloudDesc, suffix);
+							if (!errorStr.isEmpty())
+							{
+								delete cleanCloud;
+								return cmd.error(errorStr);
+							}
+						}
+						cloudDesc.basename += "_" + suffix;
+						sweepOutputs[i].push_back(cloudDesc);
+					}
+				}
 
-		QScopedPointer<ccProgressDialog> progressDialog(0);
-		if (!cmd.silentMode())
-		{
-			progressDialog.reset(new ccProgressDialog(false, cmd.widgetParent()));
-			progressDialog->setAutoClose(false);
-		}
-		
-		for (size_t i = 0; i < cmd.clouds().size(); ++i)
-		{
-			ccPointCloud* cloud = cmd.clouds()[i].pc;
-			assert(cloud);
+				return true;
+			}
 
 			//computation
 			CCLib::ReferenceCloud* selection = CCLib::CloudSamplingTools::sorFilter(cloud,
-																					knn,
-																					nSigma,
+																					knnValues.front(),
+																					sigmaValues.front(),
 																					0,
 																					progressDialog.data());
 
@@ -2190,7 +2228,9 @@ struct CommandSORFilter : public ccCommandLineInterface::Command
 				//no points fall inside selection!
 				return cmd.error(QObject::tr("Failed to apply SOR filter on cloud '%1'! (not enough memory?)").arg(cloud->getName()));
 			}
-		}
+
+			return true;
+		}, CloudJobFootprint(cmd));
 
 		if (progressDialog)
 		{
@@ -2198,6 +2238,20 @@ struct CommandSORFilter : public ccCommandLineInterface::Command
 			QCoreApplication::processEvents();
 		}
 
+		//add the sweep outputs to the loaded clouds (even if a job failed, so that they are properly released)
+		for (const std::vector<CLCloudDesc>& outputs : sweepOutputs)
+		{
+			for (const CLCloudDesc& desc : outputs)
+			{
+				cmd.clouds().push_back(desc);
+			}
+		}
+
+		if (!success)
+		{
+			return false;
+		}
+
 		return true;
 	}
 };
@@ -2317,84 +2371,199 @@ struct CommandSampleMesh : public ccCommandLineInterface::Command
 	}
 };
 
-struct CommandCrop : public ccCommandLineInterface::Command
+struct CommandLaplacianSmooth : public ccCommandLineInterface::Command
 {
-	CommandCrop() : ccCommandLineInterface::Command("Crop", COMMAND_CROP) {}
+	CommandLaplacianSmooth() : ccCommandLineInterface::Command("Laplacian smooth", COMMAND_LAPLACIAN_SMOOTH) {}
 
 	virtual bool process(ccCommandLineInterface& cmd) override
 	{
-		cmd.print("[CROP]");
+		cmd.print("[LAPLACIAN SMOOTH]");
 
-		if (cmd.arguments().empty())
-			return cmd.error(QObject::tr("Missing parameter: box extents after \"-%1\" (Xmin:Ymin:Zmin:Xmax:Ymax:Zmax)").arg(COMMAND_CROP));
-		if (cmd.clouds().empty() && cmd.meshes().empty())
-			return cmd.error(QObject::tr("No point cloud or mesh available. Be sure to open or generate one first!"));
+		if (cmd.arguments().size() < 2)
+			return cmd.error(QObject::tr("Missing parameter(s): iteration count and smoothing factor after \"-%1\"").arg(COMMAND_LAPLACIAN_SMOOTH));
 
-		//decode box extents
-		CCVector3 boxMin, boxMax;
-		{
-			QString boxBlock = cmd.arguments().takeFirst();
-			QStringList tokens = boxBlock.split(':');
-			if (tokens.size() != 6)
-				return cmd.error(QObject::tr("Invalid parameter: box extents (expected format is 'Xmin:Ymin:Zmin:Xmax:Ymax:Zmax')").arg(COMMAND_CROP));
+		bool ok = false;
+		unsigned iterationCount = cmd.arguments().takeFirst().toUInt(&ok);
+		if (!ok || iterationCount == 0)
+			return cmd.error(QObject::tr("Invalid parameter: iteration count after \"-%1\"").arg(COMMAND_LAPLACIAN_SMOOTH));
+		double factor = cmd.arguments().takeFirst().toDouble(&ok);
+		if (!ok || factor <= 0)
+			return cmd.error(QObject::tr("Invalid parameter: smoothing factor after iteration count"));
+		cmd.print(QObject::tr("\tIterations: %1 / factor: %2").arg(iterationCount).arg(factor));
 
-			for (int i = 0; i < 6; ++i)
-			{
-				CCVector3* vec = (i < 3 ? &boxMin : &boxMax);
-				bool ok = true;
-				vec->u[i % 3] = static_cast<PointCoordinateType>(tokens[i].toDouble(&ok));
-				if (!ok)
-				{
-					return cmd.error(QObject::tr("Invalid parameter: box extents (component #%1 is not a valid number)").arg(i + 1));
-				}
-			}
+		if (cmd.meshes().empty())
+			return cmd.error(QObject::tr("No mesh available. Be sure to open one first!"));
+
+		QScopedPointer<ccProgressDialog> progressDialog(0);
+		if (!cmd.silentMode())
+		{
+			progressDialog.reset(new ccProgressDialog(true, cmd.widgetParent()));
+			progressDialog->setAutoClose(false);
 		}
 
-		//optional parameters
-		bool inside = true;
-		while (!cmd.arguments().empty())
+		for (size_t i = 0; i < cmd.meshes().size(); ++i)
 		{
-			QString argument = cmd.arguments().front();
-			if (ccCommandLineInterface::IsCommand(argument, COMMAND_CROP_OUTSIDE))
+			ccMesh* mesh = ccHObjectCaster::ToMesh(cmd.meshes()[i].mesh);
+			if (!mesh)
 			{
-				//local option confirmed, we can move on
-				cmd.arguments().pop_front();
-				inside = false;
+				cmd.warning(QObject::tr("Mesh '%1' can't be smoothed (not a real mesh)").arg(cmd.meshes()[i].mesh->getName()));
+				continue;
 			}
-			else
+
+			if (!mesh->laplacianSmooth(iterationCount, static_cast<PointCoordinateType>(factor), progressDialog.data()))
 			{
-				break;
+				return cmd.error(QObject::tr("Failed to smooth mesh '%1' (not enough memory?)").arg(mesh->getName()));
 			}
-		}
 
-		ccBBox cropBox(boxMin, boxMax);
-		//crop clouds
-		{
-			for (size_t i = 0; i < cmd.clouds().size(); ++i)
+			cmd.meshes()[i].basename += QObject::tr("_SMOOTHED");
+			if (cmd.autoSaveMode())
 			{
-				ccHObject* croppedCloud = ccCropTool::Crop(cmd.clouds()[i].pc, cropBox, inside);
-				if (croppedCloud)
-				{
-					delete cmd.clouds()[i].pc;
-					assert(croppedCloud->isA(CC_TYPES::POINT_CLOUD));
-					cmd.clouds()[i].pc = static_cast<ccPointCloud*>(croppedCloud);
-					cmd.clouds()[i].basename += "_CROPPED";
-					if (cmd.autoSaveMode())
-					{
-						QString errorStr = cmd.exportEntity(cmd.clouds()[i]);
-						if (!errorStr.isEmpty())
-							return cmd.error(errorStr);
-					}
-				}
-				//otherwise an error message has already been issued
+				QString errorStr = cmd.exportEntity(cmd.meshes()[i]);
+				if (!errorStr.isEmpty())
+					return cmd.error(errorStr);
 			}
 		}
 
-		//crop meshes
+		if (progressDialog)
 		{
-			for (size_t i = 0; i < cmd.meshes().size(); ++i)
-			{
-				ccHObject* croppedMesh = ccCropTool::Crop(cmd.meshes()[i].mesh, cropBox, inside);
+			progressDialog->close();
+			QCoreApplication::processEvents();
+		}
+
+		return true;
+	}
+};
+
+struct CommandSubdivide : public ccCommandLineInterface::Command
+{
+	CommandSubdivide() : ccCommandLineInterface::Command("Subdivide", COMMAND_SUBDIVIDE) {}
+
+	virtual bool process(ccCommandLineInterface& cmd) override
+	{
+		cmd.print("[SUBDIVIDE]");
+
+		if (cmd.arguments().empty())
+			return cmd.error(QObject::tr("Missing parameter: max triangle area after \"-%1\"").arg(COMMAND_SUBDIVIDE));
+
+		bool ok = false;
+		double maxArea = cmd.arguments().takeFirst().toDouble(&ok);
+		if (!ok || maxArea <= 0)
+			return cmd.error(QObject::tr("Invalid parameter: max triangle area after \"-%1\"").arg(COMMAND_SUBDIVIDE));
+		cmd.print(QObject::tr("\tMax triangle area: %1").arg(maxArea));
+
+		if (cmd.meshes().empty())
+			return cmd.error(QObject::tr("No mesh available. Be sure to open one first!"));
+
+		for (size_t i = 0; i < cmd.meshes().size(); ++i)
+		{
+			ccMesh* mesh = ccHObjectCaster::ToMesh(cmd.meshes()[i].mesh);
+			if (!mesh)
+			{
+				cmd.warning(QObject::tr("Mesh '%1' can't be subdivided (not a real mesh)").arg(cmd.meshes()[i].mesh->getName()));
+				continue;
+			}
+
+			ccMesh* subdividedMesh = mesh->subdivide(static_cast<PointCoordinateType>(maxArea));
+			if (!subdividedMesh)
+			{
+				return cmd.error(QObject::tr("Failed to subdivide mesh '%1'").arg(mesh->getName()));
+			}
+			subdividedMesh->setName(mesh->getName() + QObject::tr(".subdivided"));
+			cmd.print(QObject::tr("\tMesh '%1': %2 triangles -> %3 triangles").arg(mesh->getName()).arg(mesh->size()).arg(subdividedMesh->size()));
+
+			delete cmd.meshes()[i].mesh;
+			cmd.meshes()[i].mesh = subdividedMesh;
+			cmd.meshes()[i].basename += QObject::tr("_SUBDIVIDED");
+			if (cmd.autoSaveMode())
+			{
+				QString errorStr = cmd.exportEntity(cmd.meshes()[i]);
+				if (!errorStr.isEmpty())
+					return cmd.error(errorStr);
+			}
+		}
+
+		return true;
+	}
+};
+
+struct CommandCrop : public ccCommandLineInterface::Command
+{
+	CommandCrop() : ccCommandLineInterface::Command("Crop", COMMAND_CROP) {}
+
+	virtual bool process(ccCommandLineInterface& cmd) override
+	{
+		cmd.print("[CROP]");
+
+		if (cmd.arguments().empty())
+			return cmd.error(QObject::tr("Missing parameter: box extents after \"-%1\" (Xmin:Ymin:Zmin:Xmax:Ymax:Zmax)").arg(COMMAND_CROP));
+		if (cmd.clouds().empty() && cmd.meshes().empty())
+			return cmd.error(QObject::tr("No point cloud or mesh available. Be sure to open or generate one first!"));
+
+		//decode box extents
+		CCVector3 boxMin, boxMax;
+		{
+			QString boxBlock = cmd.arguments().takeFirst();
+			QStringList tokens = boxBlock.split(':');
+			if (tokens.size() != 6)
+				return cmd.error(QObject::tr("Invalid parameter: box extents (expected format is 'Xmin:Ymin:Zmin:Xmax:Ymax:Zmax')").arg(COMMAND_CROP));
+
+			for (int i = 0; i < 6; ++i)
+			{
+				CCVector3* vec = (i < 3 ? &boxMin : &boxMax);
+				bool ok = true;
+				vec->u[i % 3] = static_cast<PointCoordinateType>(tokens[i].toDouble(&ok));
+				if (!ok)
+				{
+					return cmd.error(QObject::tr("Invalid parameter: box extents (component #%1 is not a valid number)").arg(i + 1));
+				}
+			}
+		}
+
+		//optional parameters
+		bool inside = true;
+		while (!cmd.arguments().empty())
+		{
+			QString argument = cmd.arguments().front();
+			if (ccCommandLineInterface::IsCommand(argument, COMMAND_CROP_OUTSIDE))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+				inside = false;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		ccBBox cropBox(boxMin, boxMax);
+		//crop clouds
+		{
+			for (size_t i = 0; i < cmd.clouds().size(); ++i)
+			{
+				ccHObject* croppedCloud = ccCropTool::Crop(cmd.clouds()[i].pc, cropBox, inside);
+				if (croppedCloud)
+				{
+					delete cmd.clouds()[i].pc;
+					assert(croppedCloud->isA(CC_TYPES::POINT_CLOUD));
+					cmd.clouds()[i].pc = static_cast<ccPointCloud*>(croppedCloud);
+					cmd.clouds()[i].basename += "_CROPPED";
+					if (cmd.autoSaveMode())
+					{
+						QString errorStr = cmd.exportEntity(cmd.clouds()[i]);
+						if (!errorStr.isEmpty())
+							return cmd.error(errorStr);
+					}
+				}
+				//otherwise an error message has already been issued
+			}
+		}
+
+		//crop meshes
+		{
+			for (size_t i = 0; i < cmd.meshes().size(); ++i)
+			{
+				ccHObject* croppedMesh = ccCropTool::Crop(cmd.meshes()[i].mesh, cropBox, inside);
 				if (croppedMesh)
 				{
 					delete cmd.meshes()[i].mesh;
@@ -3410,6 +3579,279 @@ struct CommandSFOperation : public ccCommandLineInterface::Command
 	}
 };
 
+struct CommandSFExpression : public ccCommandLineInterface::Command
+{
+	CommandSFExpression() : ccCommandLineInterface::Command("SF expression", COMMAND_SF_EXPRESSION) {}
+
+	virtual bool process(ccCommandLineInterface& cmd) override
+	{
+		cmd.print("[SF EXPRESSION]");
+
+		if (cmd.arguments().size() < 2)
+		{
+			return cmd.error(QObject::tr("Missing parameter(s): output SF name and/or expression after '%1' (2 values expected)").arg(COMMAND_SF_EXPRESSION));
+		}
+
+		QString sfName = cmd.arguments().takeFirst();
+		QString expression = cmd.arguments().takeFirst();
+		cmd.print(QObject::tr("Expression: %1 = %2").arg(sfName, expression));
+
+		//apply the expression on clouds
+		for (size_t i = 0; i < cmd.clouds().size(); ++i)
+		{
+			ccPointCloud* cloud = cmd.clouds()[i].pc;
+			if (!cloud)
+			{
+				continue;
+			}
+
+			QString errorMessage;
+			if (ccScalarFieldExpression::Apply(cloud, expression, sfName, errorMessage) < 0)
+			{
+				return cmd.error(QObject::tr("Failed to apply the expression on cloud '%1': %2").arg(cloud->getName(), errorMessage));
+			}
+			else if (cmd.autoSaveMode())
+			{
+				QString errorStr = cmd.exportEntity(cmd.clouds()[i], "SF_EXPR");
+				if (!errorStr.isEmpty())
+				{
+					return cmd.error(errorStr);
+				}
+			}
+		}
+
+		//and meshes!
+		for (size_t j = 0; j < cmd.meshes().size(); ++j)
+		{
+			bool isLocked = false;
+			ccGenericMesh* mesh = cmd.meshes()[j].mesh;
+			ccPointCloud* cloud = ccHObjectCaster::ToPointCloud(mesh, &isLocked);
+			if (!cloud || isLocked)
+			{
+				continue;
+			}
+
+			QString errorMessage;
+			if (ccScalarFieldExpression::Apply(cloud, expression, sfName, errorMessage) < 0)
+			{
+				return cmd.error(QObject::tr("Failed to apply the expression on mesh '%1': %2").arg(mesh->getName(), errorMessage));
+			}
+			else if (cmd.autoSaveMode())
+			{
+				QString errorStr = cmd.exportEntity(cmd.meshes()[j], "SF_EXPR");
+				if (!errorStr.isEmpty())
+				{
+					return cmd.error(errorStr);
+				}
+			}
+		}
+
+		return true;
+	}
+};
+
+struct CommandSFInterpolation : public ccCommandLineInterface::Command
+{
+	CommandSFInterpolation() : ccCommandLineInterface::Command("SF interpolation", COMMAND_SF_INTERP) {}
+
+	virtual bool process(ccCommandLineInterface& cmd) override
+	{
+		cmd.print("[SF INTERPOLATION]");
+
+		if (cmd.arguments().empty())
+		{
+			return cmd.error(QObject::tr("Missing parameter: SF index (or 'ALL') after '%1'").arg(COMMAND_SF_INTERP));
+		}
+
+		//read the SF index
+		bool allSFs = false;
+		int sfIndex = -1;
+		{
+			QString sfIndexStr = cmd.arguments().takeFirst();
+			if (sfIndexStr.toUpper() == "ALL")
+			{
+				allSFs = true;
+			}
+			else if (sfIndexStr.toUpper() == OPTION_LAST)
+			{
+				sfIndex = -2;
+			}
+			else
+			{
+				bool ok = true;
+				sfIndex = sfIndexStr.toInt(&ok);
+				if (!ok || sfIndex < 0)
+				{
+					return cmd.error(QObject::tr("Invalid SF index! (after %1)").arg(COMMAND_SF_INTERP));
+				}
+			}
+		}
+
+		//look for local options
+		bool sourceIsLast = false;
+		ccPointCloudInterpolator::Parameters params;
+		params.method = ccPointCloudInterpolator::Parameters::NEAREST_NEIGHBOR;
+		params.algo = ccPointCloudInterpolator::Parameters::AVERAGE;
+		
+		while (!cmd.arguments().empty())
+		{
+			QString argument = cmd.arguments().front();
+			if (ccCommandLineInterface::IsCommand(argument, COMMAND_SF_INTERP_SOURCE_IS_LAST))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				sourceIsLast = true;
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_SF_INTERP_RADIUS))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				bool ok = false;
+				params.radius = (cmd.arguments().empty() ? 0.0f : cmd.arguments().takeFirst().toFloat(&ok));
+				if (!ok || params.radius <= 0)
+					return cmd.error(QObject::tr("Invalid or missing radius after '%1'").arg(COMMAND_SF_INTERP_RADIUS));
+				params.method = ccPointCloudInterpolator::Parameters::RADIUS;
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_SF_INTERP_KNN))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				bool ok = false;
+				params.knn = (cmd.arguments().empty() ? 0 : cmd.arguments().takeFirst().toUInt(&ok));
+				if (!ok || params.knn == 0)
+					return cmd.error(QObject::tr("Invalid or missing number of neighbors after '%1'").arg(COMMAND_SF_INTERP_KNN));
+				params.method = ccPointCloudInterpolator::Parameters::K_NEAREST_NEIGHBORS;
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_SF_INTERP_ALGO))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (cmd.arguments().empty())
+					return cmd.error(QObject::tr("Missing algorithm after '%1' (AVG/MEDIAN/GAUSS/IDW)").arg(COMMAND_SF_INTERP_ALGO));
+				QString algo = cmd.arguments().takeFirst().toUpper();
+				if (algo == "AVG")
+					params.algo = ccPointCloudInterpolator::Parameters::AVERAGE;
+				else if (algo == "MEDIAN")
+					params.algo = ccPointCloudInterpolator::Parameters::MEDIAN;
+				else if (algo == "GAUSS")
+					params.algo = ccPointCloudInterpolator::Parameters::NORMAL_DIST;
+				else if (algo == "IDW")
+					params.algo = ccPointCloudInterpolator::Parameters::INVERSE_DISTANCE;
+				else
+					return cmd.error(QObject::tr("Unknown algorithm '%1' (after %2)").arg(algo, COMMAND_SF_INTERP_ALGO));
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_SF_INTERP_SIGMA))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				bool ok = false;
+				params.sigma = (cmd.arguments().empty() ? 0.0 : cmd.arguments().takeFirst().toDouble(&ok));
+				if (!ok || params.sigma <= 0)
+					return cmd.error(QObject::tr("Invalid or missing kernel after '%1'").arg(COMMAND_SF_INTERP_SIGMA));
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_SF_INTERP_POWER))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				bool ok = false;
+				params.power = (cmd.arguments().empty() ? -1.0 : cmd.arguments().takeFirst().toDouble(&ok));
+				if (!ok || params.power < 0)
+					return cmd.error(QObject::tr("Invalid or missing power after '%1'").arg(COMMAND_SF_INTERP_POWER));
+			}
+			else
+			{
+				break; //as soon as we encounter an unrecognized argument, we break the local loop to go back to the main one!
+			}
+		}
+
+		if (params.algo == ccPointCloudInterpolator::Parameters::NORMAL_DIST && params.sigma <= 0)
+		{
+			if (params.method != ccPointCloudInterpolator::Parameters::RADIUS)
+			{
+				return cmd.error(QObject::tr("The Gaussian kernel requires a sigma value (-%1) with the KNN method").arg(COMMAND_SF_INTERP_SIGMA));
+			}
+			//same default value as the GUI
+			params.sigma = params.radius / 2.5;
+		}
+
+		if (cmd.clouds().size() < 2)
+		{
+			return cmd.error(QObject::tr("At least two clouds are required (one source and one or several destinations)"));
+		}
+
+		//source cloud
+		size_t sourceIndex = (sourceIsLast ? cmd.clouds().size() - 1 : 0);
+		ccPointCloud* sourceCloud = cmd.clouds()[sourceIndex].pc;
+		unsigned sourceSFCount = sourceCloud->getNumberOfScalarFields();
+		if (sourceSFCount == 0)
+		{
+			return cmd.error(QObject::tr("Source cloud '%1' has no scalar field").arg(sourceCloud->getName()));
+		}
+
+		std::vector<int> sfIndexes;
+		if (allSFs)
+		{
+			for (unsigned i = 0; i < sourceSFCount; ++i)
+				sfIndexes.push_back(static_cast<int>(i));
+		}
+		else
+		{
+			if (sfIndex == -2)
+				sfIndex = static_cast<int>(sourceSFCount) - 1;
+			if (sfIndex >= static_cast<int>(sourceSFCount))
+				return cmd.error(QObject::tr("Source cloud '%1' has no scalar field with index #%2").arg(sourceCloud->getName()).arg(sfIndex));
+			sfIndexes.push_back(sfIndex);
+		}
+		cmd.print(QObject::tr("Source cloud: '%1' (%2 scalar field(s) to interpolate)").arg(sourceCloud->getName()).arg(sfIndexes.size()));
+
+		QScopedPointer<ccProgressDialog> progressDialog(0);
+		if (!cmd.silentMode())
+		{
+			progressDialog.reset(new ccProgressDialog(true, cmd.widgetParent()));
+			progressDialog->setAutoClose(false);
+		}
+
+		//the destination clouds are processed (and saved) one after the other
+		for (size_t i = 0; i < cmd.clouds().size(); ++i)
+		{
+			if (i == sourceIndex)
+			{
+				continue;
+			}
+
+			ccPointCloud* destCloud = cmd.clouds()[i].pc;
+			if (!ccPointCloudInterpolator::InterpolateScalarFieldsFrom(destCloud, sourceCloud, sfIndexes, params, progressDialog.data()))
+			{
+				return cmd.error(QObject::tr("Failed to interpolate the scalar field(s) on cloud '%1'").arg(destCloud->getName()));
+			}
+			destCloud->setCurrentDisplayedScalarField(static_cast<int>(destCloud->getNumberOfScalarFields()) - 1);
+
+			if (cmd.autoSaveMode())
+			{
+				QString errorStr = cmd.exportEntity(cmd.clouds()[i], "SF_INTERP");
+				if (!errorStr.isEmpty())
+				{
+					return cmd.error(errorStr);
+				}
+			}
+		}
+
+		if (progressDialog)
+		{
+			progressDialog->close();
+			QCoreApplication::processEvents();
+		}
+
+		return true;
+	}
+};
+
 struct CommandICP : public ccCommandLineInterface::Command
 {
 	CommandICP() : ccCommandLineInterface::Command("ICP", COMMAND_ICP) {}
@@ -3757,6 +4199,173 @@ struct CommandChangePLYExportFormat : public ccCommandLineInterface::Command
 	}
 };
 
+struct CommandBinQuantization : public ccCommandLineInterface::Command
+{
+	CommandBinQuantization() : ccCommandLineInterface::Command("Set BIN points quantization", COMMAND_BIN_QUANTIZATION) {}
+
+	virtual bool process(ccCommandLineInterface& cmd) override
+	{
+		if (cmd.arguments().empty())
+			return cmd.error(QObject::tr("Missing parameter: quantization step after '%1'").arg(COMMAND_BIN_QUANTIZATION));
+
+		bool ok = false;
+		double step = cmd.arguments().takeFirst().toDouble(&ok);
+		if (!ok || step < 0)
+			return cmd.error(QObject::tr("Invalid quantization step! (%1)").arg(COMMAND_BIN_QUANTIZATION));
+
+		cmd.setBinQuantizationStep(step);
+		if (step > 0)
+			cmd.print(QObject::tr("Points will be saved in BIN files as quantized coordinates (step = %1)").arg(step));
+		else
+			cmd.print(QObject::tr("Points will be saved in BIN files as is"));
+
+		return true;
+	}
+};
+
+struct CommandQuantizationBenchmark : public ccCommandLineInterface::Command
+{
+	CommandQuantizationBenchmark() : ccCommandLineInterface::Command("Quantized coordinates benchmark", COMMAND_QUANTIZATION_BENCHMARK) {}
+
+	//! Saves a cloud in a temporary BIN file with quantized coordinates, reloads it and checks the points
+	static bool BinRoundTrip(ccCommandLineInterface& cmd, ccPointCloud* cloud, double step)
+	{
+		QTemporaryFile tempFile(QDir::temp().absoluteFilePath("cc_quantization_XXXXXX.bin"));
+		if (!tempFile.open())
+			return cmd.error(QObject::tr("Failed to create a temporary BIN file"));
+		QString filename = tempFile.fileName();
+		tempFile.close();
+
+		QElapsedTimer timer;
+		timer.start();
+		FileIOFilter::SaveParameters saveParameters;
+		saveParameters.alwaysDisplaySaveDialog = false;
+		saveParameters.binQuantizationStep = step;
+		CC_FILE_ERROR result = FileIOFilter::SaveToFile(cloud, filename, saveParameters, BinFilter::GetFileFilter());
+		if (result != CC_FERR_NO_ERROR)
+			return cmd.error(QObject::tr("Failed to save cloud '%1' in a BIN file").arg(cloud->getName()));
+		qint64 saveTime_ms = timer.elapsed();
+		qint64 fileSize = QFileInfo(filename).size();
+
+		timer.start();
+		FileIOFilter::LoadParameters loadParameters;
+		loadParameters.alwaysDisplayLoadDialog = false;
+		loadParameters.shiftHandlingMode = ccGlobalShiftManager::NO_DIALOG;
+		QScopedPointer<ccHObject> container(FileIOFilter::LoadFromFile(filename, loadParameters, result, BinFilter::GetFileFilter()));
+		if (!container || result != CC_FERR_NO_ERROR)
+			return cmd.error(QObject::tr("Failed to reload the BIN file of cloud '%1'").arg(cloud->getName()));
+		qint64 loadTime_ms = timer.elapsed();
+
+		ccHObject::Container clouds;
+		container->filterChildren(clouds, true, CC_TYPES::POINT_CLOUD, true);
+		ccPointCloud* reloaded = (clouds.size() == 1 ? static_cast<ccPointCloud*>(clouds.front()) : nullptr);
+		if (!reloaded || reloaded->size() != cloud->size())
+			return cmd.error(QObject::tr("The reloaded BIN file of cloud '%1' doesn't match the original cloud").arg(cloud->getName()));
+
+		double maxError = 0;
+		for (unsigned i = 0; i < cloud->size(); ++i)
+		{
+			CCVector3 d = *reloaded->getPoint(i) - *cloud->getPoint(i);
+			maxError = std::max(maxError, static_cast<double>(std::max(std::abs(d.x), std::max(std::abs(d.y), std::abs(d.z)))));
+		}
+
+		cmd.print(QObject::tr("\tBIN file: %1 bytes/point / saved in %2 ms / reloaded in %3 ms / max error: %4").arg(static_cast<double>(fileSize) / cloud->size(), 0, 'f', 2).arg(saveTime_ms).arg(loadTime_ms).arg(maxError));
+		//half a step on each dimension, plus the float rounding of the decoded coordinates
+		if (!(maxError <= step))
+			return cmd.error(QObject::tr("The reloaded points of cloud '%1' are too far from the original ones").arg(cloud->getName()));
+
+		return true;
+	}
+
+	virtual bool process(ccCommandLineInterface& cmd) override
+	{
+		cmd.print(QObject::tr("[QUANTIZATION BENCHMARK]"));
+
+		if (cmd.arguments().empty())
+			return cmd.error(QObject::tr("Missing parameter: quantization step after '%1'").arg(COMMAND_QUANTIZATION_BENCHMARK));
+
+		bool ok = false;
+		double step = cmd.arguments().takeFirst().toDouble(&ok);
+		if (!ok || step <= 0)
+			return cmd.error(QObject::tr("Invalid quantization step! (%1)").arg(COMMAND_QUANTIZATION_BENCHMARK));
+
+		if (cmd.clouds().empty())
+			return cmd.error(QObject::tr("No point cloud loaded (be sure to open one with \"-%1 [cloud filename]\" before \"-%2\")").arg(COMMAND_OPEN, COMMAND_QUANTIZATION_BENCHMARK));
+
+		for (const CLCloudDesc& desc : cmd.clouds())
+		{
+			ccPointCloud* cloud = desc.pc;
+			unsigned pointCount = cloud->size();
+			if (pointCount == 0)
+				continue;
+
+			std::vector<CCVector3> points, blockBuffer;
+			try
+			{
+				points.resize(pointCount);
+				blockBuffer.resize(CCLib::QuantizedCoordinates::BLOCK_SIZE);
+			}
+			catch (const std::bad_alloc&)
+			{
+				return cmd.error(QObject::tr("Not enough memory"));
+			}
+
+			QElapsedTimer timer;
+
+			//reference: plain copy of the coordinates
+			timer.start();
+			for (unsigned i = 0; i < pointCount; ++i)
+			{
+				points[i] = *cloud->getPoint(i);
+			}
+			qint64 copyTime_ms = timer.elapsed();
+
+			CCLib::QuantizedCoordinates quantized;
+			CCVector3d scale(step, step, step);
+			timer.start();
+			if (!quantized.encode(cloud, scale))
+			{
+				cmd.warning(QObject::tr("Cloud '%1' can't be quantized with this step (or not enough memory)").arg(cloud->getName()));
+				continue;
+			}
+			qint64 encodeTime_ms = timer.elapsed();
+
+			//whole cloud decoding (in parallel)
+			timer.start();
+			quantized.decode(points.data());
+			qint64 decodeTime_ms = timer.elapsed();
+
+			//block by block decoding (as a renderer or an algorithm would do)
+			timer.start();
+			for (unsigned b = 0; b < quantized.blockCount(); ++b)
+			{
+				quantized.decodeBlock(b, blockBuffer.data());
+			}
+			qint64 blockDecodeTime_ms = timer.elapsed();
+
+			//max error
+			double maxError = 0;
+			for (unsigned i = 0; i < pointCount; ++i)
+			{
+				CCVector3 d = points[i] - *cloud->getPoint(i);
+				maxError = std::max(maxError, static_cast<double>(std::max(std::abs(d.x), std::max(std::abs(d.y), std::abs(d.z)))));
+			}
+
+			cmd.print(QObject::tr("Cloud '%1' (%2 points)").arg(cloud->getName()).arg(pointCount));
+			cmd.print(QObject::tr("\tMemory: %1 bytes/point (%2 as floats)").arg(static_cast<double>(quantized.memoryUsage()) / pointCount, 0, 'f', 2).arg(sizeof(CCVector3)));
+			cmd.print(QObject::tr("\tEncoding: %1 ms").arg(encodeTime_ms));
+			cmd.print(QObject::tr("\tDecoding: %1 ms (whole cloud) / %2 ms (block by block) / %3 ms (plain copy)").arg(decodeTime_ms).arg(blockDecodeTime_ms).arg(copyTime_ms));
+			cmd.print(QObject::tr("\tMax error: %1 (step = %2)").arg(maxError).arg(step));
+
+			//BIN file round trip (quantized save + reload)
+			if (!BinRoundTrip(cmd, cloud, step))
+				return false;
+		}
+
+		return true;
+	}
+};
+
 struct CommandForceNormalsComputation : public ccCommandLineInterface::Command
 {
 	CommandForceNormalsComputation() : ccCommandLineInterface::Command("Compute structured cloud normals", COMMAND_COMPUTE_GRIDDED_NORMALS) {}
@@ -3975,6 +4584,105 @@ struct CommandAutoSave : public ccCommandLineInterface::Command
 	}
 };
 
+struct CommandParallelEntities : public ccCommandLineInterface::Command
+{
+	CommandParallelEntities() : ccCommandLineInterface::Command("Parallel entities", COMMAND_PARALLEL_ENTITIES) {}
+
+	virtual bool process(ccCommandLineInterface& cmd) override
+	{
+		if (cmd.arguments().empty())
+			return cmd.error(QObject::tr("Missing parameter: max number of entities processed concurrently after '%1' (0 = as many as CPU cores)").arg(COMMAND_PARALLEL_ENTITIES));
+
+		bool ok = false;
+		QString countStr = cmd.arguments().takeFirst();
+		int count = countStr.toInt(&ok);
+		if (!ok || count < 0)
+			return cmd.error(QObject::tr("Invalid parameter: number of entities after '%1' (got '%2')").arg(COMMAND_PARALLEL_ENTITIES, countStr));
+
+		//optional parameter: memory budget
+		qint64 memBudget_MB = 0;
+		if (!cmd.arguments().empty())
+		{
+			QString argument = cmd.arguments().front();
+			if (ccCommandLineInterface::IsCommand(argument, COMMAND_PARALLEL_MEM_BUDGET))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+				if (cmd.arguments().empty())
+					return cmd.error(QObject::tr("Missing parameter: memory budget (in MB) after \"-%1\"").arg(COMMAND_PARALLEL_MEM_BUDGET));
+
+				QString budgetStr = cmd.arguments().takeFirst();
+				memBudget_MB = budgetStr.toLongLong(&ok);
+				if (!ok || memBudget_MB < 0)
+					return cmd.error(QObject::tr("Invalid parameter: memory budget after \"-%1\" (got '%2')").arg(COMMAND_PARALLEL_MEM_BUDGET, budgetStr));
+			}
+		}
+
+		cmd.setMaxParallelEntities(count);
+		cmd.setParallelMemoryBudget(memBudget_MB);
+
+		if (count == 1)
+			cmd.print("Entities will be processed sequentially");
+		else
+			cmd.print(QObject::tr("Entities will be processed concurrently (max: %1)").arg(count == 0 ? QString("CPU cores") : QString::number(count)));
+		if (memBudget_MB != 0)
+			cmd.print(QObject::tr("\tMemory budget: %1 MB").arg(memBudget_MB));
+
+		return true;
+	}
+};
+
+struct CommandAsyncSave : public ccCommandLineInterface::Command
+{
+	CommandAsyncSave() : ccCommandLineInterface::Command("Asynchronous save state", COMMAND_ASYNC_SAVE) {}
+
+	virtual bool process(ccCommandLineInterface& cmd) override
+	{
+		if (cmd.arguments().empty())
+			return cmd.error(QObject::tr("Missing parameter: option after '%1' (%2/%3)").arg(COMMAND_ASYNC_SAVE, OPTION_ON, OPTION_OFF));
+
+		QString option = cmd.arguments().takeFirst().toUpper();
+		if (option == OPTION_ON)
+		{
+			cmd.print("Files will be saved in the background");
+			cmd.toggleAsyncSaveMode(true);
+		}
+		else if (option == OPTION_OFF)
+		{
+			cmd.print("Files will be saved directly");
+			cmd.toggleAsyncSaveMode(false);
+			//wait for the pending files
+			if (!cmd.waitForPendingSaves())
+				return false;
+		}
+		else
+		{
+			return cmd.error(QObject::tr("Unrecognized option after '%1' (%2 or %3 expected)").arg(COMMAND_ASYNC_SAVE, OPTION_ON, OPTION_OFF));
+		}
+
+		return true;
+	}
+};
+
+struct CommandProfile : public ccCommandLineInterface::Command
+{
+	CommandProfile() : ccCommandLineInterface::Command("Profile", COMMAND_PROFILE) {}
+
+	virtual bool process(ccCommandLineInterface& cmd) override
+	{
+		if (cmd.arguments().empty())
+			return cmd.error(QObject::tr("Missing parameter: report filename after '%1'").arg(COMMAND_PROFILE));
+
+		QString filename = cmd.arguments().takeFirst();
+		if (!cmd.enableProfiling(filename))
+			return cmd.error(QObject::tr("Failed to enable the profiling mode"));
+
+		cmd.print(QObject::tr("Profiling enabled (report: '%1')").arg(filename));
+
+		return true;
+	}
+};
+
 struct CommandLogFile : public ccCommandLineInterface::Command
 {
 	CommandLogFile() : ccCommandLineInterface::Command("Set log file", COMMAND_LOG_FILE) {}
@@ -2,11 +2,14 @@
 
 //Local
 #include "ccCommandLineCommands.h"
+#include "ccCommandLineProfiler.h"
 #include "ccCommandCrossSection.h"
 #include "ccCommandRaster.h"
+#include "ccCommandRender.h"
 #include "ccPluginInterface.h"
 
 //qCC_db
+#include <ccMesh.h>
 #include <ccProgressDialog.h>
 
 //qCC_io
@@ -17,8 +20,14 @@
 #include "ccConsole.h"
 
 //Qt
-#include <QMessageBox>
+#include <QCoreApplication>
 #include <QElapsedTimer>
+#include <QMessageBox>
+#include <QMutex>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <QtConcurrentRun>
 
 //system
 #include <unordered_set>
@@ -27,14 +36,69 @@
 static const char COMMAND_HELP[]							= "HELP";
 static const char COMMAND_SILENT_MODE[]						= "SILENT";
 
+//! Returns whether entities can be saved in a given format outside of the main thread
+/** Most filters may use dialogs (even if no parent widget is set). Only the BIN
+	and ASCII filters are known to be GUI-free (the ASCII filter options must be
+	retrieved beforehand on the main thread: see SaveToFile).
+**/
+static bool CanSaveOutsideOfMainThread(const QString& format)
+{
+	return (format == BinFilter::GetFileFilter() || format == AsciiFilter::GetFileFilter());
+}
+
+//! Saves an entity (thread-safe version of FileIOFilter::SaveToFile for the formats accepted by CanSaveOutsideOfMainThread)
+/** \param entity entity to save
+	\param filename output filename
+	\param parameters save parameters
+	\param format output format (file filter)
+	\param asciiOptions options used if the format is ASCII (instead of the save dialog state)
+**/
+static CC_FILE_ERROR SaveToFile(ccHObject* entity,
+								const QString& filename,
+								const FileIOFilter::SaveParameters& parameters,
+								const QString& format,
+								const AsciiFilter::SaveOptions& asciiOptions)
+{
+	if (format != AsciiFilter::GetFileFilter())
+	{
+		return FileIOFilter::SaveToFile(entity, filename, parameters, format);
+	}
+
+	//the ASCII save dialog must not be accessed from another thread
+	CC_FILE_ERROR result = CC_FERR_NO_ERROR;
+	try
+	{
+		AsciiFilter filter;
+		result = filter.saveToFile(entity, filename, asciiOptions, parameters.parentWidget);
+	}
+	catch (const std::bad_alloc&)
+	{
+		result = CC_FERR_NOT_ENOUGH_MEMORY;
+	}
+
+	if (result == CC_FERR_NO_ERROR)
+	{
+		ccLog::Print(QString("[I/O] File '%1' saved successfully").arg(filename));
+	}
+	else
+	{
+		FileIOFilter::DisplayErrorMessage(result, "saving", filename);
+	}
+
+	return result;
+}
+
 /*****************************************************/
 /*************** ccCommandLineParser *****************/
 /*****************************************************/
 
+//Messages logged by concurrent jobs are captured (see ccCommandLineParser::processEntities)
+//and will be echoed when they are flushed
+
 void ccCommandLineParser::print(const QString& message) const
 {
 	ccConsole::Print(message);
-	if (m_silentMode)
+	if (m_silentMode && !ccLog::IsCapturingThreadMessages())
 	{
 		printf("%s\n", qPrintable(message));
 	}
@@ -43,7 +107,7 @@ void ccCommandLineParser::print(const QString& message) const
 void ccCommandLineParser::warning(const QString& message) const
 {
 	ccConsole::Warning(message);
-	if (m_silentMode)
+	if (m_silentMode && !ccLog::IsCapturingThreadMessages())
 	{
 		printf("[WARNING] %s\n", qPrintable(message));
 	}
@@ -52,7 +116,7 @@ void ccCommandLineParser::warning(const QString& message) const
 bool ccCommandLineParser::error(const QString& message) const
 {
 	ccConsole::Error(message);
-	if (m_silentMode)
+	if (m_silentMode && !ccLog::IsCapturingThreadMessages())
 	{
 		printf("[ERROR] %s\n", qPrintable(message));
 	}
@@ -60,6 +124,246 @@ bool ccCommandLineParser::error(const QString& message) const
 	return false;
 }
 
+QDialog* ccCommandLineParser::widgetParent()
+{
+	//no GUI outside of the main thread
+	return (QThread::currentThread() == QCoreApplication::instance()->thread() ? m_parentWidget : nullptr);
+}
+
+bool ccCommandLineParser::processEntities(size_t count, EntityJob job, EntityFootprint footprint/*=EntityFootprint()*/)
+{
+	//profiling
+	if (m_profiler)
+	{
+		EntityJob innerJob = job;
+		job = [this, innerJob](size_t index) -> bool
+		{
+			ccCommandLineProfiler::EntityJob record;
+			record.index = index;
+			if (index < m_clouds.size())
+			{
+				record.entityName = m_clouds[index].pc->getName();
+				record.pointsIn = m_clouds[index].pc->size();
+			}
+			double cpuTime_s = ccCommandLineProfiler::GetCurrentThreadCPUTime();
+			record.start = CCLib::Profiler::Clock::now();
+
+			record.success = innerJob(index);
+
+			record.stop = CCLib::Profiler::Clock::now();
+			record.cpuTime_s = ccCommandLineProfiler::GetCurrentThreadCPUTime() - cpuTime_s;
+			if (index < m_clouds.size())
+			{
+				//the job may have replaced the cloud
+				record.pointsOut = m_clouds[index].pc->size();
+			}
+			m_profiler->addEntityJob(record);
+			return record.success;
+		};
+	}
+
+	int maxThreadCount = (m_maxParallelEntities > 0 ? m_maxParallelEntities : QThread::idealThreadCount());
+	if (count < 2 || maxThreadCount < 2)
+	{
+		//sequential processing
+		return ccCommandLineInterface::processEntities(count, job, footprint);
+	}
+	int threadCount = static_cast<int>(std::min(count, static_cast<size_t>(maxThreadCount)));
+
+	struct JobState
+	{
+		JobState() : footprint(0), done(false), success(false) {}
+
+		qint64 footprint;
+		bool done;
+		bool success;
+		std::vector<ccLog::Message> messages;
+	};
+
+	std::vector<JobState> jobs;
+	try
+	{
+		jobs.resize(count);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return error("Not enough memory");
+	}
+
+	qint64 budget = m_parallelMemoryBudget_MB * (1 << 20);
+	if (footprint && budget > 0)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			jobs[i].footprint = footprint(i);
+		}
+	}
+
+	print(QString("[Batch] Processing %1 entities with up to %2 concurrent jobs").arg(count).arg(threadCount));
+
+	//the jobs can't read the ASCII save dialog (see exportEntity)
+	if (m_cloudExportFormat == AsciiFilter::GetFileFilter() || m_meshExportFormat == AsciiFilter::GetFileFilter())
+	{
+		m_jobsAsciiSaveOptions = AsciiFilter::GetSaveOptions();
+	}
+
+	QMutex& mutex = m_jobsMutex;
+	QWaitCondition& stateChanged = m_jobsStateChanged;
+	size_t nextJob = 0;
+	int runningJobs = 0;
+	int activeWorkers = threadCount;
+	qint64 usedMemory = 0;
+	bool failed = false;
+
+	auto worker = [&]()
+	{
+		QMutexLocker locker(&mutex);
+		while (nextJob < count && !failed)
+		{
+			//jobs are started in order
+			JobState& state = jobs[nextJob++];
+
+			//wait for enough memory (unless nothing else is running)
+			while (budget > 0 && runningJobs != 0 && usedMemory + state.footprint > budget && !failed)
+			{
+				stateChanged.wait(&mutex);
+			}
+			if (failed)
+			{
+				break;
+			}
+			++runningJobs;
+			usedMemory += state.footprint;
+			size_t jobIndex = static_cast<size_t>(&state - jobs.data());
+			locker.unlock();
+
+			bool success = false;
+			ccLog::CaptureThreadMessages(&state.messages);
+			try
+			{
+				success = job(jobIndex);
+			}
+			catch (const std::bad_alloc&)
+			{
+				error("Not enough memory");
+			}
+			ccLog::CaptureThreadMessages(nullptr);
+
+			locker.relock();
+			--runningJobs;
+			usedMemory -= state.footprint;
+			state.success = success;
+			state.done = true;
+			if (!success)
+			{
+				failed = true;
+			}
+			stateChanged.wakeAll();
+		}
+		--activeWorkers;
+		stateChanged.wakeAll();
+	};
+
+	//dedicated pool (the algorithms may use the global one)
+	QThreadPool pool;
+	pool.setMaxThreadCount(threadCount);
+	for (int i = 0; i < threadCount; ++i)
+	{
+		QtConcurrent::run(&pool, worker);
+	}
+
+	//flush the jobs messages in order
+	bool success = true;
+	for (size_t i = 0; i < count; ++i)
+	{
+		QMutexLocker locker(&mutex);
+		while (!jobs[i].done && activeWorkers != 0)
+		{
+			//functions posted by the jobs (see runOnMainThread)
+			while (!m_mainThreadCalls.empty())
+			{
+				MainThreadCall* call = m_mainThreadCalls.front();
+				m_mainThreadCalls.erase(m_mainThreadCalls.begin());
+				locker.unlock();
+				call->function();
+				locker.relock();
+				call->done = true;
+				stateChanged.wakeAll();
+			}
+			if (jobs[i].done)
+			{
+				break;
+			}
+
+			stateChanged.wait(&mutex, 100);
+			locker.unlock();
+			QCoreApplication::processEvents();
+			locker.relock();
+		}
+		if (!jobs[i].done)
+		{
+			//this job was never started (because another one failed)
+			success = false;
+			continue;
+		}
+		locker.unlock();
+
+		for (const ccLog::Message& message : jobs[i].messages)
+		{
+			if (message.flags & ccLog::LOG_ERROR)
+				error(message.text);
+			else if (message.flags & ccLog::LOG_WARNING)
+				warning(message.text);
+			else
+				print(message.text);
+		}
+		jobs[i].messages.clear();
+
+		success &= jobs[i].success;
+	}
+
+	pool.waitForDone();
+
+	return success && !failed;
+}
+
+void ccCommandLineParser::runOnMainThread(std::function<void()> function)
+{
+	if (QThread::currentThread() == QCoreApplication::instance()->thread())
+	{
+		function();
+		return;
+	}
+
+	//the messages logged on the main thread are logged again by this thread
+	//(so that they are flushed with the other messages of the job)
+	std::vector<ccLog::Message> messages;
+
+	MainThreadCall call;
+	call.done = false;
+	call.function = [&function, &messages]()
+	{
+		ccLog::CaptureThreadMessages(&messages);
+		function();
+		ccLog::CaptureThreadMessages(nullptr);
+	};
+
+	{
+		QMutexLocker locker(&m_jobsMutex);
+		m_mainThreadCalls.push_back(&call);
+		m_jobsStateChanged.wakeAll();
+		while (!call.done)
+		{
+			m_jobsStateChanged.wait(&m_jobsMutex);
+		}
+	}
+
+	for (const ccLog::Message& message : messages)
+	{
+		ccLog::LogMessage(message.text, message.flags);
+	}
+}
+
 int ccCommandLineParser::Parse(int nargs, char** args, ccPluginInterfaceList& plugins)
 {
 	if (!args || nargs < 2)
@@ -138,6 +442,8 @@ ccCommandLineParser::ccCommandLineParser()
 	, m_progressDialog(0)
 	, m_parentWidget(0)
 {
+	m_writerPool.setMaxThreadCount(1);
+
 	registerCommand(Command::Shared(new CommandLoad));
 	registerCommand(Command::Shared(new CommandSubsample));
 	registerCommand(Command::Shared(new CommandExtractCCs));
@@ -159,6 +465,8 @@ ccCommandLineParser::ccCommandLineParser()
 	registerCommand(Command::Shared(new CommandOrientNormalsMST));
 	registerCommand(Command::Shared(new CommandSORFilter));
 	registerCommand(Command::Shared(new CommandSampleMesh));
+	registerCommand(Command::Shared(new CommandLaplacianSmooth));
+	registerCommand(Command::Shared(new CommandSubdivide));
 	registerCommand(Command::Shared(new CommandCrossSection));
 	registerCommand(Command::Shared(new CommandCrop));
 	registerCommand(Command::Shared(new CommandCrop2D));
@@ -170,15 +478,21 @@ ccCommandLineParser::ccCommandLineParser()
 	registerCommand(Command::Shared(new CommandDelaunayTri));
 	registerCommand(Command::Shared(new CommandSFArithmetic));
 	registerCommand(Command::Shared(new CommandSFOperation));
+	registerCommand(Command::Shared(new CommandSFExpression));
+	registerCommand(Command::Shared(new CommandSFInterpolation));
 	registerCommand(Command::Shared(new CommandICP));
 	registerCommand(Command::Shared(new CommandChangeCloudOutputFormat));
 	registerCommand(Command::Shared(new CommandChangeMeshOutputFormat));
 	registerCommand(Command::Shared(new CommandChangeFBXOutputFormat));
 	registerCommand(Command::Shared(new CommandChangePLYExportFormat));
+	registerCommand(Command::Shared(new CommandBinQuantization));
+	registerCommand(Command::Shared(new CommandQuantizationBenchmark));
 	registerCommand(Command::Shared(new CommandForceNormalsComputation));
 	registerCommand(Command::Shared(new CommandSaveClouds));
 	registerCommand(Command::Shared(new CommandSaveMeshes));
 	registerCommand(Command::Shared(new CommandAutoSave));
+	registerCommand(Command::Shared(new CommandAsyncSave));
+	registerCommand(Command::Shared(new CommandProfile));
 	registerCommand(Command::Shared(new CommandLogFile));
 	registerCommand(Command::Shared(new CommandClear));
 	registerCommand(Command::Shared(new CommandClearClouds));
@@ -186,6 +500,7 @@ ccCommandLineParser::ccCommandLineParser()
 	registerCommand(Command::Shared(new CommandClearMeshes));
 	registerCommand(Command::Shared(new CommandPopMeshes));
 	registerCommand(Command::Shared(new CommandSetNoTimestamp));
+	registerCommand(Command::Shared(new CommandParallelEntities));
 	registerCommand(Command::Shared(new CommandVolume25D));
 	registerCommand(Command::Shared(new CommandRasterize));
 	registerCommand(Command::Shared(new CommandOctreeNormal));
@@ -193,10 +508,14 @@ ccCommandLineParser::ccCommandLineParser()
 	registerCommand(Command::Shared(new CommandComputeMeshVolume));
 	registerCommand(Command::Shared(new CommandSFColorScale));
 	registerCommand(Command::Shared(new CommandSFConvertToRGB));
+	registerCommand(Command::Shared(new CommandRender));
 }
 
 ccCommandLineParser::~ccCommandLineParser()
 {
+	//the background saves must be complete (their errors should have already been reported)
+	m_writerPool.waitForDone();
+
 	removeClouds();
 	removeMeshes();
 
@@ -288,8 +607,6 @@ QString ccCommandLineParser::exportEntity(	CLEntityDesc& entityDesc,
 											bool forceIsCloud/*=false*/,
 											bool forceNoTimestamp/*=false*/)
 {
-	print("[SAVING]");
-
 	//fetch the real entity
 	ccHObject* entity = entityDesc.getEntity();
 	if (!entity)
@@ -301,6 +618,21 @@ QString ccCommandLineParser::exportEntity(	CLEntityDesc& entityDesc,
 	//specific case: clouds
 	bool isCloud = entity->isA(CC_TYPES::POINT_CLOUD);
 	isCloud |= forceIsCloud;
+
+	//concurrent jobs: most filters can only be used from the main thread
+	bool mainThread = (QThread::currentThread() == QCoreApplication::instance()->thread());
+	if (!mainThread && !CanSaveOutsideOfMainThread(isCloud ? m_cloudExportFormat : m_meshExportFormat))
+	{
+		QString errorStr;
+		runOnMainThread([&]()
+		{
+			errorStr = exportEntity(entityDesc, suffix, baseOutputFilename, forceIsCloud, forceNoTimestamp);
+		});
+		return errorStr;
+	}
+
+	print("[SAVING]");
+
 	QString extension = isCloud ? m_cloudExportExt : m_meshExportExt;
 
 	QString outputFilename = getExportFilename(entityDesc, extension, suffix, baseOutputFilename, forceNoTimestamp);
@@ -325,6 +657,14 @@ QString ccCommandLineParser::exportEntity(	CLEntityDesc& entityDesc,
 		entity->setName(entName);
 	}
 
+	//asynchronous save (concurrent jobs save their entities directly)
+	if (	m_asyncSaveMode
+		&&	mainThread
+		&&	saveInBackground(entity, outputFilename, isCloud ? m_cloudExportFormat : m_meshExportFormat))
+	{
+		return QString();
+	}
+
 	bool tempDependencyCreated = false;
 	ccGenericMesh* mesh = 0;
 	if (entity->isKindOf(CC_TYPES::MESH) && m_meshExportFormat == BinFilter::GetFileFilter())
@@ -346,7 +686,8 @@ QString ccCommandLineParser::exportEntity(	CLEntityDesc& entityDesc,
 	{
 		//no dialog by default for command line mode!
 		parameters.alwaysDisplaySaveDialog = false;
-		if (!silentMode() && ccConsole::TheInstance())
+		parameters.binQuantizationStep = m_binQuantizationStep;
+		if (!silentMode() && ccConsole::TheInstance() && mainThread)
 		{
 			parameters.parentWidget = ccConsole::TheInstance()->parentWidget();
 		}
@@ -355,10 +696,22 @@ QString ccCommandLineParser::exportEntity(	CLEntityDesc& entityDesc,
 #ifdef _DEBUG
 	print("Output filename: " + outputFilename);
 #endif
-	CC_FILE_ERROR result = FileIOFilter::SaveToFile(entity,
-													outputFilename,
-													parameters,
-													isCloud ? m_cloudExportFormat : m_meshExportFormat);
+	CC_FILE_ERROR result = CC_FERR_NO_ERROR;
+	{
+		CCLib::Profiler::Scope profilerScope("File save");
+		if (mainThread)
+		{
+			result = FileIOFilter::SaveToFile(	entity,
+												outputFilename,
+												parameters,
+												isCloud ? m_cloudExportFormat : m_meshExportFormat);
+		}
+		else
+		{
+			//the ASCII options have been read beforehand (see processEntities)
+			result = SaveToFile(entity, outputFilename, parameters, isCloud ? m_cloudExportFormat : m_meshExportFormat, m_jobsAsciiSaveOptions);
+		}
+	}
 
 	//restore input state!
 	if (tempDependencyCreated)
@@ -376,6 +729,178 @@ QString ccCommandLineParser::exportEntity(	CLEntityDesc& entityDesc,
 	return (result != CC_FERR_NO_ERROR ? QString("Failed to save result in file '%1'").arg(outputFilename) : QString());
 }
 
+bool ccCommandLineParser::saveInBackground(ccHObject* entity, const QString& filename, const QString& format)
+{
+	if (!entity)
+	{
+		assert(false);
+		return false;
+	}
+
+	if (!CanSaveOutsideOfMainThread(format))
+	{
+		//this filter may use dialogs
+		return false;
+	}
+
+	//the ASCII options are read now (on the main thread) as the next commands may change them
+	AsciiFilter::SaveOptions asciiOptions;
+	if (format == AsciiFilter::GetFileFilter())
+	{
+		asciiOptions = AsciiFilter::GetSaveOptions();
+	}
+
+	//we save a copy of the entity, as the next commands may modify (or delete) it
+	ccHObject* snapshot = 0;
+	if (entity->isA(CC_TYPES::POINT_CLOUD))
+	{
+		ccPointCloud* cloud = static_cast<ccPointCloud*>(entity);
+		ccPointCloud* clone = cloud->cloneThis();
+		if (clone)
+		{
+			clone->setName(cloud->getName());
+			snapshot = clone;
+		}
+	}
+	else if (entity->isA(CC_TYPES::MESH))
+	{
+		//the vertices are cloned as well (and will be a child of the cloned mesh)
+		ccMesh* mesh = static_cast<ccMesh*>(entity);
+		ccMesh* clone = mesh->cloneMesh();
+		if (clone)
+		{
+			clone->setName(mesh->getName());
+			if (mesh->getAssociatedCloud() && clone->getAssociatedCloud())
+			{
+				clone->getAssociatedCloud()->setName(mesh->getAssociatedCloud()->getName());
+			}
+			snapshot = clone;
+		}
+	}
+	else
+	{
+		//other entities (groups, etc.) are saved directly
+		return false;
+	}
+
+	if (!snapshot)
+	{
+		warning(QString("Not enough memory to save '%1' in the background (it will be saved directly)").arg(entity->getName()));
+		return false;
+	}
+
+	//limit the number of pending snapshots (= memory)
+	static const int s_maxPendingSaves = 2;
+	while (m_pendingSaves.size() >= s_maxPendingSaves)
+	{
+		QString errorStr = m_pendingSaves.takeFirst().result();
+		if (!errorStr.isEmpty())
+		{
+			//will be reported by waitForPendingSaves
+			m_failedSaves.push_back(errorStr);
+		}
+	}
+
+	print(QString("Saving '%1' in the background").arg(filename));
+
+	//same thing for the BIN quantization step
+	double binQuantizationStep = m_binQuantizationStep;
+
+	m_pendingSaves.push_back(QtConcurrent::run(&m_writerPool, [snapshot, filename, format, asciiOptions, binQuantizationStep]() -> QString
+	{
+		//the writer doesn't run the profiled commands
+		ccCommandLineProfiler::RegisterBackgroundThread();
+
+		//no dialog in the background!
+		FileIOFilter::SaveParameters parameters;
+		parameters.alwaysDisplaySaveDialog = false;
+		parameters.parentWidget = 0;
+		parameters.binQuantizationStep = binQuantizationStep;
+
+		CC_FILE_ERROR result = CC_FERR_NO_ERROR;
+		try
+		{
+			CCLib::Profiler::Scope profilerScope("File save (background)");
+			result = SaveToFile(snapshot, filename, parameters, format, asciiOptions);
+		}
+		catch (const std::bad_alloc&)
+		{
+			result = CC_FERR_NOT_ENOUGH_MEMORY;
+		}
+		delete snapshot;
+
+		return (result != CC_FERR_NO_ERROR ? QString("Failed to save result in file '%1'").arg(filename) : QString());
+	}));
+
+	return true;
+}
+
+bool ccCommandLineParser::waitForPendingSaves()
+{
+	if (!m_pendingSaves.empty())
+	{
+		print(QString("Waiting for %1 file(s) to be saved in the background...").arg(m_pendingSaves.size()));
+	}
+
+	while (!m_pendingSaves.empty())
+	{
+		QString errorStr = m_pendingSaves.takeFirst().result();
+		if (!errorStr.isEmpty())
+		{
+			m_failedSaves.push_back(errorStr);
+		}
+	}
+
+	if (m_failedSaves.empty())
+	{
+		return true;
+	}
+
+	//report all the write errors
+	for (const QString& errorStr : m_failedSaves)
+	{
+		error(errorStr);
+	}
+	m_failedSaves.clear();
+
+	return false;
+}
+
+bool ccCommandLineParser::enableProfiling(const QString& filename)
+{
+	if (filename.isEmpty())
+	{
+		assert(false);
+		return false;
+	}
+
+	//save the previous report first (if any)
+	if (m_profiler)
+	{
+		m_profiler->save();
+	}
+
+	m_profiler.reset(new ccCommandLineProfiler(filename));
+
+	return true;
+}
+
+qint64 ccCommandLineParser::pointCount() const
+{
+	qint64 count = 0;
+	for (const CLCloudDesc& desc : m_clouds)
+	{
+		if (desc.pc)
+			count += desc.pc->size();
+	}
+	for (const CLMeshDesc& desc : m_meshes)
+	{
+		if (desc.mesh && desc.mesh->getAssociatedCloud())
+			count += desc.mesh->getAssociatedCloud()->size();
+	}
+	return count;
+}
+
 void ccCommandLineParser::removeClouds(bool onlyLast/*=false*/)
 {
 	while (!m_clouds.empty())
@@ -405,6 +930,8 @@ bool ccCommandLineParser::importFile(QString filename, FileIOFilter::Shared filt
 {
 	print(QString("Opening file: '%1'").arg(filename));
 
+	CCLib::Profiler::Scope profilerScope("File load");
+
 	CC_FILE_ERROR result = CC_FERR_NO_ERROR;
 	ccHObject* db = 0;
 	if (filter)
@@ -486,7 +1013,7 @@ bool ccCommandLineParser::importFile(QString filename, FileIOFilter::Shared filt
 	//now look for the remaining clouds inside loaded DB
 	{
 		ccHObject::Container clouds;
-		db->filterChildren(clouds, false, CC_TYPES::POINT_CLOUD);
+		db->filterChildren(clouds, false, CC_TYPES::POINT_CLOUD, true); //strict: sub-clouds are ignored
 		size_t count = clouds.size();
 		for (size_t i = 0; i < count; ++i)
 		{
@@ -634,6 +1161,10 @@ int ccCommandLineParser::start(QDialog* parent/*=0*/)
 	}
 
 	m_parentWidget = parent;
+
+	//the threads that already exist don't run the commands (e.g. Qt's own threads)
+	ccCommandLineProfiler::RegisterExistingThreadsAsBackground();
+
 	//if (!m_silentMode)
 	//{
 	//	m_progressDialog = new ccProgressDialog(false, parent);
@@ -661,7 +1192,18 @@ int ccCommandLineParser::start(QDialog* parent/*=0*/)
 		if (m_commands.contains(keyword))
 		{
 			assert(m_commands[keyword]);
+			bool profiled = !m_profiler.isNull();
+			if (profiled)
+			{
+				m_profiler->startCommand(keyword, pointCount());
+			}
+
 			success = m_commands[keyword]->process(*this);
+
+			if (profiled)
+			{
+				print(m_profiler->stopCommand(success, pointCount()));
+			}
 		}
 		//silent mode (i.e. no console)
 		else if (keyword == COMMAND_SILENT_MODE)
@@ -684,6 +1226,20 @@ int ccCommandLineParser::start(QDialog* parent/*=0*/)
 		}
 	}
 
+	//wait for the files being saved in the background
+	if (!waitForPendingSaves())
+	{
+		success = false;
+	}
+
+	//save the profiling report
+	if (m_profiler)
+	{
+		if (m_profiler->save())
+			print(QString("[Profile] Report saved: '%1'").arg(m_profiler->filename()));
+		m_profiler.reset();
+	}
+
 	print(QString("Processed finished in %1 s.").arg(eTimer.elapsed() / 1.0e3, 0, 'f', 2));
 
 	return success ? EXIT_SUCCESS : EXIT_FAILURE;
@@ -7,6 +7,19 @@
 //Local
 #include "ccPluginManager.h"
 
+//qCC_io
+#include <AsciiFilter.h>
+
+//Qt
+#include <QFuture>
+#include <QMutex>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+//system
+#include <vector>
+
+class ccCommandLineProfiler;
 class ccProgressDialog;
 class QDialog;
 
@@ -37,12 +50,13 @@ public:
 	virtual QStringList& arguments() override { return m_arguments; }
 	virtual const QStringList& arguments() const override { return m_arguments; }
 	virtual bool registerCommand(Command::Shared command) override;
-	virtual QDialog* widgetParent() override { return m_parentWidget; }
+	virtual QDialog* widgetParent() override;
 	virtual void print(const QString& message) const override;
 	virtual void warning(const QString& message) const override;
 	virtual bool error(const QString& message) const override; //must always return false!
 	virtual bool saveClouds(QString suffix = QString(), bool allAtOnce = false, const QString* allAtOnceFileName = 0) override;
 	virtual bool saveMeshes(QString suffix = QString(), bool allAtOnce = false, const QString* allAtOnceFileName = 0) override;
+	virtual bool waitForPendingSaves() override;
 	virtual bool importFile(QString filename, FileIOFilter::Shared filter = FileIOFilter::Shared(0)) override;
 	virtual QString cloudExportFormat() const override { return m_cloudExportFormat; }
 	virtual QString cloudExportExt() const override { return m_cloudExportExt; }
@@ -50,6 +64,8 @@ public:
 	virtual QString meshExportExt() const override { return m_meshExportExt; }
 	virtual void setCloudExportFormat(QString format, QString ext) override { m_cloudExportFormat = format; m_cloudExportExt = ext; }
 	virtual void setMeshExportFormat(QString format, QString ext) override { m_meshExportFormat = format; m_meshExportExt = ext; }
+	virtual bool processEntities(size_t count, EntityJob job, EntityFootprint footprint = EntityFootprint()) override;
+	virtual bool enableProfiling(const QString& filename) override;
 
 protected: //other methods
 
@@ -61,6 +77,22 @@ protected: //other methods
 	//! Parses the command line
 	int start(QDialog* parent = 0);
 
+	//! Saves a copy of an entity in the background
+	/** \return false if the entity type is not handled (it should then be saved directly)
+	**/
+	bool saveInBackground(ccHObject* entity, const QString& filename, const QString& format);
+
+	//! Returns the total number of points (clouds + meshes vertices)
+	qint64 pointCount() const;
+
+	//! Runs a function on the main thread and waits for its completion
+	/** For the concurrent jobs (see processEntities) that need the main thread
+		(e.g. to save files with filters that may use dialogs). The messages logged
+		by the function are output with the job messages.
+		The function is called directly if this method is called from the main thread.
+	**/
+	void runOnMainThread(std::function<void()> function);
+
 private: //members
 
 	//! Current cloud(s) export format (can be modified with the 'COMMAND_CLOUD_EXPORT_FORMAT' option)
@@ -89,6 +121,36 @@ private: //members
 
 	//! Widget parent
 	QDialog* m_parentWidget;
+
+	//! Background writer (single thread)
+	QThreadPool m_writerPool;
+
+	//! Files being saved in the background (+ their error string)
+	QList< QFuture<QString> > m_pendingSaves;
+
+	//! Errors of the files that failed to be saved in the background (not reported yet)
+	QStringList m_failedSaves;
+
+	//! Profiler (if enabled)
+	QScopedPointer<ccCommandLineProfiler> m_profiler;
+
+	//! Function posted by a concurrent job to the main thread (see runOnMainThread)
+	struct MainThreadCall
+	{
+		std::function<void()> function;
+		bool done;
+	};
+
+	//! Functions waiting to be called by the main thread
+	std::vector<MainThreadCall*> m_mainThreadCalls;
+
+	//! Concurrent jobs synchronization (see processEntities)
+	QMutex m_jobsMutex;
+	//! Concurrent jobs state change notification (see processEntities)
+	QWaitCondition m_jobsStateChanged;
+
+	//! ASCII save options used by the concurrent jobs (read on the main thread before they start)
+	AsciiFilter::SaveOptions m_jobsAsciiSaveOptions;
 };
 
 #endif
@@ -0,0 +1,363 @@
+#include "ccCommandLineProfiler.h"
+
+//qCC_db
+#include <ccLog.h>
+
+//Qt
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+
+//system
+#include <algorithm>
+#include <atomic>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#include <tlhelp32.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "psapi.lib")
+#endif
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#endif
+#include <ctime>
+#include <functional>
+#include <thread>
+
+//! Returns a small (and stable) identifier for the current thread
+static int CurrentThreadID()
+{
+	static std::atomic<int> s_lastID(0);
+	thread_local int s_id = ++s_lastID;
+	return s_id;
+}
+
+//! Returns the system identifier of the current thread
+static qint64 CurrentSystemThreadID()
+{
+#if defined(_WIN32)
+	return static_cast<qint64>(GetCurrentThreadId());
+#elif defined(__linux__)
+	return static_cast<qint64>(syscall(SYS_gettid));
+#else
+	return static_cast<qint64>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+#endif
+}
+
+//! Background threads (see ccCommandLineProfiler::RegisterBackgroundThread)
+static std::set<qint64> s_backgroundThreads;
+//! Background threads mutex
+static QMutex s_backgroundThreadsMutex;
+
+void ccCommandLineProfiler::RegisterBackgroundThread()
+{
+	QMutexLocker locker(&s_backgroundThreadsMutex);
+	s_backgroundThreads.insert(CurrentSystemThreadID());
+}
+
+void ccCommandLineProfiler::RegisterExistingThreadsAsBackground()
+{
+	std::map<qint64, double> threads = GetThreadsCPUTime();
+	threads.erase(CurrentSystemThreadID());
+
+	QMutexLocker locker(&s_backgroundThreadsMutex);
+	for (const auto& thread : threads)
+	{
+		s_backgroundThreads.insert(thread.first);
+	}
+}
+
+bool ccCommandLineProfiler::IsBackgroundThread(qint64 threadID)
+{
+	QMutexLocker locker(&s_backgroundThreadsMutex);
+	return s_backgroundThreads.find(threadID) != s_backgroundThreads.end();
+}
+
+double ccCommandLineProfiler::GetCurrentThreadCPUTime()
+{
+#if defined(_WIN32)
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	if (GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime))
+	{
+		//FILETIME values are expressed in 100 ns units
+		ULARGE_INTEGER k, u;
+		k.LowPart = kernelTime.dwLowDateTime;
+		k.HighPart = kernelTime.dwHighDateTime;
+		u.LowPart = userTime.dwLowDateTime;
+		u.HighPart = userTime.dwHighDateTime;
+		return (k.QuadPart + u.QuadPart) / 1.0e7;
+	}
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+	struct timespec ts;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+	{
+		return ts.tv_sec + ts.tv_nsec / 1.0e9;
+	}
+#endif
+	return 0.0;
+}
+
+std::map<qint64, double> ccCommandLineProfiler::GetThreadsCPUTime()
+{
+	std::map<qint64, double> cpuTimes;
+
+#if defined(_WIN32)
+	HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+	if (snapshot != INVALID_HANDLE_VALUE)
+	{
+		const DWORD pid = GetCurrentProcessId();
+		THREADENTRY32 entry;
+		entry.dwSize = sizeof(entry);
+		for (BOOL ok = Thread32First(snapshot, &entry); ok; ok = Thread32Next(snapshot, &entry))
+		{
+			if (entry.th32OwnerProcessID != pid)
+				continue;
+
+			HANDLE thread = OpenThread(THREAD_QUERY_LIMITED_INFORMATION, FALSE, entry.th32ThreadID);
+			if (!thread)
+				continue;
+
+			FILETIME creationTime, exitTime, kernelTime, userTime;
+			if (GetThreadTimes(thread, &creationTime, &exitTime, &kernelTime, &userTime))
+			{
+				//FILETIME values are expressed in 100 ns units
+				ULARGE_INTEGER k, u;
+				k.LowPart = kernelTime.dwLowDateTime;
+				k.HighPart = kernelTime.dwHighDateTime;
+				u.LowPart = userTime.dwLowDateTime;
+				u.HighPart = userTime.dwHighDateTime;
+				cpuTimes[static_cast<qint64>(entry.th32ThreadID)] = (k.QuadPart + u.QuadPart) / 1.0e7;
+			}
+			CloseHandle(thread);
+		}
+		CloseHandle(snapshot);
+	}
+#elif defined(__linux__)
+	const double ticksPerSecond = static_cast<double>(sysconf(_SC_CLK_TCK));
+	QDir taskDir("/proc/self/task");
+	for (const QString& tid : taskDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+	{
+		QFile statFile(QString("/proc/self/task/%1/stat").arg(tid));
+		if (!statFile.open(QFile::ReadOnly))
+			continue; //the thread may have ended in the meantime
+
+		//the thread name (2nd field) is between parentheses and may contain spaces
+		QString stat = QString::fromLatin1(statFile.readAll());
+		QStringList fields = stat.mid(stat.lastIndexOf(')') + 2).split(' ');
+		//utime and stime are the 14th and 15th fields (i.e. the 12th and 13th after the name)
+		if (fields.size() > 12)
+		{
+			cpuTimes[tid.toLongLong()] = (fields[11].toLongLong() + fields[12].toLongLong()) / ticksPerSecond;
+		}
+	}
+#endif
+
+	return cpuTimes;
+}
+
+ccCommandLineProfiler::ResourcesUsage ccCommandLineProfiler::GetResourcesUsage()
+{
+	ResourcesUsage usage;
+
+#ifdef _WIN32
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	if (GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+	{
+		//FILETIME values are expressed in 100 ns units
+		ULARGE_INTEGER k, u;
+		k.LowPart = kernelTime.dwLowDateTime;
+		k.HighPart = kernelTime.dwHighDateTime;
+		u.LowPart = userTime.dwLowDateTime;
+		u.HighPart = userTime.dwHighDateTime;
+		usage.cpuTime_s = (k.QuadPart + u.QuadPart) / 1.0e7;
+	}
+
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		usage.peakRSS_MB = counters.PeakWorkingSetSize / static_cast<double>(1 << 20);
+	}
+#else
+	struct rusage ru;
+	if (getrusage(RUSAGE_SELF, &ru) == 0)
+	{
+		usage.cpuTime_s =	ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1.0e6
+						+	ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1.0e6;
+#ifdef __APPLE__
+		//bytes
+		usage.peakRSS_MB = ru.ru_maxrss / static_cast<double>(1 << 20);
+#else
+		//kilobytes
+		usage.peakRSS_MB = ru.ru_maxrss / 1024.0;
+#endif
+	}
+#endif
+
+	return usage;
+}
+
+ccCommandLineProfiler::ccCommandLineProfiler(const QString& filename)
+	: m_filename(filename)
+	, m_origin(CCLib::Profiler::Clock::now())
+{
+	CCLib::Profiler::SetSink(this);
+}
+
+ccCommandLineProfiler::~ccCommandLineProfiler()
+{
+	if (CCLib::Profiler::GetSink() == this)
+	{
+		CCLib::Profiler::SetSink(nullptr);
+	}
+}
+
+qint64 ccCommandLineProfiler::toMicroseconds(CCLib::Profiler::Clock::time_point t) const
+{
+	return static_cast<qint64>(std::chrono::duration_cast<std::chrono::microseconds>(t - m_origin).count());
+}
+
+void ccCommandLineProfiler::addEvent(const QString& name, const QString& category, CCLib::Profiler::Clock::time_point start, CCLib::Profiler::Clock::time_point stop, const QJsonObject& args)
+{
+	QJsonObject event;
+	event["name"] = name;
+	event["cat"] = category;
+	event["ph"] = "X"; //'complete' event
+	event["ts"] = toMicroseconds(start);
+	event["dur"] = static_cast<qint64>(std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count());
+	event["pid"] = static_cast<qint64>(QCoreApplication::applicationPid());
+	event["tid"] = CurrentThreadID();
+	if (!args.isEmpty())
+	{
+		event["args"] = args;
+	}
+
+	qint64 threadID = CurrentSystemThreadID();
+	bool backgroundThread = IsBackgroundThread(threadID);
+
+	QMutexLocker locker(&m_mutex);
+	m_events.append(event);
+	if (!backgroundThread)
+	{
+		m_currentCommand.reportingThreads.insert(threadID);
+	}
+}
+
+void ccCommandLineProfiler::startCommand(const QString& keyword, qint64 pointsIn)
+{
+	m_currentCommand.keyword = keyword;
+	m_currentCommand.pointsIn = pointsIn;
+	m_currentCommand.threadsCPUTime = GetThreadsCPUTime();
+	{
+		QMutexLocker locker(&m_mutex);
+		m_currentCommand.reportingThreads.clear();
+	}
+	m_currentCommand.usage = GetResourcesUsage();
+	m_currentCommand.start = CCLib::Profiler::Clock::now();
+}
+
+QString ccCommandLineProfiler::stopCommand(bool success, qint64 pointsOut)
+{
+	CCLib::Profiler::Clock::time_point stop = CCLib::Profiler::Clock::now();
+	ResourcesUsage usage = GetResourcesUsage();
+
+	double wallTime_s = std::chrono::duration<double>(stop - m_currentCommand.start).count();
+	double cpuTime_s = usage.cpuTime_s - m_currentCommand.usage.cpuTime_s;
+
+	//threads that actually ran during the command: the ones whose CPU time has increased,
+	//plus the ones that reported events (they may have ended before the end of the command).
+	//The background threads (e.g. the writer saving the output of a previous command) and
+	//Qt's own threads are ignored, and their CPU time is removed from the command CPU time.
+	std::set<qint64> threads;
+	{
+		QMutexLocker locker(&m_mutex);
+		threads = m_currentCommand.reportingThreads;
+	}
+	threads.insert(CurrentSystemThreadID());
+	for (const auto& thread : GetThreadsCPUTime())
+	{
+		std::map<qint64, double>::const_iterator before = m_currentCommand.threadsCPUTime.find(thread.first);
+		double threadCPUTime_s = thread.second - (before != m_currentCommand.threadsCPUTime.end() ? before->second : 0.0);
+		if (threadCPUTime_s <= 0)
+		{
+			continue;
+		}
+		if (IsBackgroundThread(thread.first))
+		{
+			cpuTime_s -= threadCPUTime_s;
+		}
+		else
+		{
+			threads.insert(thread.first);
+		}
+	}
+	cpuTime_s = std::max(cpuTime_s, 0.0);
+
+	QJsonObject args;
+	args["wall_time_s"] = wallTime_s;
+	args["cpu_time_s"] = cpuTime_s;
+	args["peak_rss_MB"] = usage.peakRSS_MB;
+	args["peak_rss_increase_MB"] = usage.peakRSS_MB - m_currentCommand.usage.peakRSS_MB;
+	args["points_in"] = m_currentCommand.pointsIn;
+	args["points_out"] = pointsOut;
+	args["threads"] = static_cast<int>(threads.size());
+	args["cpu_parallelism"] = (wallTime_s > 0 ? cpuTime_s / wallTime_s : 0.0);
+	args["success"] = success;
+
+	addEvent(m_currentCommand.keyword, "command", m_currentCommand.start, stop, args);
+
+	return QString("[Profile] -%1: wall %2 s / CPU %3 s / threads %4 / peak RSS %5 MB / points %6 -> %7")
+			.arg(m_currentCommand.keyword)
+			.arg(wallTime_s, 0, 'f', 3)
+			.arg(cpuTime_s, 0, 'f', 3)
+			.arg(threads.size())
+			.arg(usage.peakRSS_MB, 0, 'f', 1)
+			.arg(m_currentCommand.pointsIn)
+			.arg(pointsOut);
+}
+
+void ccCommandLineProfiler::addEntityJob(const EntityJob& job)
+{
+	QJsonObject args;
+	args["index"] = static_cast<qint64>(job.index);
+	args["entity"] = job.entityName;
+	args["wall_time_s"] = std::chrono::duration<double>(job.stop - job.start).count();
+	args["cpu_time_s"] = job.cpuTime_s;
+	args["points_in"] = job.pointsIn;
+	args["points_out"] = job.pointsOut;
+	args["success"] = job.success;
+
+	addEvent(QString("%1 [#%2]").arg(m_currentCommand.keyword).arg(job.index), "entity", job.start, job.stop, args);
+}
+
+void ccCommandLineProfiler::addPhase(const char* name, CCLib::Profiler::Clock::time_point start, CCLib::Profiler::Clock::time_point stop)
+{
+	addEvent(QString(name), "phase", start, stop, QJsonObject());
+}
+
+bool ccCommandLineProfiler::save() const
+{
+	QFile file(m_filename);
+	if (!file.open(QFile::WriteOnly | QFile::Text))
+	{
+		ccLog::Warning(QString("[Profile] Failed to open file '%1' for writing").arg(m_filename));
+		return false;
+	}
+
+	QJsonObject root;
+	{
+		QMutexLocker locker(&m_mutex);
+		root["traceEvents"] = m_events;
+	}
+	root["displayTimeUnit"] = "ms";
+
+	file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+
+	return true;
+}
@@ -0,0 +1,163 @@
+#ifndef CC_COMMAND_LINE_PROFILER_HEADER
+#define CC_COMMAND_LINE_PROFILER_HEADER
+
+//CCLib
+#include <Profiler.h>
+
+//Qt
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QMutex>
+#include <QString>
+
+//system
+#include <map>
+#include <set>
+
+//! Command line profiler
+/** Records the commands (wall time, CPU time, peak memory, points in/out, threads),
+	the per-entity jobs and the main phases of the CCLib algorithms (see CCLib::Profiler).
+	The report is saved in the Chrome trace event format (JSON), which can be
+	read by chrome://tracing or https://ui.perfetto.dev.
+**/
+class ccCommandLineProfiler : public CCLib::Profiler::Sink
+{
+public:
+
+	//! Process resources usage
+	struct ResourcesUsage
+	{
+		ResourcesUsage() : cpuTime_s(0), peakRSS_MB(0) {}
+
+		//! CPU time (user + system, in seconds)
+		double cpuTime_s;
+		//! Peak resident set size (in MB)
+		double peakRSS_MB;
+	};
+
+	//! Returns the current process resources usage
+	static ResourcesUsage GetResourcesUsage();
+
+	//! Returns the CPU time (in seconds) of each (system) thread of the process
+	/** Only supported on Linux and Windows (the map is empty otherwise).
+	**/
+	static std::map<qint64, double> GetThreadsCPUTime();
+
+	//! Returns the CPU time (in seconds) of the current thread
+	/** Returns 0 if not supported.
+	**/
+	static double GetCurrentThreadCPUTime();
+
+	//! Flags the current thread as a background thread (e.g. the file writer)
+	/** The background threads don't run the profiled commands: they are not counted
+		in the commands threads and their CPU time is excluded from the commands CPU
+		time (if the per-thread CPU time is supported).
+	**/
+	static void RegisterBackgroundThread();
+
+	//! Flags all the existing threads (except the current one) as background threads
+	/** To be called before the first command, so that Qt's own threads are ignored.
+	**/
+	static void RegisterExistingThreadsAsBackground();
+
+	//! Default constructor
+	/** \param filename report filename
+	**/
+	explicit ccCommandLineProfiler(const QString& filename);
+
+	//! Destructor
+	virtual ~ccCommandLineProfiler();
+
+	//! Returns the report filename
+	const QString& filename() const { return m_filename; }
+
+	//! Starts recording a command
+	/** \param keyword command keyword
+		\param pointsIn number of points (clouds + mesh vertices) before the command
+	**/
+	void startCommand(const QString& keyword, qint64 pointsIn);
+
+	//! Stops recording the current command
+	/** \param success whether the command succeeded
+		\param pointsOut number of points (clouds + mesh vertices) after the command
+		\return a summary of the command (for the log)
+	**/
+	QString stopCommand(bool success, qint64 pointsOut);
+
+	//! Per-entity job record
+	struct EntityJob
+	{
+		EntityJob() : index(0), cpuTime_s(0), pointsIn(0), pointsOut(0), success(false) {}
+
+		//! Entity index
+		size_t index;
+		//! Entity name
+		QString entityName;
+		//! Start time
+		CCLib::Profiler::Clock::time_point start;
+		//! Stop time
+		CCLib::Profiler::Clock::time_point stop;
+		//! CPU time of the thread that ran the job (the nested parallel loops are not included)
+		double cpuTime_s;
+		//! Number of points before the job
+		qint64 pointsIn;
+		//! Number of points after the job
+		qint64 pointsOut;
+		//! Whether the job succeeded
+		bool success;
+	};
+
+	//! Reports a per-entity job
+	/** The threads are only counted per command: the jobs run concurrently and
+		their nested parallel loops can't be told apart.
+	**/
+	void addEntityJob(const EntityJob& job);
+
+	//inherited from CCLib::Profiler::Sink
+	virtual void addPhase(const char* name, CCLib::Profiler::Clock::time_point start, CCLib::Profiler::Clock::time_point stop) override;
+
+	//! Saves the report
+	bool save() const;
+
+protected:
+
+	//! Adds a 'complete' event (thread-safe)
+	void addEvent(const QString& name, const QString& category, CCLib::Profiler::Clock::time_point start, CCLib::Profiler::Clock::time_point stop, const QJsonObject& args);
+
+	//! Returns the timestamp (in microseconds) of a time point
+	qint64 toMicroseconds(CCLib::Profiler::Clock::time_point t) const;
+
+	//! Returns whether a (system) thread is a background thread
+	static bool IsBackgroundThread(qint64 threadID);
+
+	//! Report filename
+	QString m_filename;
+
+	//! Origin of the timestamps
+	CCLib::Profiler::Clock::time_point m_origin;
+
+	//! Recorded events
+	QJsonArray m_events;
+	//! Events mutex
+	mutable QMutex m_mutex;
+
+	//! Current command
+	struct Command
+	{
+		Command() : pointsIn(0) {}
+
+		QString keyword;
+		CCLib::Profiler::Clock::time_point start;
+		ResourcesUsage usage;
+		qint64 pointsIn;
+		//! CPU time of each thread at the beginning of the command
+		std::map<qint64, double> threadsCPUTime;
+		//! (System) IDs of the threads that reported events during the command
+		std::set<qint64> reportingThreads;
+	};
+
+	//! Current command
+	Command m_currentCommand;
+};
+
+#endif //CC_COMMAND_LINE_PROFILER_HEADER
@@ -0,0 +1,274 @@
+#ifndef COMMAND_LINE_RENDER_HEADER
+#define COMMAND_LINE_RENDER_HEADER
+
+#include "ccCommandLineInterface.h"
+
+//qCC_db
+#include <cc2DViewportObject.h>
+#include <ccSoftwareRenderer.h>
+
+//qCC_io
+#include <BinFilter.h>
+
+//qCC_gl
+#include <ccGLUtils.h>
+
+//Qt
+#include <QElapsedTimer>
+#include <QScopedPointer>
+
+static const char COMMAND_RENDER[]							= "RENDER";			//+ output image filename
+static const char COMMAND_RENDER_WIDTH[]					= "WIDTH";			//+ width (in pixels)
+static const char COMMAND_RENDER_HEIGHT[]					= "HEIGHT";			//+ height (in pixels)
+static const char COMMAND_RENDER_VIEW[]						= "VIEW";			//+ TOP/BOTTOM/FRONT/BACK/LEFT/RIGHT/ISO1/ISO2
+static const char COMMAND_RENDER_VIEWPORT[]					= "VIEWPORT";		//+ BIN file (first saved viewport)
+static const char COMMAND_RENDER_PERSPECTIVE[]				= "PERSPECTIVE";	//+ F.O.V. (in degrees)
+static const char COMMAND_RENDER_POINT_SIZE[]				= "POINT_SIZE";		//+ point size (in pixels)
+static const char COMMAND_RENDER_MAX_POINTS[]				= "MAX_POINTS";		//+ max number of rendered points
+static const char COMMAND_RENDER_NO_SHADING[]				= "NO_SHADING";
+
+//! Headless rendering: -RENDER {image file} [-WIDTH w] [-HEIGHT h] [-VIEW orientation] [-VIEWPORT {BIN file}] [-PERSPECTIVE fov] [-POINT_SIZE s] [-MAX_POINTS n] [-NO_SHADING]
+/** The loaded clouds and meshes are rendered on the CPU (see ccSoftwareRenderer), i.e. without any OpenGL context.
+	By default the whole scene is seen from the top. Otherwise the camera is either a predefined orientation
+	(fitted to the scene) or the first viewport saved in a BIN file.
+**/
+struct CommandRender : public ccCommandLineInterface::Command
+{
+	CommandRender() : ccCommandLineInterface::Command("Render", COMMAND_RENDER) {}
+
+	//helper
+	bool readOrientation(const QString& option, CC_VIEW_ORIENTATION& orientation)
+	{
+		QString upperOption = option.toUpper();
+		if (upperOption == "TOP")
+			orientation = CC_TOP_VIEW;
+		else if (upperOption == "BOTTOM")
+			orientation = CC_BOTTOM_VIEW;
+		else if (upperOption == "FRONT")
+			orientation = CC_FRONT_VIEW;
+		else if (upperOption == "BACK")
+			orientation = CC_BACK_VIEW;
+		else if (upperOption == "LEFT")
+			orientation = CC_LEFT_VIEW;
+		else if (upperOption == "RIGHT")
+			orientation = CC_RIGHT_VIEW;
+		else if (upperOption == "ISO1")
+			orientation = CC_ISO_VIEW_1;
+		else if (upperOption == "ISO2")
+			orientation = CC_ISO_VIEW_2;
+		else
+			return false;
+
+		return true;
+	}
+
+	//helper
+	bool readPositiveInteger(ccCommandLineInterface& cmd, const char* option, int& value)
+	{
+		if (cmd.arguments().empty())
+		{
+			return cmd.error(QString("Missing parameter: value after \"-%1\"").arg(option));
+		}
+
+		bool ok = false;
+		value = cmd.arguments().takeFirst().toInt(&ok);
+		if (!ok || value <= 0)
+		{
+			return cmd.error(QString("Invalid value after \"-%1\" (should be a strictly positive integer)").arg(option));
+		}
+
+		return true;
+	}
+
+	virtual bool process(ccCommandLineInterface& cmd) override
+	{
+		cmd.print("[RENDER]");
+		if (cmd.arguments().empty())
+		{
+			return cmd.error(QString("Missing parameter: image filename after \"-%1\"").arg(COMMAND_RENDER));
+		}
+
+		QString imageFilename = cmd.arguments().takeFirst();
+
+		ccSoftwareRenderer::Parameters params;
+		CC_VIEW_ORIENTATION orientation = CC_TOP_VIEW;
+		QString viewportFilename;
+		float fov_deg = 0;
+
+		//look for additional parameters
+		while (!cmd.arguments().empty())
+		{
+			QString argument = cmd.arguments().front();
+			if (ccCommandLineInterface::IsCommand(argument, COMMAND_RENDER_WIDTH))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+				if (!readPositiveInteger(cmd, COMMAND_RENDER_WIDTH, params.width))
+				{
+					return false;
+				}
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RENDER_HEIGHT))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+				if (!readPositiveInteger(cmd, COMMAND_RENDER_HEIGHT, params.height))
+				{
+					return false;
+				}
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RENDER_VIEW))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+				if (cmd.arguments().empty())
+				{
+					return cmd.error(QString("Missing parameter: orientation after \"-%1\"").arg(COMMAND_RENDER_VIEW));
+				}
+
+				QString option = cmd.arguments().takeFirst();
+				if (!readOrientation(option, orientation))
+				{
+					return cmd.error(QString("Invalid orientation: %1 (should be TOP, BOTTOM, FRONT, BACK, LEFT, RIGHT, ISO1 or ISO2)").arg(option));
+				}
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RENDER_VIEWPORT))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+				if (cmd.arguments().empty())
+				{
+					return cmd.error(QString("Missing parameter: BIN filename after \"-%1\"").arg(COMMAND_RENDER_VIEWPORT));
+				}
+				viewportFilename = cmd.arguments().takeFirst();
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RENDER_PERSPECTIVE))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+				if (cmd.arguments().empty())
+				{
+					return cmd.error(QString("Missing parameter: F.O.V. after \"-%1\"").arg(COMMAND_RENDER_PERSPECTIVE));
+				}
+
+				bool ok = false;
+				fov_deg = cmd.arguments().takeFirst().toFloat(&ok);
+				if (!ok || fov_deg <= 0 || fov_deg >= 180.0f)
+				{
+					return cmd.error("Invalid F.O.V. (should be between 0 and 180 degrees)");
+				}
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RENDER_POINT_SIZE))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+				if (cmd.arguments().empty())
+				{
+					return cmd.error(QString("Missing parameter: point size after \"-%1\"").arg(COMMAND_RENDER_POINT_SIZE));
+				}
+
+				bool ok = false;
+				params.pointSize = cmd.arguments().takeFirst().toFloat(&ok);
+				if (!ok || params.pointSize <= 0)
+				{
+					return cmd.error("Invalid point size (should be strictly positive)");
+				}
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RENDER_MAX_POINTS))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+				int maxPointCount = 0;
+				if (!readPositiveInteger(cmd, COMMAND_RENDER_MAX_POINTS, maxPointCount))
+				{
+					return false;
+				}
+				params.maxPointCount = static_cast<unsigned>(maxPointCount);
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RENDER_NO_SHADING))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+				params.shading = false;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		ccHObject::Container entities;
+		for (const CLCloudDesc& desc : cmd.clouds())
+		{
+			entities.push_back(desc.pc);
+		}
+		for (const CLMeshDesc& desc : cmd.meshes())
+		{
+			entities.push_back(desc.mesh);
+		}
+		if (entities.empty())
+		{
+			return cmd.error(QString("No entity loaded (clouds or meshes must be loaded before \"-%1\")").arg(COMMAND_RENDER));
+		}
+
+		ccViewportParameters viewport;
+		if (!viewportFilename.isEmpty())
+		{
+			FileIOFilter::LoadParameters loadParameters;
+			loadParameters.alwaysDisplayLoadDialog = false;
+			loadParameters.shiftHandlingMode = ccGlobalShiftManager::NO_DIALOG;
+			CC_FILE_ERROR result = CC_FERR_NO_ERROR;
+			QScopedPointer<ccHObject> viewportDB(FileIOFilter::LoadFromFile(viewportFilename, loadParameters, result, BinFilter::GetFileFilter()));
+			if (!viewportDB)
+			{
+				return cmd.error(QString("Failed to load the viewport file '%1'").arg(viewportFilename));
+			}
+
+			ccHObject::Container viewports;
+			if (viewportDB->filterChildren(viewports, true, CC_TYPES::VIEWPORT_2D_OBJECT, true) == 0)
+			{
+				return cmd.error(QString("File '%1' contains no viewport").arg(viewportFilename));
+			}
+			viewport = static_cast<cc2DViewportObject*>(viewports.front())->getParameters();
+			cmd.print(QString("Viewport: %1").arg(viewports.front()->getName()));
+		}
+		else
+		{
+			viewport.viewMat = ccGLUtils::GenerateViewMat(orientation);
+			viewport.objectCenteredView = true;
+			if (fov_deg > 0)
+			{
+				viewport.perspectiveView = true;
+				viewport.fov = fov_deg;
+			}
+
+			ccHObject::Container displayedEntities;
+			ccSoftwareRenderer::CollectDisplayedEntities(entities, displayedEntities);
+			if (!ccSoftwareRenderer::FitViewport(viewport, ccSoftwareRenderer::ComputeSceneBox(displayedEntities), params.width, params.height))
+			{
+				return cmd.error("Invalid scene bounding-box");
+			}
+		}
+
+		QElapsedTimer timer;
+		timer.start();
+
+		ccSoftwareRenderer renderer;
+		QImage image;
+		if (!renderer.render(entities, viewport, params, image))
+		{
+			return cmd.error("Rendering failed (not enough memory?)");
+		}
+		cmd.print(QString("Image rendered (%1 x %2) in %3 ms").arg(params.width).arg(params.height).arg(timer.elapsed()));
+
+		if (!image.save(imageFilename))
+		{
+			return cmd.error(QString("Failed to save the image '%1'").arg(imageFilename));
+		}
+		cmd.print(QString("Image saved: %1").arg(imageFilename));
+
+		return true;
+	}
+};
+
+#endif //COMMAND_LINE_RENDER_HEADER
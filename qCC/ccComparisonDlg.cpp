@@ -760,6 +760,7 @@ bool ccComparisonDlg::computeDistances()
 			{
 				size_t validDB = 0;
 				//we also make sure that the sensors have valid depth buffer!
+				std::vector<ccGBLSensor*> sensorsWithoutDB;
 				for (unsigned i = 0; i < pc->getChildrenNumber(); ++i)
 				{
 					ccHObject* child = pc->getChild(i);
@@ -768,15 +769,26 @@ bool ccComparisonDlg::computeDistances()
 						ccGBLSensor* sensor = static_cast<ccGBLSensor*>(child);
 						if (sensor->getDepthBuffer().zBuff.empty())
 						{
-							int errorCode;
-							if (!sensor->computeDepthBuffer(pc, errorCode))
-							{
-								ccLog::Warning(QString("[ComputeDistances] ") + ccGBLSensor::GetErrorString(errorCode));
-							}
-							else
-							{
-								++validDB;
-							}
+							sensorsWithoutDB.push_back(sensor);
+						}
+						else
+						{
+							++validDB;
+						}
+					}
+				}
+
+				if (!sensorsWithoutDB.empty())
+				{
+					//the missing depth buffers are computed concurrently
+					ccProgressDialog pDlg(true, this);
+					std::vector<int> errorCodes;
+					ccGBLSensor::ComputeDepthBuffers(sensorsWithoutDB, pc, errorCodes, &pDlg);
+					for (size_t i = 0; i < errorCodes.size(); ++i)
+					{
+						if (errorCodes[i] != 0)
+						{
+							ccLog::Warning(QString("[ComputeDistances] ") + ccGBLSensor::GetErrorString(errorCodes[i]));
 						}
 						else
 						{
@@ -471,11 +471,13 @@ namespace ccEntityAction
 		static ccPointCloudInterpolator::Parameters::Method s_interpMethod = ccPointCloudInterpolator::Parameters::RADIUS;
 		static ccPointCloudInterpolator::Parameters::Algo s_interpAlgo = ccPointCloudInterpolator::Parameters::NORMAL_DIST;
 		static int s_interpKNN = 6;
+		static double s_interpPower = 2.0;
 
 		ccInterpolationDlg iDlg(app->getMainWindow());
 		iDlg.setInterpolationMethod(s_interpMethod);
 		iDlg.setInterpolationAlgorithm(s_interpAlgo);
 		iDlg.knnSpinBox->setValue(s_interpKNN);
+		iDlg.powerDoubleSpinBox->setValue(s_interpPower);
 		iDlg.radiusDoubleSpinBox->setValue(dest->getOwnBB().getDiagNormd() / 100);
 
 		if (!iDlg.exec())
@@ -491,6 +493,7 @@ namespace ccEntityAction
 		params.knn = s_interpKNN = iDlg.knnSpinBox->value();
 		params.radius = iDlg.radiusDoubleSpinBox->value();
 		params.sigma = iDlg.kernelDoubleSpinBox->value();
+		params.power = s_interpPower = iDlg.powerDoubleSpinBox->value();
 
 		ccProgressDialog pDlg(true, app->getMainWindow());
 		unsigned sfCountBefore = dest->getNumberOfScalarFields();
@@ -606,6 +606,58 @@ void ccGraphicalSegmentationTool::segmentOut()
 	segment(false);
 }
 
+//! Projects the points in the screen coordinate system (centered on the screen center)
+class CameraProjector : public CCLib::ManualSegmentationTools::Projector
+{
+public:
+	explicit CameraProjector(const ccGLCameraParameters& camera)
+		: m_camera(camera)
+		, m_halfW(camera.viewport[2] / 2.0)
+		, m_halfH(camera.viewport[3] / 2.0)
+	{}
+
+	CCVector2 project(const CCVector3& P3D) const override
+	{
+		CCVector3d Q2D(0, 0, 0);
+		m_camera.project(P3D, Q2D);
+		return CCVector2(	static_cast<PointCoordinateType>(Q2D.x - m_halfW),
+							static_cast<PointCoordinateType>(Q2D.y - m_halfH) );
+	}
+
+	bool isBoxProjectable(const CCVector3& bbMin, const CCVector3& bbMax) const override
+	{
+		if (!m_camera.perspective)
+		{
+			return true;
+		}
+
+		//all the box corners must lie in front of the camera (w > 0)
+		const double* mv = m_camera.modelViewMat.data();
+		const double* proj = m_camera.projectionMat.data();
+		for (unsigned char j = 0; j < 8; ++j)
+		{
+			CCVector3d P(	j & 1 ? bbMax.x : bbMin.x,
+							j & 2 ? bbMax.y : bbMin.y,
+							j & 4 ? bbMax.z : bbMin.z);
+			double x = mv[0] * P.x + mv[4] * P.y + mv[ 8] * P.z + mv[12];
+			double y = mv[1] * P.x + mv[5] * P.y + mv[ 9] * P.z + mv[13];
+			double z = mv[2] * P.x + mv[6] * P.y + mv[10] * P.z + mv[14];
+			double w = mv[3] * P.x + mv[7] * P.y + mv[11] * P.z + mv[15];
+			if (proj[3] * x + proj[7] * y + proj[11] * z + proj[15] * w <= 0)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+protected:
+	const ccGLCameraParameters& m_camera;
+	double m_halfW;
+	double m_halfH;
+};
+
 void ccGraphicalSegmentationTool::segment(bool keepPointsInside)
 {
 	if (!m_associatedWin)
@@ -626,8 +678,15 @@ void ccGraphicalSegmentationTool::segment(bool keepPointsInside)
 	//viewing parameters
 	ccGLCameraParameters camera;
 	m_associatedWin->getGLCameraParameters(camera);
-	const double half_w = camera.viewport[2] / 2.0;
-	const double half_h = camera.viewport[3] / 2.0;
+	CameraProjector projector(camera);
+
+	//the polygon edges are sorted by bands (faster point-in-polygon tests)
+	CCLib::ManualSegmentationTools::PolygonIndex polygon;
+	if (!polygon.init(m_segmentationPoly))
+	{
+		ccLog::Error("Not enough memory!");
+		return;
+	}
 
 	//for each selected entity
 	for (QSet<ccHObject*>::const_iterator p = m_toSegment.constBegin(); p != m_toSegment.constEnd(); ++p)
@@ -638,29 +697,9 @@ void ccGraphicalSegmentationTool::segment(bool keepPointsInside)
 		ccGenericPointCloud::VisibilityTableType& visibilityArray = cloud->getTheVisibilityArray();
 		assert(!visibilityArray.empty());
 
-		unsigned cloudSize = cloud->size();
-
-		//we project each point and we check if it falls inside the segmentation polyline
-#if defined(_OPENMP)
-#pragma omp parallel for
-#endif
-		for (int i = 0; i < static_cast<int>(cloudSize); ++i)
-		{
-			if (visibilityArray[i] == POINT_VISIBLE)
-			{
-				const CCVector3* P3D = cloud->getPoint(i);
-
-				CCVector3d Q2D;
-				camera.project(*P3D, Q2D);
-
-				CCVector2 P2D(	static_cast<PointCoordinateType>(Q2D.x-half_w),
-								static_cast<PointCoordinateType>(Q2D.y-half_h) );
-				
-				bool pointInside = CCLib::ManualSegmentationTools::isPointInsidePoly(P2D, m_segmentationPoly);
-
-				visibilityArray[i] = (keepPointsInside != pointInside ? POINT_HIDDEN : POINT_VISIBLE);
-			}
-		}
+		//we project each point (or each octree cell if the octree is available) and we check if it falls inside the segmentation polyline
+		ccOctree::Shared octree = cloud->getOctree();
+		CCLib::ManualSegmentationTools::segment(cloud, polygon, projector, keepPointsInside, visibilityArray, octree.data());
 	}
 
 	m_somethingHasChanged = true;
@@ -26,6 +26,9 @@
 #include <ccColorScalesManager.h>
 #include <ccFileUtils.h>
 
+//CCLib
+#include <ScalarFieldStatistics.h>
+
 //qCC_io
 #include <ImageFileFilter.h>
 
@@ -255,18 +258,16 @@ bool ccHistogramWindow::computeBinArrayFromSF(size_t binCount)
 	double range = m_maxVal - m_minVal;
 	if (range > 0.0)
 	{
-		unsigned count = m_associatedSF->currentSize();
-		double step = range / static_cast<double>(binCount);
-		for (unsigned i = 0; i < count; ++i)
+		//we ignore values outside of [m_minVal,m_maxVal] (works fro NaN values as well)
+		if (!CCLib::ScalarFieldStatistics::ComputeHistogram(	m_associatedSF->data(),
+																m_associatedSF->size(),
+																static_cast<ScalarType>(m_minVal),
+																static_cast<ScalarType>(m_maxVal),
+																m_histoValues))
 		{
-			double val = static_cast<double>(m_associatedSF->getValue(i));
-
-			//we ignore values outside of [m_minVal,m_maxVal] (works fro NaN values as well)
-			if (/*ccScalarField::ValidValue(val) &&*/val >= m_minVal && val <= m_maxVal)
-			{
-				size_t bin = static_cast<size_t>(floor((val - m_minVal) / step));
-				++m_histoValues[std::min(bin, binCount - 1)];
-			}
+			ccLog::Warning("[ccHistogramWindow::computeBinArrayFromSF] Not enough memory!");
+			m_histoValues.clear();
+			return false;
 		}
 	}
 	else
@@ -68,6 +68,8 @@ ccPointCloudInterpolator::Parameters::Algo ccInterpolationDlg::getInterpolationA
 		return ccPointCloudInterpolator::Parameters::MEDIAN;
 	else if (normalDistribRadioButton->isChecked())
 		return ccPointCloudInterpolator::Parameters::NORMAL_DIST;
+	else if (idwRadioButton->isChecked())
+		return ccPointCloudInterpolator::Parameters::INVERSE_DISTANCE;
 
 	assert(false);
 	return ccPointCloudInterpolator::Parameters::AVERAGE;
@@ -86,6 +88,9 @@ void ccInterpolationDlg::setInterpolationAlgorithm(ccPointCloudInterpolator::Par
 	case ccPointCloudInterpolator::Parameters::NORMAL_DIST:
 		normalDistribRadioButton->setChecked(true);
 		break;
+	case ccPointCloudInterpolator::Parameters::INVERSE_DISTANCE:
+		idwRadioButton->setChecked(true);
+		break;
 	default:
 		assert(false);
 	}
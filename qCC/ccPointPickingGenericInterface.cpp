@@ -26,8 +26,10 @@
 #include <ccPickingHub.h>
 
 //qCC_db
+#include <ccHObjectCaster.h>
 #include <ccLog.h>
 #include <ccPointCloud.h>
+#include <ccSubCloud.h>
 
 ccPointPickingGenericInterface::ccPointPickingGenericInterface(ccPickingHub* pickingHub, QWidget* parent/*=0*/)
 	: ccOverlayDialog(parent)
@@ -113,14 +115,25 @@ void ccPointPickingGenericInterface::onItemPicked(const PickedItem& pi)
 
 	if (pi.entity->isKindOf(CC_TYPES::POINT_CLOUD))
 	{
-		ccPointCloud* cloud = static_cast<ccPointCloud*>(pi.entity);
+		ccPointCloud* cloud = ccHObjectCaster::ToPointCloud(pi.entity);
+		unsigned pointIndex = pi.itemIndex;
+		if (!cloud)
+		{
+			//sub-clouds only reference the points of their associated cloud
+			ccSubCloud* subCloud = ccHObjectCaster::ToSubCloud(pi.entity);
+			if (subCloud && subCloud->getAssociatedCloud())
+			{
+				cloud = subCloud->getAssociatedCloud();
+				pointIndex = subCloud->getPointGlobalIndex(pi.itemIndex);
+			}
+		}
 		if (!cloud)
 		{
 			assert(false);
 			ccLog::Warning("[Item picking] Picked point is not in pickable entities DB?!");
 			return;
 		}
-		processPickedPoint(cloud, pi.itemIndex, pi.clickPoint.x(), pi.clickPoint.y());
+		processPickedPoint(cloud, pointIndex, pi.clickPoint.x(), pi.clickPoint.y());
 	}
 	else if (pi.entity->isKindOf(CC_TYPES::MESH))
 	{
@@ -17,6 +17,9 @@
 
 #include "ccScalarFieldArithmeticsDlg.h"
 
+//local
+#include "ccScalarFieldExpression.h"
+
 //Qt
 #include <QPushButton>
 #include <QMessageBox>
@@ -41,6 +44,8 @@ static const char s_opNames[s_opCount][12] = {"add", "sub", "mult", "div", "sqrt
 static int s_previouslySelectedOperationIndex = 1;
 static bool s_applyInPlace = false;
 static double s_previousConstValue = 1.0;
+static bool s_useExpression = false;
+static QString s_previousExpression;
 
 ccScalarFieldArithmeticsDlg::ccScalarFieldArithmeticsDlg(	ccPointCloud* cloud,
 															QWidget* parent/*=0*/)
@@ -77,10 +82,13 @@ ccScalarFieldArithmeticsDlg::ccScalarFieldArithmeticsDlg(	ccPointCloud* cloud,
 	//connect signals/slots
 	connect(operationComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(onOperationIndexChanged(int)));
 	connect(sf2ComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(onSF2IndexChanged(int)));
+	connect(expressionCheckBox, SIGNAL(toggled(bool)), this, SLOT(onExpressionToggled(bool)));
 	
 	operationComboBox->setCurrentIndex(s_previouslySelectedOperationIndex);
 	constantDoubleSpinBox->setValue(s_previousConstValue);
 	updateSF1CheckBox->setChecked(s_applyInPlace);
+	expressionLineEdit->setText(s_previousExpression);
+	expressionCheckBox->setChecked(s_useExpression);
 }
 
 void ccScalarFieldArithmeticsDlg::onOperationIndexChanged(int index)
@@ -94,6 +102,22 @@ void ccScalarFieldArithmeticsDlg::onSF2IndexChanged(int index)
 	constantDoubleSpinBox->setEnabled(sf2ComboBox->currentIndex()+1 == sf2ComboBox->count());
 }
 
+void ccScalarFieldArithmeticsDlg::onExpressionToggled(bool state)
+{
+	expressionLineEdit->setEnabled(state);
+	operationComboBox->setEnabled(!state);
+	if (state)
+	{
+		sf2ComboBox->setEnabled(false);
+		constantDoubleSpinBox->setEnabled(false);
+	}
+	else
+	{
+		onOperationIndexChanged(operationComboBox->currentIndex());
+		onSF2IndexChanged(sf2ComboBox->currentIndex());
+	}
+}
+
 int ccScalarFieldArithmeticsDlg::getSF1Index()
 {
 	return sf1ComboBox->currentIndex();
@@ -173,6 +197,13 @@ bool ccScalarFieldArithmeticsDlg::apply(ccPointCloud* cloud)
 	s_previouslySelectedOperationIndex = operationComboBox->currentIndex();
 	s_previousConstValue = constantDoubleSpinBox->value();
 	s_applyInPlace = updateSF1CheckBox->isChecked();
+	s_useExpression = expressionCheckBox->isChecked();
+	s_previousExpression = expressionLineEdit->text();
+
+	if (s_useExpression)
+	{
+		return applyExpression(cloud, s_previousExpression, sf1Idx, s_applyInPlace);
+	}
 
 	SF2 sf2Desc;
 	sf2Desc.isConstantValue = constantDoubleSpinBox->isEnabled();
@@ -182,6 +213,56 @@ bool ccScalarFieldArithmeticsDlg::apply(ccPointCloud* cloud)
 	return Apply(cloud, op, sf1Idx, s_applyInPlace, &sf2Desc, this);
 }
 
+bool ccScalarFieldArithmeticsDlg::applyExpression(ccPointCloud* cloud, QString expression, int sf1Idx, bool inplace)
+{
+	assert(cloud);
+
+	expression = expression.trimmed();
+	if (expression.isEmpty())
+	{
+		ccLog::Error("Empty formula");
+		return false;
+	}
+
+	//output SF
+	QString sfName;
+	if (inplace)
+	{
+		CCLib::ScalarField* sf1 = cloud->getScalarField(sf1Idx);
+		if (!sf1)
+		{
+			ccLog::Warning("[ccScalarFieldArithmeticsDlg::apply] Invalid SF1 index!");
+			assert(false);
+			return false;
+		}
+		sfName = sf1->getName();
+	}
+	else
+	{
+		//if the formula is too long, we use a generic name instead
+		sfName = (expression.length() > 24 ? QString("Formula") : expression);
+
+		if (cloud->getScalarFieldIndexByName(qPrintable(sfName)) >= 0
+			&& QMessageBox::warning(this,
+									"Same scalar field name",
+									"Resulting scalar field already exists! Overwrite it?",
+									QMessageBox::Ok | QMessageBox::Cancel,
+									QMessageBox::Ok) != QMessageBox::Ok)
+		{
+			return false;
+		}
+	}
+
+	QString errorMessage;
+	if (ccScalarFieldExpression::Apply(cloud, expression, sfName, errorMessage) < 0)
+	{
+		ccLog::Error(QString("Failed to apply the formula: %1").arg(errorMessage));
+		return false;
+	}
+
+	return true;
+}
+
 bool ccScalarFieldArithmeticsDlg::Apply(ccPointCloud* cloud,
 										Operation op,
 										int sf1Idx,
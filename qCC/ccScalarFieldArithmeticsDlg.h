@@ -107,6 +107,9 @@ protected slots:
 	//! Called when the SF2 combo-box is modified
 	void onSF2IndexChanged(int index);
 
+	//! Called when the 'formula' checkbox is toggled
+	void onExpressionToggled(bool state);
+
 protected:
 	
 	//! Returns first selected SF index
@@ -117,6 +120,9 @@ protected:
 	//! Returns selected operation name
 	QString getOperationName(QString sf1, QString sf2 = QString()) const;
 
+	//! Applies a formula (see ccScalarFieldExpression) on a given cloud
+	bool applyExpression(ccPointCloud* cloud, QString expression, int sf1Idx, bool inplace);
+
 };
 
 #endif //CC_SF_ARITMETHIC_DLG_HEADER
@@ -0,0 +1,825 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include "ccScalarFieldExpression.h"
+
+//CCLib
+#include <CCConst.h>
+
+//qCC_db
+#include <ccPointCloud.h>
+#include <ccScalarField.h>
+
+//system
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#ifdef USE_TBB
+#include <tbb/parallel_for.h>
+#endif
+
+//! Number of points processed by each task
+static const unsigned s_chunkSize = 65536;
+//! Number of values processed by each instruction (block)
+static const unsigned s_blockSize = 256;
+
+static const double s_nan = std::numeric_limits<double>::quiet_NaN();
+
+//Scalar operations (same conventions as ccScalarFieldArithmeticsDlg::Apply)
+static inline double OpSqrt(double a) { return a >= 0 ? std::sqrt(a) : s_nan; }
+static inline double OpLog(double a) { return a >= 0 ? std::log(a) : s_nan; }
+static inline double OpLog10(double a) { return a >= 0 ? std::log10(a) : s_nan; }
+static inline double OpAcos(double a) { return a >= -1.0 && a <= 1.0 ? std::acos(a) : s_nan; }
+static inline double OpAsin(double a) { return a >= -1.0 && a <= 1.0 ? std::asin(a) : s_nan; }
+static inline double OpInverse(double a) { return std::abs(a) < ZERO_TOLERANCE ? s_nan : 1.0 / a; }
+static inline double OpDiv(double a, double b) { return std::abs(b) < ZERO_TOLERANCE ? s_nan : a / b; }
+static inline double OpMin(double a, double b) { return (a != a || b != b) ? s_nan : std::min(a, b); }
+static inline double OpMax(double a, double b) { return (a != a || b != b) ? s_nan : std::max(a, b); }
+
+static double ApplyUnary(ccScalarFieldExpression::OpCode op, double a)
+{
+	switch (op)
+	{
+	case ccScalarFieldExpression::NEG:
+		return -a;
+	case ccScalarFieldExpression::SQRT:
+		return OpSqrt(a);
+	case ccScalarFieldExpression::EXP:
+		return std::exp(a);
+	case ccScalarFieldExpression::LOG:
+		return OpLog(a);
+	case ccScalarFieldExpression::LOG10:
+		return OpLog10(a);
+	case ccScalarFieldExpression::COS:
+		return std::cos(a);
+	case ccScalarFieldExpression::SIN:
+		return std::sin(a);
+	case ccScalarFieldExpression::TAN:
+		return std::tan(a);
+	case ccScalarFieldExpression::ACOS:
+		return OpAcos(a);
+	case ccScalarFieldExpression::ASIN:
+		return OpAsin(a);
+	case ccScalarFieldExpression::ATAN:
+		return std::atan(a);
+	case ccScalarFieldExpression::INT:
+		return std::trunc(a);
+	case ccScalarFieldExpression::ABS:
+		return std::abs(a);
+	case ccScalarFieldExpression::INVERSE:
+		return OpInverse(a);
+	default:
+		assert(false);
+		break;
+	}
+	return s_nan;
+}
+
+static double ApplyBinary(ccScalarFieldExpression::OpCode op, double a, double b)
+{
+	switch (op)
+	{
+	case ccScalarFieldExpression::ADD:
+		return a + b;
+	case ccScalarFieldExpression::SUB:
+		return a - b;
+	case ccScalarFieldExpression::MUL:
+		return a * b;
+	case ccScalarFieldExpression::DIV:
+		return OpDiv(a, b);
+	case ccScalarFieldExpression::POW:
+		return std::pow(a, b);
+	case ccScalarFieldExpression::MIN:
+		return OpMin(a, b);
+	case ccScalarFieldExpression::MAX:
+		return OpMax(a, b);
+	case ccScalarFieldExpression::ATAN2:
+		return std::atan2(a, b);
+	default:
+		assert(false);
+		break;
+	}
+	return s_nan;
+}
+
+//! Applies a unary function on a block of values
+template <class Func> static inline void UnaryBlock(double* dst, const double* a, unsigned count, Func func)
+{
+	for (unsigned k = 0; k < count; ++k)
+	{
+		dst[k] = func(a[k]);
+	}
+}
+
+//! Applies a binary function on two blocks of values
+template <class Func> static inline void BinaryBlock(double* dst, const double* a, const double* b, unsigned count, Func func)
+{
+	for (unsigned k = 0; k < count; ++k)
+	{
+		dst[k] = func(a[k], b[k]);
+	}
+}
+
+//! Function descriptor
+struct FunctionDesc
+{
+	const char* name;
+	ccScalarFieldExpression::OpCode op;
+	int argCount;
+};
+
+static const FunctionDesc s_functions[] = {	{ "sqrt",		ccScalarFieldExpression::SQRT,		1 },
+											{ "exp",		ccScalarFieldExpression::EXP,		1 },
+											{ "log",		ccScalarFieldExpression::LOG,		1 },
+											{ "log10",		ccScalarFieldExpression::LOG10,		1 },
+											{ "cos",		ccScalarFieldExpression::COS,		1 },
+											{ "sin",		ccScalarFieldExpression::SIN,		1 },
+											{ "tan",		ccScalarFieldExpression::TAN,		1 },
+											{ "acos",		ccScalarFieldExpression::ACOS,		1 },
+											{ "asin",		ccScalarFieldExpression::ASIN,		1 },
+											{ "atan",		ccScalarFieldExpression::ATAN,		1 },
+											{ "int",		ccScalarFieldExpression::INT,		1 },
+											{ "abs",		ccScalarFieldExpression::ABS,		1 },
+											{ "inverse",	ccScalarFieldExpression::INVERSE,	1 },
+											{ "min",		ccScalarFieldExpression::MIN,		2 },
+											{ "max",		ccScalarFieldExpression::MAX,		2 },
+											{ "pow",		ccScalarFieldExpression::POW,		2 },
+											{ "atan2",		ccScalarFieldExpression::ATAN2,		2 } };
+
+//! Recursive descent parser
+struct ccScalarFieldExpression::Parser
+{
+	Parser(const QString& text, const ccPointCloud* cloud, std::vector<Node>& nodes)
+		: needColors(false)
+		, needNormals(false)
+		, m_text(text)
+		, m_pos(0)
+		, m_cloud(cloud)
+		, m_nodes(nodes)
+	{}
+
+	//! Parses the whole expression
+	/** \return the root node index (or -1 if an error occurred)
+	**/
+	int parse()
+	{
+		int root = parseExpression();
+		if (root >= 0)
+		{
+			skipSpaces();
+			if (m_pos < m_text.length())
+			{
+				return fail(QString("Unexpected character '%1'").arg(m_text[m_pos]));
+			}
+		}
+		return root;
+	}
+
+	//! Error message
+	QString error;
+	//! Whether the expression uses the colors
+	bool needColors;
+	//! Whether the expression uses the normals
+	bool needNormals;
+
+protected:
+
+	int fail(const QString& message)
+	{
+		if (error.isEmpty())
+		{
+			error = QString("%1 (position %2)").arg(message).arg(m_pos + 1);
+		}
+		return -1;
+	}
+
+	void skipSpaces()
+	{
+		while (m_pos < m_text.length() && m_text[m_pos].isSpace())
+			++m_pos;
+	}
+
+	bool accept(QChar c)
+	{
+		skipSpaces();
+		if (m_pos < m_text.length() && m_text[m_pos] == c)
+		{
+			++m_pos;
+			return true;
+		}
+		return false;
+	}
+
+	int addNode(const Node& node)
+	{
+		m_nodes.push_back(node);
+		return static_cast<int>(m_nodes.size()) - 1;
+	}
+
+	//! Adds a unary operation node (constants are folded)
+	int addUnary(OpCode op, int arg)
+	{
+		if (m_nodes[arg].op == LOAD_CONST)
+		{
+			m_nodes[arg].value = ApplyUnary(op, m_nodes[arg].value);
+			return arg;
+		}
+		Node node(op);
+		node.left = arg;
+		return addNode(node);
+	}
+
+	//! Adds a binary operation node (constants are folded)
+	int addBinary(OpCode op, int left, int right)
+	{
+		if (m_nodes[left].op == LOAD_CONST && m_nodes[right].op == LOAD_CONST)
+		{
+			m_nodes[left].value = ApplyBinary(op, m_nodes[left].value, m_nodes[right].value);
+			return left;
+		}
+		Node node(op);
+		node.left = left;
+		node.right = right;
+		return addNode(node);
+	}
+
+	//expression := term (('+'|'-') term)*
+	int parseExpression()
+	{
+		int left = parseTerm();
+		while (left >= 0)
+		{
+			OpCode op;
+			if (accept('+'))
+				op = ADD;
+			else if (accept('-'))
+				op = SUB;
+			else
+				break;
+
+			int right = parseTerm();
+			if (right < 0)
+				return -1;
+			left = addBinary(op, left, right);
+		}
+		return left;
+	}
+
+	//term := unary (('*'|'/') unary)*
+	int parseTerm()
+	{
+		int left = parseUnary();
+		while (left >= 0)
+		{
+			OpCode op;
+			if (accept('*'))
+				op = MUL;
+			else if (accept('/'))
+				op = DIV;
+			else
+				break;
+
+			int right = parseUnary();
+			if (right < 0)
+				return -1;
+			left = addBinary(op, left, right);
+		}
+		return left;
+	}
+
+	//unary := ('-'|'+') unary | power
+	int parseUnary()
+	{
+		if (accept('-'))
+		{
+			int arg = parseUnary();
+			return arg < 0 ? -1 : addUnary(NEG, arg);
+		}
+		if (accept('+'))
+		{
+			return parseUnary();
+		}
+		return parsePower();
+	}
+
+	//power := primary ('^' unary)?
+	int parsePower()
+	{
+		int base = parsePrimary();
+		if (base >= 0 && accept('^'))
+		{
+			int exponent = parseUnary();
+			if (exponent < 0)
+				return -1;
+			return addBinary(POW, base, exponent);
+		}
+		return base;
+	}
+
+	//primary := number | '(' expression ')' | '[' SF name ']' | function '(' arguments ')' | variable
+	int parsePrimary()
+	{
+		skipSpaces();
+		if (m_pos >= m_text.length())
+		{
+			return fail("Unexpected end of expression");
+		}
+
+		QChar c = m_text[m_pos];
+
+		//number
+		if (c.isDigit() || c == '.')
+		{
+			int start = m_pos;
+			while (m_pos < m_text.length() && (m_text[m_pos].isDigit() || m_text[m_pos] == '.'))
+				++m_pos;
+			//exponent
+			if (m_pos < m_text.length() && (m_text[m_pos] == 'e' || m_text[m_pos] == 'E'))
+			{
+				int expPos = m_pos + 1;
+				if (expPos < m_text.length() && (m_text[expPos] == '+' || m_text[expPos] == '-'))
+					++expPos;
+				if (expPos < m_text.length() && m_text[expPos].isDigit())
+				{
+					m_pos = expPos;
+					while (m_pos < m_text.length() && m_text[m_pos].isDigit())
+						++m_pos;
+				}
+			}
+			bool ok = false;
+			double value = m_text.mid(start, m_pos - start).toDouble(&ok);
+			if (!ok)
+			{
+				m_pos = start;
+				return fail("Invalid number");
+			}
+			return addNode(Node(LOAD_CONST, value));
+		}
+
+		//sub-expression
+		if (accept('('))
+		{
+			int node = parseExpression();
+			if (node >= 0 && !accept(')'))
+				return fail("Missing closing parenthesis");
+			return node;
+		}
+
+		//scalar field name
+		if (accept('['))
+		{
+			int end = m_text.indexOf(']', m_pos);
+			if (end < 0)
+				return fail("Missing closing bracket");
+			QString sfName = m_text.mid(m_pos, end - m_pos).trimmed();
+			int sfIndex = m_cloud->getScalarFieldIndexByName(qPrintable(sfName));
+			if (sfIndex < 0)
+				return fail(QString("Unknown scalar field '%1'").arg(sfName));
+			m_pos = end + 1;
+			Node node(LOAD_SF);
+			node.sfIndex = sfIndex;
+			return addNode(node);
+		}
+
+		//identifier
+		if (c.isLetter() || c == '_')
+		{
+			int start = m_pos;
+			while (m_pos < m_text.length() && (m_text[m_pos].isLetterOrNumber() || m_text[m_pos] == '_'))
+				++m_pos;
+			QString name = m_text.mid(start, m_pos - start);
+
+			//function
+			if (accept('('))
+			{
+				for (const FunctionDesc& f : s_functions)
+				{
+					if (name.compare(f.name, Qt::CaseInsensitive) != 0)
+						continue;
+
+					int args[2] = { -1, -1 };
+					for (int i = 0; i < f.argCount; ++i)
+					{
+						if (i != 0 && !accept(','))
+							return fail(QString("Function '%1' expects %2 arguments").arg(name).arg(f.argCount));
+						args[i] = parseExpression();
+						if (args[i] < 0)
+							return -1;
+					}
+					if (!accept(')'))
+						return fail(QString("Missing closing parenthesis after the argument(s) of '%1'").arg(name));
+
+					return f.argCount == 1 ? addUnary(f.op, args[0]) : addBinary(f.op, args[0], args[1]);
+				}
+				m_pos = start;
+				return fail(QString("Unknown function '%1'").arg(name));
+			}
+
+			return parseVariable(name, start);
+		}
+
+		return fail(QString("Unexpected character '%1'").arg(c));
+	}
+
+	//! Resolves a variable (coordinates, normals, colors, constants or scalar fields)
+	int parseVariable(const QString& name, int start)
+	{
+		static const struct { const char* name; OpCode op; } s_variables[] = {	{ "x", LOAD_X }, { "y", LOAD_Y }, { "z", LOAD_Z },
+																				{ "nx", LOAD_NX }, { "ny", LOAD_NY }, { "nz", LOAD_NZ },
+																				{ "r", LOAD_R }, { "g", LOAD_G }, { "b", LOAD_B } };
+		for (const auto& v : s_variables)
+		{
+			if (name.compare(v.name, Qt::CaseInsensitive) == 0)
+			{
+				if (v.op >= LOAD_NX && v.op <= LOAD_NZ)
+				{
+					if (!m_cloud->hasNormals())
+					{
+						m_pos = start;
+						return fail("The cloud has no normals");
+					}
+					needNormals = true;
+				}
+				else if (v.op >= LOAD_R && v.op <= LOAD_B)
+				{
+					if (!m_cloud->hasColors())
+					{
+						m_pos = start;
+						return fail("The cloud has no colors");
+					}
+					needColors = true;
+				}
+				return addNode(Node(v.op));
+			}
+		}
+
+		if (name.compare("pi", Qt::CaseInsensitive) == 0)
+		{
+			return addNode(Node(LOAD_CONST, M_PI));
+		}
+
+		//scalar field (by index: sf0, sf1, etc.)
+		int sfIndex = -1;
+		if (name.startsWith("sf", Qt::CaseInsensitive) && name.length() > 2)
+		{
+			bool ok = false;
+			int index = name.mid(2).toInt(&ok);
+			if (ok && index >= 0 && index < static_cast<int>(m_cloud->getNumberOfScalarFields()))
+			{
+				sfIndex = index;
+			}
+		}
+		//scalar field (by name)
+		if (sfIndex < 0)
+		{
+			sfIndex = m_cloud->getScalarFieldIndexByName(qPrintable(name));
+		}
+		if (sfIndex < 0)
+		{
+			m_pos = start;
+			return fail(QString("Unknown variable or scalar field '%1'").arg(name));
+		}
+
+		Node node(LOAD_SF);
+		node.sfIndex = sfIndex;
+		return addNode(node);
+	}
+
+	const QString& m_text;
+	int m_pos;
+	const ccPointCloud* m_cloud;
+	std::vector<Node>& m_nodes;
+};
+
+ccScalarFieldExpression::ccScalarFieldExpression()
+	: m_registerCount(0)
+	, m_needColors(false)
+	, m_needNormals(false)
+{
+}
+
+void ccScalarFieldExpression::generate(const std::vector<Node>& nodes, int nodeIndex, int reg)
+{
+	const Node& node = nodes[nodeIndex];
+	m_registerCount = std::max(m_registerCount, reg + 1);
+
+	Instruction instruction;
+	instruction.op = node.op;
+	instruction.dst = reg;
+	instruction.src1 = reg;
+	instruction.src2 = reg + 1;
+	instruction.value = node.value;
+	instruction.sfIndex = node.sfIndex;
+
+	//the first operand is computed in the destination register, and the second one in the next register
+	if (node.left >= 0)
+	{
+		generate(nodes, node.left, reg);
+	}
+	if (node.right >= 0)
+	{
+		generate(nodes, node.right, reg + 1);
+	}
+
+	m_program.push_back(instruction);
+}
+
+bool ccScalarFieldExpression::compile(const QString& expression, const ccPointCloud* cloud, QString& errorMessage)
+{
+	m_expression = expression;
+	m_program.clear();
+	m_registerCount = 0;
+	m_needColors = m_needNormals = false;
+
+	if (!cloud)
+	{
+		assert(false);
+		errorMessage = "Invalid input cloud";
+		return false;
+	}
+
+	try
+	{
+		std::vector<Node> nodes;
+		Parser parser(expression, cloud, nodes);
+		int root = parser.parse();
+		if (root < 0)
+		{
+			errorMessage = parser.error;
+			return false;
+		}
+
+		generate(nodes, root, 0);
+		m_needColors = parser.needColors;
+		m_needNormals = parser.needNormals;
+	}
+	catch (const std::bad_alloc&)
+	{
+		errorMessage = "Not enough memory";
+		m_program.clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool ccScalarFieldExpression::evaluate(const ccPointCloud* cloud, CCLib::ScalarField* output) const
+{
+	if (!cloud || !output || !isValid())
+	{
+		assert(false);
+		return false;
+	}
+
+	if ((m_needColors && !cloud->hasColors()) || (m_needNormals && !cloud->hasNormals()))
+	{
+		assert(false);
+		return false;
+	}
+
+	unsigned pointCount = cloud->size();
+
+	//input scalar fields
+	std::vector<const ScalarType*> sfValues(cloud->getNumberOfScalarFields(), nullptr);
+	for (const Instruction& instruction : m_program)
+	{
+		if (instruction.op == LOAD_SF)
+		{
+			CCLib::ScalarField* sf = (instruction.sfIndex < static_cast<int>(sfValues.size()) ? cloud->getScalarField(instruction.sfIndex) : nullptr);
+			if (!sf || sf->currentSize() < pointCount)
+			{
+				//the cloud has changed since the expression has been compiled?
+				assert(false);
+				return false;
+			}
+			sfValues[instruction.sfIndex] = sf->data();
+		}
+	}
+
+	if (output->currentSize() != pointCount && !output->resizeSafe(pointCount))
+	{
+		//not enough memory
+		return false;
+	}
+	ScalarType* outValues = output->data();
+
+	std::atomic<bool> error(false);
+	int chunkCount = static_cast<int>((pointCount + s_chunkSize - 1) / s_chunkSize);
+
+#ifdef USE_TBB
+	tbb::parallel_for(0, chunkCount, [&](int c)
+#else
+	for (int c = 0; c < chunkCount; ++c)
+#endif
+	{
+		std::vector<double> registers;
+		try
+		{
+			registers.resize(static_cast<size_t>(m_registerCount) * s_blockSize);
+		}
+		catch (const std::bad_alloc&)
+		{
+			error = true;
+		}
+
+		unsigned chunkStart = static_cast<unsigned>(c) * s_chunkSize;
+		unsigned chunkStop = std::min(chunkStart + s_chunkSize, pointCount);
+		for (unsigned first = chunkStart; first < chunkStop && !error; first += s_blockSize)
+		{
+			unsigned count = std::min(s_blockSize, chunkStop - first);
+
+			for (const Instruction& instruction : m_program)
+			{
+				double* dst = registers.data() + static_cast<size_t>(instruction.dst) * s_blockSize;
+				const double* a = registers.data() + static_cast<size_t>(instruction.src1) * s_blockSize;
+				const double* b = (instruction.src2 < m_registerCount ? registers.data() + static_cast<size_t>(instruction.src2) * s_blockSize : nullptr);
+
+				switch (instruction.op)
+				{
+				case LOAD_CONST:
+					std::fill(dst, dst + count, instruction.value);
+					break;
+				case LOAD_SF:
+				{
+					const ScalarType* values = sfValues[instruction.sfIndex] + first;
+					for (unsigned k = 0; k < count; ++k)
+						dst[k] = values[k];
+				}
+				break;
+				case LOAD_X:
+				case LOAD_Y:
+				case LOAD_Z:
+				{
+					unsigned char dim = static_cast<unsigned char>(instruction.op - LOAD_X);
+					for (unsigned k = 0; k < count; ++k)
+						dst[k] = cloud->getPoint(first + k)->u[dim];
+				}
+				break;
+				case LOAD_NX:
+				case LOAD_NY:
+				case LOAD_NZ:
+				{
+					unsigned char dim = static_cast<unsigned char>(instruction.op - LOAD_NX);
+					for (unsigned k = 0; k < count; ++k)
+						dst[k] = cloud->getPointNormal(first + k).u[dim];
+				}
+				break;
+				case LOAD_R:
+					for (unsigned k = 0; k < count; ++k)
+						dst[k] = cloud->getPointColor(first + k).r;
+					break;
+				case LOAD_G:
+					for (unsigned k = 0; k < count; ++k)
+						dst[k] = cloud->getPointColor(first + k).g;
+					break;
+				case LOAD_B:
+					for (unsigned k = 0; k < count; ++k)
+						dst[k] = cloud->getPointColor(first + k).b;
+					break;
+
+				case NEG:
+					UnaryBlock(dst, a, count, [](double v) { return -v; });
+					break;
+				case SQRT:
+					UnaryBlock(dst, a, count, OpSqrt);
+					break;
+				case EXP:
+					UnaryBlock(dst, a, count, [](double v) { return std::exp(v); });
+					break;
+				case LOG:
+					UnaryBlock(dst, a, count, OpLog);
+					break;
+				case LOG10:
+					UnaryBlock(dst, a, count, OpLog10);
+					break;
+				case COS:
+					UnaryBlock(dst, a, count, [](double v) { return std::cos(v); });
+					break;
+				case SIN:
+					UnaryBlock(dst, a, count, [](double v) { return std::sin(v); });
+					break;
+				case TAN:
+					UnaryBlock(dst, a, count, [](double v) { return std::tan(v); });
+					break;
+				case ACOS:
+					UnaryBlock(dst, a, count, OpAcos);
+					break;
+				case ASIN:
+					UnaryBlock(dst, a, count, OpAsin);
+					break;
+				case ATAN:
+					UnaryBlock(dst, a, count, [](double v) { return std::atan(v); });
+					break;
+				case INT:
+					UnaryBlock(dst, a, count, [](double v) { return std::trunc(v); });
+					break;
+				case ABS:
+					UnaryBlock(dst, a, count, [](double v) { return std::abs(v); });
+					break;
+				case INVERSE:
+					UnaryBlock(dst, a, count, OpInverse);
+					break;
+
+				case ADD:
+					BinaryBlock(dst, a, b, count, [](double u, double v) { return u + v; });
+					break;
+				case SUB:
+					BinaryBlock(dst, a, b, count, [](double u, double v) { return u - v; });
+					break;
+				case MUL:
+					BinaryBlock(dst, a, b, count, [](double u, double v) { return u * v; });
+					break;
+				case DIV:
+					BinaryBlock(dst, a, b, count, OpDiv);
+					break;
+				case POW:
+					BinaryBlock(dst, a, b, count, [](double u, double v) { return std::pow(u, v); });
+					break;
+				case MIN:
+					BinaryBlock(dst, a, b, count, OpMin);
+					break;
+				case MAX:
+					BinaryBlock(dst, a, b, count, OpMax);
+					break;
+				case ATAN2:
+					BinaryBlock(dst, a, b, count, [](double u, double v) { return std::atan2(u, v); });
+					break;
+				}
+			}
+
+			//the result is always in the first register
+			for (unsigned k = 0; k < count; ++k)
+			{
+				outValues[first + k] = static_cast<ScalarType>(registers[k]);
+			}
+		}
+	}
+#ifdef USE_TBB
+	);
+#endif
+
+	return !error;
+}
+
+int ccScalarFieldExpression::Apply(ccPointCloud* cloud, const QString& expression, const QString& outputSFName, QString& errorMessage)
+{
+	if (!cloud || outputSFName.isEmpty())
+	{
+		assert(false);
+		errorMessage = "Invalid input";
+		return -1;
+	}
+
+	ccScalarFieldExpression program;
+	if (!program.compile(expression, cloud, errorMessage))
+	{
+		return -1;
+	}
+
+	//output SF (it can be one of the inputs, as the values are read before being written)
+	int sfIdx = cloud->getScalarFieldIndexByName(qPrintable(outputSFName));
+	bool newSF = (sfIdx < 0);
+	if (newSF)
+	{
+		sfIdx = cloud->addScalarField(qPrintable(outputSFName));
+		if (sfIdx < 0)
+		{
+			errorMessage = "Failed to create the output scalar field (not enough memory?)";
+			return -1;
+		}
+	}
+	CCLib::ScalarField* sf = cloud->getScalarField(sfIdx);
+	assert(sf);
+
+	if (!program.evaluate(cloud, sf))
+	{
+		errorMessage = "Not enough memory";
+		if (newSF)
+		{
+			cloud->deleteScalarField(sfIdx);
+		}
+		return -1;
+	}
+
+	sf->computeMinAndMax();
+	cloud->setCurrentDisplayedScalarField(sfIdx);
+
+	return sfIdx;
+}
@@ -0,0 +1,146 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_SCALAR_FIELD_EXPRESSION_HEADER
+#define CC_SCALAR_FIELD_EXPRESSION_HEADER
+
+//Qt
+#include <QString>
+
+//system
+#include <vector>
+
+class ccPointCloud;
+
+namespace CCLib
+{
+	class ScalarField;
+}
+
+//! Arithmetic expression over the scalar fields, coordinates, normals and colors of a cloud
+/** Syntax:
+	- numbers, operators + - * / ^ (power), parentheses and unary minus
+	- coordinates: x, y, z
+	- normals: nx, ny, nz
+	- colors: r, g, b (between 0 and 255)
+	- scalar fields: by name between brackets (e.g. [Intensity]) or by index (sf0, sf1, etc.).
+		A scalar field name without any space or operator can also be used directly.
+	- constant: pi
+	- functions with one argument: sqrt, exp, log, log10, cos, sin, tan, acos, asin, atan, int, abs, inverse
+	- functions with two arguments: min, max, pow, atan2
+
+	Invalid values (NaN) are propagated. As with ccScalarFieldArithmeticsDlg, divisions by
+	zero and values outside of a function domain give invalid values.
+
+	The expression is compiled once into a short program of 'vector' instructions. Each
+	instruction is applied on a whole block of values (simple loops that the compiler can
+	vectorize). The blocks of points are processed in parallel and the result is written
+	directly in the output scalar field, without any intermediate scalar field.
+**/
+class ccScalarFieldExpression
+{
+public:
+
+	//! Default constructor
+	ccScalarFieldExpression();
+
+	//! Compiles an expression for a given cloud
+	/** \param expression expression
+		\param cloud cloud (to resolve the scalar fields names and check the colors/normals)
+		\param[out] errorMessage error message (if any)
+		\return success
+	**/
+	bool compile(const QString& expression, const ccPointCloud* cloud, QString& errorMessage);
+
+	//! Returns whether the expression has been successfully compiled
+	inline bool isValid() const { return !m_program.empty(); }
+
+	//! Returns the (compiled) expression
+	inline const QString& expression() const { return m_expression; }
+
+	//! Evaluates the (compiled) expression for all the points of a cloud
+	/** \param cloud cloud (should be the one used to compile the expression)
+		\param output output scalar field (will be resized if necessary). Can be one of the input scalar fields.
+		\return success
+	**/
+	bool evaluate(const ccPointCloud* cloud, CCLib::ScalarField* output) const;
+
+	//! Compiles and evaluates an expression on a cloud
+	/** \param cloud cloud
+		\param expression expression
+		\param outputSFName output scalar field name (the scalar field is created if necessary, or overwritten)
+		\param[out] errorMessage error message (if any)
+		\return the output scalar field index (or -1 if an error occurred)
+	**/
+	static int Apply(ccPointCloud* cloud, const QString& expression, const QString& outputSFName, QString& errorMessage);
+
+	//! Operation codes
+	enum OpCode {	//loads
+					LOAD_CONST, LOAD_SF, LOAD_X, LOAD_Y, LOAD_Z, LOAD_NX, LOAD_NY, LOAD_NZ, LOAD_R, LOAD_G, LOAD_B,
+					//unary operations
+					NEG, SQRT, EXP, LOG, LOG10, COS, SIN, TAN, ACOS, ASIN, ATAN, INT, ABS, INVERSE,
+					//binary operations
+					ADD, SUB, MUL, DIV, POW, MIN, MAX, ATAN2
+	};
+
+protected:
+
+	//! Expression tree node (parsing)
+	struct Node
+	{
+		Node(OpCode o = LOAD_CONST, double v = 0.0) : op(o), value(v), sfIndex(-1), left(-1), right(-1) {}
+
+		OpCode op;
+		double value;
+		int sfIndex;
+		int left;
+		int right;
+	};
+
+	//! Program instruction
+	struct Instruction
+	{
+		OpCode op;
+		//! Destination register
+		int dst;
+		//! Operand registers
+		int src1, src2;
+		//! Constant value (LOAD_CONST)
+		double value;
+		//! Scalar field index (LOAD_SF)
+		int sfIndex;
+	};
+
+	//! Parser state
+	struct Parser;
+
+	//! Generates the instructions of a given node (recursive)
+	void generate(const std::vector<Node>& nodes, int nodeIndex, int reg);
+
+	//! Original expression
+	QString m_expression;
+	//! Program
+	std::vector<Instruction> m_program;
+	//! Number of registers
+	int m_registerCount;
+	//! Whether the program needs the cloud colors
+	bool m_needColors;
+	//! Whether the program needs the cloud normals
+	bool m_needNormals;
+};
+
+#endif //CC_SCALAR_FIELD_EXPRESSION_HEADER
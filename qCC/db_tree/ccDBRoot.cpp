@@ -192,6 +192,7 @@ private:
 		mIconMap = {
 			{ CC_TYPES::HIERARCHY_OBJECT, hObjectIndex },
 			{ CC_TYPES::POINT_CLOUD, cloudIndex },
+			{ CC_TYPES::SUB_CLOUD, cloudIndex },
 			{ CC_TYPES::PLANE, geomIndex },
 			{ CC_TYPES::SPHERE, geomIndex },
 			{ CC_TYPES::TORUS, geomIndex },
@@ -1855,6 +1856,7 @@ void ccDBRoot::selectByTypeAndName()
 {
 	ccSelectChildrenDlg scDlg(MainWindow::TheInstance());
 	scDlg.addType("Point cloud",       CC_TYPES::POINT_CLOUD);
+	scDlg.addType("  Sub-cloud",       CC_TYPES::SUB_CLOUD);
 	scDlg.addType("Poly-line",         CC_TYPES::POLY_LINE);
 	scDlg.addType("Mesh",              CC_TYPES::MESH);
 	scDlg.addType("  Sub-mesh",        CC_TYPES::SUB_MESH);
@@ -21,6 +21,7 @@
 #include <CloudSamplingTools.h>
 #include <Delaunay2dMesh.h>
 #include <Jacobi.h>
+#include <MeshAdjacency.h>
 #include <MeshSamplingTools.h>
 #include <NormalDistribution.h>
 #include <ParallelSort.h>
@@ -47,6 +48,7 @@
 #include <ccProgressDialog.h>
 #include <ccQuadric.h>
 #include <ccSphere.h>
+#include <ccSubCloud.h>
 #include <ccSubMesh.h>
 
 //qCC_io
@@ -940,7 +942,7 @@ void MainWindow::doActionResampleWithOctree()
 		/*if (ent->isKindOf(CC_TYPES::MESH)) //TODO
 			cloud = ccHObjectCaster::ToGenericMesh(ent)->getAssociatedCloud();
 		else */
-		if (entity->isKindOf(CC_TYPES::POINT_CLOUD))
+		if (entity->isA(CC_TYPES::POINT_CLOUD))
 		{
 			cloud = static_cast<ccPointCloud*>(entity);
 		}
@@ -1591,7 +1593,19 @@ void MainWindow::doActionFlagMeshVertices()
 				CCLib::ScalarField* flags = vertices->getScalarField(sfIdx);
 
 				CCLib::MeshSamplingTools::EdgeConnectivityStats stats;
-				if (CCLib::MeshSamplingTools::flagMeshVerticesByType(mesh,flags,&stats))
+				bool flagged = false;
+				if (mesh->isA(CC_TYPES::MESH))
+				{
+					//use the (cached) adjacency structure
+					const CCLib::MeshAdjacency* adjacency = static_cast<ccMesh*>(mesh)->getAdjacency();
+					flagged = (adjacency && CCLib::MeshSamplingTools::flagMeshVerticesByType(*adjacency, flags, &stats));
+				}
+				else
+				{
+					flagged = CCLib::MeshSamplingTools::flagMeshVerticesByType(mesh, flags, &stats);
+				}
+
+				if (flagged)
 				{
 					vertices->setCurrentDisplayedScalarField(sfIdx);
 					ccScalarField* sf = vertices->getCurrentDisplayedScalarField();
@@ -1656,7 +1670,8 @@ void MainWindow::doActionMeasureMeshVolume()
 
 				//check that the mesh is closed
 				CCLib::MeshSamplingTools::EdgeConnectivityStats stats;
-				if (CCLib::MeshSamplingTools::computeMeshEdgesConnectivity(mesh, stats))
+				const CCLib::MeshAdjacency* adjacency = mesh->getAdjacency();
+				if (adjacency && CCLib::MeshSamplingTools::computeMeshEdgesConnectivity(*adjacency, stats))
 				{
 					if (stats.edgesNotShared != 0)
 					{
@@ -2487,28 +2502,26 @@ void MainWindow::doActionComputePointsVisibility()
 
 		//progress bar
 		ccProgressDialog pdlg(true);
-		CCLib::NormalizedProgress nprogress(&pdlg,pointCloud->size());
 		pdlg.setMethodTitle(tr("Compute visibility"));
 		pdlg.setInfo(tr("Points: %L1").arg( pointCloud->size() ));
 		pdlg.start();
 		QApplication::processEvents();
 
-		for (unsigned i = 0; i < pointCloud->size(); i++)
+		//all the points are tested at once (in parallel)
+		std::vector<unsigned char> visibility;
+		if (sensor->checkVisibility(pointCloud, visibility, &pdlg))
 		{
-			const CCVector3* P = pointCloud->getPoint(i);
-			unsigned char visibility = sensor->checkVisibility(*P);
-			ScalarType visValue = static_cast<ScalarType>(visibility);
-
-			sf->setValue(i, visValue);
-
-			if (!nprogress.oneStep())
+			for (unsigned i = 0; i < pointCloud->size(); i++)
 			{
-				//cancelled by user
-				pointCloud->deleteScalarField(sfIdx);
-				sf = nullptr;
-				break;
+				sf->setValue(i, static_cast<ScalarType>(visibility[i]));
 			}
 		}
+		else
+		{
+			//cancelled by user (or not enough memory)
+			pointCloud->deleteScalarField(sfIdx);
+			sf = nullptr;
+		}
 
 		if (sf)
 		{
@@ -6183,7 +6196,7 @@ void MainWindow::deactivateSegmentationMode(bool state)
 			{
 				//first, do the things that must absolutely be done BEFORE removing the entity from DB (even temporarily)
 				//bool lockedVertices;
-				ccPointCloud* cloud = ccHObjectCaster::ToPointCloud(entity/*,&lockedVertices*/);
+				ccGenericPointCloud* cloud = ccHObjectCaster::ToGenericPointCloud(entity/*,&lockedVertices*/);
 				assert(cloud);
 				if (cloud)
 				{
@@ -10370,7 +10383,7 @@ void MainWindow::doActionCompressFWFData()
 {
 	for ( ccHObject *entity : getSelectedEntities() )
 	{
-		if (!entity || !entity->isKindOf(CC_TYPES::POINT_CLOUD))
+		if (!entity || !entity->isA(CC_TYPES::POINT_CLOUD))
 		{
 			continue;
 		}
@@ -10386,7 +10399,7 @@ void MainWindow::doActionShowWaveDialog()
 		return;
 
 	ccHObject* entity = haveOneSelection() ? m_selectedEntities[0] : nullptr;
-	if (!entity || !entity->isKindOf(CC_TYPES::POINT_CLOUD))
+	if (!entity || !entity->isA(CC_TYPES::POINT_CLOUD))
 	{
 		ccConsole::Error("Select one point cloud!");
 		return;